@@ -780,6 +780,14 @@ typedef struct {
 				      * PACK for state file)*/
 	List user_limit_list; /* slurmdb_used_limits_t's (DON'T PACK
 			       * for state file) */
+	void **acct_limit_hash; /* acct_limit_list indexed by account
+				 * (DON'T PACK for state file) */
+	uint32_t acct_limit_hash_cnt;  /* records in acct_limit_hash */
+	uint32_t acct_limit_hash_size; /* slots in acct_limit_hash */
+	void **user_limit_hash; /* user_limit_list indexed by uid
+				 * (DON'T PACK for state file) */
+	uint32_t user_limit_hash_cnt;  /* records in user_limit_hash */
+	uint32_t user_limit_hash_size; /* slots in user_limit_hash */
 } slurmdb_qos_usage_t;
 
 typedef struct {
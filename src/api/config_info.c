@@ -1833,6 +1833,23 @@ slurm_load_slurmd_status(slurmd_status_t **slurmd_status_ptr)
 	return SLURM_PROTOCOL_SUCCESS;
 }
 
+static uint32_t _script_hist_cnt(uint32_t *hist)
+{
+	uint32_t cnt = 0;
+	int i;
+
+	for (i = 0; i < SLURMD_SCRIPT_HIST_CNT; i++)
+		cnt += hist[i];
+	return cnt;
+}
+
+static void _print_script_hist(FILE *out, char *label, uint32_t *hist)
+{
+	fprintf(out, "%s = %u/%u/%u/%u/%u/%u (<10ms/<100ms/<1s/<10s/<100s/"
+		"longer)\n", label, hist[0], hist[1], hist[2], hist[3],
+		hist[4], hist[5]);
+}
+
 /*
  * slurm_print_slurmd_status - output the contents of slurmd status
  *	message as loaded using slurm_load_slurmd_status
@@ -1880,6 +1897,72 @@ void slurm_print_slurmd_status (FILE* out,
 	} else
 		fprintf(out, "Last slurmctld msg time  = NONE\n");
 
+	if (slurmd_status_ptr->msg_aggr_window_msgs > 1) {
+		fprintf(out, "Msg aggr window          = %u msgs, %u msec%s\n",
+			slurmd_status_ptr->msg_aggr_window_msgs,
+			slurmd_status_ptr->msg_aggr_window_time,
+			slurmd_status_ptr->msg_aggr_adaptive ?
+			" (adaptive)" : "");
+		fprintf(out, "Msg aggr batches         = %u (%u failed), "
+			"%u msgs\n",
+			slurmd_status_ptr->msg_aggr_batch_cnt,
+			slurmd_status_ptr->msg_aggr_batch_fail,
+			slurmd_status_ptr->msg_aggr_msg_cnt);
+		fprintf(out, "Msg aggr mean arrival    = %u usec\n",
+			slurmd_status_ptr->msg_aggr_arrival_usec);
+		fprintf(out, "Msg aggr mean ack        = %u usec\n",
+			slurmd_status_ptr->msg_aggr_ack_usec);
+	}
+
+	if (slurmd_status_ptr->stepd_launch_cnt) {
+		fprintf(out, "Step launches            = %u (%u from zygote)\n",
+			slurmd_status_ptr->stepd_launch_cnt,
+			slurmd_status_ptr->stepd_launch_zygote);
+		fprintf(out, "Step launch latency      = %u/%u/%u usec "
+			"(p50/p90/p99)\n",
+			slurmd_status_ptr->stepd_launch_p50,
+			slurmd_status_ptr->stepd_launch_p90,
+			slurmd_status_ptr->stepd_launch_p99);
+	}
+
+	if (slurmd_status_ptr->id_cache_hits ||
+	    slurmd_status_ptr->id_cache_misses) {
+		fprintf(out, "User/group cache         = %u entries, %u hits, "
+			"%u misses, %u refreshes\n",
+			slurmd_status_ptr->id_cache_entries,
+			slurmd_status_ptr->id_cache_hits,
+			slurmd_status_ptr->id_cache_misses,
+			slurmd_status_ptr->id_cache_refreshes);
+		fprintf(out, "User/group lookup time   = %u usec mean, "
+			"%u usec max\n",
+			slurmd_status_ptr->id_cache_resolve_mean,
+			slurmd_status_ptr->id_cache_resolve_max);
+	}
+
+	if (slurmd_status_ptr->job_script_wait_mean ||
+	    slurmd_status_ptr->job_script_wait_max ||
+	    slurmd_status_ptr->epilog_msg_cnt ||
+	    _script_hist_cnt(slurmd_status_ptr->prolog_hist) ||
+	    _script_hist_cnt(slurmd_status_ptr->epilog_hist)) {
+		fprintf(out, "Prologs/epilogs          = %u running, "
+			"%u queued (max %u), %u timed out\n",
+			slurmd_status_ptr->job_script_running,
+			slurmd_status_ptr->job_script_queued,
+			slurmd_status_ptr->job_script_max,
+			slurmd_status_ptr->job_script_timeouts);
+		fprintf(out, "Prolog/epilog queue wait = %u usec mean, "
+			"%u usec max\n",
+			slurmd_status_ptr->job_script_wait_mean,
+			slurmd_status_ptr->job_script_wait_max);
+		_print_script_hist(out, "Prolog run times        ",
+				   slurmd_status_ptr->prolog_hist);
+		_print_script_hist(out, "Epilog run times        ",
+				   slurmd_status_ptr->epilog_hist);
+		fprintf(out, "Epilog complete msgs     = %u in %u sends\n",
+			slurmd_status_ptr->epilog_msg_cnt,
+			slurmd_status_ptr->epilog_msg_batches);
+	}
+
 	fprintf(out, "Slurmd PID               = %u\n",
 		slurmd_status_ptr->pid);
 	fprintf(out, "Slurmd Debug             = %u\n",
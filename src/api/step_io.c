@@ -84,6 +84,7 @@ static int      _read_io_init_msg(int fd, client_io_t *cio, char *host);
 static int      _wid(int n);
 static bool     _incoming_buf_free(client_io_t *cio);
 static bool     _outgoing_buf_free(client_io_t *cio);
+static void     _put_free_outgoing(client_io_t *cio, struct io_buf *msg);
 
 /**********************************************************************
  * Listening socket declarations
@@ -103,6 +104,9 @@ static bool _server_readable(eio_obj_t *obj);
 static int _server_read(eio_obj_t *obj, List objs);
 static bool _server_writable(eio_obj_t *obj);
 static int _server_write(eio_obj_t *obj, List objs);
+static int _server_read_batch(eio_obj_t *obj);
+static void _server_eof_msg(eio_obj_t *obj, uint16_t type);
+static void _server_route_msg(eio_obj_t *obj, struct io_buf *msg);
 
 struct io_operations server_ops = {
 	.readable = &_server_readable,
@@ -123,6 +127,9 @@ struct server_io_info {
 	bool in_eof;
 	int remote_stdout_objs; /* active eio_obj_t's on the remote node */
 	int remote_stderr_objs; /* active eio_obj_t's on the remote node */
+	char *batch;		/* body of a SLURM_IO_BATCH message */
+	uint32_t batch_len;
+	uint32_t batch_remaining;
 
 	/* outgoing variables */
 	List msg_queue;
@@ -291,6 +298,8 @@ _server_read(eio_obj_t *obj, List objs)
 	int n;
 
 	debug4("Entering _server_read");
+	if (s->batch)
+		return _server_read_batch(obj);
 	if (s->in_msg == NULL) {
 		if (_outgoing_buf_free(s->cio)) {
 			s->in_msg = list_dequeue(s->cio->free_outgoing);
@@ -315,38 +324,46 @@ _server_read(eio_obj_t *obj, List objs)
 			obj->fd = -1;
 			s->in_eof = true;
 			s->out_eof = true;
-			list_enqueue(s->cio->free_outgoing, s->in_msg);
+			_put_free_outgoing(s->cio, s->in_msg);
 			s->in_msg = NULL;
 			return SLURM_SUCCESS;
 		}
-		if (s->header.type == SLURM_IO_CONNECTION_TEST) {
+		if (s->header.type == SLURM_IO_BATCH) {
+			_put_free_outgoing(s->cio, s->in_msg);
+			s->in_msg = NULL;
+			if (s->header.length > IO_BATCH_MAX_LEN) {
+				error("%s: fd %d batched output of %u bytes "
+				      "exceeds maximum of %u", __func__,
+				      obj->fd, s->header.length,
+				      IO_BATCH_MAX_LEN);
+				if (s->cio->sls)
+					step_launch_notify_io_failure(
+						s->cio->sls, s->node_id);
+				close(obj->fd);
+				obj->fd = -1;
+				s->in_eof = true;
+				s->out_eof = true;
+				return SLURM_SUCCESS;
+			}
+			if (s->header.length == 0)
+				return SLURM_SUCCESS;
+			s->batch_len = s->header.length;
+			s->batch_remaining = s->header.length;
+			s->batch = xmalloc(s->batch_len);
+			return _server_read_batch(obj);
+
+		} else if (s->header.type == SLURM_IO_CONNECTION_TEST) {
 			if (s->cio->sls)
 				step_launch_clear_questionable_state(
 					s->cio->sls, s->node_id);
-			list_enqueue(s->cio->free_outgoing, s->in_msg);
+			_put_free_outgoing(s->cio, s->in_msg);
 			s->in_msg = NULL;
 			s->testing_connection = false;
 			return SLURM_SUCCESS;
 
 		} else if (s->header.length == 0) { /* eof message */
-			if (s->header.type == SLURM_IO_STDOUT) {
-				s->remote_stdout_objs--;
-				debug3( "got eof-stdout msg on _server_read "
-					"header");
-			} else if (s->header.type == SLURM_IO_STDERR) {
-				s->remote_stderr_objs--;
-				debug3( "got eof-stderr msg on _server_read "
-					"header");
-			} else
-				error("Unrecognized output message type");
-			/* If all remote eios are gone, shutdown
-			 * the i/o channel with stepd.
-			 */
-			if (s->remote_stdout_objs == 0
-				&& s->remote_stderr_objs == 0) {
-				obj->shutdown = true;
-			}
-			list_enqueue(s->cio->free_outgoing, s->in_msg);
+			_server_eof_msg(obj, s->header.type);
+			_put_free_outgoing(s->cio, s->in_msg);
 			s->in_msg = NULL;
 			return SLURM_SUCCESS;
 		}
@@ -390,7 +407,7 @@ _server_read(eio_obj_t *obj, List objs)
 			obj->fd = -1;
 			s->in_eof = true;
 			s->out_eof = true;
-			list_enqueue(s->cio->free_outgoing, s->in_msg);
+			_put_free_outgoing(s->cio, s->in_msg);
 			s->in_msg = NULL;
 			return SLURM_SUCCESS;
 		}
@@ -403,31 +420,139 @@ _server_read(eio_obj_t *obj, List objs)
 		debug3("***** passing on eof message");
 	}
 
-	/*
-	 * Route the message to the proper output
-	 */
-	{
-		eio_obj_t *obj;
-		struct file_write_info *info;
+	_server_route_msg(obj, s->in_msg);
+	s->in_msg = NULL;
 
-		s->in_msg->ref_count = 1;
-		if (s->in_msg->header.type == SLURM_IO_STDOUT)
-			obj = s->cio->stdout_obj;
-		else
-			obj = s->cio->stderr_obj;
-		info = (struct file_write_info *) obj->arg;
-		if (info->eof)
-			/* this output is closed, discard message */
-			list_enqueue(s->cio->free_outgoing, s->in_msg);
-		else
-			list_enqueue(info->msg_queue, s->in_msg);
+	return SLURM_SUCCESS;
+}
 
-		s->in_msg = NULL;
+/*
+ * Read the body of a SLURM_IO_BATCH message and, once complete, split it
+ * back into the individually framed messages it carries.
+ */
+static int
+_server_read_batch(eio_obj_t *obj)
+{
+	struct server_io_info *s = (struct server_io_info *) obj->arg;
+	struct slurm_io_header header;
+	struct io_buf *msg;
+	Buf buffer;
+	int n;
+
+again:
+	if ((n = read(obj->fd, s->batch + (s->batch_len - s->batch_remaining),
+		      s->batch_remaining)) < 0) {
+		if (errno == EINTR)
+			goto again;
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+			return SLURM_SUCCESS;
+		debug3("%s error: %m", __func__);
+	}
+	if (n <= 0) { /* got eof or unhandled error */
+		error("%s: fd %d got error or unexpected eof reading batched "
+		      "output", __func__, obj->fd);
+		if (s->cio->sls)
+			step_launch_notify_io_failure(s->cio->sls, s->node_id);
+		close(obj->fd);
+		obj->fd = -1;
+		s->in_eof = true;
+		s->out_eof = true;
+		xfree(s->batch);
+		return SLURM_SUCCESS;
+	}
+	s->batch_remaining -= n;
+	if (s->batch_remaining > 0)
+		return SLURM_SUCCESS;
+
+	buffer = create_buf(s->batch, s->batch_len);
+	s->batch = NULL;
+	while (remaining_buf(buffer) > 0) {
+		if ((io_hdr_unpack(&header, buffer) != SLURM_SUCCESS) ||
+		    (header.length > MAX_MSG_LEN) ||
+		    (header.length > remaining_buf(buffer))) {
+			error("%s: fd %d invalid message in batched output",
+			      __func__, obj->fd);
+			break;
+		}
+		if (header.type == SLURM_IO_CONNECTION_TEST) {
+			if (s->cio->sls)
+				step_launch_clear_questionable_state(
+					s->cio->sls, s->node_id);
+			s->testing_connection = false;
+		} else if (header.length == 0) {
+			_server_eof_msg(obj, header.type);
+		} else {
+			/* _server_readable() only checks for one free
+			 * buffer, so a batch may exceed STDIO_MAX_FREE_BUF
+			 * by up to IO_BATCH_MAX_MSGS buffers */
+			if (!_outgoing_buf_free(s->cio)) {
+				list_enqueue(s->cio->free_outgoing,
+					     _alloc_io_buf());
+				s->cio->outgoing_count++;
+			}
+			msg = list_dequeue(s->cio->free_outgoing);
+			memcpy(msg->data, get_buf_data(buffer) +
+			       get_buf_offset(buffer), header.length);
+			msg->length = header.length;
+			msg->header = header;
+			_server_route_msg(obj, msg);
+			set_buf_offset(buffer,
+				       get_buf_offset(buffer) + header.length);
+		}
 	}
+	free_buf(buffer);
 
 	return SLURM_SUCCESS;
 }
 
+/* Handle a zero length (end of file) message of the given type */
+static void
+_server_eof_msg(eio_obj_t *obj, uint16_t type)
+{
+	struct server_io_info *s = (struct server_io_info *) obj->arg;
+
+	if (type == SLURM_IO_STDOUT) {
+		s->remote_stdout_objs--;
+		debug3("got eof-stdout msg on _server_read header");
+	} else if (type == SLURM_IO_STDERR) {
+		s->remote_stderr_objs--;
+		debug3("got eof-stderr msg on _server_read header");
+	} else
+		error("Unrecognized output message type");
+	/* If all remote eios are gone, shutdown
+	 * the i/o channel with stepd.
+	 */
+	if (s->remote_stdout_objs == 0
+		&& s->remote_stderr_objs == 0) {
+		obj->shutdown = true;
+	}
+}
+
+/*
+ * Route the message to the proper output
+ */
+static void
+_server_route_msg(eio_obj_t *obj, struct io_buf *msg)
+{
+	struct server_io_info *s = (struct server_io_info *) obj->arg;
+	eio_obj_t *out_obj;
+	struct file_write_info *info;
+
+	msg->ref_count = 1;
+	if (msg->header.type == SLURM_IO_STDOUT)
+		out_obj = s->cio->stdout_obj;
+	else
+		out_obj = s->cio->stderr_obj;
+	info = (struct file_write_info *) out_obj->arg;
+	if (info->eof)
+		/* this output is closed, discard message */
+		_put_free_outgoing(s->cio, msg);
+	else {
+		list_enqueue(info->msg_queue, msg);
+		eio_obj_changed(out_obj);
+	}
+}
+
 static bool
 _server_writable(eio_obj_t *obj)
 {
@@ -515,6 +640,8 @@ again:
 		slurm_mutex_lock(&s->cio->ioservers_lock);
 		list_enqueue(s->cio->free_incoming, s->out_msg);
 		slurm_mutex_unlock(&s->cio->ioservers_lock);
+		if (s->cio->stdin_obj)
+			eio_obj_changed(s->cio->stdin_obj);
 	} else
 		debug3("  Could not free msg!!");
 	s->out_msg = NULL;
@@ -596,7 +723,7 @@ static int _file_write(eio_obj_t *obj, List objs)
 					        info->out_msg->header.gtaskid,
 					        info->cio->label,
 					        info->cio->label_width)) < 0) {
-			list_enqueue(info->cio->free_outgoing, info->out_msg);
+			_put_free_outgoing(info->cio, info->out_msg);
 			info->eof = true;
 			return SLURM_ERROR;
 		}
@@ -611,7 +738,7 @@ static int _file_write(eio_obj_t *obj, List objs)
 	 */
 	info->out_msg->ref_count--;
 	if (info->out_msg->ref_count == 0)
-		list_enqueue(info->cio->free_outgoing, info->out_msg);
+		_put_free_outgoing(info->cio, info->out_msg);
 	info->out_msg = NULL;
 	debug2("Leaving  _file_write");
 
@@ -756,6 +883,7 @@ again:
 			else {
 				server = info->cio->ioserver[i]->arg;
 				list_enqueue(server->msg_queue, msg);
+				eio_obj_changed(info->cio->ioserver[i]);
 			}
 		}
 	} else if (header.type == SLURM_IO_STDIN) {
@@ -771,6 +899,7 @@ again:
 		} else {
 			server = info->cio->ioserver[nodeid]->arg;
 			list_enqueue(server->msg_queue, msg);
+			eio_obj_changed(info->cio->ioserver[nodeid]);
 		}
 	} else {
 		fatal("Unsupported header.type");
@@ -862,6 +991,9 @@ _read_io_init_msg(int fd, client_io_t *cio, char *host)
 	 */
 	eio_new_initial_obj(cio->eio, cio->ioserver[msg.nodeid]);
 	slurm_mutex_unlock(&cio->ioservers_lock);
+	/* stdin is only read once every node has connected */
+	if (cio->stdin_obj)
+		eio_obj_changed(cio->stdin_obj);
 
 	if (cio->sls)
 		step_launch_clear_questionable_state(cio->sls, msg.nodeid);
@@ -1048,6 +1180,23 @@ _incoming_buf_free(client_io_t *cio)
 	return false;
 }
 
+/* Put a message back on the free List. Servers are not readable while the
+ * List is empty, so ask them again once it no longer is. */
+static void
+_put_free_outgoing(client_io_t *cio, struct io_buf *msg)
+{
+	bool was_empty = list_is_empty(cio->free_outgoing);
+	int i;
+
+	list_enqueue(cio->free_outgoing, msg);
+	if (!was_empty)
+		return;
+	for (i = 0; i < cio->num_nodes; i++) {
+		if (cio->ioserver[i])
+			eio_obj_changed(cio->ioserver[i]);
+	}
+}
+
 static bool
 _outgoing_buf_free(client_io_t *cio)
 {
@@ -1085,7 +1234,7 @@ client_io_handler_create(slurm_step_io_fds_t fds,
 	client_io_t *cio;
 	int i;
 	uint32_t siglen;
-	char *sig;
+	char *sig, *launch_params;
 	uint16_t *ports;
 	uint16_t eio_timeout;
 
@@ -1112,6 +1261,10 @@ client_io_handler_create(slurm_step_io_fds_t fds,
 
 	eio_timeout = slurm_get_srun_eio_timeout();
 	cio->eio = eio_handle_create(eio_timeout);
+	launch_params = slurm_get_launch_params();
+	if (launch_params && strstr(launch_params, "eio_epoll"))
+		(void) eio_handle_use_epoll(cio->eio);
+	xfree(launch_params);
 
 	/* Compute number of listening sockets needed to allow
 	 * all of the slurmds to establish IO streams with srun, without
@@ -1324,6 +1477,8 @@ client_io_handler_abort(client_io_t *cio)
 		}
 	}
 	slurm_mutex_unlock(&cio->ioservers_lock);
+
+	eio_signal_wakeup(cio->eio);
 }
 
 
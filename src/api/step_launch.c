@@ -185,6 +185,7 @@ int slurm_step_launch (slurm_step_ctx_t *ctx,
 	int i;
 	char **env = NULL;
 	char **mpi_env = NULL;
+	char *launch_params;
 	int rc = SLURM_SUCCESS;
 
 	debug("Entering slurm_step_launch");
@@ -320,6 +321,10 @@ int slurm_step_launch (slurm_step_ctx_t *ctx,
 			launch.flags	|= LAUNCH_BUFFERED_IO;
 		if (params->labelio)
 			launch.flags	|= LAUNCH_LABEL_IO;
+		launch_params = slurm_get_launch_params();
+		if (launch_params && strstr(launch_params, "io_coalesce"))
+			launch.flags	|= LAUNCH_COALESCE_IO;
+		xfree(launch_params);
 		ctx->launch_state->io.normal =
 			client_io_handler_create(params->local_fds,
 						 ctx->step_req->num_tasks,
@@ -77,6 +77,15 @@
 
 #define MAX_THREADS      8	/* These can be huge messages, so
 				 * only run MAX_THREADS at one time */
+#define MAX_RETRIES     10	/* pthread_create retries */
+
+/* One data block being distributed in swarm mode. Each block is seeded to
+ * a different node of the allocation, which then serves it to the others */
+typedef struct swarm_block {
+	file_bcast_msg_t *bcast_msg;	/* private copy of message and data */
+	int head_inx;			/* index of node seeding this block */
+	struct bcast_parameters *params;
+} swarm_block_t;
 
 int block_len;				/* block size */
 int fd;					/* source file descriptor */
@@ -84,12 +93,21 @@ void *src;				/* source mmap'd address */
 struct stat f_stat;			/* source file stats */
 job_sbcast_cred_msg_t *sbcast_cred;	/* job alloc info and sbcast cred */
 
+static pthread_mutex_t swarm_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  swarm_cond  = PTHREAD_COND_INITIALIZER;
+static int swarm_active = 0;		/* blocks currently in flight */
+static int swarm_rc = SLURM_SUCCESS;	/* worst return code of any block */
+
 static int   _bcast_file(struct bcast_parameters *params);
 static int   _file_bcast(struct bcast_parameters *params,
-			 file_bcast_msg_t *bcast_msg,
-			 job_sbcast_cred_msg_t *sbcast_cred);
+			 file_bcast_msg_t *bcast_msg, char *node_list);
 static int   _file_state(struct bcast_parameters *params);
 static int  _get_job_info(struct bcast_parameters *params);
+static int   _swarm_bcast_block(struct bcast_parameters *params,
+				file_bcast_msg_t *bcast_msg, int head_inx);
+static void  _swarm_queue_block(struct bcast_parameters *params,
+				file_bcast_msg_t *bcast_msg, int head_inx);
+static int   _swarm_wait(int max_active);
 
 
 static int _file_state(struct bcast_parameters *params)
@@ -164,10 +182,9 @@ static int _get_job_info(struct bcast_parameters *params)
 	return rc;
 }
 
-/* Issue the RPC to transfer the file's data */
+/* Issue the RPC to transfer the file's data to every node in node_list */
 static int _file_bcast(struct bcast_parameters *params,
-		       file_bcast_msg_t *bcast_msg,
-		       job_sbcast_cred_msg_t *sbcast_cred)
+		       file_bcast_msg_t *bcast_msg, char *node_list)
 {
 	List ret_list = NULL;
 	ListIterator itr;
@@ -179,8 +196,7 @@ static int _file_bcast(struct bcast_parameters *params,
 	msg.data = bcast_msg;
 	msg.msg_type = REQUEST_FILE_BCAST;
 
-	ret_list = slurm_send_recv_msgs(
-		sbcast_cred->node_list, &msg, params->timeout, true);
+	ret_list = slurm_send_recv_msgs(node_list, &msg, params->timeout, true);
 	if (ret_list == NULL) {
 		error("slurm_send_recv_msgs: %m");
 		exit(1);
@@ -204,6 +220,170 @@ static int _file_bcast(struct bcast_parameters *params,
 	return rc;
 }
 
+/*
+ * Transfer one block in swarm mode. The block is sent once to the node at
+ * head_inx, which forwards it to the remainder of the allocation using its
+ * own forwarding tree. Rotating head_inx from block to block spreads the
+ * work of serving data across every node rather than the originating node.
+ */
+static int _swarm_bcast_block(struct bcast_parameters *params,
+			      file_bcast_msg_t *bcast_msg, int head_inx)
+{
+	List ret_list = NULL;
+	ListIterator itr;
+	ret_data_info_t *ret_data_info = NULL;
+	hostlist_t hl, failed_hl;
+	char *head_name, *failed_list;
+	int rc = SLURM_SUCCESS, msg_rc, ret_cnt, timeout;
+	slurm_msg_t msg;
+
+	hl = hostlist_create(sbcast_cred->node_list);
+	head_name = hostlist_nth(hl, head_inx);
+	hostlist_delete_nth(hl, head_inx);
+
+	slurm_msg_t_init(&msg);
+	msg.data = bcast_msg;
+	msg.msg_type = REQUEST_FILE_BCAST;
+	if (slurm_conf_get_addr(head_name, &msg.address) == SLURM_ERROR) {
+		debug("%s: can't find address for host %s, using tree",
+		      __func__, head_name);
+		free(head_name);
+		hostlist_destroy(hl);
+		return _file_bcast(params, bcast_msg, sbcast_cred->node_list);
+	}
+
+	if (params->timeout > 0)
+		timeout = params->timeout;
+	else
+		timeout = slurm_get_msg_timeout() * 1000;
+	msg.forward.timeout = timeout;
+	if ((msg.forward.cnt = hostlist_count(hl)))
+		msg.forward.nodelist = hostlist_ranged_string_xmalloc(hl);
+	hostlist_destroy(hl);
+
+	ret_list = slurm_send_addr_recv_msgs(&msg, head_name, timeout);
+	xfree(msg.forward.nodelist);
+	if (ret_list == NULL) {
+		error("slurm_send_addr_recv_msgs: %m");
+		exit(1);
+	}
+
+	/* The head node never got the block, so nobody else did either.
+	 * Writes are positioned by block_offset, so a resend is harmless. */
+	ret_cnt = list_count(ret_list);
+	if (ret_cnt <= msg.forward.cnt) {
+		debug("%s: seed node %s failed, block %u resent using tree",
+		      __func__, head_name, bcast_msg->block_no);
+		FREE_NULL_LIST(ret_list);
+		free(head_name);
+		return _file_bcast(params, bcast_msg, sbcast_cred->node_list);
+	}
+	free(head_name);
+
+	failed_hl = hostlist_create(NULL);
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		if (ret_data_info->type == RESPONSE_FORWARD_FAILED) {
+			hostlist_push_host(failed_hl, ret_data_info->node_name);
+			continue;
+		}
+		msg_rc = slurm_get_return_code(ret_data_info->type,
+					       ret_data_info->data);
+		if (msg_rc == SLURM_SUCCESS)
+			continue;
+
+		error("REQUEST_FILE_BCAST(%s): %s",
+		      ret_data_info->node_name,
+		      slurm_strerror(msg_rc));
+		rc = MAX(rc, msg_rc);
+	}
+	list_iterator_destroy(itr);
+	FREE_NULL_LIST(ret_list);
+
+	/* Nodes lost somewhere in the seed's tree get the block directly */
+	if ((rc == SLURM_SUCCESS) && hostlist_count(failed_hl)) {
+		failed_list = hostlist_ranged_string_xmalloc(failed_hl);
+		debug("%s: block %u resent to %s",
+		      __func__, bcast_msg->block_no, failed_list);
+		rc = _file_bcast(params, bcast_msg, failed_list);
+		xfree(failed_list);
+	}
+	hostlist_destroy(failed_hl);
+
+	return rc;
+}
+
+static void *_swarm_thread(void *arg)
+{
+	swarm_block_t *swarm_block = (swarm_block_t *) arg;
+	int rc;
+
+	rc = _swarm_bcast_block(swarm_block->params, swarm_block->bcast_msg,
+				swarm_block->head_inx);
+
+	xfree(swarm_block->bcast_msg->block);
+	xfree(swarm_block->bcast_msg);
+	xfree(swarm_block);
+
+	slurm_mutex_lock(&swarm_mutex);
+	swarm_rc = MAX(swarm_rc, rc);
+	swarm_active--;
+	slurm_cond_broadcast(&swarm_cond);
+	slurm_mutex_unlock(&swarm_mutex);
+
+	return NULL;
+}
+
+/* Start transferring a copy of bcast_msg (and its data) in the background */
+static void _swarm_queue_block(struct bcast_parameters *params,
+			       file_bcast_msg_t *bcast_msg, int head_inx)
+{
+	pthread_attr_t attr;
+	pthread_t thread_id;
+	swarm_block_t *swarm_block;
+	int retries = 0;
+
+	swarm_block = xmalloc(sizeof(swarm_block_t));
+	swarm_block->params = params;
+	swarm_block->head_inx = head_inx;
+	swarm_block->bcast_msg = xmalloc(sizeof(file_bcast_msg_t));
+	memcpy(swarm_block->bcast_msg, bcast_msg, sizeof(file_bcast_msg_t));
+	swarm_block->bcast_msg->block = xmalloc(bcast_msg->block_len);
+	memcpy(swarm_block->bcast_msg->block, bcast_msg->block,
+	       bcast_msg->block_len);
+
+	slurm_mutex_lock(&swarm_mutex);
+	swarm_active++;
+	slurm_mutex_unlock(&swarm_mutex);
+
+	slurm_attr_init(&attr);
+	if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED))
+		error("pthread_attr_setdetachstate error %m");
+	while (pthread_create(&thread_id, &attr, _swarm_thread,
+			      (void *) swarm_block)) {
+		error("pthread_create error %m");
+		if (++retries > MAX_RETRIES)
+			fatal("Can't create pthread");
+		usleep(100000);	/* sleep and try again */
+	}
+	slurm_attr_destroy(&attr);
+}
+
+/* Wait until no more than max_active blocks are in flight,
+ * RET worst return code of any block completed so far */
+static int _swarm_wait(int max_active)
+{
+	int rc;
+
+	slurm_mutex_lock(&swarm_mutex);
+	while (swarm_active > max_active)
+		slurm_cond_wait(&swarm_cond, &swarm_mutex);
+	rc = swarm_rc;
+	slurm_mutex_unlock(&swarm_mutex);
+
+	return rc;
+}
+
 /* load a buffer with data from the file to broadcast,
  * return number of bytes read, zero on end of file */
 static int _get_block_none(char **buffer, int *orig_len, bool *more)
@@ -373,6 +553,7 @@ static int _bcast_file(struct bcast_parameters *params)
 	uint32_t size_uncompressed = 0, size_compressed = 0;
 	uint32_t time_compression = 0;
 	bool more = true;
+	int head_inx = 0, node_cnt;
 	DEF_TIMERS;
 
 	if (params->block_size)
@@ -400,6 +581,10 @@ static int _bcast_file(struct bcast_parameters *params)
 		params->fanout = MAX_THREADS;
 	slurm_set_tree_width(MIN(MAX_THREADS, params->fanout));
 
+	node_cnt = sbcast_cred->node_cnt;
+	if (params->swarm && (node_cnt < 2))
+		params->swarm = false;
+
 	while (more) {
 		START_TIMER;
 		bcast_msg.block_len = _next_block(params, &buffer, &orig_len,
@@ -416,7 +601,22 @@ static int _bcast_file(struct bcast_parameters *params)
 		if (!more)
 			bcast_msg.last_block = 1;
 
-		rc = _file_bcast(params, &bcast_msg, sbcast_cred);
+		if (params->swarm && (bcast_msg.block_no > 1) && more) {
+			/* Intermediate blocks may arrive in any order, up to
+			 * fanout of them in flight from different seeds */
+			if ((rc = _swarm_wait(MIN(MAX_THREADS,
+						  params->fanout) - 1)))
+				break;
+			_swarm_queue_block(params, &bcast_msg, head_inx);
+			head_inx = (head_inx + 1) % node_cnt;
+		} else {
+			/* First block registers the file and last block
+			 * closes it, so they must not overlap with others */
+			if (params->swarm && (rc = _swarm_wait(0)))
+				break;
+			rc = _file_bcast(params, &bcast_msg,
+					 sbcast_cred->node_list);
+		}
 		if (rc != SLURM_SUCCESS)
 			break;
 		if (bcast_msg.last_block)
@@ -424,6 +624,8 @@ static int _bcast_file(struct bcast_parameters *params)
 		bcast_msg.block_no++;
 		bcast_msg.block_offset += orig_len;
 	}
+	if (params->swarm)
+		rc = MAX(rc, _swarm_wait(0));
 	xfree(bcast_msg.user_name);
 	xfree(buffer);
 
@@ -557,3 +759,33 @@ extern int bcast_decompress_data(file_bcast_msg_t *req)
 	      __func__, req->compress);
 	return -1;
 }
+
+extern int bcast_write_block(int fd, file_bcast_msg_t *req,
+			     uint16_t protocol_version)
+{
+	uint32_t offset = 0;
+	ssize_t inx;
+
+	/* Blocks may arrive out of order when sbcast runs in swarm mode,
+	 * so position each write explicitly when the sender provides the
+	 * full 64 bit offset. Older versions only send blocks in sequence,
+	 * and their 32 bit offset wraps past 4 GiB. */
+	while (req->block_len - offset) {
+		if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+			inx = pwrite(fd, &req->block[offset],
+				     (req->block_len - offset),
+				     (off_t) (req->block_offset + offset));
+		} else {
+			inx = write(fd, &req->block[offset],
+				    (req->block_len - offset));
+		}
+		if (inx == -1) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			return -1;
+		}
+		offset += inx;
+	}
+
+	return 0;
+}
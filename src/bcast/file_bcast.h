@@ -50,6 +50,7 @@ struct bcast_parameters {
 	bool preserve;
 	char *src_fname;
 	uint32_t step_id;
+	bool swarm;
 	int timeout;
 	int verbose;
 };
@@ -71,4 +72,13 @@ extern int bcast_file(struct bcast_parameters *params);
 
 extern int bcast_decompress_data(file_bcast_msg_t *req);
 
+/*
+ * Write the (decompressed) data of a block to fd, at the block's offset if
+ * the sender's protocol version carries it in full, otherwise following the
+ * previous block.
+ * RET 0 on success, -1 on failure with errno set
+ */
+extern int bcast_write_block(int fd, file_bcast_msg_t *req,
+			     uint16_t protocol_version);
+
 #endif
@@ -51,6 +51,24 @@
 
 #define ASSOC_HASH_SIZE 1000
 #define ASSOC_HASH_ID_INX(_assoc_id)	(_assoc_id % ASSOC_HASH_SIZE)
+#define ASSOC_REFRESH_TRIES 3
+
+/*
+ * Index of assoc_mgr_user_list or assoc_mgr_qos_list by ID and by name
+ * (case insensitive), open addressing tables of pointers into the list.
+ * The index is marked dirty as the list's write lock is released and is
+ * rebuilt on the next lookup. The thread holding the write lock may change
+ * the list at any time, so its lookups walk the list instead.
+ */
+typedef struct {
+	uint32_t (*id_func) (void *rec);   /* record's ID, NO_VAL to skip */
+	char *   (*name_func) (void *rec); /* record's name */
+	void **id_table;		/* records by ID */
+	void **name_table;		/* records by name */
+	uint32_t size;			/* slots in each table, a power of 2 */
+	bool dirty;			/* rebuild before next lookup */
+	bool writer;			/* write lock held, don't use index */
+} list_index_t;
 
 slurmdb_assoc_rec_t *assoc_mgr_root_assoc = NULL;
 uint32_t g_qos_max_priority = 0;
@@ -66,6 +84,7 @@ List assoc_mgr_res_list = NULL;
 List assoc_mgr_qos_list = NULL;
 List assoc_mgr_user_list = NULL;
 List assoc_mgr_wckey_list = NULL;
+uint32_t assoc_mgr_write_gen = 1;
 
 static char *assoc_mgr_cluster_name = NULL;
 static int setup_children = 0;
@@ -77,6 +96,31 @@ static slurmdb_assoc_rec_t **assoc_hash = NULL;
 static pthread_mutex_t locks_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t locks_cond = PTHREAD_COND_INITIALIZER;
 
+/* Write lock hold start times, each protected by its own write lock */
+static struct timeval assoc_write_start;
+static struct timeval qos_write_start;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static assoc_mgr_stats_t assoc_mgr_stats;
+
+/* An association and a QOS write lock may be held by different threads at
+ * once, so both can be releasing them together */
+static pthread_mutex_t write_gen_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Bumped under the association write lock by each association update so a
+ * refresh can tell whether one came in while it was fetching the list */
+static uint32_t assoc_update_gen = 0;
+
+static uint32_t _qos_index_id(void *rec);
+static char *_qos_index_name(void *rec);
+static uint32_t _user_index_id(void *rec);
+static char *_user_index_name(void *rec);
+
+static pthread_mutex_t list_index_lock = PTHREAD_MUTEX_INITIALIZER;
+static list_index_t qos_index = {
+	_qos_index_id, _qos_index_name, NULL, NULL, 0, true, false };
+static list_index_t user_index = {
+	_user_index_id, _user_index_name, NULL, NULL, 0, true, false };
+
 static int _get_str_inx(char *name)
 {
 	int j, index = 0;
@@ -310,6 +354,142 @@ static void _delete_assoc_hash(slurmdb_assoc_rec_t *assoc)
 }
 
 
+static uint32_t _qos_index_id(void *rec)
+{
+	return ((slurmdb_qos_rec_t *) rec)->id;
+}
+
+static char *_qos_index_name(void *rec)
+{
+	return ((slurmdb_qos_rec_t *) rec)->name;
+}
+
+static uint32_t _user_index_id(void *rec)
+{
+	return ((slurmdb_user_rec_t *) rec)->uid;
+}
+
+static char *_user_index_name(void *rec)
+{
+	return ((slurmdb_user_rec_t *) rec)->name;
+}
+
+static uint32_t _list_index_name_hash(char *name)
+{
+	uint32_t hash = 5381;
+
+	while (name && *name)
+		hash = (hash * 33) + tolower((int) *name++);
+	return hash;
+}
+
+/* Rebuild an index from its list. Only the first record in list order
+ * with a given ID or name is indexed, matching a walk of the list. */
+static void _list_index_build(list_index_t *index, List rec_list)
+{
+	ListIterator itr;
+	void *rec, *tmp;
+	uint32_t id, inx, mask;
+	char *name;
+
+	index->dirty = false;
+	index->size = 64;
+	if (rec_list) {
+		while (index->size < (list_count(rec_list) * 2))
+			index->size *= 2;
+	}
+	mask = index->size - 1;
+	xfree(index->id_table);
+	xfree(index->name_table);
+	index->id_table = xmalloc(sizeof(void *) * index->size);
+	index->name_table = xmalloc(sizeof(void *) * index->size);
+	if (!rec_list)
+		return;
+
+	itr = list_iterator_create(rec_list);
+	while ((rec = list_next(itr))) {
+		if ((id = (index->id_func)(rec)) != NO_VAL) {
+			inx = id & mask;
+			while ((tmp = index->id_table[inx]) &&
+			       ((index->id_func)(tmp) != id))
+				inx = (inx + 1) & mask;
+			if (!tmp)
+				index->id_table[inx] = rec;
+		}
+		if ((name = (index->name_func)(rec))) {
+			inx = _list_index_name_hash(name) & mask;
+			while ((tmp = index->name_table[inx]) &&
+			       xstrcasecmp((index->name_func)(tmp), name))
+				inx = (inx + 1) & mask;
+			if (!tmp)
+				index->name_table[inx] = rec;
+		}
+	}
+	list_iterator_destroy(itr);
+}
+
+/*
+ * _list_index_find - Find a record by ID or else by name
+ * IN index - index of rec_list
+ * IN rec_list - the list, walked if the caller holds its write lock
+ * IN id - ID to find, or NO_VAL to find name
+ * IN name - name to find if no record has the ID, may be NULL
+ * RET the record or NULL if not found
+ */
+static void *_list_index_find(list_index_t *index, List rec_list,
+			      uint32_t id, char *name)
+{
+	ListIterator itr;
+	void *rec = NULL;
+	uint32_t inx, mask;
+
+	if (index->writer) {
+		itr = list_iterator_create(rec_list);
+		while ((rec = list_next(itr))) {
+			if ((id != NO_VAL) && ((index->id_func)(rec) == id))
+				break;
+		}
+		if (!rec && name) {
+			list_iterator_reset(itr);
+			while ((rec = list_next(itr))) {
+				if (!xstrcasecmp((index->name_func)(rec),
+						 name))
+					break;
+			}
+		}
+		list_iterator_destroy(itr);
+		return rec;
+	}
+
+	slurm_mutex_lock(&list_index_lock);
+	if (index->dirty)
+		_list_index_build(index, rec_list);
+	mask = index->size - 1;
+	if (id != NO_VAL) {
+		inx = id & mask;
+		while ((rec = index->id_table[inx]) &&
+		       ((index->id_func)(rec) != id))
+			inx = (inx + 1) & mask;
+	}
+	if (!rec && name) {
+		inx = _list_index_name_hash(name) & mask;
+		while ((rec = index->name_table[inx]) &&
+		       xstrcasecmp((index->name_func)(rec), name))
+			inx = (inx + 1) & mask;
+	}
+	slurm_mutex_unlock(&list_index_lock);
+
+	return rec;
+}
+
+static void _list_index_free(list_index_t *index)
+{
+	xfree(index->id_table);
+	xfree(index->name_table);
+	index->size = 0;
+	index->dirty = true;
+}
+
 static void _normalize_assoc_shares_fair_tree(
 	slurmdb_assoc_rec_t *assoc)
 {
@@ -1618,14 +1798,16 @@ static int _refresh_assoc_mgr_tres_list(void *db_conn, int enforce)
 static int _refresh_assoc_mgr_assoc_list(void *db_conn, int enforce)
 {
 	slurmdb_assoc_cond_t assoc_q;
-	List current_assocs = NULL;
+	List current_assocs = NULL, new_assocs;
 	uid_t uid = getuid();
 	ListIterator curr_itr = NULL;
-	ListIterator assoc_mgr_itr = NULL;
 	slurmdb_assoc_rec_t *curr_assoc = NULL, *assoc = NULL;
+	uint32_t update_gen;
+	int tries;
 	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
 				   READ_LOCK, WRITE_LOCK, NO_LOCK };
-//	DEF_TIMERS;
+	assoc_mgr_lock_t read_locks = { READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
+					NO_LOCK, NO_LOCK, NO_LOCK };
 
 	memset(&assoc_q, 0, sizeof(slurmdb_assoc_cond_t));
 	if (assoc_mgr_cluster_name) {
@@ -1637,26 +1819,49 @@ static int _refresh_assoc_mgr_assoc_list(void *db_conn, int enforce)
 		      "all associations.");
 	}
 
-	assoc_mgr_lock(&locks);
+	/* Build the new list before locking, readers keep using the
+	 * current one until it is swapped in below.  An update applied to
+	 * the current list meanwhile may be missing from the new one, so
+	 * fetch again if one came in.  After ASSOC_REFRESH_TRIES attempts
+	 * fetch under the write lock, holding off updates until done. */
+	for (tries = 1; ; tries++) {
+		if (tries < ASSOC_REFRESH_TRIES) {
+			assoc_mgr_lock(&read_locks);
+			update_gen = assoc_update_gen;
+			assoc_mgr_unlock(&read_locks);
+		} else
+			assoc_mgr_lock(&locks);
 
-	current_assocs = assoc_mgr_assoc_list;
+		new_assocs = acct_storage_g_get_assocs(db_conn, uid, &assoc_q);
 
-//	START_TIMER;
-	assoc_mgr_assoc_list =
-		acct_storage_g_get_assocs(db_conn, uid, &assoc_q);
-//	END_TIMER2("get_assocs");
+		if (tries < ASSOC_REFRESH_TRIES) {
+			if (!new_assocs)
+				break;
+			assoc_mgr_lock(&locks);
+			if (update_gen == assoc_update_gen)
+				break;
+			assoc_mgr_unlock(&locks);
+			debug("%s: associations updated while fetching them, "
+			      "fetching again", __func__);
+			FREE_NULL_LIST(new_assocs);
+		} else {
+			if (!new_assocs)
+				assoc_mgr_unlock(&locks);
+			break;
+		}
+	}
 
 	FREE_NULL_LIST(assoc_q.cluster_list);
 
-	if (!assoc_mgr_assoc_list) {
-		assoc_mgr_assoc_list = current_assocs;
-		assoc_mgr_unlock(&locks);
-
+	if (!new_assocs) {
 		error("_refresh_assoc_mgr_assoc_list: "
 		      "no new list given back keeping cached one.");
 		return SLURM_ERROR;
 	}
 
+	current_assocs = assoc_mgr_assoc_list;
+	assoc_mgr_assoc_list = new_assocs;
+
 	_post_assoc_list();
 
 	if (!current_assocs) {
@@ -1664,30 +1869,21 @@ static int _refresh_assoc_mgr_assoc_list(void *db_conn, int enforce)
 		return SLURM_SUCCESS;
 	}
 
-	curr_itr = list_iterator_create(current_assocs);
-	assoc_mgr_itr = list_iterator_create(assoc_mgr_assoc_list);
-
 	/* add used limits We only look for the user associations to
 	 * do the parents since a parent may have moved */
+	curr_itr = list_iterator_create(current_assocs);
 	while ((curr_assoc = list_next(curr_itr))) {
 		if (!curr_assoc->user)
 			continue;
-		while ((assoc = list_next(assoc_mgr_itr))) {
-			if (assoc->id == curr_assoc->id)
-				break;
-		}
-
+		assoc = _find_assoc_rec_id(curr_assoc->id);
 		while (assoc) {
 			_addto_used_info(assoc, curr_assoc);
 			/* get the parent last since this pointer is
 			   different than the one we are updating from */
 			assoc = assoc->usage->parent_assoc_ptr;
 		}
-		list_iterator_reset(assoc_mgr_itr);
 	}
-
 	list_iterator_destroy(curr_itr);
-	list_iterator_destroy(assoc_mgr_itr);
 
 	assoc_mgr_unlock(&locks);
 
@@ -2036,12 +2232,63 @@ extern int assoc_mgr_fini(char *state_save_location)
 
 	xfree(assoc_hash_id);
 	xfree(assoc_hash);
+	_list_index_free(&qos_index);
+	_list_index_free(&user_index);
 
 	assoc_mgr_unlock(&locks);
 
 	return SLURM_SUCCESS;
 }
 
+/* Record the time a write lock was held, from start until now */
+static void _add_write_stats(struct timeval *start)
+{
+	struct timeval now;
+	uint32_t usec;
+
+	gettimeofday(&now, NULL);
+	usec = ((now.tv_sec - start->tv_sec) * 1000000) +
+	       (now.tv_usec - start->tv_usec);
+
+	slurm_mutex_lock(&stats_lock);
+	assoc_mgr_stats.write_cnt++;
+	assoc_mgr_stats.write_sum += usec;
+	if (usec > assoc_mgr_stats.write_max)
+		assoc_mgr_stats.write_max = usec;
+	slurm_mutex_unlock(&stats_lock);
+}
+
+/* Count an update or list refresh as applied, taking usec */
+static void _add_update_stats(uint32_t usec)
+{
+	slurm_mutex_lock(&stats_lock);
+	assoc_mgr_stats.version++;
+	assoc_mgr_stats.update_cnt++;
+	assoc_mgr_stats.update_last = usec;
+	assoc_mgr_stats.update_sum += usec;
+	if (usec > assoc_mgr_stats.update_max)
+		assoc_mgr_stats.update_max = usec;
+	slurm_mutex_unlock(&stats_lock);
+}
+
+extern void assoc_mgr_get_stats(assoc_mgr_stats_t *stats)
+{
+	slurm_mutex_lock(&stats_lock);
+	memcpy(stats, &assoc_mgr_stats, sizeof(assoc_mgr_stats_t));
+	slurm_mutex_unlock(&stats_lock);
+}
+
+extern void assoc_mgr_reset_stats(void)
+{
+	uint32_t version;
+
+	slurm_mutex_lock(&stats_lock);
+	version = assoc_mgr_stats.version;
+	memset(&assoc_mgr_stats, 0, sizeof(assoc_mgr_stats_t));
+	assoc_mgr_stats.version = version;
+	slurm_mutex_unlock(&stats_lock);
+}
+
 extern void assoc_mgr_lock(assoc_mgr_lock_t *locks)
 {
 	if (locks->assoc == READ_LOCK)
@@ -2056,8 +2303,10 @@ extern void assoc_mgr_lock(assoc_mgr_lock_t *locks)
 
 	if (locks->qos == READ_LOCK)
 		_wr_rdlock(QOS_LOCK);
-	else if (locks->qos == WRITE_LOCK)
+	else if (locks->qos == WRITE_LOCK) {
 		_wr_wrlock(QOS_LOCK);
+		qos_index.writer = true;
+	}
 
 	if (locks->res == READ_LOCK)
 		_wr_rdlock(RES_LOCK);
@@ -2071,17 +2320,39 @@ extern void assoc_mgr_lock(assoc_mgr_lock_t *locks)
 
 	if (locks->user == READ_LOCK)
 		_wr_rdlock(USER_LOCK);
-	else if (locks->user == WRITE_LOCK)
+	else if (locks->user == WRITE_LOCK) {
 		_wr_wrlock(USER_LOCK);
+		user_index.writer = true;
+	}
 
 	if (locks->wckey == READ_LOCK)
 		_wr_rdlock(WCKEY_LOCK);
 	else if (locks->wckey == WRITE_LOCK)
 		_wr_wrlock(WCKEY_LOCK);
+
+	if (locks->assoc == WRITE_LOCK)
+		gettimeofday(&assoc_write_start, NULL);
+	else if (locks->qos == WRITE_LOCK)
+		gettimeofday(&qos_write_start, NULL);
 }
 
-extern void assoc_mgr_unlock(assoc_mgr_lock_t *locks)
+static void _unlock(assoc_mgr_lock_t *locks, bool new_gen)
 {
+	if ((locks->assoc == WRITE_LOCK) || (locks->qos == WRITE_LOCK)) {
+		/* Anything derived from association or QOS limits and usage
+		 * may now be stale */
+		if (new_gen) {
+			slurm_mutex_lock(&write_gen_lock);
+			if (++assoc_mgr_write_gen == 0)
+				assoc_mgr_write_gen = 1;
+			slurm_mutex_unlock(&write_gen_lock);
+		}
+		if (locks->assoc == WRITE_LOCK)
+			_add_write_stats(&assoc_write_start);
+		else
+			_add_write_stats(&qos_write_start);
+	}
+
 	if (locks->wckey == READ_LOCK)
 		_wr_rdunlock(WCKEY_LOCK);
 	else if (locks->wckey == WRITE_LOCK)
@@ -2089,8 +2360,11 @@ extern void assoc_mgr_unlock(assoc_mgr_lock_t *locks)
 
 	if (locks->user == READ_LOCK)
 		_wr_rdunlock(USER_LOCK);
-	else if (locks->user == WRITE_LOCK)
+	else if (locks->user == WRITE_LOCK) {
+		user_index.writer = false;
+		user_index.dirty = true;
 		_wr_wrunlock(USER_LOCK);
+	}
 
 	if (locks->tres == READ_LOCK)
 		_wr_rdunlock(TRES_LOCK);
@@ -2104,8 +2378,11 @@ extern void assoc_mgr_unlock(assoc_mgr_lock_t *locks)
 
 	if (locks->qos == READ_LOCK)
 		_wr_rdunlock(QOS_LOCK);
-	else if (locks->qos == WRITE_LOCK)
+	else if (locks->qos == WRITE_LOCK) {
+		qos_index.writer = false;
+		qos_index.dirty = true;
 		_wr_wrunlock(QOS_LOCK);
+	}
 
 	if (locks->file == READ_LOCK)
 		_wr_rdunlock(FILE_LOCK);
@@ -2118,6 +2395,16 @@ extern void assoc_mgr_unlock(assoc_mgr_lock_t *locks)
 		_wr_wrunlock(ASSOC_LOCK);
 }
 
+extern void assoc_mgr_unlock(assoc_mgr_lock_t *locks)
+{
+	_unlock(locks, true);
+}
+
+extern void assoc_mgr_unlock_usage_added(assoc_mgr_lock_t *locks)
+{
+	_unlock(locks, false);
+}
+
 /* Since the returned assoc_list is full of pointers from the
  * assoc_mgr_assoc_list assoc_mgr_lock_t READ_LOCK on
  * assocs must be set before calling this function and while
@@ -2484,7 +2771,6 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 				  int enforce,
 				  slurmdb_user_rec_t **user_pptr)
 {
-	ListIterator itr = NULL;
 	slurmdb_user_rec_t * found_user = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
 				   NO_LOCK, READ_LOCK, NO_LOCK };
@@ -2502,16 +2788,13 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_user_list);
-	while ((found_user = list_next(itr))) {
-		if (user->uid != NO_VAL) {
-			if (user->uid == found_user->uid)
-				break;
-		} else if (user->name
-			   && !xstrcasecmp(user->name, found_user->name))
-			break;
+	if (user->uid != NO_VAL) {
+		found_user = _list_index_find(&user_index, assoc_mgr_user_list,
+					      user->uid, NULL);
+	} else if (user->name) {
+		found_user = _list_index_find(&user_index, assoc_mgr_user_list,
+					      NO_VAL, user->name);
 	}
-	list_iterator_destroy(itr);
 
 	if (!found_user) {
 		assoc_mgr_unlock(&locks);
@@ -2554,7 +2837,6 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 				 int enforce,
 				 slurmdb_qos_rec_t **qos_pptr, bool locked)
 {
-	ListIterator itr = NULL;
 	slurmdb_qos_rec_t * found_qos = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK, READ_LOCK, NO_LOCK,
 				   NO_LOCK, NO_LOCK, NO_LOCK };
@@ -2588,14 +2870,8 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_qos_list);
-	while ((found_qos = list_next(itr))) {
-		if (qos->id == found_qos->id)
-			break;
-		else if (qos->name && !xstrcasecmp(qos->name, found_qos->name))
-			break;
-	}
-	list_iterator_destroy(itr);
+	found_qos = _list_index_find(&qos_index, assoc_mgr_qos_list,
+				     qos->id, qos->name);
 
 	if (!found_qos) {
 		if (!locked)
@@ -3441,8 +3717,10 @@ extern int assoc_mgr_update(List update_list, bool locked)
 	int rc = SLURM_SUCCESS;
 	ListIterator itr = NULL;
 	slurmdb_update_object_t *object = NULL;
+	DEF_TIMERS;
 
 	xassert(update_list);
+	START_TIMER;
 	itr = list_iterator_create(update_list);
 	while ((object = list_next(itr))) {
 		if (!object->objects || !list_count(object->objects))
@@ -3499,6 +3777,9 @@ extern int assoc_mgr_update(List update_list, bool locked)
 		}
 	}
 	list_iterator_destroy(itr);
+	END_TIMER2("assoc_mgr_update");
+	_add_update_stats(DELTA_TIMER);
+
 	return rc;
 }
 
@@ -3524,6 +3805,7 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update, bool locked)
 		return SLURM_SUCCESS;
 	}
 
+	assoc_update_gen++;
 	while ((object = list_pop(update->objects))) {
 		bool update_jobs = false;
 		if (object->cluster && assoc_mgr_cluster_name) {
@@ -5763,6 +6045,9 @@ unpack_error:
 extern int assoc_mgr_refresh_lists(void *db_conn, uint16_t cache_level)
 {
 	bool partial_list = 1;
+	DEF_TIMERS;
+
+	START_TIMER;
 
 	if (!cache_level) {
 		cache_level = init_setup.cache_level;
@@ -5806,6 +6091,9 @@ extern int assoc_mgr_refresh_lists(void *db_conn, uint16_t cache_level)
 	if (!partial_list)
 		running_cache = 0;
 
+	END_TIMER2("assoc_mgr_refresh_lists");
+	_add_update_stats(DELTA_TIMER);
+
 	return SLURM_SUCCESS;
 }
 
@@ -118,6 +118,25 @@ extern List assoc_mgr_user_list;
 extern List assoc_mgr_wckey_list;
 
 extern slurmdb_assoc_rec_t *assoc_mgr_root_assoc;
+/* Incremented as each association or QOS write lock is released, other than
+ * by assoc_mgr_unlock_usage_added(). Read it with the association and QOS
+ * read locks held to tell if cached failures of limit tests are still
+ * current (never 0) */
+extern uint32_t assoc_mgr_write_gen;
+
+/* Statistics on applying slurmdbd updates and on association or QOS write
+ * lock hold times, as these block every reader. Times are in usec. */
+typedef struct {
+	uint32_t version;	/* updates and list refreshes applied since
+				 * start, not reset */
+	uint32_t update_cnt;	/* updates applied */
+	uint32_t update_last;	/* time to apply the last update */
+	uint32_t update_max;
+	uint64_t update_sum;
+	uint32_t write_cnt;	/* association or QOS write lock holds */
+	uint32_t write_max;
+	uint64_t write_sum;
+} assoc_mgr_stats_t;
 
 extern uint32_t g_qos_max_priority; /* max priority in all qos's */
 extern uint32_t g_qos_count; /* count used for generating qos bitstr's */
@@ -131,6 +150,24 @@ extern int assoc_mgr_init(void *db_conn, assoc_init_args_t *args,
 extern int assoc_mgr_fini(char *state_save_location);
 extern void assoc_mgr_lock(assoc_mgr_lock_t *locks);
 extern void assoc_mgr_unlock(assoc_mgr_lock_t *locks);
+/*
+ * assoc_mgr_unlock_usage_added - release locks as assoc_mgr_unlock() does
+ *	after changes that only added association or QOS usage, as a job
+ *	being submitted or starting does. More usage can not let a job pass
+ *	a limit it failed, so assoc_mgr_write_gen is left as it was.
+ */
+extern void assoc_mgr_unlock_usage_added(assoc_mgr_lock_t *locks);
+
+/*
+ * assoc_mgr_get_stats - copy the association manager update statistics
+ * OUT stats - filled in with the current values
+ */
+extern void assoc_mgr_get_stats(assoc_mgr_stats_t *stats);
+
+/*
+ * assoc_mgr_reset_stats - clear all update statistics except the version
+ */
+extern void assoc_mgr_reset_stats(void);
 
 /*
  * get info from the storage
@@ -44,6 +44,10 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
+#if HAVE_SYS_EPOLL_H
+#  include <sys/epoll.h>
+#endif
+
 #include "src/common/fd.h"
 #include "src/common/eio.h"
 #include "src/common/log.h"
@@ -60,12 +64,15 @@
 strong_alias(eio_handle_create,		slurm_eio_handle_create);
 strong_alias(eio_handle_destroy,	slurm_eio_handle_destroy);
 strong_alias(eio_handle_mainloop,	slurm_eio_handle_mainloop);
+strong_alias(eio_handle_use_epoll,	slurm_eio_handle_use_epoll);
+strong_alias(eio_handle_timeout,	slurm_eio_handle_timeout);
 strong_alias(eio_message_socket_readable, slurm_eio_message_socket_readable);
 strong_alias(eio_message_socket_accept,	slurm_eio_message_socket_accept);
 strong_alias(eio_new_obj,		slurm_eio_new_obj);
 strong_alias(eio_new_initial_obj,	slurm_eio_new_initial_obj);
 strong_alias(eio_obj_create,		slurm_eio_obj_create);
 strong_alias(eio_obj_destroy,		slurm_eio_obj_destroy);
+strong_alias(eio_obj_changed,		slurm_eio_obj_changed);
 strong_alias(eio_remove_obj,		slurm_eio_remove_obj);
 strong_alias(eio_signal_shutdown,	slurm_eio_signal_shutdown);
 strong_alias(eio_signal_wakeup,		slurm_eio_signal_wakeup);
@@ -86,19 +93,62 @@ struct eio_handle_components {
 	uint16_t shutdown_wait;
 	List obj_list;
 	List new_objs;
+	int  epfd;		/* epoll instance, -1 to use poll() */
+	struct epoll_state *ep;	/* epoll mainloop state */
+	int  timeout;		/* msec limit on the next wait, -1 if none */
 };
 
+#if HAVE_SYS_EPOLL_H
+/*
+ * epoll registration state for one file descriptor. Several objects may
+ * share a file descriptor (e.g. a pty used for both stdin and stdout), so
+ * the registered events are the union of the interest of every object
+ * chained on it.
+ */
+typedef struct {
+	uint32_t events;	/* events currently registered with epoll */
+	eio_obj_t *head;	/* objects waiting on this fd */
+} epoll_fd_t;
+
+/*
+ * An object is only asked again whether it is readable or writable once it
+ * is on the "changed" array: when it is added, after one of its handlers
+ * ran, after eio_obj_changed(), while it keeps calling eio_handle_timeout(),
+ * and after any eio_signal_wakeup(), which puts every object there.
+ */
+typedef struct epoll_state {
+	epoll_fd_t *fds;	/* indexed by file descriptor */
+	int fd_cnt;		/* size of fds array */
+	int reg_cnt;		/* file descriptors registered with epoll */
+	int obj_cnt;		/* objects waiting on some file descriptor */
+	eio_obj_t **changed;	/* objects to ask again, NULL if destroyed */
+	int changed_cnt;
+	int changed_size;
+	eio_obj_t *cur;		/* object being asked */
+	bool cur_timeout;	/* cur called eio_handle_timeout() */
+	eio_obj_t *dispatch;	/* object whose handler runs, NULL if gone */
+	eio_obj_t *dispatch_next; /* next object to dispatch the event to */
+	struct epoll_event *ev;	/* events returned by epoll_wait() */
+	int ev_cnt;		/* size of ev array */
+} epoll_state_t;
+#endif
+
 
 /* Function prototypes
  */
 
 static int          _poll_internal(struct pollfd *pfds, unsigned int nfds,
-				   time_t shutdown_time);
+				   int timeout);
+static int          _next_timeout(eio_handle_t *eio, time_t shutdown_time);
 static unsigned int _poll_setup_pollfds(struct pollfd *, eio_obj_t **, List);
 static void         _poll_dispatch(struct pollfd *, unsigned int, eio_obj_t **,
 		                   List objList);
 static void         _poll_handle_event(short revents, eio_obj_t *obj,
 		                       List objList);
+#if HAVE_SYS_EPOLL_H
+static int          _epoll_mainloop(eio_handle_t *eio);
+static void         _epoll_forget(eio_obj_t *obj);
+#endif
 
 
 eio_handle_t *eio_handle_create(uint16_t shutdown_wait)
@@ -117,6 +167,8 @@ eio_handle_t *eio_handle_create(uint16_t shutdown_wait)
 
 	xassert(eio->magic = EIO_MAGIC);
 
+	eio->epfd = -1;
+	eio->timeout = -1;
 	eio->obj_list = list_create(eio_obj_destroy);
 	eio->new_objs = list_create(eio_obj_destroy);
 
@@ -136,12 +188,88 @@ void eio_handle_destroy(eio_handle_t *eio)
 	close(eio->fds[1]);
 	FREE_NULL_LIST(eio->obj_list);
 	FREE_NULL_LIST(eio->new_objs);
+#if HAVE_SYS_EPOLL_H
+	if (eio->ep) {
+		xfree(eio->ep->fds);
+		xfree(eio->ep->changed);
+		xfree(eio->ep->ev);
+		xfree(eio->ep);
+	}
+#endif
+	if (eio->epfd >= 0)
+		close(eio->epfd);
 	slurm_mutex_destroy(&eio->shutdown_mutex);
 
 	xassert(eio->magic = ~EIO_MAGIC);
 	xfree(eio);
 }
 
+/*
+ * Use epoll() rather than poll() in eio_handle_mainloop(). File descriptors
+ * stay registered with the kernel between passes and are only modified when
+ * an object's interest changes. Only objects with pending events or marked
+ * as changed are visited, so the cost of each wakeup no longer grows with
+ * the number of objects. Must be called before eio_handle_mainloop().
+ *
+ * RET SLURM_SUCCESS, or SLURM_ERROR if epoll is unavailable (the handle
+ * then continues to use poll())
+ */
+int eio_handle_use_epoll(eio_handle_t *eio)
+{
+	xassert(eio != NULL);
+	xassert(eio->magic == EIO_MAGIC);
+
+#if HAVE_SYS_EPOLL_H
+	if (eio->epfd >= 0)
+		return SLURM_SUCCESS;
+	if ((eio->epfd = epoll_create(64)) < 0) {
+		error("%s: epoll_create: %m", __func__);
+		return SLURM_ERROR;
+	}
+	fd_set_close_on_exec(eio->epfd);
+	return SLURM_SUCCESS;
+#else
+	debug("%s: epoll not supported, using poll", __func__);
+	return SLURM_ERROR;
+#endif
+}
+
+/*
+ * Limit the next wait for events in eio_handle_mainloop() to "msec"
+ * milliseconds. Meant to be called from an object's readable() or
+ * writable() callback (i.e. from the thread running the mainloop) by an
+ * object that is deliberately holding back I/O and must be polled again
+ * later. The request only applies to the next pass; the shortest of
+ * several requests wins.
+ */
+void eio_handle_timeout(eio_handle_t *eio, int msec)
+{
+	xassert(eio != NULL);
+	xassert(eio->magic == EIO_MAGIC);
+
+	if (msec < 0)
+		msec = 0;
+	if ((eio->timeout < 0) || (msec < eio->timeout))
+		eio->timeout = msec;
+#if HAVE_SYS_EPOLL_H
+	/* Ask the object again on the next pass */
+	if (eio->ep && eio->ep->cur)
+		eio->ep->cur_timeout = true;
+#endif
+}
+
+/* Return the poll()/epoll_wait() timeout for this pass and clear any
+ * one-shot request made through eio_handle_timeout() */
+static int _next_timeout(eio_handle_t *eio, time_t shutdown_time)
+{
+	int timeout = eio->timeout;
+
+	eio->timeout = -1;
+	if (shutdown_time && ((timeout < 0) || (timeout > 1000)))
+		timeout = 1000;	/* Return every 1000 msec during shutdown */
+	return timeout;
+}
+
 bool eio_message_socket_readable(eio_obj_t *obj)
 {
 	debug3("Called eio_message_socket_readable %d %d",
@@ -290,6 +418,11 @@ int eio_handle_mainloop(eio_handle_t *eio)
 	xassert (eio != NULL);
 	xassert (eio->magic == EIO_MAGIC);
 
+#if HAVE_SYS_EPOLL_H
+	if (eio->epfd >= 0)
+		return _epoll_mainloop(eio);
+#endif
+
 	for (;;) {
 
 		/* Alloc memory for pfds and map if needed */
@@ -322,7 +455,8 @@ int eio_handle_mainloop(eio_handle_t *eio)
 		slurm_mutex_lock(&eio->shutdown_mutex);
 		shutdown_time = eio->shutdown_time;
 		slurm_mutex_unlock(&eio->shutdown_mutex);
-		if (_poll_internal(pollfds, nfds, shutdown_time) < 0)
+		if (_poll_internal(pollfds, nfds,
+				   _next_timeout(eio, shutdown_time)) < 0)
 			goto error;
 
 		if (pollfds[nfds-1].revents & POLLIN)
@@ -349,14 +483,10 @@ int eio_handle_mainloop(eio_handle_t *eio)
 }
 
 static int
-_poll_internal(struct pollfd *pfds, unsigned int nfds, time_t shutdown_time)
+_poll_internal(struct pollfd *pfds, unsigned int nfds, int timeout)
 {
-	int n, timeout;
+	int n;
 
-	if (shutdown_time)
-		timeout = 1000;	/* Return every 1000 msec during shutdown */
-	else
-		timeout = -1;
 	while ((n = poll(pfds, nfds, timeout)) < 0) {
 		switch (errno) {
 		case EINTR :
@@ -508,6 +638,395 @@ _poll_handle_event(short revents, eio_obj_t *obj, List objList)
 	}
 }
 
+#if HAVE_SYS_EPOLL_H
+static short
+_epoll_to_poll(uint32_t events)
+{
+	short revents = 0;
+
+	if (events & EPOLLIN)
+		revents |= POLLIN;
+	if (events & EPOLLOUT)
+		revents |= POLLOUT;
+	if (events & EPOLLERR)
+		revents |= POLLERR;
+	if (events & EPOLLHUP)
+		revents |= POLLHUP;
+#ifdef POLLRDHUP
+	if (events & EPOLLRDHUP)
+		revents |= POLLRDHUP;
+#endif
+	return revents;
+}
+
+static uint32_t
+_poll_to_epoll(short events)
+{
+	uint32_t ep_events = 0;
+
+	if (events & POLLIN)
+		ep_events |= EPOLLIN;
+	if (events & POLLOUT)
+		ep_events |= EPOLLOUT;
+#ifdef POLLRDHUP
+	if (events & POLLRDHUP)
+		ep_events |= EPOLLRDHUP;
+#endif
+	return ep_events;
+}
+
+/* Put an object on the changed array, to be asked again whether it is
+ * readable or writable before the next wait */
+static void
+_epoll_changed(epoll_state_t *ep, eio_obj_t *obj)
+{
+	if (obj->changed)
+		return;
+	obj->changed = true;
+	if (ep->changed_cnt >= ep->changed_size) {
+		ep->changed_size += 64;
+		xrealloc(ep->changed, ep->changed_size * sizeof(eio_obj_t *));
+	}
+	ep->changed[ep->changed_cnt++] = obj;
+}
+
+/* Put every object on the changed array, adopting new ones */
+static void
+_epoll_changed_all(eio_handle_t *eio)
+{
+	ListIterator itr;
+	eio_obj_t *obj;
+
+	itr = list_iterator_create(eio->obj_list);
+	while ((obj = list_next(itr))) {
+		obj->eio = eio;
+		_epoll_changed(eio->ep, obj);
+	}
+	list_iterator_destroy(itr);
+}
+
+/* Bring the kernel's registration of a file descriptor in line with the
+ * interest of the objects chained on it */
+static void
+_epoll_fd_update(eio_handle_t *eio, int fd)
+{
+	epoll_state_t *ep = eio->ep;
+	epoll_fd_t *efd = &ep->fds[fd];
+	struct epoll_event ev;
+	eio_obj_t *obj;
+	uint32_t want = 0;
+	int op;
+
+	for (obj = efd->head; obj; obj = obj->epoll_next)
+		want |= _poll_to_epoll(obj->epoll_events);
+	if (want == efd->events)
+		return;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events  = want;
+	ev.data.fd = fd;
+	if (!want) {
+		op = EPOLL_CTL_DEL;
+		ep->reg_cnt--;
+	} else if (!efd->events) {
+		op = EPOLL_CTL_ADD;
+		ep->reg_cnt++;
+	} else
+		op = EPOLL_CTL_MOD;
+	if (epoll_ctl(eio->epfd, op, fd, &ev) < 0) {
+		/* The fd may have been closed and reused since it was
+		 * registered, which removes it from the set */
+		if ((op == EPOLL_CTL_MOD) && (errno == ENOENT))
+			(void) epoll_ctl(eio->epfd, EPOLL_CTL_ADD, fd, &ev);
+		else if ((op == EPOLL_CTL_ADD) && (errno == EEXIST))
+			(void) epoll_ctl(eio->epfd, EPOLL_CTL_MOD, fd, &ev);
+		else if (op != EPOLL_CTL_DEL)
+			error("%s: epoll_ctl(%d): %m", __func__, fd);
+	}
+	efd->events = want;
+}
+
+/* Take an object off the file descriptor it waits on */
+static void
+_epoll_unchain(eio_handle_t *eio, eio_obj_t *obj)
+{
+	epoll_state_t *ep = eio->ep;
+	eio_obj_t **obj_pptr;
+	int fd = obj->epoll_fd;
+
+	if (fd < 0)
+		return;
+	for (obj_pptr = &ep->fds[fd].head; *obj_pptr;
+	     obj_pptr = &(*obj_pptr)->epoll_next) {
+		if (*obj_pptr == obj) {
+			*obj_pptr = obj->epoll_next;
+			break;
+		}
+	}
+	if (ep->dispatch_next == obj)
+		ep->dispatch_next = obj->epoll_next;
+	obj->epoll_fd = -1;
+	obj->epoll_events = 0;
+	obj->epoll_next = NULL;
+	ep->obj_cnt--;
+	_epoll_fd_update(eio, fd);
+}
+
+/* Ask an object whether it is readable or writable and change what it
+ * waits on to match */
+static void
+_epoll_ask(eio_handle_t *eio, eio_obj_t *obj)
+{
+	epoll_state_t *ep = eio->ep;
+	bool readable, writable;
+	short events = 0;
+	int fd, i, old_cnt;
+
+	obj->changed = false;
+	ep->cur = obj;
+	ep->cur_timeout = false;
+	writable = _is_writable(obj);
+	readable = _is_readable(obj);
+	ep->cur = NULL;
+
+	if (obj->fd >= 0) {
+		if (writable)
+			events |= POLLOUT;
+		if (readable)
+			events |= POLLIN;
+#ifdef POLLRDHUP
+		if (readable)
+			events |= POLLRDHUP;
+#endif
+	}
+	if ((obj->fd != obj->epoll_fd) || (events != obj->epoll_events)) {
+		_epoll_unchain(eio, obj);
+		if (events) {
+			fd = obj->fd;
+			if (fd >= ep->fd_cnt) {
+				old_cnt = ep->fd_cnt;
+				ep->fd_cnt = fd + 64;
+				xrealloc(ep->fds, ep->fd_cnt *
+						  sizeof(epoll_fd_t));
+				for (i = old_cnt; i < ep->fd_cnt; i++) {
+					ep->fds[i].events = 0;
+					ep->fds[i].head = NULL;
+				}
+			}
+			obj->epoll_fd = fd;
+			obj->epoll_events = events;
+			obj->epoll_next = ep->fds[fd].head;
+			ep->fds[fd].head = obj;
+			ep->obj_cnt++;
+			_epoll_fd_update(eio, fd);
+		}
+	}
+
+	if (ep->cur_timeout)
+		_epoll_changed(ep, obj);
+}
+
+/* Ask every changed object, those changed again meanwhile are kept for
+ * the next pass */
+static void
+_epoll_ask_changed(eio_handle_t *eio)
+{
+	epoll_state_t *ep = eio->ep;
+	int i, cnt = ep->changed_cnt;
+
+	for (i = 0; i < cnt; i++) {
+		if (ep->changed[i])
+			_epoll_ask(eio, ep->changed[i]);
+	}
+	ep->changed_cnt -= cnt;
+	memmove(ep->changed, ep->changed + cnt,
+		ep->changed_cnt * sizeof(eio_obj_t *));
+}
+
+/* Forget an object being destroyed */
+static void
+_epoll_forget(eio_obj_t *obj)
+{
+	eio_handle_t *eio = obj->eio;
+	epoll_state_t *ep;
+	int i;
+
+	if (!eio || !(ep = eio->ep))
+		return;
+	_epoll_unchain(eio, obj);
+	for (i = 0; obj->changed && (i < ep->changed_cnt); i++) {
+		if (ep->changed[i] == obj)
+			ep->changed[i] = NULL;
+	}
+	if (ep->dispatch == obj)
+		ep->dispatch = NULL;
+	obj->eio = NULL;
+}
+
+/* Forget everything registered, register the handle's signalling fd with
+ * the epoll instance and put every object on the changed array */
+static int
+_epoll_reset(eio_handle_t *eio)
+{
+	epoll_state_t *ep = eio->ep;
+	struct epoll_event ev;
+	ListIterator itr;
+	eio_obj_t *obj;
+	int i;
+
+	for (i = 0; i < ep->fd_cnt; i++) {
+		ep->fds[i].events = 0;
+		ep->fds[i].head = NULL;
+	}
+	ep->reg_cnt = 0;
+	ep->obj_cnt = 0;
+	ep->changed_cnt = 0;
+	itr = list_iterator_create(eio->obj_list);
+	while ((obj = list_next(itr))) {
+		obj->changed = false;
+		obj->epoll_fd = -1;
+		obj->epoll_events = 0;
+		obj->epoll_next = NULL;
+	}
+	list_iterator_destroy(itr);
+	_epoll_changed_all(eio);
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events  = EPOLLIN;
+	ev.data.fd = eio->fds[0];
+	if (epoll_ctl(eio->epfd, EPOLL_CTL_ADD, eio->fds[0], &ev) < 0) {
+		error("%s: epoll_ctl: %m", __func__);
+		return -1;
+	}
+	return 0;
+}
+
+/* Hand an event to every object waiting on its file descriptor
+ * RET false if no object waits on it */
+static bool
+_epoll_dispatch(eio_handle_t *eio, struct epoll_event *ev)
+{
+	epoll_state_t *ep = eio->ep;
+	eio_obj_t *obj;
+	short revents, obj_revents;
+	int fd = ev->data.fd;
+
+	if ((fd < 0) || (fd >= ep->fd_cnt) || !ep->fds[fd].head)
+		return false;
+
+	revents = _epoll_to_poll(ev->events);
+	for (obj = ep->fds[fd].head; obj; obj = ep->dispatch_next) {
+		/* Handlers may destroy objects, see _epoll_forget() */
+		ep->dispatch_next = obj->epoll_next;
+		obj_revents = revents & (obj->epoll_events |
+					 POLLERR | POLLHUP | POLLNVAL);
+		if (!obj_revents)
+			continue;
+		if (obj->fd != fd) {
+			/* Changed its fd without a handler running */
+			_epoll_changed(ep, obj);
+			continue;
+		}
+		ep->dispatch = obj;
+		_poll_handle_event(obj_revents, obj, eio->obj_list);
+		if (ep->dispatch)
+			_epoll_changed(ep, obj);
+		ep->dispatch = NULL;
+	}
+	ep->dispatch_next = NULL;
+
+	return true;
+}
+
+static int
+_epoll_mainloop(eio_handle_t *eio)
+{
+	epoll_state_t *ep;
+	time_t shutdown_time;
+	int i, n, timeout, retval = 0;
+	bool stale;
+
+	if (!eio->ep)
+		eio->ep = xmalloc(sizeof(epoll_state_t));
+	ep = eio->ep;
+	if (_epoll_reset(eio) < 0)
+		return -1;
+
+	for (;;) {
+		debug4("eio: handling events for %d objects, %d changed",
+		       list_count(eio->obj_list), ep->changed_cnt);
+		_epoll_ask_changed(eio);
+		if (ep->obj_cnt <= 0)
+			break;
+
+		if (ep->ev_cnt < ep->reg_cnt + 1) {
+			ep->ev_cnt = ep->reg_cnt + 64;
+			xrealloc(ep->ev, ep->ev_cnt *
+					 sizeof(struct epoll_event));
+		}
+
+		slurm_mutex_lock(&eio->shutdown_mutex);
+		shutdown_time = eio->shutdown_time;
+		slurm_mutex_unlock(&eio->shutdown_mutex);
+		timeout = _next_timeout(eio, shutdown_time);
+		n = epoll_wait(eio->epfd, ep->ev, ep->ev_cnt, timeout);
+		if (n < 0) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			error("epoll_wait: %m");
+			retval = -1;
+			break;
+		}
+
+		/* Other threads change what objects wait for, add objects
+		 * or request shutdown before waking the mainloop */
+		for (i = 0; i < n; i++) {
+			if (ep->ev[i].data.fd == eio->fds[0]) {
+				_eio_wakeup_handler(eio);
+				_epoll_changed_all(eio);
+				break;
+			}
+		}
+
+		stale = false;
+		for (i = 0; i < n; i++) {
+			if (ep->ev[i].data.fd == eio->fds[0])
+				continue;
+			if (!_epoll_dispatch(eio, &ep->ev[i]))
+				stale = true;
+		}
+
+		/* An event for a file descriptor no object uses means a
+		 * closed descriptor is still registered through a copy
+		 * held elsewhere, which epoll_ctl() can no longer remove */
+		if (stale) {
+			debug("%s: rebuilding epoll set", __func__);
+			close(eio->epfd);
+			if (((eio->epfd = epoll_create(64)) < 0) ||
+			    (_epoll_reset(eio) < 0)) {
+				error("%s: epoll_create: %m", __func__);
+				retval = -1;
+				break;
+			}
+			fd_set_close_on_exec(eio->epfd);
+		}
+
+		slurm_mutex_lock(&eio->shutdown_mutex);
+		shutdown_time = eio->shutdown_time;
+		slurm_mutex_unlock(&eio->shutdown_mutex);
+		if (shutdown_time &&
+		    (difftime(time(NULL), shutdown_time)>=eio->shutdown_wait)) {
+			error("%s: Abandoning IO %d secs after job shutdown "
+			      "initiated", __func__, eio->shutdown_wait);
+			retval = -1;
+			break;
+		}
+	}
+
+	return retval;
+}
+#endif
+
 static struct io_operations *
 _ops_copy(struct io_operations *ops)
 {
@@ -526,13 +1045,32 @@ eio_obj_create(int fd, struct io_operations *ops, void *arg)
 	obj->arg = arg;
 	obj->ops = _ops_copy(ops);
 	obj->shutdown = false;
+	obj->epoll_fd = -1;
 	return obj;
 }
 
+/*
+ * With eio_handle_use_epoll(), an object is only asked again whether it is
+ * readable or writable after one of its own handlers ran or a wakeup. Call
+ * this from the mainloop thread when something else changes the answer.
+ */
+void eio_obj_changed(eio_obj_t *obj)
+{
+	xassert(obj != NULL);
+
+#if HAVE_SYS_EPOLL_H
+	if (obj->eio && obj->eio->ep)
+		_epoll_changed(obj->eio->ep, obj);
+#endif
+}
+
 void eio_obj_destroy(void *arg)
 {
 	eio_obj_t *obj = (eio_obj_t *)arg;
 	if (obj) {
+#if HAVE_SYS_EPOLL_H
+		_epoll_forget(obj);
+#endif
 		/* If the obj->fd is still open we need it to be to be
 		   sure we get the possible extra output that may be
 		   on the port.  see test7.11.
@@ -560,6 +1098,13 @@ void eio_new_initial_obj(eio_handle_t *eio, eio_obj_t *obj)
 	xassert(eio->magic == EIO_MAGIC);
 
 	list_enqueue(eio->obj_list, obj);
+#if HAVE_SYS_EPOLL_H
+	/* Added by a handler, from inside the mainloop */
+	if (eio->ep) {
+		obj->eio = eio;
+		_epoll_changed(eio->ep, obj);
+	}
+#endif
 }
 
 /*
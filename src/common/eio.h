@@ -67,11 +67,39 @@ struct eio_obj {
 	void *arg;                        /* application-specific data       */
 	struct io_operations *ops;        /* pointer to ops struct for obj   */
 	bool shutdown;
+
+	/* Private to the epoll mainloop, see eio_handle_use_epoll() */
+	eio_handle_t *eio;                /* handle whose mainloop runs obj  */
+	bool changed;                     /* readable/writable to be asked   */
+	int epoll_fd;                     /* fd waited on, -1 if none        */
+	short epoll_events;               /* poll() events waited for        */
+	eio_obj_t *epoll_next;            /* next object waiting on epoll_fd */
 };
 
 eio_handle_t *eio_handle_create(uint16_t);
 void eio_handle_destroy(eio_handle_t *eio);
 
+/*
+ * Use epoll() rather than poll() in eio_handle_mainloop() when available.
+ * Registrations persist between passes, so wakeups cost O(active fds) in
+ * the kernel rather than O(objects). Must be called before the mainloop
+ * starts. Returns SLURM_ERROR (and keeps using poll()) if unsupported.
+ *
+ * Objects are then only asked again whether they are readable or writable
+ * when added, after one of their handlers ran, while they keep calling
+ * eio_handle_timeout(), after eio_signal_wakeup() and after
+ * eio_obj_changed(). A handler changing what another object waits for must
+ * call eio_obj_changed() on that object.
+ */
+int eio_handle_use_epoll(eio_handle_t *eio);
+
+/*
+ * Limit the next wait in eio_handle_mainloop() to "msec" milliseconds.
+ * For use from an object's readable()/writable() callback when it holds
+ * back I/O and needs to be re-examined later; applies to one pass only.
+ */
+void eio_handle_timeout(eio_handle_t *eio, int msec);
+
 /*
  * Add an eio_obj_t "obj" to an eio_handle_t "eio"'s internal object list.
  *
@@ -115,4 +143,11 @@ int eio_signal_shutdown(eio_handle_t *eio);
 eio_obj_t *eio_obj_create(int fd, struct io_operations *ops, void *arg);
 void eio_obj_destroy(void *arg);
 
+/*
+ * Have the mainloop ask "obj" again whether it is readable or writable
+ * before it next waits, see eio_handle_use_epoll(). Call from the mainloop
+ * thread only. Does nothing with poll(), which asks every object each pass.
+ */
+void eio_obj_changed(eio_obj_t *obj);
+
 #endif /* !_EIO_H */
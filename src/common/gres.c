@@ -145,11 +145,18 @@ static char *gres_plugin_list = NULL;
 static pthread_mutex_t gres_context_lock = PTHREAD_MUTEX_INITIALIZER;
 static List gres_conf_list = NULL;
 static bool init_run = false;
+static char **gres_type_name = NULL;	/* type names indexed by type id - 1 */
+static uint32_t gres_type_cnt = 0;
 
 /* Local functions */
 static gres_node_state_t *
 		_build_gres_node_state(void);
 static uint32_t	_build_id(char *gres_name);
+static uint32_t	_gres_type_id(char *type);
+static uint32_t	_job_type_id(gres_job_state_t *job_gres_ptr);
+static void	_node_index_build(gres_node_state_t *gres_data);
+static bitstr_t *_node_cpu_bitmap(bitstr_t *cpu_bitmap, int cpu_start_bit,
+				  int cpus_ctld);
 static bitstr_t *_cpu_bitmap_rebuild(bitstr_t *old_cpu_bitmap, int new_size);
 static void	_destroy_gres_slurmd_conf(void *x);
 static void	_get_gres_cnt(gres_node_state_t *gres_data, char *orig_config,
@@ -244,6 +251,104 @@ static uint32_t	_build_id(char *gres_name)
 	return id;
 }
 
+/*
+ * Map a GRES type (model) name onto a small integer which is unique within
+ * this process, so job tests and allocations can match types numerically.
+ * Caller must hold gres_context_lock.
+ * RET type id, 0 for a NULL or empty name
+ */
+static uint32_t _gres_type_id(char *type)
+{
+	uint32_t i;
+
+	if (!type || !type[0])
+		return 0;
+	for (i = 0; i < gres_type_cnt; i++) {
+		if (!xstrcmp(gres_type_name[i], type))
+			return i + 1;
+	}
+	xrealloc(gres_type_name, sizeof(char *) * (gres_type_cnt + 1));
+	gres_type_name[gres_type_cnt++] = xstrdup(type);
+	return gres_type_cnt;
+}
+
+/* Return the type id of a job's GRES request, resolving it on first use.
+ * Caller must hold gres_context_lock. */
+static uint32_t _job_type_id(gres_job_state_t *job_gres_ptr)
+{
+	if ((job_gres_ptr->type_id == 0) && job_gres_ptr->type_model)
+		job_gres_ptr->type_id = _gres_type_id(job_gres_ptr->type_model);
+	return job_gres_ptr->type_id;
+}
+
+/*
+ * Build the numeric index of a node's topo_ and type_ arrays: the type id
+ * of each record and, for each topo_ record, the type_ record which
+ * accounts for it. Caller must hold gres_context_lock.
+ */
+static void _node_index_build(gres_node_state_t *gres_data)
+{
+	int i, j;
+
+	if (gres_data->index_valid)
+		return;
+
+	xfree(gres_data->topo_type_id);
+	xfree(gres_data->topo_type_inx);
+	xfree(gres_data->type_id);
+	if (gres_data->type_cnt) {
+		gres_data->type_id = xmalloc(sizeof(uint32_t) *
+					     gres_data->type_cnt);
+	}
+	for (j = 0; j < gres_data->type_cnt; j++) {
+		gres_data->type_id[j] =
+			_gres_type_id(gres_data->type_model[j]);
+	}
+	if (gres_data->topo_cnt) {
+		gres_data->topo_type_id = xmalloc(sizeof(uint32_t) *
+						  gres_data->topo_cnt);
+		gres_data->topo_type_inx = xmalloc(sizeof(int) *
+						   gres_data->topo_cnt);
+	}
+	for (i = 0; i < gres_data->topo_cnt; i++) {
+		gres_data->topo_type_id[i] = gres_data->topo_model ?
+			_gres_type_id(gres_data->topo_model[i]) : 0;
+		gres_data->topo_type_inx[i] = -1;
+		if (gres_data->topo_type_id[i] == 0)
+			continue;
+		for (j = 0; j < gres_data->type_cnt; j++) {
+			if (gres_data->type_id[j] ==
+			    gres_data->topo_type_id[i]) {
+				gres_data->topo_type_inx[i] = j;
+				break;
+			}
+		}
+	}
+	gres_data->index_valid = true;
+}
+
+/*
+ * Copy the CPUs of one node from a system-wide cpu_bitmap into a bitmap
+ * sized for that node, so they can be compared against topo_cpus_bitmap
+ * with word-wide bitmap operations.
+ */
+static bitstr_t *_node_cpu_bitmap(bitstr_t *cpu_bitmap, int cpu_start_bit,
+				  int cpus_ctld)
+{
+	bitstr_t *node_cpus = bit_alloc(cpus_ctld);
+	int i;
+
+	if (!cpu_bitmap) {
+		bit_nset(node_cpus, 0, cpus_ctld - 1);
+		return node_cpus;
+	}
+	for (i = 0; i < cpus_ctld; i++) {
+		if (bit_test(cpu_bitmap, cpu_start_bit + i))
+			bit_set(node_cpus, i);
+	}
+	return node_cpus;
+}
+
 static int _gres_find_id(void *x, void *key)
 {
 	uint32_t *plugin_id = (uint32_t *)key;
@@ -536,6 +641,10 @@ extern int gres_plugin_fini(void)
 	xfree(gres_context);
 	xfree(gres_plugin_list);
 	FREE_NULL_LIST(gres_conf_list);
+	for (i = 0; i < gres_type_cnt; i++)
+		xfree(gres_type_name[i]);
+	xfree(gres_type_name);
+	gres_type_cnt = 0;
 	gres_context_cnt = -1;
 
 fini:	slurm_mutex_unlock(&gres_context_lock);
@@ -1353,6 +1462,9 @@ static void _gres_node_list_delete(void *list_element)
 	xfree(gres_node_ptr->type_cnt_alloc);
 	xfree(gres_node_ptr->type_cnt_avail);
 	xfree(gres_node_ptr->type_model);
+	xfree(gres_node_ptr->topo_type_id);
+	xfree(gres_node_ptr->topo_type_inx);
+	xfree(gres_node_ptr->type_id);
 	xfree(gres_node_ptr);
 	xfree(gres_ptr);
 }
@@ -1387,6 +1499,7 @@ static void _add_gres_type(char *type, gres_node_state_t *gres_data,
 				 sizeof(char *) * gres_data->type_cnt);
 		gres_data->type_cnt_avail[i] += tmp_gres_cnt;
 		gres_data->type_model[i] = xstrdup(type);
+		gres_data->index_valid = false;
 	}
 }
 
@@ -1781,6 +1894,7 @@ extern int _node_config_validate(char *node_name, char *orig_config,
 		xfree(gres_data->topo_cpus_bitmap);
 		xfree(gres_data->topo_model);
 		gres_data->topo_cnt = set_cnt;
+		gres_data->index_valid = false;
 	}
 
 	if (context_ptr->has_file && (set_cnt != gres_data->topo_cnt)) {
@@ -1812,6 +1926,7 @@ extern int _node_config_validate(char *node_name, char *orig_config,
 		gres_data->topo_model = xrealloc(gres_data->topo_model,
 						 set_cnt * sizeof(char *));
 		gres_data->topo_cnt = set_cnt;
+		gres_data->index_valid = false;
 
 		iter = list_iterator_create(gres_conf_list);
 		gres_inx = i = 0;
@@ -1920,6 +2035,7 @@ extern int _node_config_validate(char *node_name, char *orig_config,
 			xfree(gres_data->topo_model);
 		}
 		gres_data->topo_cnt = 0;
+		gres_data->index_valid = false;
 	} else if ((fast_schedule == 0) &&
 		   (gres_data->gres_cnt_found > gres_data->gres_cnt_config)) {
 		/* need to rebuild new_config */
@@ -3429,6 +3545,7 @@ static void	_job_core_filter(void *job_gres_data, void *node_gres_data,
 				 char *gres_name, char *node_name)
 {
 	int i, j, cpus_ctld;
+	uint32_t type_id;
 	gres_job_state_t  *job_gres_ptr  = (gres_job_state_t *)  job_gres_data;
 	gres_node_state_t *node_gres_ptr = (gres_node_state_t *) node_gres_data;
 	bitstr_t *avail_cpu_bitmap = NULL;
@@ -3437,9 +3554,12 @@ static void	_job_core_filter(void *job_gres_data, void *node_gres_data,
 	    !job_gres_ptr->gres_cnt_alloc)		/* No job GRES */
 		return;
 
-	/* Determine which specific CPUs can be used */
-	avail_cpu_bitmap = bit_copy(cpu_bitmap);
-	bit_nclear(avail_cpu_bitmap, cpu_start_bit, cpu_end_bit);
+	/* Determine which specific CPUs can be used: the union of the
+	 * node-relative CPU bitmaps of every usable topology record */
+	_node_index_build(node_gres_ptr);
+	type_id = _job_type_id(job_gres_ptr);
+	cpus_ctld = cpu_end_bit - cpu_start_bit + 1;
+	_validate_gres_node_cpus(node_gres_ptr, cpus_ctld, node_name);
 	for (i = 0; i < node_gres_ptr->topo_cnt; i++) {
 		if (node_gres_ptr->topo_gres_cnt_avail[i] == 0)
 			continue;
@@ -3447,25 +3567,24 @@ static void	_job_core_filter(void *job_gres_data, void *node_gres_data,
 		    (node_gres_ptr->topo_gres_cnt_alloc[i] >=
 		     node_gres_ptr->topo_gres_cnt_avail[i]))
 			continue;
-		if (job_gres_ptr->type_model &&
-		    (!node_gres_ptr->topo_model[i] ||
-		     xstrcmp(job_gres_ptr->type_model,
-			     node_gres_ptr->topo_model[i])))
+		if (type_id && (node_gres_ptr->topo_type_id[i] != type_id))
 			continue;
 		if (!node_gres_ptr->topo_cpus_bitmap[i]) {
 			FREE_NULL_BITMAP(avail_cpu_bitmap);	/* No filter */
 			return;
 		}
-		cpus_ctld = cpu_end_bit - cpu_start_bit + 1;
-		_validate_gres_node_cpus(node_gres_ptr, cpus_ctld, node_name);
-		cpus_ctld = bit_size(node_gres_ptr->topo_cpus_bitmap[i]);
-		for (j = 0; j < cpus_ctld; j++) {
-			if (bit_test(node_gres_ptr->topo_cpus_bitmap[i], j)) {
-				bit_set(avail_cpu_bitmap, cpu_start_bit + j);
-			}
+		if (!avail_cpu_bitmap) {
+			avail_cpu_bitmap =
+				bit_copy(node_gres_ptr->topo_cpus_bitmap[i]);
+		} else {
+			bit_or(avail_cpu_bitmap,
+			       node_gres_ptr->topo_cpus_bitmap[i]);
 		}
 	}
-	bit_and(cpu_bitmap, avail_cpu_bitmap);
+	for (j = 0; j < cpus_ctld; j++) {
+		if (!avail_cpu_bitmap || !bit_test(avail_cpu_bitmap, j))
+			bit_clear(cpu_bitmap, cpu_start_bit + j);
+	}
 	FREE_NULL_BITMAP(avail_cpu_bitmap);
 }
 
@@ -3474,17 +3593,20 @@ static uint32_t _job_test(void *job_gres_data, void *node_gres_data,
 			  int cpu_start_bit, int cpu_end_bit, bool *topo_set,
 			  uint32_t job_id, char *node_name, char *gres_name)
 {
-	int i, j, cpu_size, cpus_ctld, top_inx;
+	int i, j, cpus_ctld, top_inx;
 	uint64_t gres_avail = 0, gres_total;
 	gres_job_state_t  *job_gres_ptr  = (gres_job_state_t *)  job_gres_data;
 	gres_node_state_t *node_gres_ptr = (gres_node_state_t *) node_gres_data;
 	uint32_t *cpus_addnt = NULL;  /* Additional CPUs avail from this GRES */
 	uint32_t *cpus_avail = NULL;  /* CPUs initially avail from this GRES */
-	uint32_t cpu_cnt = 0;
+	uint32_t cpu_cnt = 0, type_id;
 	bitstr_t *alloc_cpu_bitmap = NULL;
+	bitstr_t *node_cpu_bitmap = NULL;
 
 	if (node_gres_ptr->no_consume)
 		use_total_gres = true;
+	_node_index_build(node_gres_ptr);
+	type_id = _job_type_id(job_gres_ptr);
 
 	if (job_gres_ptr->gres_cnt_alloc && node_gres_ptr->topo_cnt &&
 	    *topo_set) {
@@ -3501,10 +3623,8 @@ static uint32_t _job_test(void *job_gres_data, void *node_gres_data,
 						 node_name);
 		}
 		for (i = 0; i < node_gres_ptr->topo_cnt; i++) {
-			if (job_gres_ptr->type_model &&
-			    (!node_gres_ptr->topo_model[i] ||
-			     xstrcmp(node_gres_ptr->topo_model[i],
-				     job_gres_ptr->type_model)))
+			if (type_id &&
+			    (node_gres_ptr->topo_type_id[i] != type_id))
 				continue;
 			if (!node_gres_ptr->topo_cpus_bitmap[i]) {
 				gres_avail += node_gres_ptr->
@@ -3515,24 +3635,28 @@ static uint32_t _job_test(void *job_gres_data, void *node_gres_data,
 				}
 				continue;
 			}
-			cpus_ctld = bit_size(node_gres_ptr->
-					     topo_cpus_bitmap[i]);
-			for (j = 0; j < cpus_ctld; j++) {
-				if (cpu_bitmap &&
-				    !bit_test(cpu_bitmap, cpu_start_bit+j))
-					continue;
-				if (!bit_test(node_gres_ptr->
-					      topo_cpus_bitmap[i], j))
+			if (!cpu_bitmap) {
+				if (bit_ffs(node_gres_ptr->
+					    topo_cpus_bitmap[i]) == -1)
 					continue; /* not avail for this gres */
-				gres_avail += node_gres_ptr->
-					      topo_gres_cnt_avail[i];
-				if (!use_total_gres) {
-					gres_avail -= node_gres_ptr->
-						      topo_gres_cnt_alloc[i];
+			} else {
+				if (!node_cpu_bitmap) {
+					node_cpu_bitmap = _node_cpu_bitmap(
+						cpu_bitmap, cpu_start_bit,
+						cpu_end_bit - cpu_start_bit + 1);
 				}
-				break;
+				if (!bit_overlap(node_cpu_bitmap,
+						 node_gres_ptr->
+						 topo_cpus_bitmap[i]))
+					continue; /* not avail for this gres */
+			}
+			gres_avail += node_gres_ptr->topo_gres_cnt_avail[i];
+			if (!use_total_gres) {
+				gres_avail -= node_gres_ptr->
+					      topo_gres_cnt_alloc[i];
 			}
 		}
+		FREE_NULL_BITMAP(node_cpu_bitmap);
 		if (job_gres_ptr->gres_cnt_alloc > gres_avail)
 			return (uint32_t) 0;	/* insufficient, gres to use */
 		return NO_VAL;
@@ -3563,15 +3687,8 @@ static uint32_t _job_test(void *job_gres_data, void *node_gres_data,
 			}
 		}
 
-		alloc_cpu_bitmap = bit_alloc(cpus_ctld);
-		if (cpu_bitmap) {
-			for (j = 0; j < cpus_ctld; j++) {
-				if (bit_test(cpu_bitmap, cpu_start_bit+j))
-					bit_set(alloc_cpu_bitmap, j);
-			}
-		} else {
-			bit_nset(alloc_cpu_bitmap, 0, cpus_ctld - 1);
-		}
+		alloc_cpu_bitmap = _node_cpu_bitmap(cpu_bitmap, cpu_start_bit,
+						    cpus_ctld);
 
 		cpus_addnt = xmalloc(sizeof(uint32_t)*node_gres_ptr->topo_cnt);
 		cpus_avail = xmalloc(sizeof(uint32_t)*node_gres_ptr->topo_cnt);
@@ -3582,24 +3699,22 @@ static uint32_t _job_test(void *job_gres_data, void *node_gres_data,
 			    (node_gres_ptr->topo_gres_cnt_alloc[i] >=
 			     node_gres_ptr->topo_gres_cnt_avail[i]))
 				continue;
-			if (job_gres_ptr->type_model &&
-			    (!node_gres_ptr->topo_model[i] ||
-			     xstrcmp(node_gres_ptr->topo_model[i],
-				     job_gres_ptr->type_model)))
+			if (type_id &&
+			    (node_gres_ptr->topo_type_id[i] != type_id))
 				continue;
 			if (!node_gres_ptr->topo_cpus_bitmap[i]) {
 				cpus_avail[i] = cpu_end_bit - cpu_start_bit + 1;
 				continue;
 			}
-			cpu_size = bit_size(node_gres_ptr->topo_cpus_bitmap[i]);
-			for (j = 0; j < cpu_size; j++) {
-				if (cpu_bitmap &&
-				    !bit_test(cpu_bitmap, cpu_start_bit+j))
-					continue;
-				if (bit_test(node_gres_ptr->
-					     topo_cpus_bitmap[i], j)) {
-					cpus_avail[i]++;
-				}
+			if (cpu_bitmap) {
+				/* alloc_cpu_bitmap still holds the CPUs
+				 * usable on this node */
+				cpus_avail[i] = bit_overlap(alloc_cpu_bitmap,
+							    node_gres_ptr->
+							    topo_cpus_bitmap[i]);
+			} else {
+				cpus_avail[i] = bit_set_count(node_gres_ptr->
+							topo_cpus_bitmap[i]);
 			}
 		}
 
@@ -3672,11 +3787,9 @@ static uint32_t _job_test(void *job_gres_data, void *node_gres_data,
 		xfree(cpus_addnt);
 		xfree(cpus_avail);
 		return cpu_cnt;
-	} else if (job_gres_ptr->type_model) {
+	} else if (type_id) {
 		for (i = 0; i < node_gres_ptr->type_cnt; i++) {
-			if (node_gres_ptr->type_model[i] &&
-			    !xstrcmp(node_gres_ptr->type_model[i],
-				     job_gres_ptr->type_model))
+			if (node_gres_ptr->type_id[i] == type_id)
 				break;
 		}
 		if (i >= node_gres_ptr->type_cnt)
@@ -3865,10 +3978,8 @@ static bool _cores_on_gres(bitstr_t *core_bitmap, bitstr_t *alloc_core_bitmap,
 			continue;
 		if (!bit_test(node_gres_ptr->topo_gres_bitmap[i], gres_inx))
 			continue;
-		if (job_gres_ptr->type_model &&
-		    (!node_gres_ptr->topo_model[i] ||
-		     xstrcmp(job_gres_ptr->type_model,
-			     node_gres_ptr->topo_model[i])))
+		if (job_gres_ptr->type_id &&
+		    (node_gres_ptr->topo_type_id[i] != job_gres_ptr->type_id))
 			continue;
 		if (!node_gres_ptr->topo_cpus_bitmap[i])
 			return true;
@@ -3932,6 +4043,7 @@ static int _job_alloc(void *job_gres_data, void *node_gres_data,
 {
 	int j, k, sz1, sz2;
 	uint64_t gres_cnt, i;
+	uint32_t type_id;
 	gres_job_state_t  *job_gres_ptr  = (gres_job_state_t *)  job_gres_data;
 	gres_node_state_t *node_gres_ptr = (gres_node_state_t *) node_gres_data;
 	bool type_array_updated = false;
@@ -3949,6 +4061,8 @@ static int _job_alloc(void *job_gres_data, void *node_gres_data,
 	if (node_gres_ptr->no_consume)
 		return SLURM_SUCCESS;
 
+	_node_index_build(node_gres_ptr);
+	type_id = _job_type_id(job_gres_ptr);
 	xfree(node_gres_ptr->gres_used);	/* Clear cache */
 	if (job_gres_ptr->node_cnt == 0) {
 		job_gres_ptr->node_cnt = node_cnt;
@@ -4082,10 +4196,8 @@ static int _job_alloc(void *job_gres_data, void *node_gres_data,
 	    node_gres_ptr->topo_gres_bitmap &&
 	    node_gres_ptr->topo_gres_cnt_alloc) {
 		for (i = 0; i < node_gres_ptr->topo_cnt; i++) {
-			if (job_gres_ptr->type_model &&
-			    (!node_gres_ptr->topo_model[i] ||
-			     xstrcmp(job_gres_ptr->type_model,
-				     node_gres_ptr->topo_model[i])))
+			if (type_id &&
+			    (node_gres_ptr->topo_type_id[i] != type_id))
 				continue;
 			sz1 = bit_size(job_gres_ptr->gres_bit_alloc[node_offset]);
 			sz2 = bit_size(node_gres_ptr->topo_gres_bitmap[i]);
@@ -4100,17 +4212,9 @@ static int _job_alloc(void *job_gres_data, void *node_gres_data,
 					       node_gres_ptr->
 					       topo_gres_bitmap[i]);
 			node_gres_ptr->topo_gres_cnt_alloc[i] += gres_cnt;
-			if ((node_gres_ptr->type_cnt == 0) ||
-			    (node_gres_ptr->topo_model == NULL) ||
-			    (node_gres_ptr->topo_model[i] == NULL))
-				continue;
-			for (j = 0; j < node_gres_ptr->type_cnt; j++) {
-				if (!node_gres_ptr->type_model[j] ||
-				    xstrcmp(node_gres_ptr->topo_model[i],
-					    node_gres_ptr->type_model[j]))
-					continue;
+			j = node_gres_ptr->topo_type_inx[i];
+			if (j >= 0)
 				node_gres_ptr->type_cnt_alloc[j] += gres_cnt;
-			}
 		}
 		type_array_updated = true;
 	} else if (job_gres_ptr->gres_bit_alloc &&
@@ -4148,9 +4252,9 @@ static int _job_alloc(void *job_gres_data, void *node_gres_data,
 			 * underflows when this job is deallocated */
 			_add_gres_type(job_gres_ptr->type_model, node_gres_ptr,
 				       0);
+			_node_index_build(node_gres_ptr);
 			for (j = 0; j < node_gres_ptr->type_cnt; j++) {
-				if (xstrcmp(job_gres_ptr->type_model,
-					    node_gres_ptr->type_model[j]))
+				if (node_gres_ptr->type_id[j] != type_id)
 					continue;
 				node_gres_ptr->type_cnt_alloc[j] +=
 					job_gres_ptr->gres_cnt_alloc;
@@ -4159,12 +4263,10 @@ static int _job_alloc(void *job_gres_data, void *node_gres_data,
 		}
 	}
 
-	if (!type_array_updated && job_gres_ptr->type_model) {
+	if (!type_array_updated && type_id) {
 		gres_cnt = job_gres_ptr->gres_cnt_alloc;
 		for (j = 0; j < node_gres_ptr->type_cnt; j++) {
-			if (!node_gres_ptr->type_model[j] ||
-			    xstrcmp(job_gres_ptr->type_model,
-				    node_gres_ptr->type_model[j]))
+			if (node_gres_ptr->type_id[j] != type_id)
 				continue;
 			k = node_gres_ptr->type_cnt_avail[j] -
 			    node_gres_ptr->type_cnt_alloc[j];
@@ -4261,6 +4363,7 @@ static int _job_dealloc(void *job_gres_data, void *node_gres_data,
 			char *node_name)
 {
 	int i, j, len, sz1, sz2;
+	uint32_t type_id;
 	gres_job_state_t  *job_gres_ptr  = (gres_job_state_t *)  job_gres_data;
 	gres_node_state_t *node_gres_ptr = (gres_node_state_t *) node_gres_data;
 	bool type_array_updated = false;
@@ -4284,6 +4387,8 @@ static int _job_dealloc(void *job_gres_data, void *node_gres_data,
 		return SLURM_ERROR;
 	}
 
+	_node_index_build(node_gres_ptr);
+	type_id = _job_type_id(job_gres_ptr);
 	xfree(node_gres_ptr->gres_used);	/* Clear cache */
 	if (node_gres_ptr->gres_bit_alloc && job_gres_ptr->gres_bit_alloc &&
 	    job_gres_ptr->gres_bit_alloc[node_offset]) {
@@ -4351,29 +4456,19 @@ static int _job_dealloc(void *job_gres_data, void *node_gres_data,
 				      gres_cnt);
 				node_gres_ptr->topo_gres_cnt_alloc[i] = 0;
 			}
-			if ((node_gres_ptr->type_cnt == 0) ||
-			    (node_gres_ptr->topo_model == NULL) ||
-			    (node_gres_ptr->topo_model[i] == NULL))
+			if ((j = node_gres_ptr->topo_type_inx[i]) < 0)
 				continue;
-			for (j = 0; j < node_gres_ptr->type_cnt; j++) {
-				if (!node_gres_ptr->type_model[j] ||
-				    xstrcmp(node_gres_ptr->topo_model[i],
-					    node_gres_ptr->type_model[j]))
-					continue;
-				if (node_gres_ptr->type_cnt_alloc[j] >=
-				    gres_cnt) {
-					node_gres_ptr->type_cnt_alloc[j] -=
-						gres_cnt;
-				} else {
-					error("gres/%s: job %u dealloc node %s "
-					      "type %s gres count underflow "
-					      "(%"PRIu64" %"PRIu64")",
-					      gres_name, job_id, node_name,
-					      node_gres_ptr->type_model[j],
-					      node_gres_ptr->type_cnt_alloc[j],
-					      gres_cnt);
-					node_gres_ptr->type_cnt_alloc[j] = 0;
-				}
+			if (node_gres_ptr->type_cnt_alloc[j] >= gres_cnt) {
+				node_gres_ptr->type_cnt_alloc[j] -= gres_cnt;
+			} else {
+				error("gres/%s: job %u dealloc node %s type %s "
+				      "gres count underflow "
+				      "(%"PRIu64" %"PRIu64")",
+				      gres_name, job_id, node_name,
+				      node_gres_ptr->type_model[j],
+				      node_gres_ptr->type_cnt_alloc[j],
+				      gres_cnt);
+				node_gres_ptr->type_cnt_alloc[j] = 0;
 			}
 		}
 		type_array_updated = true;
@@ -4405,12 +4500,10 @@ static int _job_dealloc(void *job_gres_data, void *node_gres_data,
 		type_array_updated = true;
 	}
 
-	if (!type_array_updated && job_gres_ptr->type_model) {
+	if (!type_array_updated && type_id) {
 		gres_cnt = job_gres_ptr->gres_cnt_alloc;
 		for (j = 0; j < node_gres_ptr->type_cnt; j++) {
-			if (!node_gres_ptr->type_model[j] ||
-			    xstrcmp(job_gres_ptr->type_model,
-				    node_gres_ptr->type_model[j]))
+			if (node_gres_ptr->type_id[j] != type_id)
 				continue;
 			k = MIN(gres_cnt, node_gres_ptr->type_cnt_alloc[j]);
 			node_gres_ptr->type_cnt_alloc[j] -= k;
@@ -116,11 +116,21 @@ typedef struct gres_node_state {
 	uint64_t *type_cnt_alloc;
 	uint64_t *type_cnt_avail;
 	char **type_model;		/* Type of this gres (e.g. model name) */
+
+	/* Numeric index of the topo_ and type_ arrays used by job tests and
+	 * allocations in place of model name compares. Built on demand by
+	 * gres.c, invalidated when either array is changed */
+	bool index_valid;
+	uint32_t *topo_type_id;		/* type id of each topo_ record */
+	int *topo_type_inx;		/* type_ array index of each topo_
+					 * record, -1 if none */
+	uint32_t *type_id;		/* type id of each type_ record */
 } gres_node_state_t;
 
 /* Gres job state as used by slurmctld daemon */
 typedef struct gres_job_state {
 	char *type_model;		/* Type of this gres (e.g. model name) */
+	uint32_t type_id;		/* Numeric type_model, set on demand */
 
 	/* Count of resources needed per node */
 	uint64_t gres_cnt_alloc;
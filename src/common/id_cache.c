@@ -0,0 +1,637 @@
+/*****************************************************************************\
+ *  id_cache.c - cache of user names, group access lists and group members
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+
+#include "config.h"
+
+/* needed for getgrent_r */
+#define _GNU_SOURCE
+#define   __USE_GNU
+
+#include <grp.h>
+#include <pthread.h>
+#include <pwd.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "src/common/id_cache.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/siphash.h"
+#include "src/common/timers.h"
+#include "src/common/uid.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "slurm/slurm_errno.h"
+
+/*
+ * Looking up users and groups can take seconds with a remote directory
+ * service behind NSS, and enumerating a group's members walks the whole
+ * group and password databases. Results are kept here for the daemons with
+ * a time to live. Entries looked up within the last two TTLs are resolved
+ * again by a background thread when half their TTL has passed, so callers
+ * holding daemon locks rarely wait on a lookup. Failed lookups are cached
+ * too, for ID_CACHE_NEG_TTL at most.
+ */
+
+#define ID_CACHE_HASH_SIZE	1024
+#define ID_CACHE_NEG_TTL	60	/* secs to cache a failed lookup */
+#define ID_CACHE_TTL		600	/* secs, default until id_cache_init() */
+
+enum {
+	ID_CACHE_UID_NAME,		/* uid -> user name */
+	ID_CACHE_USER_GIDS,		/* user name, gid -> group access list */
+	ID_CACHE_GROUP_MEMBERS		/* group name -> member uids */
+};
+
+typedef struct id_cache_ent {
+	int type;			/* ID_CACHE_* */
+	char *name;			/* user or group name looked up */
+	uint32_t id;			/* uid or primary gid looked up */
+	bool negative;			/* lookup failed */
+	char *user_name;		/* ID_CACHE_UID_NAME result */
+	uint32_t *ids;			/* gids or uids, zero terminated uids */
+	int id_cnt;			/* entries in ids */
+	time_t resolved;		/* time of last resolution */
+	time_t used;			/* time of last lookup */
+	struct id_cache_ent *next;	/* next entry in hash bucket */
+} id_cache_ent_t;
+
+static pthread_mutex_t id_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t id_cache_cond = PTHREAD_COND_INITIALIZER;
+static id_cache_ent_t **id_cache_hash = NULL;
+static id_cache_stats_t id_cache_stats;
+static int id_cache_ttl = ID_CACHE_TTL;
+static pthread_t id_cache_thread = 0;
+static bool id_cache_shutdown = false;
+
+static int _hash_inx(int type, char *name, uint32_t id)
+{
+	if (type == ID_CACHE_UID_NAME)
+		return id % ID_CACHE_HASH_SIZE;
+	return (siphash_str(name) + id) % ID_CACHE_HASH_SIZE;
+}
+
+static void _ent_free(id_cache_ent_t *ent)
+{
+	xfree(ent->name);
+	xfree(ent->user_name);
+	xfree(ent->ids);
+	xfree(ent);
+}
+
+/* Call with id_cache_lock */
+static id_cache_ent_t **_find(int type, char *name, uint32_t id)
+{
+	id_cache_ent_t **ent_pptr;
+
+	if (!id_cache_hash)
+		return NULL;
+	ent_pptr = &id_cache_hash[_hash_inx(type, name, id)];
+	for ( ; *ent_pptr; ent_pptr = &(*ent_pptr)->next) {
+		if (((*ent_pptr)->type == type) && ((*ent_pptr)->id == id) &&
+		    !xstrcmp((*ent_pptr)->name, name))
+			return ent_pptr;
+	}
+	return NULL;
+}
+
+/* Call with id_cache_lock */
+static bool _fresh(id_cache_ent_t *ent, time_t now)
+{
+	if (ent->negative)
+		return (difftime(now, ent->resolved) <
+			MIN(ID_CACHE_NEG_TTL, id_cache_ttl ? id_cache_ttl :
+			    ID_CACHE_NEG_TTL));
+	if (id_cache_ttl == 0)
+		return true;
+	return (difftime(now, ent->resolved) < id_cache_ttl);
+}
+
+static void _resolve_uid_name(id_cache_ent_t *ent)
+{
+	struct passwd pwd, *result = NULL;
+	char buffer[PW_BUF_SIZE];
+
+	/* Suse Linux does not handle multiple users with UID=0 well */
+	if (ent->id == 0) {
+		ent->user_name = xstrdup("root");
+		return;
+	}
+	if (!slurm_getpwuid_r((uid_t) ent->id, &pwd, buffer, PW_BUF_SIZE,
+			      &result) && result)
+		ent->user_name = xstrdup(result->pw_name);
+	else
+		ent->negative = true;
+}
+
+static void _resolve_user_gids(id_cache_ent_t *ent)
+{
+	int ngroups = 64;
+	gid_t *groups;
+
+	groups = xmalloc(sizeof(gid_t) * ngroups);
+	if (getgrouplist(ent->name, (gid_t) ent->id, groups, &ngroups) < 0) {
+		xrealloc(groups, sizeof(gid_t) * ngroups);
+		if (getgrouplist(ent->name, (gid_t) ent->id, groups,
+				 &ngroups) < 0) {
+			error("getgrouplist(%s) failed", ent->name);
+			/* Retry after the negative TTL rather than dropping
+			 * the user's groups until the entry is refreshed */
+			xfree(groups);
+			ngroups = 0;
+			ent->negative = true;
+		}
+	}
+	ent->ids = (uint32_t *) groups;
+	ent->id_cnt = ngroups;
+}
+
+/* Add uid to a zero terminated list of ent->id_cnt uids */
+static void _add_member(id_cache_ent_t *ent, uid_t uid, int *size)
+{
+	if (uid == 0)
+		return;
+	if (ent->id_cnt + 1 >= *size) {
+		*size += 100;
+		xrealloc(ent->ids, sizeof(uid_t) * *size);
+	}
+	ent->ids[ent->id_cnt++] = uid;
+}
+
+static void _resolve_group_members(id_cache_ent_t *ent)
+{
+	char *grp_buffer = NULL;
+	struct group grp, *grp_result = NULL;
+	struct passwd *pwd_result = NULL;
+	uid_t my_uid;
+	gid_t my_gid;
+	int buflen = PW_BUF_SIZE, i, res, size = 0;
+#if defined (__APPLE__) || defined (__CYGWIN__)
+#else
+	char pw_buffer[PW_BUF_SIZE];
+	struct passwd pw;
+#endif
+
+#if defined(_SC_GETGR_R_SIZE_MAX)
+	i = sysconf(_SC_GETGR_R_SIZE_MAX);
+	buflen = MAX(buflen, i);
+#endif
+	grp_buffer = xmalloc(buflen);
+	while (1) {
+		slurm_seterrno(0);
+		res = getgrnam_r(ent->name, &grp, grp_buffer, buflen,
+				 &grp_result);
+
+		/* We need to check for !grp_result, since it appears some
+		 * versions of this function do not return an error on
+		 * failure.
+		 */
+		if (res != 0 || !grp_result) {
+			if (errno == ERANGE) {
+				buflen *= 2;
+				xrealloc(grp_buffer, buflen);
+				continue;
+			}
+			error("%s: Could not find configured group %s",
+			      __func__, ent->name);
+			xfree(grp_buffer);
+			ent->negative = true;
+			return;
+		}
+		break;
+	}
+	my_gid = grp_result->gr_gid;
+
+	/* Get the members from the getgrnam_r() call.
+	 */
+	for (i = 0; grp_result->gr_mem[i]; i++) {
+		if (uid_from_string(grp_result->gr_mem[i], &my_uid) < 0)
+			continue;
+		_add_member(ent, my_uid, &size);
+	}
+
+	/* Note that in environments where user/group enumeration has
+	 * been disabled (typically necessary for large user/group
+	 * databases), the rest of this function essentially does
+	 * nothing.  */
+
+	slurm_getent_lock();
+#if defined (__APPLE__) || defined (__CYGWIN__)
+	setgrent();
+	while (1) {
+		if ((grp_result = getgrent()) == NULL)
+			break;
+#else
+	setgrent();
+	while (1) {
+		/* MH-CEA workaround to handle different group entries with
+		 * the same gid
+		 */
+		slurm_seterrno(0);
+		res = getgrent_r(&grp, grp_buffer, buflen, &grp_result);
+		if (res != 0 || grp_result == NULL) {
+			/* FreeBSD returns 0 and sets the grp_result to NULL
+			 * unlike linux which returns ENOENT.
+			 */
+			if (errno == ERANGE) {
+				buflen *= 2;
+				xrealloc(grp_buffer, buflen);
+				continue;
+			}
+			break;
+		}
+#endif
+		if (grp_result->gr_gid == my_gid) {
+			if (xstrcmp(grp_result->gr_name, ent->name)) {
+				debug("including members of group '%s' as it "
+				      "corresponds to the same gid as group"
+				      " '%s'", grp_result->gr_name, ent->name);
+			}
+
+			for (i = 0; grp_result->gr_mem[i]; i++) {
+				if (uid_from_string(grp_result->gr_mem[i],
+						    &my_uid) < 0) {
+					/* Group member without valid login */
+					continue;
+				}
+				_add_member(ent, my_uid, &size);
+			}
+		}
+	}
+	endgrent();
+	setpwent();
+#if defined (__sun)
+	while ((pwd_result = getpwent_r(&pw, pw_buffer, PW_BUF_SIZE)) != NULL) {
+#elif defined (__APPLE__) || defined (__CYGWIN__)
+	while ((pwd_result = getpwent()) != NULL) {
+#else
+	while (!getpwent_r(&pw, pw_buffer, PW_BUF_SIZE, &pwd_result)) {
+#endif
+		/* At eof FreeBSD returns 0 unlike Linux
+		 * which returns ENOENT.
+		 */
+		if (pwd_result == NULL)
+			break;
+		if (pwd_result->pw_gid != my_gid)
+			continue;
+		_add_member(ent, pwd_result->pw_uid, &size);
+	}
+	endpwent();
+	slurm_getent_unlock();
+	xfree(grp_buffer);
+
+	if (!ent->ids)
+		ent->ids = xmalloc(sizeof(uid_t));
+	ent->ids[ent->id_cnt] = 0;
+}
+
+/* Resolve an entry without holding id_cache_lock
+ * RET usec taken */
+static long _resolve(id_cache_ent_t *ent)
+{
+	DEF_TIMERS;
+
+	START_TIMER;
+	switch (ent->type) {
+	case ID_CACHE_UID_NAME:
+		_resolve_uid_name(ent);
+		break;
+	case ID_CACHE_USER_GIDS:
+		_resolve_user_gids(ent);
+		break;
+	case ID_CACHE_GROUP_MEMBERS:
+		_resolve_group_members(ent);
+		break;
+	}
+	END_TIMER;
+	ent->resolved = time(NULL);
+
+	return DELTA_TIMER;
+}
+
+/* Record a resolved entry in place of any older one for the same key.
+ * Call with id_cache_lock. RET the entry, now owned by the cache */
+static id_cache_ent_t *_store(id_cache_ent_t *ent, long usec)
+{
+	id_cache_ent_t **ent_pptr, *old_ent;
+	int inx;
+
+	id_cache_stats.resolve_max = MAX(id_cache_stats.resolve_max, usec);
+	id_cache_stats.resolve_sum += usec;
+
+	if (!id_cache_hash) {
+		id_cache_hash = xmalloc(sizeof(id_cache_ent_t *) *
+					ID_CACHE_HASH_SIZE);
+	}
+	if ((ent_pptr = _find(ent->type, ent->name, ent->id))) {
+		old_ent = *ent_pptr;
+		ent->next = old_ent->next;
+		ent->used = MAX(ent->used, old_ent->used);
+		*ent_pptr = ent;
+		_ent_free(old_ent);
+	} else {
+		inx = _hash_inx(ent->type, ent->name, ent->id);
+		ent->next = id_cache_hash[inx];
+		id_cache_hash[inx] = ent;
+		id_cache_stats.entry_cnt++;
+	}
+	return ent;
+}
+
+/* Find the entry for a key, resolving it first if missing or expired.
+ * RET the entry with id_cache_lock held */
+static id_cache_ent_t *_lookup(int type, char *name, uint32_t id)
+{
+	id_cache_ent_t **ent_pptr, *ent;
+	time_t now = time(NULL);
+	long usec;
+
+	slurm_mutex_lock(&id_cache_lock);
+	if ((ent_pptr = _find(type, name, id)) && _fresh(*ent_pptr, now)) {
+		id_cache_stats.hit_cnt++;
+		(*ent_pptr)->used = now;
+		return *ent_pptr;
+	}
+	slurm_mutex_unlock(&id_cache_lock);
+
+	ent = xmalloc(sizeof(id_cache_ent_t));
+	ent->type = type;
+	ent->name = xstrdup(name);
+	ent->id = id;
+	ent->used = now;
+	usec = _resolve(ent);
+
+	slurm_mutex_lock(&id_cache_lock);
+	id_cache_stats.miss_cnt++;
+	return _store(ent, usec);
+}
+
+/* Call with id_cache_lock */
+static void _purge(int type)
+{
+	id_cache_ent_t **ent_pptr, *ent;
+	int i;
+
+	if (!id_cache_hash)
+		return;
+	for (i = 0; i < ID_CACHE_HASH_SIZE; i++) {
+		ent_pptr = &id_cache_hash[i];
+		while ((ent = *ent_pptr)) {
+			if ((type >= 0) && (ent->type != type)) {
+				ent_pptr = &ent->next;
+				continue;
+			}
+			*ent_pptr = ent->next;
+			_ent_free(ent);
+			id_cache_stats.entry_cnt--;
+		}
+	}
+}
+
+/* Drop expired failed lookups and entries not looked up for two TTLs, then
+ * resolve again those entries which are past half their TTL */
+static void _refresh(void)
+{
+	id_cache_ent_t **ent_pptr, *ent, *refresh = NULL, *next;
+	time_t now = time(NULL);
+	int i, half_ttl;
+	long usec;
+
+	slurm_mutex_lock(&id_cache_lock);
+	half_ttl = id_cache_ttl / 2;
+	for (i = 0; id_cache_hash && (i < ID_CACHE_HASH_SIZE); i++) {
+		ent_pptr = &id_cache_hash[i];
+		while ((ent = *ent_pptr)) {
+			if ((ent->negative && !_fresh(ent, now)) ||
+			    (difftime(now, ent->used) >= (2 * id_cache_ttl))) {
+				*ent_pptr = ent->next;
+				_ent_free(ent);
+				id_cache_stats.entry_cnt--;
+				continue;
+			}
+			if (!ent->negative &&
+			    (difftime(now, ent->resolved) >= half_ttl)) {
+				next = xmalloc(sizeof(id_cache_ent_t));
+				next->type = ent->type;
+				next->name = xstrdup(ent->name);
+				next->id = ent->id;
+				next->next = refresh;
+				refresh = next;
+			}
+			ent_pptr = &ent->next;
+		}
+	}
+	slurm_mutex_unlock(&id_cache_lock);
+
+	for (ent = refresh; ent && !id_cache_shutdown; ent = next) {
+		next = ent->next;
+		refresh = next;
+		usec = _resolve(ent);
+		slurm_mutex_lock(&id_cache_lock);
+		/* Keep a good result if the refresh failed */
+		if (!ent->negative) {
+			id_cache_stats.refresh_cnt++;
+			(void) _store(ent, usec);
+			ent = NULL;
+		}
+		slurm_mutex_unlock(&id_cache_lock);
+		if (ent)
+			_ent_free(ent);
+	}
+	for (ent = refresh; ent; ent = next) {
+		next = ent->next;
+		_ent_free(ent);
+	}
+}
+
+static void *_refresh_thread(void *arg)
+{
+	struct timespec ts = {0, 0};
+	int interval;
+
+	slurm_mutex_lock(&id_cache_lock);
+	while (!id_cache_shutdown && id_cache_ttl) {
+		interval = MAX(id_cache_ttl / 4, 1);
+		ts.tv_sec = time(NULL) + interval;
+		slurm_cond_timedwait(&id_cache_cond, &id_cache_lock, &ts);
+		if (id_cache_shutdown || !id_cache_ttl)
+			break;
+		slurm_mutex_unlock(&id_cache_lock);
+		_refresh();
+		slurm_mutex_lock(&id_cache_lock);
+	}
+	id_cache_thread = 0;
+	slurm_mutex_unlock(&id_cache_lock);
+
+	return NULL;
+}
+
+extern void id_cache_init(int ttl)
+{
+	pthread_attr_t attr;
+
+	slurm_mutex_lock(&id_cache_lock);
+	id_cache_ttl = ttl;
+	id_cache_shutdown = false;
+	if (ttl && !id_cache_thread) {
+		slurm_attr_init(&attr);
+		if (pthread_create(&id_cache_thread, &attr, _refresh_thread,
+				   NULL)) {
+			error("%s: pthread_create: %m", __func__);
+			id_cache_thread = 0;
+		}
+		slurm_attr_destroy(&attr);
+	}
+	slurm_cond_broadcast(&id_cache_cond);
+	slurm_mutex_unlock(&id_cache_lock);
+}
+
+extern void id_cache_fini(void)
+{
+	pthread_t thread_id;
+
+	slurm_mutex_lock(&id_cache_lock);
+	id_cache_shutdown = true;
+	thread_id = id_cache_thread;
+	slurm_cond_broadcast(&id_cache_cond);
+	slurm_mutex_unlock(&id_cache_lock);
+	if (thread_id)
+		pthread_join(thread_id, NULL);
+
+	slurm_mutex_lock(&id_cache_lock);
+	_purge(-1);
+	xfree(id_cache_hash);
+	slurm_mutex_unlock(&id_cache_lock);
+}
+
+extern void id_cache_purge(void)
+{
+	slurm_mutex_lock(&id_cache_lock);
+	_purge(-1);
+	slurm_mutex_unlock(&id_cache_lock);
+}
+
+extern void id_cache_purge_groups(void)
+{
+	slurm_mutex_lock(&id_cache_lock);
+	_purge(ID_CACHE_GROUP_MEMBERS);
+	slurm_mutex_unlock(&id_cache_lock);
+}
+
+extern char *id_cache_uid_to_name(uid_t uid)
+{
+	id_cache_ent_t *ent;
+	char *user_name;
+
+	ent = _lookup(ID_CACHE_UID_NAME, NULL, (uint32_t) uid);
+	user_name = xstrdup(ent->user_name);
+	slurm_mutex_unlock(&id_cache_lock);
+
+	return user_name;
+}
+
+extern char *id_cache_uid_to_string(uid_t uid)
+{
+	char *user_name = id_cache_uid_to_name(uid);
+
+	if (!user_name)
+		user_name = xstrdup("nobody");
+	return user_name;
+}
+
+extern int id_cache_user_gids(char *user_name, gid_t gid, gid_t **gids)
+{
+	id_cache_ent_t *ent;
+	int ngids;
+
+	ent = _lookup(ID_CACHE_USER_GIDS, user_name, (uint32_t) gid);
+	ngids = ent->id_cnt;
+	*gids = NULL;
+	if (ngids) {
+		*gids = xmalloc(sizeof(gid_t) * ngids);
+		memcpy(*gids, ent->ids, sizeof(gid_t) * ngids);
+	}
+	slurm_mutex_unlock(&id_cache_lock);
+
+	return ngids;
+}
+
+extern uid_t *id_cache_group_members(char *group_name)
+{
+	id_cache_ent_t *ent;
+	uid_t *uids = NULL;
+	int sz;
+
+	ent = _lookup(ID_CACHE_GROUP_MEMBERS, group_name, 0);
+	if (!ent->negative) {
+		sz = sizeof(uid_t) * (ent->id_cnt + 1);
+		uids = xmalloc(sz);
+		memcpy(uids, ent->ids, sz);
+	}
+	slurm_mutex_unlock(&id_cache_lock);
+
+	return uids;
+}
+
+extern void id_cache_get_stats(id_cache_stats_t *stats)
+{
+	id_cache_ent_t *ent;
+	int i;
+
+	slurm_mutex_lock(&id_cache_lock);
+	memcpy(stats, &id_cache_stats, sizeof(id_cache_stats_t));
+	stats->neg_cnt = 0;
+	for (i = 0; id_cache_hash && (i < ID_CACHE_HASH_SIZE); i++) {
+		for (ent = id_cache_hash[i]; ent; ent = ent->next) {
+			if (ent->negative)
+				stats->neg_cnt++;
+		}
+	}
+	slurm_mutex_unlock(&id_cache_lock);
+}
+
+extern void id_cache_reset_stats(void)
+{
+	slurm_mutex_lock(&id_cache_lock);
+	id_cache_stats.hit_cnt = 0;
+	id_cache_stats.miss_cnt = 0;
+	id_cache_stats.refresh_cnt = 0;
+	id_cache_stats.resolve_max = 0;
+	id_cache_stats.resolve_sum = 0;
+	slurm_mutex_unlock(&id_cache_lock);
+}
@@ -0,0 +1,108 @@
+/*****************************************************************************\
+ *  id_cache.h - cache of user names, group access lists and group members
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+#ifndef _ID_CACHE_H
+#define _ID_CACHE_H
+
+#include <inttypes.h>
+#include <sys/types.h>
+
+/* Statistics of the identity cache, see id_cache_get_stats() */
+typedef struct {
+	uint32_t entry_cnt;	/* entries cached */
+	uint32_t neg_cnt;	/* entries caching a failed lookup */
+	uint32_t hit_cnt;	/* lookups answered from the cache */
+	uint32_t miss_cnt;	/* lookups resolved by the caller */
+	uint32_t refresh_cnt;	/* entries resolved again in the background */
+	uint32_t resolve_max;	/* usec, longest resolution */
+	uint64_t resolve_sum;	/* usec, all resolutions */
+} id_cache_stats_t;
+
+/*
+ * Set how long resolved entries stay valid and start the thread refreshing
+ * entries in use before they expire. Call again on reconfiguration.
+ * IN ttl - seconds, GroupUpdateTime. With zero entries never expire and are
+ *          not refreshed. Failed lookups are cached for at most a minute.
+ */
+extern void id_cache_init(int ttl);
+
+/* Stop the refresh thread and free every entry */
+extern void id_cache_fini(void);
+
+/* Free every entry, the next lookup of each is resolved again */
+extern void id_cache_purge(void);
+
+/* Free the entries for group members, see id_cache_group_members() */
+extern void id_cache_purge_groups(void);
+
+/*
+ * Translate a uid to a user name. Like the other entries the name is
+ * resolved again by the refresh thread, so a renamed user may be reported
+ * under the old name for up to the TTL given to id_cache_init(). With a zero
+ * TTL names are kept until id_cache_purge(), which reconfiguration calls.
+ * RET the name or NULL if the uid is unknown, xfree the return value
+ */
+extern char *id_cache_uid_to_name(uid_t uid);
+
+/*
+ * Translate a uid to a user name as uid_to_string(), "nobody" if unknown.
+ * RET the name, xfree the return value
+ */
+extern char *id_cache_uid_to_string(uid_t uid);
+
+/*
+ * Get the group access list of a user, as getgrouplist().
+ * IN user_name - user to look up
+ * IN gid - user's primary group, included in the list
+ * OUT gids - the groups, xfree when not NULL
+ * RET count of groups in gids
+ */
+extern int id_cache_user_gids(char *user_name, gid_t gid, gid_t **gids);
+
+/*
+ * Identify the users in a group, by its members and the users whose primary
+ * group it is. Groups sharing its gid are included. Root is never included.
+ * IN group_name - a single group name
+ * RET a zero terminated list of UIDs or NULL if there is no such group,
+ *     xfree the return value
+ */
+extern uid_t *id_cache_group_members(char *group_name);
+
+/* Copy the statistics of the cache */
+extern void id_cache_get_stats(id_cache_stats_t *stats);
+
+/* Clear those statistics, other than the counts of entries */
+extern void id_cache_reset_stats(void);
+
+#endif /* !_ID_CACHE_H */
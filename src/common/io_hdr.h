@@ -54,6 +54,15 @@
 #define SLURM_IO_STDERR 2
 #define SLURM_IO_ALLSTDIN 3
 #define SLURM_IO_CONNECTION_TEST 4
+#define SLURM_IO_BATCH 5	/* body is a series of framed STDOUT/STDERR
+				 * messages, sent when LAUNCH_COALESCE_IO */
+
+/* Limits on a SLURM_IO_BATCH message. The extra 16 bytes per message cover
+ * the packed header of each framed message (see io_hdr_packed_size()). */
+#define IO_BATCH_MAX_MSGS	64
+#define IO_BATCH_FLUSH_LEN	(16 * MAX_MSG_LEN)
+#define IO_BATCH_MAX_LEN	(IO_BATCH_MAX_MSGS * (MAX_MSG_LEN + 16))
+#define IO_BATCH_DELAY_MSEC	10	/* default latency cap */
 
 struct slurm_io_init_msg {
 	uint16_t      version;
@@ -53,9 +53,20 @@
 #include "src/common/xstring.h"
 #include "src/slurmd/slurmd/slurmd.h"
 
+/* In adaptive mode the window size in messages may grow up to this many
+ * times the configured WindowMsgs */
+#define ADAPT_MSG_SCALE		8
+/* Shortest adaptive window in msec */
+#define ADAPT_MIN_WINDOW	1
+/* Longest gap between messages counted toward the mean arrival time */
+#define ADAPT_MAX_ARRIVAL	10000000
+
 typedef struct {
+	bool		adaptive;
 	pthread_mutex_t	aggr_mutex;
 	pthread_cond_t	cond;
+	uint64_t	cur_max_msg_cnt; /* max_msg_cnt in effect */
+	uint64_t	cur_window;	/* window in effect */
 	uint32_t        debug_flags;
 	bool		max_msgs;
 	uint64_t        max_msg_cnt;
@@ -64,6 +75,10 @@ typedef struct {
 	pthread_mutex_t	mutex;
 	slurm_addr_t    node_addr;
 	bool            running;
+	msg_aggr_stats_t stats;
+	struct timeval	last_arrival;	/* when the last msg was added */
+	struct timeval	last_send;	/* when the last composite msg was
+					 * sent, cleared when acknowledged */
 	pthread_t       thread_id;
 	uint64_t        window;
 } msg_collection_type_t;
@@ -184,6 +199,70 @@ static int _send_to_next_collector(slurm_msg_t *msg)
 	return rc;
 }
 
+static uint32_t _delta_usec(struct timeval *start, struct timeval *end)
+{
+	int64_t usec;
+
+	usec = ((int64_t) (end->tv_sec - start->tv_sec) * 1000000) +
+	       (end->tv_usec - start->tv_usec);
+	if (usec < 0)
+		return 0;
+	if (usec > ADAPT_MAX_ARRIVAL)
+		return ADAPT_MAX_ARRIVAL;
+	return (uint32_t) usec;
+}
+
+/* Add a sample to a running mean which weighs recent samples most */
+static void _add_sample(uint32_t *mean, uint32_t sample)
+{
+	if (*mean == 0)
+		*mean = sample;
+	else
+		*mean = ((uint64_t) *mean * 7 + sample) / 8;
+}
+
+/*
+ * _adapt_window - resize the collection window after sending a composite
+ *	message, called with msg_collection.mutex locked
+ * IN msg_cnt - count of messages sent in the composite message
+ */
+static void _adapt_window(uint64_t msg_cnt)
+{
+	uint64_t arrival = msg_collection.stats.arrival_usec;
+	uint64_t ack = msg_collection.stats.ack_usec / 1000;
+	uint64_t target;
+
+	/* Batches which fill before the window expires are too small for
+	 * the load, grow them. Shrink them back when mostly empty. */
+	if (msg_cnt >= msg_collection.cur_max_msg_cnt) {
+		msg_collection.cur_max_msg_cnt =
+			MIN(msg_collection.cur_max_msg_cnt * 2,
+			    msg_collection.max_msg_cnt * ADAPT_MSG_SCALE);
+	} else if ((msg_cnt * 4) < msg_collection.cur_max_msg_cnt) {
+		msg_collection.cur_max_msg_cnt =
+			MAX(msg_collection.cur_max_msg_cnt / 2,
+			    msg_collection.max_msg_cnt);
+	}
+
+	/* If fewer than two messages are expected within the configured
+	 * window, waiting only adds latency. Otherwise wait long enough to
+	 * fill a batch at the observed arrival rate. Never send batches
+	 * faster than the collector acknowledges them. */
+	if (!arrival || ((msg_collection.window * 1000) < (arrival * 2)))
+		target = ADAPT_MIN_WINDOW;
+	else
+		target = (arrival * msg_collection.cur_max_msg_cnt) / 1000;
+	target = MAX(target, ack);
+	target = MIN(target, msg_collection.window);
+	target = MAX(target, ADAPT_MIN_WINDOW);
+	msg_collection.cur_window = (msg_collection.cur_window + target) / 2;
+	if (msg_collection.cur_window < ADAPT_MIN_WINDOW)
+		msg_collection.cur_window = ADAPT_MIN_WINDOW;
+
+	msg_collection.stats.window = msg_collection.cur_window;
+	msg_collection.stats.max_msg_cnt = msg_collection.cur_max_msg_cnt;
+}
+
 /*
  * _msg_aggregation_sender()
  *
@@ -197,6 +276,7 @@ static void * _msg_aggregation_sender(void *arg)
 	struct timespec timeout;
 	slurm_msg_t msg;
 	composite_msg_t cmp;
+	uint64_t msg_cnt;
 
 	msg_collection.running = 1;
 
@@ -213,9 +293,10 @@ static void * _msg_aggregation_sender(void *arg)
 
 		/* A msg has been collected; start new window */
 		gettimeofday(&now, NULL);
-		timeout.tv_sec = now.tv_sec + (msg_collection.window / 1000);
+		timeout.tv_sec = now.tv_sec +
+			(msg_collection.cur_window / 1000);
 		timeout.tv_nsec = (now.tv_usec * 1000) +
-			(1000000 * (msg_collection.window % 1000));
+			(1000000 * (msg_collection.cur_window % 1000));
 		timeout.tv_sec += timeout.tv_nsec / 1000000000;
 		timeout.tv_nsec %= 1000000000;
 
@@ -245,12 +326,20 @@ static void * _msg_aggregation_sender(void *arg)
 		msg.msg_type = MESSAGE_COMPOSITE;
 		msg.protocol_version = SLURM_PROTOCOL_VERSION;
 		msg.data = &cmp;
+		msg_cnt = list_count(cmp.msg_list);
+		gettimeofday(&msg_collection.last_send, NULL);
 		if (_send_to_next_collector(&msg) != SLURM_SUCCESS) {
 			error("_msg_aggregation_engine: Unable to send "
 			      "composite msg: %m");
+			msg_collection.stats.batch_fail++;
 		}
 		FREE_NULL_LIST(cmp.msg_list);
 
+		msg_collection.stats.batch_cnt++;
+		msg_collection.stats.msg_cnt += msg_cnt;
+		if (msg_collection.adaptive)
+			_adapt_window(msg_cnt);
+
 		/* Resume message collection */
 		slurm_cond_broadcast(&msg_collection.cond);
 	}
@@ -260,7 +349,7 @@ static void * _msg_aggregation_sender(void *arg)
 }
 
 extern void msg_aggr_sender_init(char *host, uint16_t port, uint64_t window,
-				 uint64_t max_msg_cnt)
+				 uint64_t max_msg_cnt, bool adaptive)
 {
 	pthread_attr_t attr;
 	int            retries = 0;
@@ -279,6 +368,12 @@ extern void msg_aggr_sender_init(char *host, uint16_t port, uint64_t window,
 	slurm_set_addr(&msg_collection.node_addr, port, host);
 	msg_collection.window = window;
 	msg_collection.max_msg_cnt = max_msg_cnt;
+	msg_collection.adaptive = adaptive;
+	msg_collection.cur_window = window;
+	msg_collection.cur_max_msg_cnt = max_msg_cnt;
+	msg_collection.stats.adaptive = adaptive;
+	msg_collection.stats.window = window;
+	msg_collection.stats.max_msg_cnt = max_msg_cnt;
 	msg_collection.msg_aggr_list = list_create(_msg_aggr_free);
 	msg_collection.msg_list = list_create(slurm_free_comp_msg_list);
 	msg_collection.max_msgs = false;
@@ -299,12 +394,19 @@ extern void msg_aggr_sender_init(char *host, uint16_t port, uint64_t window,
 	return;
 }
 
-extern void msg_aggr_sender_reconfig(uint64_t window, uint64_t max_msg_cnt)
+extern void msg_aggr_sender_reconfig(uint64_t window, uint64_t max_msg_cnt,
+				     bool adaptive)
 {
 	if (msg_collection.running) {
 		slurm_mutex_lock(&msg_collection.mutex);
 		msg_collection.window = window;
 		msg_collection.max_msg_cnt = max_msg_cnt;
+		msg_collection.adaptive = adaptive;
+		msg_collection.cur_window = window;
+		msg_collection.cur_max_msg_cnt = max_msg_cnt;
+		msg_collection.stats.adaptive = adaptive;
+		msg_collection.stats.window = window;
+		msg_collection.stats.max_msg_cnt = max_msg_cnt;
 		msg_collection.debug_flags = slurm_get_debug_flags();
 		slurm_mutex_unlock(&msg_collection.mutex);
 	} else if (max_msg_cnt > 1) {
@@ -342,6 +444,7 @@ extern void msg_aggr_add_msg(slurm_msg_t *msg, bool wait,
 {
 	int count;
 	static uint16_t msg_index = 1;
+	struct timeval now;
 
 	if (!msg_collection.running)
 		return;
@@ -351,6 +454,13 @@ extern void msg_aggr_add_msg(slurm_msg_t *msg, bool wait,
 		slurm_cond_wait(&msg_collection.cond, &msg_collection.mutex);
 	}
 
+	gettimeofday(&now, NULL);
+	if (msg_collection.last_arrival.tv_sec) {
+		_add_sample(&msg_collection.stats.arrival_usec,
+			    _delta_usec(&msg_collection.last_arrival, &now));
+	}
+	msg_collection.last_arrival = now;
+
 	msg->msg_index = msg_index++;
 
 	/* Add msg to message collection */
@@ -364,7 +474,7 @@ extern void msg_aggr_add_msg(slurm_msg_t *msg, bool wait,
 		slurm_cond_signal(&msg_collection.cond);
 
 	/* Max msgs reached; terminate window */
-	if (count >= msg_collection.max_msg_cnt) {
+	if (count >= msg_collection.cur_max_msg_cnt) {
 		msg_collection.max_msgs = true;
 		slurm_cond_signal(&msg_collection.cond);
 	}
@@ -428,6 +538,22 @@ extern void msg_aggr_resp(slurm_msg_t *msg)
 	msg_aggr_t *msg_aggr;
 	ListIterator itr;
 
+	if (msg_collection.running) {
+		struct timeval now;
+
+		/* The first response after sending a composite msg tells how
+		 * long the collector took to acknowledge it */
+		gettimeofday(&now, NULL);
+		slurm_mutex_lock(&msg_collection.mutex);
+		if (msg_collection.last_send.tv_sec) {
+			_add_sample(&msg_collection.stats.ack_usec,
+				    _delta_usec(&msg_collection.last_send,
+						&now));
+			msg_collection.last_send.tv_sec = 0;
+		}
+		slurm_mutex_unlock(&msg_collection.mutex);
+	}
+
 	comp_msg = (composite_msg_t *)msg->data;
 	itr = list_iterator_create(comp_msg->msg_list);
 	if (msg_collection.debug_flags & DEBUG_FLAG_ROUTE)
@@ -485,3 +611,14 @@ extern void msg_aggr_resp(slurm_msg_t *msg)
 		info("msg aggr: _rpc_composite_resp: finished processing "
 		     "composite msg_list...");
 }
+
+extern void msg_aggr_get_stats(msg_aggr_stats_t *stats)
+{
+	memset(stats, 0, sizeof(msg_aggr_stats_t));
+	if (!msg_collection.running)
+		return;
+
+	slurm_mutex_lock(&msg_collection.mutex);
+	memcpy(stats, &msg_collection.stats, sizeof(msg_aggr_stats_t));
+	slurm_mutex_unlock(&msg_collection.mutex);
+}
@@ -44,11 +44,36 @@
 
 #include "src/common/slurm_protocol_defs.h"
 
+/* Message aggregation statistics for this node's collection window */
+typedef struct {
+	bool     adaptive;	/* window adapts to load */
+	uint32_t batch_cnt;	/* composite messages sent */
+	uint32_t batch_fail;	/* composite messages not sent */
+	uint32_t msg_cnt;	/* messages sent in composite messages */
+	uint64_t max_msg_cnt;	/* window size in messages in effect */
+	uint64_t window;	/* window size in msec in effect */
+	uint32_t arrival_usec;	/* mean time between messages */
+	uint32_t ack_usec;	/* mean time for collector to acknowledge */
+} msg_aggr_stats_t;
+
+/* start collecting messages
+ * IN: host, port - address of this node, where responses are sent
+ * IN: window - maximum time to collect messages in msec
+ * IN: max_msg_cnt - maximum count of messages to collect
+ * IN: adaptive - if set, resize the window to the observed message arrival
+ *	rate and collector acknowledgment latency, with window as its
+ *	upper bound and max_msg_cnt as its initial message count
+ */
 extern void msg_aggr_sender_init(char *host, uint16_t port, uint64_t window,
-				 uint64_t max_msg_cnt);
-extern void msg_aggr_sender_reconfig(uint64_t window, uint64_t max_msg_cnt);
+				 uint64_t max_msg_cnt, bool adaptive);
+extern void msg_aggr_sender_reconfig(uint64_t window, uint64_t max_msg_cnt,
+				     bool adaptive);
 extern void msg_aggr_sender_fini(void);
 
+/* get a copy of the message aggregation statistics, all zero if message
+ * aggregation is not running */
+extern void msg_aggr_get_stats(msg_aggr_stats_t *stats);
+
 /* add a message that needs to be sent.
  * IN: msg - message to be sent
  * IN: wait - whether or not we need to wait for a response
@@ -135,6 +135,55 @@ void grow_buf (Buf buffer, uint32_t size)
 	xrealloc_nz(buffer->head, buffer->size);
 }
 
+/*
+ * _grow_buf - make room for size more bytes at a buffer's current offset.
+ *	The buffer grows geometrically, by at least half its current size, so
+ *	packing a large message takes a logarithmic rather than linear number
+ *	of reallocations.
+ * IN/OUT buffer - buffer to grow
+ * IN size - count of bytes about to be packed
+ * IN caller - name of calling function, for error messages
+ * RET SLURM_SUCCESS or SLURM_ERROR if the buffer would exceed MAX_BUF_SIZE
+ */
+static int _grow_buf(Buf buffer, uint32_t size, const char *caller)
+{
+	uint64_t min_size, new_size;
+
+	min_size = (uint64_t) buffer->processed + size;
+	if (min_size > MAX_BUF_SIZE) {
+		error("%s: Buffer size limit exceeded (%"PRIu64" > %u)",
+		      caller, min_size, MAX_BUF_SIZE);
+		return SLURM_ERROR;
+	}
+
+	new_size = (uint64_t) buffer->size + MAX(buffer->size / 2, BUF_SIZE);
+	new_size = MAX(new_size, min_size + BUF_SIZE);
+	if (new_size > MAX_BUF_SIZE)
+		new_size = MAX_BUF_SIZE;
+	buffer->size = new_size;
+	xrealloc_nz(buffer->head, buffer->size);
+	return SLURM_SUCCESS;
+}
+
+/*
+ * _make_room - make room in a buffer for cnt values of the given size
+ * RET SLURM_SUCCESS or SLURM_ERROR if the buffer would exceed MAX_BUF_SIZE
+ */
+static int _make_room(Buf buffer, uint32_t cnt, uint32_t size,
+		      const char *caller)
+{
+	uint64_t need = (uint64_t) cnt * size;
+
+	if (need > MAX_BUF_SIZE) {
+		error("%s: Buffer size limit exceeded (%"PRIu64" > %u)",
+		      caller, need, MAX_BUF_SIZE);
+		return SLURM_ERROR;
+	}
+	if (remaining_buf(buffer) < need)
+		return _grow_buf(buffer, need, caller);
+	return SLURM_SUCCESS;
+}
+
 /* init_buf - create an empty buffer of the given size */
 Buf init_buf(uint32_t size)
 {
@@ -167,6 +216,54 @@ void *xfer_buf_data(Buf my_buf)
 	return data_ptr;
 }
 
+/* Largest buffer a pool keeps for reuse. Larger buffers are freed, but the
+ * pool still starts new buffers at their size. */
+#define BUF_POOL_KEEP_SIZE	(16 * 1024 * 1024)
+
+/* pool_init_buf - get an empty buffer from a pool, either the buffer last
+ * released to the pool or a new buffer as large as the largest packed */
+Buf pool_init_buf(buf_pool_t *pool)
+{
+	Buf my_buf;
+	uint32_t size;
+
+	slurm_mutex_lock(&pool->mutex);
+	my_buf = pool->buf;
+	pool->buf = NULL;
+	size = pool->high_size;
+	slurm_mutex_unlock(&pool->mutex);
+
+	if (my_buf) {
+		my_buf->processed = 0;
+		return my_buf;
+	}
+	return init_buf(size);
+}
+
+static void _pool_high_size(buf_pool_t *pool, Buf my_buf)
+{
+	if (pool->high_size < my_buf->processed)
+		pool->high_size = my_buf->processed;
+}
+
+/* pool_free_buf - release a buffer from pool_init_buf() back to its pool */
+void pool_free_buf(buf_pool_t *pool, Buf my_buf)
+{
+	if (!my_buf)
+		return;
+	assert(my_buf->magic == BUF_MAGIC);
+
+	slurm_mutex_lock(&pool->mutex);
+	_pool_high_size(pool, my_buf);
+	if (!pool->buf && (my_buf->size <= BUF_POOL_KEEP_SIZE)) {
+		pool->buf = my_buf;
+		my_buf = NULL;
+	}
+	slurm_mutex_unlock(&pool->mutex);
+
+	free_buf(my_buf);
+}
+
 /*
  * Given a time_t in host byte order, promote it to int64_t, convert to
  * network byte order, store in buffer and adjust buffer acc'd'ngly
@@ -175,16 +272,9 @@ void pack_time(time_t val, Buf buffer)
 {
 	int64_t n64 = HTON_int64((int64_t) val);
 
-	if (remaining_buf(buffer) < sizeof(n64)) {
-		if ((buffer->size + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < sizeof(n64)) &&
+	    _grow_buf(buffer, sizeof(n64), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &n64, sizeof(n64));
 	buffer->processed += sizeof(n64);
@@ -222,16 +312,9 @@ void 	packdouble(double val, Buf buffer)
 	  * more than 15 decimals will mess things up, but this corrects it. */
 	uval.d =  (val * FLOAT_MULT);
 	nl =  HTON_uint64(uval.u);
-	if (remaining_buf(buffer) < sizeof(nl)) {
-		if ((buffer->size + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < sizeof(nl)) &&
+	    _grow_buf(buffer, sizeof(nl), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
 	buffer->processed += sizeof(nl);
@@ -303,16 +386,9 @@ void pack64(uint64_t val, Buf buffer)
 {
 	uint64_t nl =  HTON_uint64(val);
 
-	if (remaining_buf(buffer) < sizeof(nl)) {
-		if ((buffer->size + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < sizeof(nl)) &&
+	    _grow_buf(buffer, sizeof(nl), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
 	buffer->processed += sizeof(nl);
@@ -342,16 +418,9 @@ void pack32(uint32_t val, Buf buffer)
 {
 	uint32_t nl = htonl(val);
 
-	if (remaining_buf(buffer) < sizeof(nl)) {
-		if ((buffer->size + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < sizeof(nl)) &&
+	    _grow_buf(buffer, sizeof(nl), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
 	buffer->processed += sizeof(nl);
@@ -376,71 +445,127 @@ int unpack32(uint32_t * valp, Buf buffer)
 /* Given a *uint16_t, it will pack an array of size_val */
 void pack16_array(uint16_t * valp, uint32_t size_val, Buf buffer)
 {
-	uint32_t i = 0;
+	uint32_t i;
+	char *dest;
+	uint16_t ns;
 
 	pack32(size_val, buffer);
+	if (_make_room(buffer, size_val, sizeof(ns), __func__))
+		return;
 
+	dest = &buffer->head[buffer->processed];
 	for (i = 0; i < size_val; i++) {
-		pack16(*(valp + i), buffer);
+		ns = htons(valp[i]);
+		memcpy(dest + (i * sizeof(ns)), &ns, sizeof(ns));
 	}
+	buffer->processed += size_val * sizeof(ns);
 }
 
 /* Given a int ptr, it will unpack an array of size_val
  */
 int unpack16_array(uint16_t ** valp, uint32_t * size_val, Buf buffer)
 {
-	uint32_t i = 0;
+	uint32_t i;
+	char *src;
+	uint16_t ns;
 
+	*valp = NULL;
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
+	if (((uint64_t) *size_val * sizeof(ns)) > remaining_buf(buffer))
+		return SLURM_ERROR;
 
 	*valp = xmalloc_nz((*size_val) * sizeof(uint16_t));
+	src = &buffer->head[buffer->processed];
 	for (i = 0; i < *size_val; i++) {
-		if (unpack16((*valp) + i, buffer))
-			return SLURM_ERROR;
+		memcpy(&ns, src + (i * sizeof(ns)), sizeof(ns));
+		(*valp)[i] = ntohs(ns);
 	}
+	buffer->processed += *size_val * sizeof(ns);
 	return SLURM_SUCCESS;
 }
 
 /* Given a *uint32_t, it will pack an array of size_val */
 void pack32_array(uint32_t * valp, uint32_t size_val, Buf buffer)
 {
-	uint32_t i = 0;
-
 	pack32(size_val, buffer);
-
-	for (i = 0; i < size_val; i++) {
-		pack32(*(valp + i), buffer);
-	}
+	pack32_values(valp, size_val, buffer);
 }
 
 /* Given a int ptr, it will unpack an array of size_val
  */
 int unpack32_array(uint32_t ** valp, uint32_t * size_val, Buf buffer)
 {
-	uint32_t i = 0;
-
+	*valp = NULL;
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
+	if (((uint64_t) *size_val * sizeof(uint32_t)) > remaining_buf(buffer))
+		return SLURM_ERROR;
 
 	*valp = xmalloc_nz((*size_val) * sizeof(uint32_t));
-	for (i = 0; i < *size_val; i++) {
-		if (unpack32((*valp) + i, buffer))
-			return SLURM_ERROR;
+	return unpack32_values(*valp, *size_val, buffer);
+}
+
+/*
+ * Given a pointer to size_val 32-bit integers in host byte order, store
+ * them in network byte order in the buffer, without their count. The
+ * byte-swapping loop follows a single bounds check and is simple enough
+ * for the compiler to vectorize.
+ */
+void pack32_values(uint32_t *valp, uint32_t size_val, Buf buffer)
+{
+	uint32_t i, nl;
+	char *dest;
+
+	if (_make_room(buffer, size_val, sizeof(nl), __func__))
+		return;
+
+	dest = &buffer->head[buffer->processed];
+	for (i = 0; i < size_val; i++) {
+		nl = htonl(valp[i]);
+		memcpy(dest + (i * sizeof(nl)), &nl, sizeof(nl));
 	}
+	buffer->processed += size_val * sizeof(nl);
+}
+
+/*
+ * Given a buffer containing size_val network byte order 32-bit integers,
+ * store them as host integers at valp, which must have room for them.
+ */
+int unpack32_values(uint32_t *valp, uint32_t size_val, Buf buffer)
+{
+	uint32_t i, nl;
+	char *src;
+
+	if (((uint64_t) size_val * sizeof(nl)) > remaining_buf(buffer))
+		return SLURM_ERROR;
+
+	src = &buffer->head[buffer->processed];
+	for (i = 0; i < size_val; i++) {
+		memcpy(&nl, src + (i * sizeof(nl)), sizeof(nl));
+		valp[i] = ntohl(nl);
+	}
+	buffer->processed += size_val * sizeof(nl);
 	return SLURM_SUCCESS;
 }
 
 /* Given a *uint64_t, it will pack an array of size_val */
 void pack64_array(uint64_t * valp, uint32_t size_val, Buf buffer)
 {
-	uint32_t i = 0;
+	uint32_t i;
+	uint64_t nl;
+	char *dest;
 
 	pack32(size_val, buffer);
+	if (_make_room(buffer, size_val, sizeof(nl), __func__))
+		return;
 
+	dest = &buffer->head[buffer->processed];
 	for (i = 0; i < size_val; i++) {
-		pack64(*(valp + i), buffer);
+		nl = HTON_uint64(valp[i]);
+		memcpy(dest + (i * sizeof(nl)), &nl, sizeof(nl));
 	}
+	buffer->processed += size_val * sizeof(nl);
 }
 
 /* Pack an array of 64bit values as if they were 32bit
@@ -460,16 +585,23 @@ void pack64_array_as_32(uint64_t * valp, uint32_t size_val, Buf buffer)
  */
 int unpack64_array(uint64_t ** valp, uint32_t * size_val, Buf buffer)
 {
-	uint32_t i = 0;
+	uint32_t i;
+	uint64_t nl;
+	char *src;
 
+	*valp = NULL;
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
+	if (((uint64_t) *size_val * sizeof(nl)) > remaining_buf(buffer))
+		return SLURM_ERROR;
 
 	*valp = xmalloc_nz((*size_val) * sizeof(uint64_t));
+	src = &buffer->head[buffer->processed];
 	for (i = 0; i < *size_val; i++) {
-		if (unpack64((*valp) + i, buffer))
-			return SLURM_ERROR;
+		memcpy(&nl, src + (i * sizeof(nl)), sizeof(nl));
+		(*valp)[i] = NTOH_uint64(nl);
 	}
+	buffer->processed += *size_val * sizeof(nl);
 	return SLURM_SUCCESS;
 }
 
@@ -553,16 +685,9 @@ void pack16(uint16_t val, Buf buffer)
 {
 	uint16_t ns = htons(val);
 
-	if (remaining_buf(buffer) < sizeof(ns)) {
-		if ((buffer->size + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < sizeof(ns)) &&
+	    _grow_buf(buffer, sizeof(ns), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
 	buffer->processed += sizeof(ns);
@@ -591,16 +716,9 @@ int unpack16(uint16_t * valp, Buf buffer)
  */
 void pack8(uint8_t val, Buf buffer)
 {
-	if (remaining_buf(buffer) < sizeof(uint8_t)) {
-		if ((buffer->size + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < sizeof(uint8_t)) &&
+	    _grow_buf(buffer, sizeof(uint8_t), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &val, sizeof(uint8_t));
 	buffer->processed += sizeof(uint8_t);
@@ -634,16 +752,9 @@ void packmem(char *valp, uint32_t size_val, Buf buffer)
 		      __func__, size_val, MAX_PACK_MEM_LEN);
 		return;
 	}
-	if (remaining_buf(buffer) < (sizeof(ns) + size_val)) {
-		if ((buffer->size + size_val + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + size_val + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += (size_val + BUF_SIZE);
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < (sizeof(ns) + size_val)) &&
+	    _grow_buf(buffer, sizeof(ns) + size_val, __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
 	buffer->processed += sizeof(ns);
@@ -811,16 +922,9 @@ void packstr_array(char **valp, uint32_t size_val, Buf buffer)
 	int i;
 	uint32_t ns = htonl(size_val);
 
-	if (remaining_buf(buffer) < sizeof(ns)) {
-		if ((buffer->size + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < sizeof(ns)) &&
+	    _grow_buf(buffer, sizeof(ns), __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
 	buffer->processed += sizeof(ns);
@@ -870,22 +974,145 @@ int unpackstr_array(char ***valp, uint32_t * size_valp, Buf buffer)
 	return SLURM_SUCCESS;
 }
 
+/* Wire size of a field, 0 if the field's size in its struct does not match
+ * its type */
+static uint32_t _field_wire_size(const pack_field_t *field)
+{
+	switch (field->type) {
+	case PACK_FIELD_16:
+		return (field->size == sizeof(uint16_t)) ? sizeof(uint16_t) : 0;
+	case PACK_FIELD_32:
+		return (field->size == sizeof(uint32_t)) ? sizeof(uint32_t) : 0;
+	case PACK_FIELD_64:
+		return (field->size == sizeof(uint64_t)) ? sizeof(uint64_t) : 0;
+	case PACK_FIELD_TIME:
+		return (field->size == sizeof(time_t)) ? sizeof(int64_t) : 0;
+	}
+	return 0;
+}
+
+static uint32_t _fields_wire_size(const pack_field_t *fields, int field_cnt)
+{
+	uint32_t size = 0, field_size;
+	int i;
+
+	for (i = 0; i < field_cnt; i++) {
+		field_size = _field_wire_size(&fields[i]);
+		if (!field_size)
+			fatal("%s: field %d invalid type %d size %u", __func__,
+			      i, fields[i].type, fields[i].size);
+		size += field_size;
+	}
+	return size;
+}
+
+/*
+ * Given a struct (obj) and descriptors of field_cnt of its scalar fields,
+ * store the fields in network byte order in the buffer, as pack16(),
+ * pack32(), pack64() or pack_time() would one at a time, with a single
+ * bounds check.
+ */
+void pack_fields(void *obj, const pack_field_t *fields, int field_cnt,
+		 Buf buffer)
+{
+	char *base = (char *) obj, *dest;
+	uint32_t size = _fields_wire_size(fields, field_cnt);
+	uint16_t ns;
+	uint32_t nl;
+	uint64_t n64;
+	int i;
+
+	if ((remaining_buf(buffer) < size) &&
+	    _grow_buf(buffer, size, __func__))
+		return;
+
+	dest = &buffer->head[buffer->processed];
+	for (i = 0; i < field_cnt; i++) {
+		switch (fields[i].type) {
+		case PACK_FIELD_16:
+			ns = htons(*(uint16_t *) (base + fields[i].offset));
+			memcpy(dest, &ns, sizeof(ns));
+			dest += sizeof(ns);
+			break;
+		case PACK_FIELD_32:
+			nl = htonl(*(uint32_t *) (base + fields[i].offset));
+			memcpy(dest, &nl, sizeof(nl));
+			dest += sizeof(nl);
+			break;
+		case PACK_FIELD_64:
+			n64 = HTON_uint64(*(uint64_t *)
+					  (base + fields[i].offset));
+			memcpy(dest, &n64, sizeof(n64));
+			dest += sizeof(n64);
+			break;
+		case PACK_FIELD_TIME:
+			n64 = HTON_int64((int64_t) *(time_t *)
+					 (base + fields[i].offset));
+			memcpy(dest, &n64, sizeof(n64));
+			dest += sizeof(n64);
+			break;
+		}
+	}
+	buffer->processed += size;
+}
+
+/*
+ * Given a buffer containing network byte order fields described by
+ * field_cnt descriptors, store them as host values in the struct at obj.
+ */
+int unpack_fields(void *obj, const pack_field_t *fields, int field_cnt,
+		  Buf buffer)
+{
+	char *base = (char *) obj, *src;
+	uint32_t size = _fields_wire_size(fields, field_cnt);
+	uint16_t ns;
+	uint32_t nl;
+	uint64_t n64;
+	int i;
+
+	if (remaining_buf(buffer) < size)
+		return SLURM_ERROR;
+
+	src = &buffer->head[buffer->processed];
+	for (i = 0; i < field_cnt; i++) {
+		switch (fields[i].type) {
+		case PACK_FIELD_16:
+			memcpy(&ns, src, sizeof(ns));
+			*(uint16_t *) (base + fields[i].offset) = ntohs(ns);
+			src += sizeof(ns);
+			break;
+		case PACK_FIELD_32:
+			memcpy(&nl, src, sizeof(nl));
+			*(uint32_t *) (base + fields[i].offset) = ntohl(nl);
+			src += sizeof(nl);
+			break;
+		case PACK_FIELD_64:
+			memcpy(&n64, src, sizeof(n64));
+			*(uint64_t *) (base + fields[i].offset) =
+				NTOH_uint64(n64);
+			src += sizeof(n64);
+			break;
+		case PACK_FIELD_TIME:
+			memcpy(&n64, src, sizeof(n64));
+			*(time_t *) (base + fields[i].offset) =
+				(time_t) NTOH_int64(n64);
+			src += sizeof(n64);
+			break;
+		}
+	}
+	buffer->processed += size;
+	return SLURM_SUCCESS;
+}
+
 /*
  * Given a pointer to memory (valp), size (size_val), and buffer,
  * store the memory contents into the buffer
  */
 void packmem_array(char *valp, uint32_t size_val, Buf buffer)
 {
-	if (remaining_buf(buffer) < size_val) {
-		if ((buffer->size + size_val + BUF_SIZE) > MAX_BUF_SIZE) {
-			error("%s: Buffer size limit exceeded (%u > %u)",
-			      __func__, (buffer->size + size_val + BUF_SIZE),
-			      MAX_BUF_SIZE);
-			return;
-		}
-		buffer->size += (size_val + BUF_SIZE);
-		xrealloc_nz(buffer->head, buffer->size);
-	}
+	if ((remaining_buf(buffer) < size_val) &&
+	    _grow_buf(buffer, size_val, __func__))
+		return;
 
 	memcpy(&buffer->head[buffer->processed], valp, size_val);
 	buffer->processed += size_val;
@@ -43,6 +43,8 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <stddef.h>
 #include <time.h>
 #include <string.h>
 
@@ -67,6 +69,45 @@ struct slurm_buf {
 
 typedef struct slurm_buf * Buf;
 
+/* A buffer pool serves buffers packed repeatedly at one place in the code,
+ * such as each of slurmctld's job, node, partition and front end state
+ * saves. New buffers start out at the largest size packed so far, and a
+ * released buffer is kept for reuse. */
+typedef struct buf_pool {
+	pthread_mutex_t mutex;
+	uint32_t high_size;	/* largest offset of buffers released */
+	Buf buf;		/* released buffer kept for reuse */
+} buf_pool_t;
+
+#define BUF_POOL_INITIALIZER(__size) \
+	{ PTHREAD_MUTEX_INITIALIZER, __size, NULL }
+
+/* Field descriptors let a run of scalar fields of a struct be packed with
+ * one bounds check, see pack_fields(). The wire format is the same as
+ * packing each field in turn with pack16(), pack32(), pack64() or
+ * pack_time(). */
+typedef enum {
+	PACK_FIELD_16,		/* uint16_t */
+	PACK_FIELD_32,		/* uint32_t */
+	PACK_FIELD_64,		/* uint64_t */
+	PACK_FIELD_TIME		/* time_t */
+} pack_field_type_t;
+
+typedef struct pack_field {
+	pack_field_type_t type;
+	uint16_t offset;	/* offset of field in its struct */
+	uint16_t size;		/* size of field in its struct */
+} pack_field_t;
+
+/* Describe field __field of type __type (16, 32, 64 or TIME) in struct
+ * __struct, e.g. PACK_FIELD(32, job_info_t, job_id) */
+#define PACK_FIELD(__type, __struct, __field)			\
+	{ PACK_FIELD_##__type, offsetof(__struct, __field),	\
+	  sizeof(((__struct *) 0)->__field) }
+
+/* Count of descriptors in an array of them */
+#define PACK_FIELD_CNT(__fields) (sizeof(__fields) / sizeof(pack_field_t))
+
 #define get_buf_data(__buf)		(__buf->head)
 #define get_buf_offset(__buf)		(__buf->processed)
 #define set_buf_offset(__buf,__val)	(__buf->processed = __val)
@@ -79,6 +120,11 @@ Buf	init_buf(uint32_t size);
 void    grow_buf (Buf my_buf, uint32_t size);
 void	*xfer_buf_data(Buf my_buf);
 
+/* pool_init_buf - get an empty buffer from a pool */
+Buf	pool_init_buf(buf_pool_t *pool);
+/* pool_free_buf - release a buffer from pool_init_buf() back to its pool */
+void	pool_free_buf(buf_pool_t *pool, Buf my_buf);
+
 void	pack_time(time_t val, Buf buffer);
 int	unpack_time(time_t *valp, Buf buffer);
 
@@ -128,6 +174,17 @@ int	unpackmem_malloc(char **valp, uint32_t *size_valp, Buf buffer);
 void	packstr_array(char **valp, uint32_t size_val, Buf buffer);
 int	unpackstr_array(char ***valp, uint32_t* size_val, Buf buffer);
 
+/* un/pack size_val 32-bit values without their count, as a series of
+ * pack32() calls would, into storage allocated by the caller */
+void	pack32_values(uint32_t *valp, uint32_t size_val, Buf buffer);
+int	unpack32_values(uint32_t *valp, uint32_t size_val, Buf buffer);
+
+/* un/pack the fields of the struct at obj described by fields[] */
+void	pack_fields(void *obj, const pack_field_t *fields, int field_cnt,
+		    Buf buffer);
+int	unpack_fields(void *obj, const pack_field_t *fields, int field_cnt,
+		      Buf buffer);
+
 void	packmem_array(char *valp, uint32_t size_val, Buf buffer);
 int	unpackmem_array(char *valp, uint32_t size_valp, Buf buffer);
 
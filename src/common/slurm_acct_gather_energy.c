@@ -195,26 +195,25 @@ extern void acct_gather_energy_destroy(acct_gather_energy_t *energy)
 	xfree(energy);
 }
 
+static const pack_field_t energy_fields[] = {
+	PACK_FIELD(64, acct_gather_energy_t, base_consumed_energy),
+	PACK_FIELD(32, acct_gather_energy_t, base_watts),
+	PACK_FIELD(64, acct_gather_energy_t, consumed_energy),
+	PACK_FIELD(32, acct_gather_energy_t, current_watts),
+	PACK_FIELD(64, acct_gather_energy_t, previous_consumed_energy),
+	PACK_FIELD(TIME, acct_gather_energy_t, poll_time),
+};
+
 extern void acct_gather_energy_pack(acct_gather_energy_t *energy, Buf buffer,
 				    uint16_t protocol_version)
 {
-	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
-		if (!energy) {
-			pack64(0, buffer);
-			pack32(0, buffer);
-			pack64(0, buffer);
-			pack32(0, buffer);
-			pack64(0, buffer);
-			pack_time(0, buffer);
-			return;
-		}
+	static acct_gather_energy_t energy_zero;
 
-		pack64(energy->base_consumed_energy, buffer);
-		pack32(energy->base_watts, buffer);
-		pack64(energy->consumed_energy, buffer);
-		pack32(energy->current_watts, buffer);
-		pack64(energy->previous_consumed_energy, buffer);
-		pack_time(energy->poll_time, buffer);
+	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+		if (!energy)
+			energy = &energy_zero;
+		pack_fields(energy, energy_fields,
+			    PACK_FIELD_CNT(energy_fields), buffer);
 	}
 }
 
@@ -231,12 +230,9 @@ extern int acct_gather_energy_unpack(acct_gather_energy_t **energy, Buf buffer,
 	}
 
 	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
-		safe_unpack64(&energy_ptr->base_consumed_energy, buffer);
-		safe_unpack32(&energy_ptr->base_watts, buffer);
-		safe_unpack64(&energy_ptr->consumed_energy, buffer);
-		safe_unpack32(&energy_ptr->current_watts, buffer);
-		safe_unpack64(&energy_ptr->previous_consumed_energy, buffer);
-		safe_unpack_time(&energy_ptr->poll_time, buffer);
+		if (unpack_fields(energy_ptr, energy_fields,
+				  PACK_FIELD_CNT(energy_fields), buffer))
+			goto unpack_error;
 	}
 
 	return SLURM_SUCCESS;
@@ -71,6 +71,10 @@ typedef struct slurm_auth_ops {
         int          (*print)     ( void *cred, FILE *fp );
         int          (*sa_errno)  ( void *cred );
         const char * (*sa_errstr) ( int slurm_errno );
+        void *       (*create_data) ( void *argv[], char *auth_info,
+				      char *data, uint32_t len, uid_t r_uid );
+        int          (*get_data)  ( void *cred, char **data, uint32_t *len,
+				    uid_t *r_uid, char *auth_info );
 } slurm_auth_ops_t;
 /*
  * These strings must be kept in the same order as the fields
@@ -86,7 +90,9 @@ static const char *syms[] = {
 	"slurm_auth_unpack",
 	"slurm_auth_print",
 	"slurm_auth_errno",
-	"slurm_auth_errstr"
+	"slurm_auth_errstr",
+	"slurm_auth_create_data",
+	"slurm_auth_get_data"
 };
 
 /*
@@ -223,6 +229,34 @@ g_slurm_auth_create( void *hosts, int timeout, char *auth_info )
         return ret;
 }
 
+void *
+g_slurm_auth_create_data( void *hosts, int timeout, char *auth_info,
+			  char *data, uint32_t len, uid_t r_uid )
+{
+	void **argv;
+	void *ret;
+
+	if (( slurm_auth_init(NULL) < 0 ) || auth_dummy )
+		return NULL;
+
+	if ( ( argv = _slurm_auth_marshal_args(hosts, timeout) ) == NULL )
+		return NULL;
+
+	ret = (*(ops.create_data))( argv, auth_info, data, len, r_uid );
+	xfree( argv );
+	return ret;
+}
+
+int
+g_slurm_auth_get_data( void *cred, char **data, uint32_t *len,
+		       uid_t *r_uid, char *auth_info )
+{
+	if (( slurm_auth_init(NULL) < 0 ) || auth_dummy )
+		return SLURM_ERROR;
+
+	return (*(ops.get_data))( cred, data, len, r_uid, auth_info );
+}
+
 int
 g_slurm_auth_destroy( void *cred )
 {
@@ -116,6 +116,12 @@ int slurm_auth_context_destroy( slurm_auth_context_t ctxt );
  */
 #define SLURM_AUTH_NOBODY		99
 
+/*
+ * Restricted UID of a credential that any user may decode, see
+ * g_slurm_auth_create_data().
+ */
+#define SLURM_AUTH_UID_ANY		((uid_t) -1)
+
 /*
  * Prepare the global context.
  * auth_type IN: authentication mechanism (e.g. "auth/munge") or
@@ -133,6 +139,25 @@ extern int slurm_auth_fini( void );
  */
 extern void *	g_slurm_auth_create( void *hosts, int timeout, char *auth_info );
 extern int	g_slurm_auth_destroy( void *cred );
+
+/*
+ * Create a credential which also carries `len' bytes of `data', which only
+ * a process running as `r_uid' may decode with g_slurm_auth_get_data().
+ * Anyone else who sees the packed credential, including other users on
+ * hosts sharing the same key, can not read the data. If the plugin can not
+ * restrict the credential this way, NULL is returned.
+ */
+extern void *	g_slurm_auth_create_data( void *hosts, int timeout,
+					  char *auth_info, char *data,
+					  uint32_t len, uid_t r_uid );
+/*
+ * Verify a credential made by g_slurm_auth_create_data() and return the
+ * data it carries along with the UID it was restricted to, or
+ * SLURM_AUTH_UID_ANY if it was not. The data remains owned by the
+ * credential.
+ */
+extern int	g_slurm_auth_get_data( void *cred, char **data, uint32_t *len,
+				       uid_t *r_uid, char *auth_info );
 extern int	g_slurm_auth_verify( void *cred, void *hosts, int timeout,
 				     char *auth_info );
 extern uid_t	g_slurm_auth_get_uid( void *cred, char *auth_info );
@@ -83,15 +83,23 @@ typedef struct sbcast_cred sbcast_cred_t;		/* opaque data type */
 #define EXTREME_DEBUG   0
 #define MAX_TIME 0x7fffffff
 
+/*
+ * Size of the verifier's job and credential state hash tables, which must
+ * be a power of two, and maximum count of cached verified signatures
+ */
+#define CRED_HASH_SIZE	4096
+#define SIG_CACHE_MAX	4096
+
 /*
  * slurm job credential state
  *
  */
-typedef struct {
+typedef struct cred_state {
 	time_t   ctime;		/* Time that the cred was created	*/
 	time_t   expiration;    /* Time at which cred is no longer good	*/
 	uint32_t jobid;		/* SLURM job id for this credential	*/
 	uint32_t stepid;	/* SLURM step id for this credential	*/
+	struct cred_state *next;/* Next record in state_hash chain	*/
 } cred_state_t;
 
 /*
@@ -99,13 +107,30 @@ typedef struct {
  * tracks jobids for which all future credentials have been revoked
  *
  */
-typedef struct {
+typedef struct job_state {
 	time_t   ctime;         /* Time that this entry was created         */
 	time_t   expiration;    /* Time at which credentials can be purged  */
 	uint32_t jobid;         /* SLURM job id for this credential	*/
 	time_t   revoked;       /* Time at which credentials were revoked   */
+	struct job_state *next; /* Next record in job_hash chain            */
 } job_state_t;
 
+/*
+ * Credential whose signature has been verified, kept so that the same
+ * credential sent again (e.g. a launch retried after slurm_cred_rewind())
+ * need not be checked by the crypto plugin again
+ */
+typedef struct sig_cache {
+	uint32_t     digest;	/* Hash of packed credential and signature */
+	time_t       expiration;/* Time at which the credential expires	*/
+	char        *data;	/* Packed credential			*/
+	uint32_t     datalen;	/* Packed credential length in bytes	*/
+	char        *signature;	/* Credential signature			*/
+	unsigned int siglen;	/* Signature length in bytes		*/
+	struct sig_cache *next;	/* Next record in sig_hash chain	*/
+	struct sig_cache *next_added; /* Next record added to sig_hash	*/
+} sig_cache_t;
+
 
 /*
  * Completion of slurm credential context
@@ -141,6 +166,12 @@ struct slurm_cred_context {
 	void          *key;        /* private or public key                 */
 	List           job_list;   /* List of used jobids (for verifier)    */
 	List           state_list; /* List of cred states (for verifier)    */
+	job_state_t  **job_hash;   /* job_list hashed by jobid              */
+	cred_state_t **state_hash; /* state_list hashed by job, step, ctime */
+	sig_cache_t  **sig_hash;   /* Verified signatures hashed by digest  */
+	int            sig_cnt;    /* Count of records in sig_hash          */
+	sig_cache_t   *sig_oldest; /* sig_hash records in order added, and  */
+	sig_cache_t   *sig_newest; /* so close to order of expiration       */
 
 	int          expiry_window;/* expiration window for cached creds    */
 
@@ -252,7 +283,12 @@ static void           _job_state_destroy(job_state_t   *js);
 
 static job_state_t  * _find_job_state(slurm_cred_ctx_t ctx, uint32_t jobid);
 static job_state_t  * _insert_job_state(slurm_cred_ctx_t ctx,  uint32_t jobid);
+static void           _add_job_state(slurm_cred_ctx_t ctx, job_state_t *j);
+static void           _unlink_job_state(slurm_cred_ctx_t ctx, job_state_t *j);
 static int            _find_cred_state(cred_state_t *c, slurm_cred_t *cred);
+static void           _add_cred_state(slurm_cred_ctx_t ctx, cred_state_t *s);
+static void           _unlink_cred_state(slurm_cred_ctx_t ctx,
+					 cred_state_t *s);
 
 static void _insert_cred_state(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
 static void _clear_expired_job_states(slurm_cred_ctx_t ctx);
@@ -262,10 +298,19 @@ static void _verifier_ctx_init(slurm_cred_ctx_t ctx);
 static bool _credential_replayed(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
 static bool _credential_revoked(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
 
+static slurm_cred_t *_slurm_cred_build(slurm_cred_arg_t *arg);
 static int _slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
-			    uint16_t protocol_version);
+			    Buf buffer, uint16_t protocol_version);
 static int _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *c,
 					uint16_t protocol_version);
+static uint32_t _cred_digest(char *data, uint32_t datalen, char *signature,
+			     unsigned int siglen);
+static sig_cache_t *_sig_cache_find(slurm_cred_ctx_t ctx, uint32_t digest,
+				    Buf buffer, slurm_cred_t *cred);
+static void _sig_cache_add(slurm_cred_ctx_t ctx, uint32_t digest,
+			   Buf buffer, slurm_cred_t *cred);
+static void _sig_cache_flush(slurm_cred_ctx_t ctx);
+static void _clear_expired_sig_cache(slurm_cred_ctx_t ctx, time_t now);
 
 static int _slurm_crypto_init(void);
 static int _slurm_crypto_fini(void);
@@ -285,6 +330,34 @@ static void _cred_state_pack_one(cred_state_t *s, Buf buffer);
 static void _sbast_cache_add(sbcast_cred_t *sbcast_cred);
 static void _sbcast_cache_del(void *x);
 
+static inline int _job_hash_inx(uint32_t jobid)
+{
+	return jobid & (CRED_HASH_SIZE - 1);
+}
+
+static inline int _cred_hash_inx(uint32_t jobid, uint32_t stepid,
+				 time_t ctime)
+{
+	return (jobid ^ (stepid * 2654435761U) ^ (uint32_t) ctime) &
+	       (CRED_HASH_SIZE - 1);
+}
+
+/* Remove every credential state matching cred from the context's hash
+ * table, but not its list */
+static void _unlink_cred_states(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
+{
+	cred_state_t **prev;
+
+	prev = &ctx->state_hash[_cred_hash_inx(cred->jobid, cred->stepid,
+					       cred->ctime)];
+	while (*prev) {
+		if (_find_cred_state(*prev, cred))
+			*prev = (*prev)->next;
+		else
+			prev = &(*prev)->next;
+	}
+}
+
 static int _slurm_crypto_init(void)
 {
 	char	*auth_info, *tok;
@@ -440,6 +513,10 @@ slurm_cred_ctx_destroy(slurm_cred_ctx_t ctx)
 		(*(ops.crypto_destroy_key))(ctx->key);
 	FREE_NULL_LIST(ctx->job_list);
 	FREE_NULL_LIST(ctx->state_list);
+	_sig_cache_flush(ctx);
+	xfree(ctx->job_hash);
+	xfree(ctx->state_hash);
+	xfree(ctx->sig_hash);
 
 	xassert(ctx->magic = ~CRED_CTX_MAGIC);
 
@@ -532,79 +609,50 @@ slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
 {
 	slurm_cred_t *cred = NULL;
 
-	xassert(ctx != NULL);
-	xassert(arg != NULL);
-	if (_slurm_crypto_init() < 0)
+	if (slurm_cred_create_batch(ctx, arg, 1, &cred, protocol_version) < 0)
 		return NULL;
+	return cred;
+}
 
-	cred = _slurm_cred_alloc();
-	slurm_mutex_lock(&cred->mutex);
-	xassert(cred->magic == CRED_MAGIC);
+extern int
+slurm_cred_create_batch(slurm_cred_ctx_t ctx, slurm_cred_arg_t *args, int cnt,
+			slurm_cred_t **creds, uint16_t protocol_version)
+{
+	Buf buffer;
+	int i, rc = SLURM_SUCCESS;
 
-	cred->jobid  = arg->jobid;
-	cred->stepid = arg->stepid;
-	cred->uid    = arg->uid;
-	cred->job_core_spec   = arg->job_core_spec;
-	cred->job_gres_list   = gres_plugin_job_state_dup(arg->job_gres_list);
-	cred->step_gres_list  = gres_plugin_step_state_dup(arg->step_gres_list);
-	cred->job_mem_limit   = arg->job_mem_limit;
-	cred->step_mem_limit  = arg->step_mem_limit;
-	cred->step_hostlist   = xstrdup(arg->step_hostlist);
-#ifndef HAVE_BG
-	{
-		int i = 0, sock_recs = 0;
-		if (arg->sock_core_rep_count) {
-			for (i = 0; i < arg->job_nhosts; i++) {
-				sock_recs += arg->sock_core_rep_count[i];
-				if (sock_recs >= arg->job_nhosts)
-					break;
-			}
-		}
-		i++;
-		if (arg->job_core_bitmap)
-			cred->job_core_bitmap = bit_copy(arg->job_core_bitmap);
-		if (arg->step_core_bitmap)
-			cred->step_core_bitmap =bit_copy(arg->step_core_bitmap);
-		cred->core_array_size     = i;
-		cred->cores_per_socket    = xmalloc(sizeof(uint16_t) * i);
-		cred->sockets_per_node    = xmalloc(sizeof(uint16_t) * i);
-		cred->sock_core_rep_count = xmalloc(sizeof(uint32_t) * i);
-		if (arg->cores_per_socket) {
-			memcpy(cred->cores_per_socket, arg->cores_per_socket,
-			       (sizeof(uint16_t) * i));
-		}
-		if (arg->sockets_per_node) {
-			memcpy(cred->sockets_per_node, arg->sockets_per_node,
-			       (sizeof(uint16_t) * i));
-		}
-		if (arg->sock_core_rep_count) {
-			memcpy(cred->sock_core_rep_count,
-			       arg->sock_core_rep_count,
-			       (sizeof(uint32_t) * i));
-		}
-		cred->job_constraints = xstrdup(arg->job_constraints);
-		cred->job_nhosts      = arg->job_nhosts;
-		cred->job_hostlist    = xstrdup(arg->job_hostlist);
-	}
-#endif
-	cred->ctime  = time(NULL);
+	xassert(ctx != NULL);
+	xassert(args != NULL);
+	xassert(creds != NULL);
+	memset(creds, 0, sizeof(slurm_cred_t *) * cnt);
+	if (_slurm_crypto_init() < 0)
+		return SLURM_ERROR;
+
+	for (i = 0; i < cnt; i++)
+		creds[i] = _slurm_cred_build(&args[i]);
 
+	/* Sign everything under one context lock, reusing one buffer */
+	buffer = init_buf(4096);
 	slurm_mutex_lock(&ctx->mutex);
 	xassert(ctx->magic == CRED_CTX_MAGIC);
 	xassert(ctx->type == SLURM_CRED_CREATOR);
-	if (_slurm_cred_sign(ctx, cred, protocol_version) < 0)
-		goto fail;
-
+	for (i = 0; i < cnt; i++) {
+		set_buf_offset(buffer, 0);
+		slurm_mutex_lock(&creds[i]->mutex);
+		if (_slurm_cred_sign(ctx, creds[i], buffer,
+				     protocol_version) < 0) {
+			slurm_mutex_unlock(&creds[i]->mutex);
+			slurm_cred_destroy(creds[i]);
+			creds[i] = NULL;
+			rc = SLURM_ERROR;
+			continue;
+		}
+		slurm_mutex_unlock(&creds[i]->mutex);
+	}
 	slurm_mutex_unlock(&ctx->mutex);
-	slurm_mutex_unlock(&cred->mutex);
-
-	return cred;
+	free_buf(buffer);
 
-fail:
-	slurm_mutex_unlock(&ctx->mutex);
-	slurm_mutex_unlock(&cred->mutex);
-	slurm_cred_destroy(cred);
-	return NULL;
+	return rc;
 }
 
 slurm_cred_t *
@@ -979,6 +1027,7 @@ slurm_cred_rewind(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 	xassert(ctx->magic == CRED_CTX_MAGIC);
 	xassert(ctx->type  == SLURM_CRED_VERIFIER);
 
+	_unlink_cred_states(ctx, cred);
 	rc = list_delete_all(ctx->state_list,
 			     (ListFindF) _find_cred_state, cred);
 
@@ -1545,6 +1594,9 @@ _verifier_ctx_init(slurm_cred_ctx_t ctx)
 
 	ctx->job_list   = list_create((ListDelF) _job_state_destroy);
 	ctx->state_list = list_create((ListDelF) _cred_state_destroy);
+	ctx->job_hash   = xmalloc(sizeof(job_state_t *) * CRED_HASH_SIZE);
+	ctx->state_hash = xmalloc(sizeof(cred_state_t *) * CRED_HASH_SIZE);
+	ctx->sig_hash   = xmalloc(sizeof(sig_cache_t *) * CRED_HASH_SIZE);
 
 	return;
 }
@@ -1598,6 +1650,7 @@ _ctx_update_public_key(slurm_cred_ctx_t ctx, const char *path)
 
 	ctx->exkey = ctx->key;
 	ctx->key   = pk;
+	_sig_cache_flush(ctx);
 
 	/*
 	 * exkey expires in expiry_window seconds plus one minute.
@@ -1660,6 +1713,67 @@ _slurm_cred_alloc(void)
 }
 
 
+/* Build an unsigned credential from the contents of arg */
+static slurm_cred_t *
+_slurm_cred_build(slurm_cred_arg_t *arg)
+{
+	slurm_cred_t *cred;
+
+	xassert(arg != NULL);
+
+	cred = _slurm_cred_alloc();
+	cred->jobid  = arg->jobid;
+	cred->stepid = arg->stepid;
+	cred->uid    = arg->uid;
+	cred->job_core_spec   = arg->job_core_spec;
+	cred->job_gres_list   = gres_plugin_job_state_dup(arg->job_gres_list);
+	cred->step_gres_list  = gres_plugin_step_state_dup(arg->step_gres_list);
+	cred->job_mem_limit   = arg->job_mem_limit;
+	cred->step_mem_limit  = arg->step_mem_limit;
+	cred->step_hostlist   = xstrdup(arg->step_hostlist);
+#ifndef HAVE_BG
+	{
+		int i = 0, sock_recs = 0;
+		if (arg->sock_core_rep_count) {
+			for (i = 0; i < arg->job_nhosts; i++) {
+				sock_recs += arg->sock_core_rep_count[i];
+				if (sock_recs >= arg->job_nhosts)
+					break;
+			}
+		}
+		i++;
+		if (arg->job_core_bitmap)
+			cred->job_core_bitmap = bit_copy(arg->job_core_bitmap);
+		if (arg->step_core_bitmap)
+			cred->step_core_bitmap =bit_copy(arg->step_core_bitmap);
+		cred->core_array_size     = i;
+		cred->cores_per_socket    = xmalloc(sizeof(uint16_t) * i);
+		cred->sockets_per_node    = xmalloc(sizeof(uint16_t) * i);
+		cred->sock_core_rep_count = xmalloc(sizeof(uint32_t) * i);
+		if (arg->cores_per_socket) {
+			memcpy(cred->cores_per_socket, arg->cores_per_socket,
+			       (sizeof(uint16_t) * i));
+		}
+		if (arg->sockets_per_node) {
+			memcpy(cred->sockets_per_node, arg->sockets_per_node,
+			       (sizeof(uint16_t) * i));
+		}
+		if (arg->sock_core_rep_count) {
+			memcpy(cred->sock_core_rep_count,
+			       arg->sock_core_rep_count,
+			       (sizeof(uint32_t) * i));
+		}
+		cred->job_constraints = xstrdup(arg->job_constraints);
+		cred->job_nhosts      = arg->job_nhosts;
+		cred->job_hostlist    = xstrdup(arg->job_hostlist);
+	}
+#endif
+	cred->ctime  = time(NULL);
+
+	return cred;
+}
+
+
 #if EXTREME_DEBUG
 static void
 _print_data(char *data, int datalen)
@@ -1674,20 +1788,17 @@ _print_data(char *data, int datalen)
 #endif
 
 static int
-_slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
+_slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t *cred, Buf buffer,
 		 uint16_t protocol_version)
 {
-	Buf           buffer;
 	int           rc;
 
-	buffer = init_buf(4096);
 	_pack_cred(cred, buffer, protocol_version);
 	rc = (*(ops.crypto_sign))(ctx->key,
 				  get_buf_data(buffer),
 				  get_buf_offset(buffer),
 				  &cred->signature,
 				  &cred->siglen);
-	free_buf(buffer);
 
 	if (rc) {
 		error("Credential sign: %s",
@@ -1703,11 +1814,21 @@ _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
 {
 	Buf            buffer;
 	int            rc;
+	uint32_t       digest;
 
 	debug("Checking credential with %u bytes of sig data", cred->siglen);
 	buffer = init_buf(4096);
 	_pack_cred(cred, buffer, protocol_version);
 
+	digest = _cred_digest(get_buf_data(buffer), get_buf_offset(buffer),
+			      cred->signature, cred->siglen);
+	if (_sig_cache_find(ctx, digest, buffer, cred)) {
+		debug2("Credential signature for job %u.%u cached",
+		       cred->jobid, cred->stepid);
+		free_buf(buffer);
+		return SLURM_SUCCESS;
+	}
+
 	rc = (*(ops.crypto_verify_sign))(ctx->key,
 					 get_buf_data(buffer),
 					 get_buf_offset(buffer),
@@ -1720,6 +1841,8 @@ _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
 						 cred->signature,
 						 cred->siglen);
 	}
+	if (rc == 0)
+		_sig_cache_add(ctx, digest, buffer, cred);
 	free_buf(buffer);
 
 	if (rc) {
@@ -1731,6 +1854,118 @@ _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
 }
 
 
+/* FNV-1a hash of a packed credential and its signature */
+static uint32_t
+_cred_digest(char *data, uint32_t datalen, char *signature,
+	     unsigned int siglen)
+{
+	uint32_t digest = 2166136261U;
+	uint32_t i;
+
+	for (i = 0; i < datalen; i++)
+		digest = (digest ^ (uint8_t) data[i]) * 16777619;
+	for (i = 0; i < siglen; i++)
+		digest = (digest ^ (uint8_t) signature[i]) * 16777619;
+	return digest;
+}
+
+/* Find a verified signature record matching the credential packed in
+ * buffer exactly, not just its digest */
+static sig_cache_t *
+_sig_cache_find(slurm_cred_ctx_t ctx, uint32_t digest, Buf buffer,
+		slurm_cred_t *cred)
+{
+	sig_cache_t *c;
+
+	if (!ctx->sig_cnt)
+		return NULL;
+	for (c = ctx->sig_hash[digest & (CRED_HASH_SIZE - 1)]; c; c = c->next){
+		if ((c->digest == digest) &&
+		    (c->datalen == get_buf_offset(buffer)) &&
+		    (c->siglen == cred->siglen) &&
+		    !memcmp(c->data, get_buf_data(buffer), c->datalen) &&
+		    !memcmp(c->signature, cred->signature, c->siglen))
+			return c;
+	}
+	return NULL;
+}
+
+/* Record a verified signature along with a copy of the packed credential */
+static void
+_sig_cache_add(slurm_cred_ctx_t ctx, uint32_t digest, Buf buffer,
+	       slurm_cred_t *cred)
+{
+	sig_cache_t *c;
+	int inx = digest & (CRED_HASH_SIZE - 1);
+
+	if (!ctx->sig_hash || (ctx->sig_cnt >= SIG_CACHE_MAX))
+		return;
+
+	c = xmalloc(sizeof(sig_cache_t));
+	c->digest     = digest;
+	c->expiration = cred->ctime + ctx->expiry_window;
+	c->datalen    = get_buf_offset(buffer);
+	c->data       = xmalloc(c->datalen);
+	memcpy(c->data, get_buf_data(buffer), c->datalen);
+	c->siglen     = cred->siglen;
+	c->signature  = xmalloc(c->siglen);
+	memcpy(c->signature, cred->signature, c->siglen);
+	c->next = ctx->sig_hash[inx];
+	ctx->sig_hash[inx] = c;
+	if (ctx->sig_newest)
+		ctx->sig_newest->next_added = c;
+	else
+		ctx->sig_oldest = c;
+	ctx->sig_newest = c;
+	ctx->sig_cnt++;
+}
+
+static void
+_sig_cache_destroy(sig_cache_t *c)
+{
+	xfree(c->data);
+	xfree(c->signature);
+	xfree(c);
+}
+
+/* Purge every verified signature record, e.g. after a key change */
+static void
+_sig_cache_flush(slurm_cred_ctx_t ctx)
+{
+	sig_cache_t *c;
+
+	while ((c = ctx->sig_oldest)) {
+		ctx->sig_oldest = c->next_added;
+		_sig_cache_destroy(c);
+	}
+	ctx->sig_newest = NULL;
+	ctx->sig_cnt = 0;
+	if (ctx->sig_hash)
+		memset(ctx->sig_hash, 0, sizeof(sig_cache_t *) * CRED_HASH_SIZE);
+}
+
+/* Purge expired verified signature records, oldest first. Credentials are
+ * mostly verified in the order they were created, so a record verified out
+ * of order is only kept until those added before it expire, at most one
+ * expiry window late, rather than scanning every hash chain each time */
+static void
+_clear_expired_sig_cache(slurm_cred_ctx_t ctx, time_t now)
+{
+	sig_cache_t *c, **prev;
+
+	while ((c = ctx->sig_oldest) && (now > c->expiration)) {
+		prev = &ctx->sig_hash[c->digest & (CRED_HASH_SIZE - 1)];
+		while (*prev != c)
+			prev = &(*prev)->next;
+		*prev = c->next;
+		if (!(ctx->sig_oldest = c->next_added))
+			ctx->sig_newest = NULL;
+		_sig_cache_destroy(c);
+		ctx->sig_cnt--;
+	}
+}
+
+
 static void
 _pack_cred(slurm_cred_t *cred, Buf buffer, uint16_t protocol_version)
 {
@@ -1825,21 +2060,14 @@ _pack_cred(slurm_cred_t *cred, Buf buffer, uint16_t protocol_version)
 static bool
 _credential_replayed(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
-	ListIterator  i = NULL;
 	cred_state_t *s = NULL;
 
 	_clear_expired_credential_states(ctx);
 
-	i = list_iterator_create(ctx->state_list);
-
-	while ((s = list_next(i))) {
-		if ((s->jobid  == cred->jobid)  &&
-		    (s->stepid == cred->stepid) &&
-		    (s->ctime  == cred->ctime))
-			break;
-	}
-
-	list_iterator_destroy(i);
+	s = ctx->state_hash[_cred_hash_inx(cred->jobid, cred->stepid,
+					   cred->ctime)];
+	while (s && !_find_cred_state(s, cred))
+		s = s->next;
 
 	/*
 	 * If we found a match, this credential is being replayed.
@@ -1929,15 +2157,11 @@ _credential_revoked(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 static job_state_t *
 _find_job_state(slurm_cred_ctx_t ctx, uint32_t jobid)
 {
-	ListIterator  i = NULL;
 	job_state_t  *j = NULL;
 
-	i = list_iterator_create(ctx->job_list);
-	while ((j = list_next(i))) {
-		if (j->jobid == jobid)
-			break;
-	}
-	list_iterator_destroy(i);
+	j = ctx->job_hash[_job_hash_inx(jobid)];
+	while (j && (j->jobid != jobid))
+		j = j->next;
 	return j;
 }
 
@@ -1952,10 +2176,33 @@ static job_state_t *
 _insert_job_state(slurm_cred_ctx_t ctx, uint32_t jobid)
 {
 	job_state_t *j = _job_state_create(jobid);
-	list_append(ctx->job_list, j);
+	_add_job_state(ctx, j);
 	return j;
 }
 
+/* Add a job state to the context's list and hash table */
+static void
+_add_job_state(slurm_cred_ctx_t ctx, job_state_t *j)
+{
+	int inx = _job_hash_inx(j->jobid);
+
+	list_append(ctx->job_list, j);
+	j->next = ctx->job_hash[inx];
+	ctx->job_hash[inx] = j;
+}
+
+/* Remove a job state from the context's hash table, but not its list */
+static void
+_unlink_job_state(slurm_cred_ctx_t ctx, job_state_t *j)
+{
+	job_state_t **prev = &ctx->job_hash[_job_hash_inx(j->jobid)];
+
+	while (*prev && (*prev != j))
+		prev = &(*prev)->next;
+	if (*prev)
+		*prev = j->next;
+}
+
 
 static job_state_t *
 _job_state_create(uint32_t jobid)
@@ -2015,6 +2262,7 @@ _clear_expired_job_states(slurm_cred_ctx_t ctx)
 		       (uint64_t)j->revoked);
 #endif
 		if (j->revoked && (now > j->expiration)) {
+			_unlink_job_state(ctx, j);
 			list_delete_item(i);
 		}
 	}
@@ -2037,10 +2285,14 @@ _clear_expired_credential_states(slurm_cred_ctx_t ctx)
 
 	i = list_iterator_create(ctx->state_list);
 	while ((s = list_next(i))) {
-		if (now > s->expiration)
+		if (now > s->expiration) {
+			_unlink_cred_state(ctx, s);
 			list_delete_item(i);
+		}
 	}
 	list_iterator_destroy(i);
+
+	_clear_expired_sig_cache(ctx, now);
 }
 
 
@@ -2048,7 +2300,32 @@ static void
 _insert_cred_state(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
 	cred_state_t *s = _cred_state_create(ctx, cred);
+	_add_cred_state(ctx, s);
+}
+
+/* Add a credential state to the context's list and hash table */
+static void
+_add_cred_state(slurm_cred_ctx_t ctx, cred_state_t *s)
+{
+	int inx = _cred_hash_inx(s->jobid, s->stepid, s->ctime);
+
 	list_append(ctx->state_list, s);
+	s->next = ctx->state_hash[inx];
+	ctx->state_hash[inx] = s;
+}
+
+/* Remove a credential state from the context's hash table, but not its
+ * list */
+static void
+_unlink_cred_state(slurm_cred_ctx_t ctx, cred_state_t *s)
+{
+	cred_state_t **prev;
+
+	prev = &ctx->state_hash[_cred_hash_inx(s->jobid, s->stepid, s->ctime)];
+	while (*prev && (*prev != s))
+		prev = &(*prev)->next;
+	if (*prev)
+		*prev = s->next;
 }
 
 
@@ -2179,7 +2456,7 @@ _cred_state_unpack(slurm_cred_ctx_t ctx, Buf buffer)
 			goto unpack_error;
 
 		if (now < s->expiration)
-			list_append(ctx->state_list, s);
+			_add_cred_state(ctx, s);
 		else
 			_cred_state_destroy(s);
 	}
@@ -2223,7 +2500,7 @@ _job_state_unpack(slurm_cred_ctx_t ctx, Buf buffer)
 			goto unpack_error;
 
 		if (!j->revoked || (j->revoked && (now < j->expiration)))
-			list_append(ctx->job_list, j);
+			_add_job_state(ctx, j);
 		else {
 			debug3 ("not appending expired job %u state",
 			        j->jobid);
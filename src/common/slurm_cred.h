@@ -184,6 +184,20 @@ int slurm_crypto_fini(void);
 slurm_cred_t *slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
 				uint16_t protocol_version);
 
+/*
+ * Create and sign `cnt' slurm credentials using the values in the `args'
+ * array, placing them in the `creds' array. All are signed under one lock
+ * of the context, which makes this cheaper than `cnt' calls of
+ * slurm_cred_create() when many credentials are needed at once.
+ *
+ * Returns SLURM_ERROR if any credential could not be created, in which
+ * case its `creds' entry is NULL.
+ */
+extern int slurm_cred_create_batch(slurm_cred_ctx_t ctx,
+				   slurm_cred_arg_t *args, int cnt,
+				   slurm_cred_t **creds,
+				   uint16_t protocol_version);
+
 /*
  * Copy a slurm credential.
  * Returns NULL on failure.
@@ -37,8 +37,10 @@
 
 #include "config.h"
 
+#include <fcntl.h>
 #include <poll.h>
 #include <pthread.h>
+#include <unistd.h>
 
 #if HAVE_SYS_PRCTL_H
 #include <sys/prctl.h>
@@ -46,7 +48,9 @@
 
 #include "slurm/slurm_errno.h"
 #include "src/common/fd.h"
+#include "src/common/list.h"
 #include "src/common/macros.h"
+#include "src/common/siphash.h"
 #include "src/common/slurm_auth.h"
 #include "src/common/slurm_protocol_pack.h"
 #include "src/common/slurmdbd_defs.h"
@@ -54,6 +58,7 @@
 #include "slurm_persist_conn.h"
 
 #define MAX_THREAD_COUNT 100
+#define MUX_WORKER_CNT   8	/* threads processing mux messages */
 
 /*
  *  Maximum message size. Messages larger than this value (in bytes)
@@ -61,6 +66,12 @@
  */
 #define MAX_MSG_SIZE     (16*1024*1024)
 
+/*
+ *  Size of the MAC appended to every message on a persistant connection
+ *  once an authenticated session is established.
+ */
+#define SESSION_MAC_SIZE HASHLEN
+
 typedef struct {
 	void *arg;
 	slurm_persist_conn_t *conn;
@@ -68,12 +79,38 @@ typedef struct {
 	pthread_t thread_id;
 } persist_service_conn_t;
 
+typedef struct {
+	void *arg;
+	slurm_persist_conn_t *conn;
+	bool keep;		/* false if processing msg failed */
+	char *msg;		/* message being read or processed */
+	uint32_t msg_read;	/* bytes of msg read so far */
+	uint32_t msg_size;	/* size of msg */
+	time_t msg_start;	/* when reading msg started */
+} persist_mux_conn_t;
+
 static persist_service_conn_t *persist_service_conn[MAX_THREAD_COUNT];
 static int             thread_count = 0;
 static pthread_mutex_t thread_count_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  thread_count_cond = PTHREAD_COND_INITIALIZER;
 static int             shutdown_time = 0;
 
+/* Connections read by the single mux thread, mux_ufds[i + 1] being the
+ * poll entry of mux_conns[i] */
+static persist_mux_conn_t **mux_conns = NULL;
+static struct pollfd   *mux_ufds = NULL;
+static int             mux_cnt = 0, mux_size = 0;
+static List            mux_new_list = NULL;	/* to add to mux_conns */
+static List            mux_work_list = NULL;	/* message read, to process */
+static List            mux_done_list = NULL;	/* message processed */
+static pthread_mutex_t mux_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  mux_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t       mux_thread_id = 0;
+static pthread_t       mux_worker_id[MUX_WORKER_CNT];
+static bool            mux_shutdown = false;
+static int             mux_wake_fd[2] = { -1, -1 };
+static persist_mux_stats_t mux_stats;
+
 /* Return time in msec since "start time" */
 static int _tot_wait (struct timeval *start_time)
 {
@@ -168,6 +205,85 @@ static void _sig_handler(int signal)
 {
 }
 
+/* Compute the MAC of message number seq on a session.  The payload is
+ * hashed first so the sequence number and direction can be mixed in
+ * without copying the message.  Both ends share one key, so the direction
+ * keeps a message from being reflected back to the end that sent it. */
+static void _session_mac(slurm_persist_conn_t *persist_conn, char *msg,
+			 uint32_t msg_size, uint64_t seq, bool to_server,
+			 uint8_t *mac)
+{
+	uint8_t tmp[HASHLEN + sizeof(uint64_t) + 1];
+	uint64_t nw_seq = HTON_uint64(seq);
+
+	siphash(tmp, (uint8_t *) msg, msg_size,
+		(uint8_t *) persist_conn->session_key);
+	memcpy(tmp + HASHLEN, &nw_seq, sizeof(nw_seq));
+	tmp[HASHLEN + sizeof(nw_seq)] = to_server ? 'C' : 'S';
+	siphash(mac, tmp, sizeof(tmp), (uint8_t *) persist_conn->session_key);
+}
+
+/* Verify and strip the MAC at the end of a message received on a session.
+ * RET SLURM_SUCCESS or ESLURM_AUTH_CRED_INVALID if the message was not sent
+ *     by the other end of the session or is out of sequence */
+static int _session_check(slurm_persist_conn_t *persist_conn, char *msg,
+			  uint32_t *msg_size)
+{
+	uint8_t mac[SESSION_MAC_SIZE], diff = 0;
+	uint8_t *recv_mac;
+	int i;
+
+	if (!persist_conn->session_key)
+		return SLURM_SUCCESS;
+
+	if (*msg_size < (SESSION_MAC_SIZE + 2)) {
+		error("Persistant Conn: message too short for session MAC from %s",
+		      persist_conn->rem_host);
+		return ESLURM_AUTH_CRED_INVALID;
+	}
+	*msg_size -= SESSION_MAC_SIZE;
+	recv_mac = (uint8_t *) msg + *msg_size;
+
+	_session_mac(persist_conn, msg, *msg_size,
+		     persist_conn->session_recv_seq,
+		     persist_conn->session_server, mac);
+	/* Don't leak how much of the MAC matched */
+	for (i = 0; i < SESSION_MAC_SIZE; i++)
+		diff |= mac[i] ^ recv_mac[i];
+	if (diff) {
+		error("Persistant Conn: bad session MAC on message %"PRIu64" from %s",
+		      persist_conn->session_recv_seq, persist_conn->rem_host);
+		return ESLURM_AUTH_CRED_INVALID;
+	}
+	persist_conn->session_recv_seq++;
+
+	return SLURM_SUCCESS;
+}
+
+/* Fill key with KEYLEN bytes from /dev/urandom.  There is deliberately no
+ * weaker fallback, without it no session is requested. */
+static int _session_key_create(char *key)
+{
+	int fd, rc = SLURM_ERROR;
+	ssize_t len;
+
+	if ((fd = open("/dev/urandom", O_RDONLY)) < 0) {
+		error("%s: open(/dev/urandom): %m", __func__);
+		return rc;
+	}
+	if ((len = read(fd, key, KEYLEN)) == KEYLEN)
+		rc = SLURM_SUCCESS;
+	else
+		error("%s: reading /dev/urandom: %m", __func__);
+	if (close(fd) < 0)
+		error("%s: close(/dev/urandom): %m", __func__);
+
+	return rc;
+}
+
+static int _send_msg(slurm_persist_conn_t *persist_conn, Buf buffer,
+		     bool sign);
+
 static void _persist_free_msg_members(slurm_persist_conn_t *persist_conn,
 				      persist_msg_t *persist_msg)
 {
@@ -183,7 +299,7 @@ static int _process_service_connection(
 	uint32_t nw_size = 0, msg_size = 0, uid = NO_VAL;
 	char *msg_char = NULL;
 	ssize_t msg_read = 0, offset = 0;
-	bool first = true, fini = false;
+	bool first = true, fini = false, sign_reply;
 	Buf buffer = NULL;
 	int rc = SLURM_SUCCESS;
 
@@ -230,7 +346,18 @@ static int _process_service_connection(
 			}
 			offset += msg_read;
 		}
-		if (msg_size == offset) {
+		/* The response to the init message is never signed since
+		 * the other end can't have the session key until it arrives.
+		 */
+		sign_reply = !first;
+		if ((msg_size == offset) && !first &&
+		    (_session_check(persist_conn, msg_char, &msg_size)
+		     != SLURM_SUCCESS)) {
+			buffer = slurm_persist_make_rc_msg(
+				persist_conn, ESLURM_AUTH_CRED_INVALID,
+				"Bad session MAC", 0);
+			fini = true;
+		} else if (msg_size == offset) {
 			persist_msg_t msg;
 
 			rc = slurm_persist_conn_process_msg(
@@ -262,7 +389,7 @@ static int _process_service_connection(
 
 		xfree(msg_char);
 		if (buffer) {
-			if (slurm_persist_send_msg(persist_conn, buffer)
+			if (_send_msg(persist_conn, buffer, sign_reply)
 			    != SLURM_SUCCESS) {
 				/* This is only an issue on persistent
 				 * connections, and really isn't that big of a
@@ -333,6 +460,395 @@ static void *_service_connection(void *arg)
 	return NULL;
 }
 
+/* Process the message read from a mux connection, on a worker thread.
+ * RET false if the connection should be closed */
+static bool _mux_process_msg(persist_mux_conn_t *mux_conn)
+{
+	slurm_persist_conn_t *persist_conn = mux_conn->conn;
+	uint32_t uid = NO_VAL, msg_size = mux_conn->msg_size;
+	persist_msg_t msg;
+	Buf buffer = NULL;
+	bool keep = true;
+	int rc;
+
+	if (_session_check(persist_conn, mux_conn->msg, &msg_size)
+	    != SLURM_SUCCESS)
+		return false;
+
+	rc = slurm_persist_conn_process_msg(persist_conn, &msg, mux_conn->msg,
+					    msg_size, &buffer, false);
+	if (rc == SLURM_SUCCESS) {
+		rc = (persist_conn->callback_proc)(mux_conn->arg, &msg,
+						   &buffer, &uid);
+		_persist_free_msg_members(persist_conn, &msg);
+	}
+
+	if ((rc == ESLURM_ACCESS_DENIED) ||
+	    (rc == SLURM_PROTOCOL_VERSION_ERROR))
+		keep = false;
+
+	slurm_mutex_lock(&mux_lock);
+	persist_conn->msg_cnt++;
+	mux_stats.msg_cnt++;
+	slurm_mutex_unlock(&mux_lock);
+
+	if (buffer) {
+		if (slurm_persist_send_msg(persist_conn, buffer)
+		    != SLURM_SUCCESS) {
+			debug("Problem sending response to connection %d(%s)",
+			      persist_conn->fd, persist_conn->rem_host);
+			keep = false;
+		}
+		free_buf(buffer);
+	}
+
+	return keep;
+}
+
+static void _mux_wake(void)
+{
+	char wake = 1;
+
+	if (write(mux_wake_fd[1], &wake, 1) < 0)
+		debug("%s: write: %m", __func__);
+}
+
+/* Process messages handed over by the mux thread, the connection's
+ * messages one at a time since it is not polled until this is done */
+static void *_mux_worker(void *no_data)
+{
+	persist_mux_conn_t *mux_conn;
+
+#if HAVE_SYS_PRCTL_H
+	if (prctl(PR_SET_NAME, "p-mux-worker", NULL, NULL, NULL) < 0)
+		error("%s: cannot set my name to %s %m",
+		      __func__, "p-mux-worker");
+#endif
+
+	slurm_mutex_lock(&mux_lock);
+	while (!mux_shutdown) {
+		if (!(mux_conn = list_dequeue(mux_work_list))) {
+			slurm_cond_wait(&mux_work_cond, &mux_lock);
+			continue;
+		}
+		slurm_mutex_unlock(&mux_lock);
+
+		mux_conn->keep = _mux_process_msg(mux_conn);
+		xfree(mux_conn->msg);
+		mux_conn->msg_size = mux_conn->msg_read = 0;
+
+		slurm_mutex_lock(&mux_lock);
+		list_enqueue(mux_done_list, mux_conn);
+		_mux_wake();
+	}
+	slurm_mutex_unlock(&mux_lock);
+
+	return NULL;
+}
+
+static void _mux_close_conn(persist_mux_conn_t *mux_conn)
+{
+	if (mux_conn->conn->callback_fini)
+		(mux_conn->conn->callback_fini)(mux_conn->arg);
+	else
+		debug2("Persist connection %d(%s) has disconnected",
+		       mux_conn->conn->fd, mux_conn->conn->rem_host);
+	slurm_persist_conn_destroy(mux_conn->conn);
+	xfree(mux_conn->msg);
+	xfree(mux_conn);
+}
+
+/* Stop polling and close connection inx, from the mux thread */
+static void _mux_remove_conn(int inx)
+{
+	persist_mux_conn_t *mux_conn = mux_conns[inx];
+
+	/* Slot 0 of mux_ufds is the wake pipe */
+	slurm_mutex_lock(&mux_lock);
+	mux_cnt--;
+	mux_conns[inx] = mux_conns[mux_cnt];
+	mux_ufds[inx + 1] = mux_ufds[mux_cnt + 1];
+	mux_stats.conn_cnt--;
+	mux_stats.conn_closed++;
+	slurm_mutex_unlock(&mux_lock);
+
+	_mux_close_conn(mux_conn);
+}
+
+/* Read what is available of a connection's next message.
+ * RET -1 if the connection should be closed, 1 if a message is complete,
+ *     0 if more is to come */
+static int _mux_read(persist_mux_conn_t *mux_conn)
+{
+	slurm_persist_conn_t *persist_conn = mux_conn->conn;
+	uint32_t nw_size;
+	ssize_t rc;
+
+	if (!mux_conn->msg) {
+		/* The size is sent in one write, so arrives whole unless
+		 * the other end is broken */
+		rc = read(persist_conn->fd, &nw_size, sizeof(nw_size));
+		if ((rc < 0) && ((errno == EINTR) || (errno == EAGAIN)))
+			return 0;
+		if (rc != sizeof(nw_size))
+			return -1;
+		mux_conn->msg_size = ntohl(nw_size);
+		if ((mux_conn->msg_size < 2) ||
+		    (mux_conn->msg_size > MAX_MSG_SIZE)) {
+			error("Persistant Conn: Invalid msg_size (%u) from %s",
+			      mux_conn->msg_size, persist_conn->rem_host);
+			return -1;
+		}
+		mux_conn->msg = xmalloc(mux_conn->msg_size);
+		mux_conn->msg_read = 0;
+		mux_conn->msg_start = time(NULL);
+	}
+
+	rc = read(persist_conn->fd, mux_conn->msg + mux_conn->msg_read,
+		  mux_conn->msg_size - mux_conn->msg_read);
+	if ((rc < 0) && ((errno == EINTR) || (errno == EAGAIN)))
+		return 0;
+	if (rc <= 0) {
+		if (rc < 0)
+			error("Persistant Conn: read: %m");
+		return -1;
+	}
+	mux_conn->msg_read += rc;
+
+	return (mux_conn->msg_read == mux_conn->msg_size) ? 1 : 0;
+}
+
+/* Only read and frame messages here, their processing is left to the
+ * workers so a slow RPC or a slow sender can't hold up the others */
+static void *_mux_thread(void *no_data)
+{
+	persist_mux_conn_t *mux_conn;
+	List done_list = list_create(NULL);
+	int i, rc, timeout;
+	time_t now;
+	char wake_buf[64];
+
+#if HAVE_SYS_PRCTL_H
+	if (prctl(PR_SET_NAME, "p-mux", NULL, NULL, NULL) < 0)
+		error("%s: cannot set my name to %s %m", __func__, "p-mux");
+#endif
+
+	mux_ufds = xmalloc(sizeof(struct pollfd));
+	mux_ufds[0].fd = mux_wake_fd[0];
+	mux_ufds[0].events = POLLIN;
+
+	while (1) {
+		/* Only this thread changes mux_conns and mux_ufds, others
+		 * lock them only to read the statistics */
+		slurm_mutex_lock(&mux_lock);
+		if (mux_shutdown) {
+			slurm_mutex_unlock(&mux_lock);
+			break;
+		}
+		while ((mux_conn = list_dequeue(mux_new_list))) {
+			if (mux_cnt >= mux_size) {
+				mux_size = MAX(mux_size * 2, 64);
+				xrealloc(mux_conns, sizeof(persist_mux_conn_t *)
+					 * mux_size);
+				xrealloc(mux_ufds, sizeof(struct pollfd)
+					 * (mux_size + 1));
+			}
+			mux_conns[mux_cnt] = mux_conn;
+			mux_ufds[mux_cnt + 1].fd = mux_conn->conn->fd;
+			mux_ufds[mux_cnt + 1].events = POLLIN;
+			mux_cnt++;
+		}
+		list_transfer(done_list, mux_done_list);
+		slurm_mutex_unlock(&mux_lock);
+
+		while ((mux_conn = list_dequeue(done_list))) {
+			for (i = 0; i < mux_cnt; i++) {
+				if (mux_conns[i] != mux_conn)
+					continue;
+				if (mux_conn->keep)
+					mux_ufds[i + 1].fd = mux_conn->conn->fd;
+				else
+					_mux_remove_conn(i);
+				break;
+			}
+		}
+
+		/* Drop senders of partial messages once out of time */
+		timeout = -1;
+		now = time(NULL);
+		for (i = 0; i < mux_cnt; i++) {
+			mux_conn = mux_conns[i];
+			if (!mux_conn->msg || (mux_ufds[i + 1].fd < 0))
+				continue;
+			if (((now - mux_conn->msg_start) * 1000) >=
+			    mux_conn->conn->timeout) {
+				error("Persistant Conn: only read %u of %u bytes from %s",
+				      mux_conn->msg_read, mux_conn->msg_size,
+				      mux_conn->conn->rem_host);
+				_mux_remove_conn(i--);
+				continue;
+			}
+			timeout = 1000;
+		}
+
+		rc = poll(mux_ufds, mux_cnt + 1, timeout);
+		if (rc == -1) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			error("%s: poll: %m", __func__);
+			break;
+		}
+
+		if (mux_ufds[0].revents & POLLIN) {
+			while (read(mux_wake_fd[0], wake_buf,
+				    sizeof(wake_buf)) > 0)
+				;
+		}
+
+		for (i = 0; i < mux_cnt; i++) {
+			/* Negative while a worker has the connection */
+			if ((mux_ufds[i + 1].fd < 0) ||
+			    !mux_ufds[i + 1].revents)
+				continue;
+			mux_conn = mux_conns[i];
+			if (!(mux_ufds[i + 1].revents & POLLIN) ||
+			    ((rc = _mux_read(mux_conn)) < 0)) {
+				_mux_remove_conn(i--);
+				continue;
+			}
+			if (rc == 0)
+				continue;
+
+			/* Not polled again until processed, so the
+			 * connection's responses go out in order */
+			mux_ufds[i + 1].fd = -1;
+			mux_ufds[i + 1].revents = 0;
+			slurm_mutex_lock(&mux_lock);
+			list_enqueue(mux_work_list, mux_conn);
+			slurm_cond_signal(&mux_work_cond);
+			slurm_mutex_unlock(&mux_lock);
+		}
+	}
+
+	FREE_NULL_LIST(done_list);
+
+	return NULL;
+}
+
+extern void slurm_persist_conn_mux_add(slurm_persist_conn_t *persist_conn,
+				       void *arg)
+{
+	persist_mux_conn_t *mux_conn;
+	pthread_attr_t attr;
+	int i;
+
+	xassert(persist_conn);
+	xassert(persist_conn->callback_proc);
+	xassert(persist_conn->shutdown);
+
+	/* Time allowed to send a whole message */
+	if (!persist_conn->timeout)
+		persist_conn->timeout = slurm_get_msg_timeout() * 1000;
+	fd_set_nonblocking(persist_conn->fd);
+
+	mux_conn = xmalloc(sizeof(persist_mux_conn_t));
+	mux_conn->arg = arg;
+	mux_conn->conn = persist_conn;
+
+	slurm_mutex_lock(&mux_lock);
+	if (!mux_thread_id) {
+		if (pipe(mux_wake_fd) < 0)
+			fatal("%s: pipe: %m", __func__);
+		fd_set_nonblocking(mux_wake_fd[0]);
+		fd_set_nonblocking(mux_wake_fd[1]);
+		fd_set_close_on_exec(mux_wake_fd[0]);
+		fd_set_close_on_exec(mux_wake_fd[1]);
+		mux_shutdown = false;
+		mux_new_list = list_create(NULL);
+		mux_work_list = list_create(NULL);
+		mux_done_list = list_create(NULL);
+
+		slurm_attr_init(&attr);
+		if (pthread_create(&mux_thread_id, &attr, _mux_thread, NULL))
+			fatal("%s: pthread_create: %m", __func__);
+		for (i = 0; i < MUX_WORKER_CNT; i++) {
+			if (pthread_create(&mux_worker_id[i], &attr,
+					   _mux_worker, NULL))
+				fatal("%s: pthread_create: %m", __func__);
+		}
+		slurm_attr_destroy(&attr);
+	}
+
+	list_enqueue(mux_new_list, mux_conn);
+	mux_stats.conn_opened++;
+	mux_stats.conn_cnt++;
+	_mux_wake();
+	slurm_mutex_unlock(&mux_lock);
+}
+
+extern void slurm_persist_conn_mux_fini(void)
+{
+	persist_mux_conn_t *mux_conn;
+	int i;
+
+	slurm_mutex_lock(&mux_lock);
+	if (!mux_thread_id) {
+		slurm_mutex_unlock(&mux_lock);
+		return;
+	}
+	mux_shutdown = true;
+	slurm_cond_broadcast(&mux_work_cond);
+	_mux_wake();
+	slurm_mutex_unlock(&mux_lock);
+
+	pthread_join(mux_thread_id, NULL);
+	for (i = 0; i < MUX_WORKER_CNT; i++)
+		pthread_join(mux_worker_id[i], NULL);
+
+	/* Connections with work queued or done are still in mux_conns */
+	while (mux_cnt)
+		_mux_remove_conn(0);
+	while ((mux_conn = list_dequeue(mux_new_list)))
+		_mux_close_conn(mux_conn);
+
+	slurm_mutex_lock(&mux_lock);
+	FREE_NULL_LIST(mux_new_list);
+	FREE_NULL_LIST(mux_work_list);
+	FREE_NULL_LIST(mux_done_list);
+	xfree(mux_conns);
+	xfree(mux_ufds);
+	mux_size = 0;
+	mux_stats.conn_cnt = 0;
+	mux_thread_id = 0;
+	close(mux_wake_fd[0]);
+	close(mux_wake_fd[1]);
+	mux_wake_fd[0] = mux_wake_fd[1] = -1;
+	slurm_mutex_unlock(&mux_lock);
+}
+
+extern void slurm_persist_conn_mux_get_stats(persist_mux_stats_t *stats)
+{
+	int i;
+
+	slurm_mutex_lock(&mux_lock);
+	memcpy(stats, &mux_stats, sizeof(persist_mux_stats_t));
+	for (i = 0; i < mux_cnt; i++)
+		stats->msg_max = MAX(stats->msg_max,
+				     mux_conns[i]->conn->msg_cnt);
+	slurm_mutex_unlock(&mux_lock);
+}
+
+extern void slurm_persist_conn_mux_reset_stats(void)
+{
+	uint32_t conn_cnt;
+
+	slurm_mutex_lock(&mux_lock);
+	conn_cnt = mux_stats.conn_cnt;
+	memset(&mux_stats, 0, sizeof(persist_mux_stats_t));
+	mux_stats.conn_cnt = conn_cnt;
+	slurm_mutex_unlock(&mux_lock);
+}
+
 extern void slurm_persist_conn_recv_server_init(void)
 {
 	int sigarray[] = {SIGUSR1, 0};
@@ -513,6 +1029,11 @@ extern int slurm_persist_conn_open_without_init(
 	if (!persist_conn->inited)
 		persist_conn->inited = true;
 
+	/* Any session belonged to the old connection */
+	xfree(persist_conn->session_key);
+	persist_conn->session_recv_seq = 0;
+	persist_conn->session_send_seq = 0;
+
 	if (!persist_conn->version)
 		persist_conn->version = SLURM_MIN_PROTOCOL_VERSION;
 	if (persist_conn->timeout < 0)
@@ -542,6 +1063,7 @@ extern int slurm_persist_conn_open(slurm_persist_conn_t *persist_conn)
 	slurm_msg_t req_msg;
 	persist_init_req_msg_t req;
 	persist_rc_msg_t *resp = NULL;
+	char *session_key = NULL;
 
 	if (slurm_persist_conn_open_without_init(persist_conn) != SLURM_SUCCESS)
 		return rc;
@@ -560,6 +1082,26 @@ extern int slurm_persist_conn_open(slurm_persist_conn_t *persist_conn)
 	req.cluster_name = persist_conn->cluster_name;
 	req.port = persist_conn->my_port;
 	req.version = SLURM_PROTOCOL_VERSION;
+	req.persist_type = persist_conn->persist_type;
+
+	if (persist_conn->flags & PERSIST_FLAG_SESSION) {
+		char *auth_info = slurm_get_auth_info();
+
+		session_key = xmalloc(KEYLEN);
+		if (_session_key_create(session_key) == SLURM_SUCCESS)
+			req.session_cred = g_slurm_auth_create_data(
+				NULL, 2, auth_info, session_key, KEYLEN,
+				slurm_get_slurm_user_id());
+		xfree(auth_info);
+		if (!req.session_cred) {
+			error("%s: unable to create a session for %s:%d",
+			      __func__, persist_conn->rem_host,
+			      persist_conn->rem_port);
+			xfree(session_key);
+			_close_fd(&persist_conn->fd);
+			return rc;
+		}
+	}
 
 	req_msg.data = &req;
 
@@ -591,6 +1133,22 @@ extern int slurm_persist_conn_open(slurm_persist_conn_t *persist_conn)
 			persist_conn->version = resp->ret_info;
 		}
 
+		/* An older peer ignores the session credential and would
+		 * take our messages unauthenticated, so don't talk to it. */
+		if ((rc == SLURM_SUCCESS) && session_key) {
+			if (persist_conn->version <
+			    SLURM_17_02_PROTOCOL_VERSION) {
+				error("%s: %s:%d does not support sessions",
+				      __func__, persist_conn->rem_host,
+				      persist_conn->rem_port);
+				rc = SLURM_ERROR;
+			} else {
+				persist_conn->session_key = session_key;
+				persist_conn->session_server = false;
+				session_key = NULL;
+			}
+		}
+
 		if (rc != SLURM_SUCCESS) {
 			if (resp)
 				error("%s: Something happened with the receiving/processing of the persistent connection init message to %s:%d: %s",
@@ -607,11 +1165,59 @@ extern int slurm_persist_conn_open(slurm_persist_conn_t *persist_conn)
 
 end_it:
 
+	if (req.session_cred)
+		g_slurm_auth_destroy(req.session_cred);
+	xfree(session_key);
 	slurm_persist_free_rc_msg(resp);
 
 	return rc;
 }
 
+extern int slurm_persist_conn_session_accept(
+	slurm_persist_conn_t *persist_conn, persist_init_req_msg_t *req,
+	uid_t uid, char *auth_info)
+{
+	char *key = NULL;
+	uint32_t len = 0;
+	uid_t cred_uid, r_uid = SLURM_AUTH_UID_ANY;
+
+	xassert(persist_conn);
+	xassert(req);
+
+	if (!req->session_cred)
+		return SLURM_SUCCESS;
+
+	if (g_slurm_auth_get_data(req->session_cred, &key, &len, &r_uid,
+				  auth_info) != SLURM_SUCCESS) {
+		error("%s: unable to verify session credential from %s: %s",
+		      __func__, persist_conn->rem_host,
+		      g_slurm_auth_errstr(
+			      g_slurm_auth_errno(req->session_cred)));
+		return ESLURM_AUTH_CRED_INVALID;
+	}
+	cred_uid = g_slurm_auth_get_uid(req->session_cred, auth_info);
+	if ((len != KEYLEN) || (cred_uid != uid)) {
+		error("%s: invalid session credential from %s uid(%d)",
+		      __func__, persist_conn->rem_host, (int) cred_uid);
+		return ESLURM_AUTH_CRED_INVALID;
+	}
+	/* Anyone else able to decode the credential would know the key */
+	if (r_uid != getuid()) {
+		error("%s: session credential from %s not restricted to uid(%d)",
+		      __func__, persist_conn->rem_host, (int) getuid());
+		return ESLURM_AUTH_CRED_INVALID;
+	}
+
+	xfree(persist_conn->session_key);
+	persist_conn->session_key = xmalloc(KEYLEN);
+	memcpy(persist_conn->session_key, key, KEYLEN);
+	persist_conn->session_recv_seq = 0;
+	persist_conn->session_send_seq = 0;
+	persist_conn->session_server = true;
+
+	return SLURM_SUCCESS;
+}
+
 extern void slurm_persist_conn_close(slurm_persist_conn_t *persist_conn)
 {
 	if (!persist_conn)
@@ -647,6 +1253,7 @@ extern void slurm_persist_conn_members_destroy(
 	}
 	xfree(persist_conn->cluster_name);
 	xfree(persist_conn->rem_host);
+	xfree(persist_conn->session_key);
 }
 
 /* Close the persistant connection */
@@ -781,6 +1388,15 @@ extern int slurm_persist_conn_writeable(slurm_persist_conn_t *persist_conn)
 
 extern int slurm_persist_send_msg(
 	slurm_persist_conn_t *persist_conn, Buf buffer)
+{
+	return _send_msg(persist_conn, buffer, true);
+}
+
+/* Send a message, appending the session MAC if sign is set and a session
+ * is established.  The MAC is written past the end of the packed message so
+ * the buffer itself is left unchanged. */
+static int _send_msg(slurm_persist_conn_t *persist_conn, Buf buffer,
+		     bool sign)
 {
 	uint32_t msg_size, nw_size;
 	char *msg;
@@ -812,6 +1428,17 @@ extern int slurm_persist_send_msg(
 		return EAGAIN;
 
 	msg_size = get_buf_offset(buffer);
+	/* A reopen above starts a new session, so sign here */
+	if (sign && persist_conn->session_key) {
+		if (remaining_buf(buffer) < SESSION_MAC_SIZE)
+			grow_buf(buffer, SESSION_MAC_SIZE);
+		_session_mac(persist_conn, get_buf_data(buffer), msg_size,
+			     persist_conn->session_send_seq,
+			     !persist_conn->session_server,
+			     (uint8_t *) get_buf_data(buffer) + msg_size);
+		msg_size += SESSION_MAC_SIZE;
+	} else
+		sign = false;
 	nw_size = htonl(msg_size);
 	msg_wrote = write(persist_conn->fd, &nw_size, sizeof(nw_size));
 	if (msg_wrote != sizeof(nw_size))
@@ -831,6 +1458,9 @@ extern int slurm_persist_send_msg(
 		msg_size -= msg_wrote;
 	}
 
+	if (sign)
+		persist_conn->session_send_seq++;
+
 	return SLURM_SUCCESS;
 }
 
@@ -882,6 +1512,11 @@ extern Buf slurm_persist_recv_msg(slurm_persist_conn_t *persist_conn)
 		goto endit;
 	}
 
+	if (_session_check(persist_conn, msg, &msg_size) != SLURM_SUCCESS) {
+		xfree(msg);
+		goto endit;
+	}
+
 	buffer = create_buf(msg, msg_size);
 	return buffer;
 
@@ -979,12 +1614,22 @@ extern void slurm_persist_pack_init_req_msg(
 	   since this is where the receiver gets the version from. */
 	packstr(msg->cluster_name, buffer);
 	pack16(msg->port, buffer);
+
+	if (msg->version >= SLURM_17_02_PROTOCOL_VERSION) {
+		if (msg->session_cred) {
+			pack8(1, buffer);
+			g_slurm_auth_pack(msg->session_cred, buffer);
+		} else
+			pack8(0, buffer);
+		pack16(msg->persist_type, buffer);
+	}
 }
 
 extern int slurm_persist_unpack_init_req_msg(
 	persist_init_req_msg_t **msg, Buf buffer)
 {
 	uint32_t tmp32;
+	uint8_t has_cred = 0;
 
 	persist_init_req_msg_t *msg_ptr =
 		xmalloc(sizeof(persist_init_req_msg_t));
@@ -995,6 +1640,14 @@ extern int slurm_persist_unpack_init_req_msg(
 	safe_unpackstr_xmalloc(&msg_ptr->cluster_name, &tmp32, buffer);
 	safe_unpack16(&msg_ptr->port, buffer);
 
+	if (msg_ptr->version >= SLURM_17_02_PROTOCOL_VERSION) {
+		safe_unpack8(&has_cred, buffer);
+		if (has_cred &&
+		    !(msg_ptr->session_cred = g_slurm_auth_unpack(buffer)))
+			goto unpack_error;
+		safe_unpack16(&msg_ptr->persist_type, buffer);
+	}
+
 	return SLURM_SUCCESS;
 
 unpack_error:
@@ -1007,6 +1660,8 @@ extern void slurm_persist_free_init_req_msg(persist_init_req_msg_t *msg)
 {
 	if (msg) {
 		xfree(msg->cluster_name);
+		if (msg->session_cred)
+			g_slurm_auth_destroy(msg->session_cred);
 		xfree(msg);
 	}
 }
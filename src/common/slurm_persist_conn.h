@@ -43,6 +43,15 @@
 #define PERSIST_FLAG_DBD            0x0001
 #define PERSIST_FLAG_RECONNECT      0x0002
 #define PERSIST_FLAG_ALREADY_INITED 0x0004
+#define PERSIST_FLAG_SESSION        0x0008 /* Require an authenticated session
+					    * when opening the connection, for
+					    * peers that don't munge each
+					    * message */
+
+/* What the other end of a persistant connection is, sent in its
+ * REQUEST_PERSIST_INIT */
+#define PERSIST_TYPE_NONE           0x0000 /* slurmdbd or federation peer */
+#define PERSIST_TYPE_SLURMD         0x0001 /* slurmd talking to slurmctld */
 
 typedef struct {
 	uint16_t msg_type;	/* see slurmdbd_msg_type_t or
@@ -61,8 +70,16 @@ typedef struct {
 	int fd;
 	uint16_t flags;
 	bool inited;
+	uint32_t msg_cnt;	/* Messages received on the connection */
+	uint16_t persist_type;	/* PERSIST_TYPE_* sent on open */
 	char *rem_host;
 	uint16_t rem_port;
+	char *session_key;	/* Key to MAC messages with once a session
+				 * is established, NULL otherwise */
+	uint64_t session_recv_seq; /* Count of MACed messages received */
+	uint64_t session_send_seq; /* Count of MACed messages sent */
+	bool session_server;	/* This end accepted the session rather than
+				 * opening it */
 	time_t *shutdown;
 	pthread_t thread_id;
 	int timeout;
@@ -74,6 +91,9 @@ typedef struct {
 	char *cluster_name;     /* cluster this message is coming from */
 	uint16_t port;          /* If you want to open a new connection, this is
 				 *  the port to talk to. */
+	uint16_t persist_type;	/* PERSIST_TYPE_* */
+	void *session_cred;	/* Authentication credential carrying the
+				 * session key, if a session is requested */
 	uint16_t version;	/* protocol version */
 	uint32_t uid;		/* UID originating connection,
 				 * filled by authtentication plugin*/
@@ -87,6 +107,15 @@ typedef struct {
 			    * of a message type sent. */
 } persist_rc_msg_t;
 
+/* Statistics on connections served by slurm_persist_conn_mux_add() */
+typedef struct {
+	uint32_t conn_cnt;	/* connections currently open */
+	uint32_t conn_opened;	/* connections added */
+	uint32_t conn_closed;	/* connections closed */
+	uint32_t msg_cnt;	/* messages processed */
+	uint32_t msg_max;	/* most messages on one open connection */
+} persist_mux_stats_t;
+
 /* setup a daemon to receive incoming persistant connections. */
 extern void slurm_persist_conn_recv_server_init(void);
 
@@ -116,6 +145,32 @@ extern int slurm_persist_conn_wait_for_thread_loc(void);
 extern void slurm_persist_conn_free_thread_loc(int thread_loc);
 
 
+/* Serve a persistant connection without a thread of its own, which suits a
+ * large number of connections each sending few messages.  A single thread
+ * polls every connection given here and reads their messages as data
+ * arrives, handing each complete message to a small pool of threads for
+ * processing.  A connection's messages are processed and answered in the
+ * order they were sent.
+ * IN - persist_conn - initialized connection with callback_proc and shutdown
+ *                     set.  This will be freed internally when it closes.
+ *                     The fd is made non-blocking.  A sender taking longer
+ *                     than timeout to send a whole message is disconnected,
+ *                     a timeout of 0 is replaced by MessageTimeout.
+ * IN - arg - arbitrary argument that will be sent to the callbacks.
+ */
+extern void slurm_persist_conn_mux_add(slurm_persist_conn_t *persist_conn,
+				       void *arg);
+
+/* Close every connection given to slurm_persist_conn_mux_add() and stop its
+ * thread */
+extern void slurm_persist_conn_mux_fini(void);
+
+/* Copy the statistics of slurm_persist_conn_mux_add() connections */
+extern void slurm_persist_conn_mux_get_stats(persist_mux_stats_t *stats);
+
+/* Clear those statistics, other than the count of open connections */
+extern void slurm_persist_conn_mux_reset_stats(void);
+
 /* Open a persistant socket connection
  * IN/OUT - persistant connection needing host and port filled in.  Returned
  * mostly filled in without the version to use to communicate.
@@ -130,6 +185,22 @@ extern int slurm_persist_conn_open_without_init(
  * Returns SLURM_SUCCESS on success or SLURM_ERROR on failure */
 extern int slurm_persist_conn_open(slurm_persist_conn_t *persist_conn);
 
+/* Establish the authenticated session requested by a REQUEST_PERSIST_INIT
+ * on the receiving end of a persistant connection. Once established, every
+ * message after the response to the init carries a MAC made with the
+ * session key rather than being trusted for having arrived on the
+ * connection.
+ * IN/OUT - persist_conn - receiving end of the connection
+ * IN - req - the init message, with no session requested this is a no-op
+ * IN - uid - authenticated user of the init message
+ * IN - auth_info - AuthInfo configuration to verify the credential with
+ * RET - SLURM_SUCCESS, or ESLURM_AUTH_CRED_INVALID if the session credential
+ *       does not belong to uid, can not be read or could have been read by
+ *       any user other than the one we run as */
+extern int slurm_persist_conn_session_accept(
+	slurm_persist_conn_t *persist_conn, persist_init_req_msg_t *req,
+	uid_t uid, char *auth_info);
+
 /* Close the persistant connection don't free structure or members */
 extern void slurm_persist_conn_close(slurm_persist_conn_t *persist_conn);
 
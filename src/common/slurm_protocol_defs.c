@@ -894,6 +894,24 @@ extern void slurm_free_job_launch_msg(batch_job_launch_msg_t * msg)
 	}
 }
 
+extern void slurm_free_job_launch_multi_msg(
+	batch_job_launch_multi_msg_t *msg)
+{
+	int i;
+
+	if (msg) {
+		for (i = 0; i < msg->launch_cnt; i++) {
+			if (msg->node_name)
+				xfree(msg->node_name[i]);
+			if (msg->launch_msg)
+				slurm_free_job_launch_msg(msg->launch_msg[i]);
+		}
+		xfree(msg->node_name);
+		xfree(msg->launch_msg);
+		xfree(msg);
+	}
+}
+
 extern void slurm_free_job_info(job_info_t * job)
 {
 	if (job) {
@@ -4011,6 +4029,9 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case REQUEST_BATCH_JOB_LAUNCH:
 		slurm_free_job_launch_msg(data);
 		break;
+	case REQUEST_BATCH_JOB_LAUNCH_MULTI:
+		slurm_free_job_launch_multi_msg(data);
+		break;
 	case REQUEST_LAUNCH_TASKS:
 		slurm_free_launch_tasks_request_msg(data);
 		break;
@@ -4215,6 +4236,9 @@ extern uint32_t slurm_get_return_code(slurm_msg_type_t type, void *data)
 	case RESPONSE_PING_SLURMD:
 		rc = SLURM_SUCCESS;
 		break;
+	case MESSAGE_NODE_REGISTRATION_STATUS:
+		rc = SLURM_SUCCESS;
+		break;
 	case RESPONSE_ACCT_GATHER_UPDATE:
 		rc = SLURM_SUCCESS;
 		break;
@@ -4479,6 +4503,8 @@ rpc_num2string(uint16_t opcode)
 		return "RESPONSE_SUBMIT_BATCH_JOB";
 	case REQUEST_BATCH_JOB_LAUNCH:
 		return "REQUEST_BATCH_JOB_LAUNCH";
+	case REQUEST_BATCH_JOB_LAUNCH_MULTI:
+		return "REQUEST_BATCH_JOB_LAUNCH_MULTI";
 	case REQUEST_CANCEL_JOB:
 		return "REQUEST_CANCEL_JOB";
 	case RESPONSE_CANCEL_JOB:
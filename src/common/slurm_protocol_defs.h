@@ -291,6 +291,7 @@ typedef enum {
 	REQUEST_SIB_JOB_WILL_RUN,
 	REQUEST_SIB_SUBMIT_BATCH_JOB,
 	REQUEST_SIB_RESOURCE_ALLOCATION,
+	REQUEST_BATCH_JOB_LAUNCH_MULTI,
 
 	REQUEST_JOB_STEP_CREATE = 5001,
 	RESPONSE_JOB_STEP_CREATE,
@@ -773,6 +774,7 @@ typedef struct job_step_create_response_msg {
 #define LAUNCH_BUFFERED_IO	0x00000008
 #define LAUNCH_LABEL_IO		0x00000010
 #define LAUNCH_USER_MANAGED_IO	0x00000020
+#define LAUNCH_COALESCE_IO	0x00000040
 
 typedef struct launch_tasks_request_msg {
 	uint32_t  job_id;
@@ -1038,6 +1040,14 @@ typedef struct batch_job_launch_msg {
 	uint32_t group_number;  /* jobpack group number index */
 } batch_job_launch_msg_t;
 
+/* Batch job launches for one node, sent to that node alone. A node launches
+ * only the jobs naming it. */
+typedef struct batch_job_launch_multi_msg {
+	uint32_t launch_cnt;	/* elements in below arrays */
+	char **node_name;	/* batch host of each launch */
+	batch_job_launch_msg_t **launch_msg;
+} batch_job_launch_multi_msg_t;
+
 typedef struct job_id_request_msg {
 	uint32_t job_pid;	/* local process_id of a job */
 } job_id_request_msg_t;
@@ -1113,7 +1123,7 @@ typedef struct file_bcast_msg {
 	time_t mtime;		/* last modification time for dest file */
 	sbcast_cred_t *cred;	/* credential for the RPC */
 	uint32_t block_len;	/* length of this data block */
-	uint32_t block_offset;	/* offset for this data block */
+	uint64_t block_offset;	/* offset for this data block */
 	uint32_t uncomp_len;	/* uncompressed length of this data block */
 	char *block;		/* data for this block */
 	uint64_t file_size;	/* file size */
@@ -1330,6 +1340,8 @@ extern void slurm_free_job_id_response_msg(job_id_response_msg_t * msg);
 extern void slurm_free_job_step_id_msg(job_step_id_msg_t *msg);
 
 extern void slurm_free_job_launch_msg(batch_job_launch_msg_t * msg);
+extern void slurm_free_job_launch_multi_msg(
+	batch_job_launch_multi_msg_t *msg);
 
 extern void slurm_free_update_front_end_msg(update_front_end_msg_t * msg);
 extern void slurm_free_update_node_msg(update_node_msg_t * msg);
@@ -447,6 +447,13 @@ static int _unpack_batch_job_launch_msg(batch_job_launch_msg_t ** msg,
 					Buf buffer,
 					uint16_t protocol_version);
 
+static void _pack_batch_job_launch_multi_msg(
+	batch_job_launch_multi_msg_t *msg, Buf buffer,
+	uint16_t protocol_version);
+static int _unpack_batch_job_launch_multi_msg(
+	batch_job_launch_multi_msg_t **msg, Buf buffer,
+	uint16_t protocol_version);
+
 static void _pack_prolog_launch_msg(prolog_launch_msg_t * msg,
 				Buf buffer, uint16_t protocol_version);
 static int _unpack_prolog_launch_msg(prolog_launch_msg_t ** msg,
@@ -1374,6 +1381,11 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 					   msg->data, buffer,
 					   msg->protocol_version);
 		break;
+	case REQUEST_BATCH_JOB_LAUNCH_MULTI:
+		_pack_batch_job_launch_multi_msg(
+			(batch_job_launch_multi_msg_t *) msg->data, buffer,
+			msg->protocol_version);
+		break;
 	case REQUEST_LAUNCH_PROLOG:
 		_pack_prolog_launch_msg((prolog_launch_msg_t *)
 					   msg->data, buffer, msg->protocol_version);
@@ -2073,6 +2085,11 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 						  & (msg->data), buffer,
 						  msg->protocol_version);
 		break;
+	case REQUEST_BATCH_JOB_LAUNCH_MULTI:
+		rc = _unpack_batch_job_launch_multi_msg(
+			(batch_job_launch_multi_msg_t **) &(msg->data),
+			buffer, msg->protocol_version);
+		break;
 	case REQUEST_LAUNCH_PROLOG:
 		rc = _unpack_prolog_launch_msg((prolog_launch_msg_t **)
 					       & (msg->data),
@@ -3371,6 +3388,22 @@ unpack_error:
 
 }
 
+/* Node registration scalars, SLURM_17_02_PROTOCOL_VERSION and later */
+static const pack_field_t node_reg_fields[] = {
+	PACK_FIELD(16, slurm_node_registration_status_msg_t, cpus),
+	PACK_FIELD(16, slurm_node_registration_status_msg_t, boards),
+	PACK_FIELD(16, slurm_node_registration_status_msg_t, sockets),
+	PACK_FIELD(16, slurm_node_registration_status_msg_t, cores),
+	PACK_FIELD(16, slurm_node_registration_status_msg_t, threads),
+	PACK_FIELD(64, slurm_node_registration_status_msg_t, real_memory),
+	PACK_FIELD(32, slurm_node_registration_status_msg_t, tmp_disk),
+	PACK_FIELD(32, slurm_node_registration_status_msg_t, up_time),
+	PACK_FIELD(32, slurm_node_registration_status_msg_t, hash_val),
+	PACK_FIELD(32, slurm_node_registration_status_msg_t, cpu_load),
+	PACK_FIELD(64, slurm_node_registration_status_msg_t, free_mem),
+	PACK_FIELD(32, slurm_node_registration_status_msg_t, job_count),
+};
+
 static void
 _pack_node_registration_status_msg(slurm_node_registration_status_msg_t *
 				   msg, Buf buffer,
@@ -3390,25 +3423,10 @@ _pack_node_registration_status_msg(slurm_node_registration_status_msg_t *
 		packstr(msg->arch, buffer);
 		packstr(msg->cpu_spec_list, buffer);
 		packstr(msg->os, buffer);
-		pack16(msg->cpus, buffer);
-		pack16(msg->boards, buffer);
-		pack16(msg->sockets, buffer);
-		pack16(msg->cores, buffer);
-		pack16(msg->threads, buffer);
-		pack64(msg->real_memory, buffer);
-		pack32(msg->tmp_disk, buffer);
-		pack32(msg->up_time, buffer);
-		pack32(msg->hash_val, buffer);
-		pack32(msg->cpu_load, buffer);
-		pack64(msg->free_mem, buffer);
-
-		pack32(msg->job_count, buffer);
-		for (i = 0; i < msg->job_count; i++) {
-			pack32(msg->job_id[i], buffer);
-		}
-		for (i = 0; i < msg->job_count; i++) {
-			pack32(msg->step_id[i], buffer);
-		}
+		pack_fields(msg, node_reg_fields,
+			    PACK_FIELD_CNT(node_reg_fields), buffer);
+		pack32_values(msg->job_id, msg->job_count, buffer);
+		pack32_values(msg->step_id, msg->job_count, buffer);
 		pack16(msg->startup, buffer);
 		if (msg->startup)
 			switch_g_pack_node_info(msg->switch_nodeinfo, buffer,
@@ -3542,29 +3560,24 @@ _unpack_node_registration_status_msg(slurm_node_registration_status_msg_t
 		safe_unpackstr_xmalloc(&node_reg_ptr->cpu_spec_list,
 				       &uint32_tmp, buffer);
 		safe_unpackstr_xmalloc(&node_reg_ptr->os, &uint32_tmp, buffer);
-		safe_unpack16(&node_reg_ptr->cpus, buffer);
-		safe_unpack16(&node_reg_ptr->boards, buffer);
-		safe_unpack16(&node_reg_ptr->sockets, buffer);
-		safe_unpack16(&node_reg_ptr->cores, buffer);
-		safe_unpack16(&node_reg_ptr->threads, buffer);
-		safe_unpack64(&node_reg_ptr->real_memory, buffer);
-		safe_unpack32(&node_reg_ptr->tmp_disk, buffer);
-		safe_unpack32(&node_reg_ptr->up_time, buffer);
-		safe_unpack32(&node_reg_ptr->hash_val, buffer);
-		safe_unpack32(&node_reg_ptr->cpu_load, buffer);
-		safe_unpack64(&node_reg_ptr->free_mem, buffer);
+		if (unpack_fields(node_reg_ptr, node_reg_fields,
+				  PACK_FIELD_CNT(node_reg_fields), buffer))
+			goto unpack_error;
 
-		safe_unpack32(&node_reg_ptr->job_count, buffer);
+		if (((uint64_t) node_reg_ptr->job_count * 2 * sizeof(uint32_t))
+		    > remaining_buf(buffer)) {
+			node_reg_ptr->job_count = 0;
+			goto unpack_error;
+		}
 		node_reg_ptr->job_id =
 			xmalloc(sizeof(uint32_t) * node_reg_ptr->job_count);
-		for (i = 0; i < node_reg_ptr->job_count; i++) {
-			safe_unpack32(&node_reg_ptr->job_id[i], buffer);
-		}
 		node_reg_ptr->step_id =
 			xmalloc(sizeof(uint32_t) * node_reg_ptr->job_count);
-		for (i = 0; i < node_reg_ptr->job_count; i++) {
-			safe_unpack32(&node_reg_ptr->step_id[i], buffer);
-		}
+		if (unpack32_values(node_reg_ptr->job_id,
+				    node_reg_ptr->job_count, buffer) ||
+		    unpack32_values(node_reg_ptr->step_id,
+				    node_reg_ptr->job_count, buffer))
+			goto unpack_error;
 
 		safe_unpack16(&node_reg_ptr->startup, buffer);
 		if (node_reg_ptr->startup
@@ -13071,6 +13084,72 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static void
+_pack_batch_job_launch_multi_msg(batch_job_launch_multi_msg_t *msg,
+				 Buf buffer, uint16_t protocol_version)
+{
+	int i;
+
+	xassert(msg != NULL);
+
+	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+		pack32(msg->launch_cnt, buffer);
+		for (i = 0; i < msg->launch_cnt; i++) {
+			packstr(msg->node_name[i], buffer);
+			_pack_batch_job_launch_msg(msg->launch_msg[i], buffer,
+						   protocol_version);
+		}
+	} else {
+		error("%s: protocol_version %hu not supported",
+		      __func__, protocol_version);
+	}
+}
+
+static int
+_unpack_batch_job_launch_multi_msg(batch_job_launch_multi_msg_t **msg,
+				   Buf buffer, uint16_t protocol_version)
+{
+	uint32_t uint32_tmp;
+	batch_job_launch_multi_msg_t *multi_msg_ptr;
+	int i;
+
+	xassert(msg != NULL);
+	multi_msg_ptr = xmalloc(sizeof(batch_job_launch_multi_msg_t));
+	*msg = multi_msg_ptr;
+
+	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+		safe_unpack32(&multi_msg_ptr->launch_cnt, buffer);
+		if (multi_msg_ptr->launch_cnt >= NO_VAL16) {
+			multi_msg_ptr->launch_cnt = 0;
+			goto unpack_error;
+		}
+		multi_msg_ptr->node_name = xmalloc(sizeof(char *) *
+						   multi_msg_ptr->launch_cnt);
+		multi_msg_ptr->launch_msg = xmalloc(
+			sizeof(batch_job_launch_msg_t *) *
+			multi_msg_ptr->launch_cnt);
+		for (i = 0; i < multi_msg_ptr->launch_cnt; i++) {
+			safe_unpackstr_xmalloc(&multi_msg_ptr->node_name[i],
+					       &uint32_tmp, buffer);
+			if (_unpack_batch_job_launch_msg(
+				    &multi_msg_ptr->launch_msg[i], buffer,
+				    protocol_version))
+				goto unpack_error;
+		}
+	} else {
+		error("%s: protocol_version %hu not supported",
+		      __func__, protocol_version);
+		goto unpack_error;
+	}
+
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_launch_multi_msg(multi_msg_ptr);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 static void
 _pack_job_id_request_msg(job_id_request_msg_t * msg, Buf buffer,
 			 uint16_t protocol_version)
@@ -13752,7 +13831,28 @@ static void _pack_file_bcast(file_bcast_msg_t * msg , Buf buffer,
 
 	grow_buf(buffer,  msg->block_len);
 
-	if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+		pack16 ( msg->block_no, buffer );
+		pack16 ( msg->compress, buffer );
+		pack16 ( msg->last_block, buffer );
+		pack16 ( msg->force, buffer );
+		pack16 ( msg->modes, buffer );
+
+		pack32 ( msg->uid, buffer );
+		packstr ( msg->user_name, buffer );
+		pack32 ( msg->gid, buffer );
+
+		pack_time ( msg->atime, buffer );
+		pack_time ( msg->mtime, buffer );
+
+		packstr ( msg->fname, buffer );
+		pack32 ( msg->block_len, buffer );
+		pack32(msg->uncomp_len, buffer);
+		pack64(msg->block_offset, buffer);
+		pack64(msg->file_size, buffer);
+		packmem ( msg->block, msg->block_len, buffer );
+		pack_sbcast_cred( msg->cred, buffer );
+	} else if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
 		pack16 ( msg->block_no, buffer );
 		pack16 ( msg->compress, buffer );
 		pack16 ( msg->last_block, buffer );
@@ -13769,7 +13869,7 @@ static void _pack_file_bcast(file_bcast_msg_t * msg , Buf buffer,
 		packstr ( msg->fname, buffer );
 		pack32 ( msg->block_len, buffer );
 		pack32(msg->uncomp_len, buffer);
-		pack32(msg->block_offset, buffer);
+		pack32((uint32_t) msg->block_offset, buffer);
 		pack64(msg->file_size, buffer);
 		packmem ( msg->block, msg->block_len, buffer );
 		pack_sbcast_cred( msg->cred, buffer );
@@ -13804,7 +13904,33 @@ static int _unpack_file_bcast(file_bcast_msg_t ** msg_ptr , Buf buffer,
 	msg = xmalloc ( sizeof (file_bcast_msg_t) ) ;
 	*msg_ptr = msg;
 
-	if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+		safe_unpack16 ( & msg->block_no, buffer );
+		safe_unpack16 ( & msg->compress, buffer );
+		safe_unpack16 ( & msg->last_block, buffer );
+		safe_unpack16 ( & msg->force, buffer );
+		safe_unpack16 ( & msg->modes, buffer );
+
+		safe_unpack32 ( & msg->uid, buffer );
+		safe_unpackstr_xmalloc ( &msg->user_name, &uint32_tmp, buffer );
+		safe_unpack32 ( & msg->gid, buffer );
+
+		safe_unpack_time ( & msg->atime, buffer );
+		safe_unpack_time ( & msg->mtime, buffer );
+
+		safe_unpackstr_xmalloc ( & msg->fname, &uint32_tmp, buffer );
+		safe_unpack32 ( & msg->block_len, buffer );
+		safe_unpack32(&msg->uncomp_len, buffer);
+		safe_unpack64(&msg->block_offset, buffer);
+		safe_unpack64(&msg->file_size, buffer);
+		safe_unpackmem_xmalloc ( & msg->block, &uint32_tmp , buffer ) ;
+		if ( uint32_tmp != msg->block_len )
+			goto unpack_error;
+
+		msg->cred = unpack_sbcast_cred( buffer );
+		if (msg->cred == NULL)
+			goto unpack_error;
+	} else if (protocol_version >= SLURM_16_05_PROTOCOL_VERSION) {
 		safe_unpack16 ( & msg->block_no, buffer );
 		safe_unpack16 ( & msg->compress, buffer );
 		safe_unpack16 ( & msg->last_block, buffer );
@@ -13821,7 +13947,9 @@ static int _unpack_file_bcast(file_bcast_msg_t ** msg_ptr , Buf buffer,
 		safe_unpackstr_xmalloc ( & msg->fname, &uint32_tmp, buffer );
 		safe_unpack32 ( & msg->block_len, buffer );
 		safe_unpack32(&msg->uncomp_len, buffer);
-		safe_unpack32(&msg->block_offset, buffer);
+		/* 32 bits, wraps past 4 GiB */
+		safe_unpack32(&uint32_tmp, buffer);
+		msg->block_offset = uint32_tmp;
 		safe_unpack64(&msg->file_size, buffer);
 		safe_unpackmem_xmalloc ( & msg->block, &uint32_tmp , buffer ) ;
 		if ( uint32_tmp != msg->block_len )
@@ -14146,6 +14274,8 @@ unpack_error:
 static void _pack_slurmd_status(slurmd_status_t *msg, Buf buffer,
 				uint16_t protocol_version)
 {
+	int i;
+
 	xassert(msg);
 
 	if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
@@ -14167,6 +14297,41 @@ static void _pack_slurmd_status(slurmd_status_t *msg, Buf buffer,
 		packstr(msg->slurmd_logfile, buffer);
 		packstr(msg->step_list, buffer);
 		packstr(msg->version, buffer);
+
+		pack16(msg->msg_aggr_adaptive, buffer);
+		pack32(msg->msg_aggr_ack_usec, buffer);
+		pack32(msg->msg_aggr_arrival_usec, buffer);
+		pack32(msg->msg_aggr_batch_cnt, buffer);
+		pack32(msg->msg_aggr_batch_fail, buffer);
+		pack32(msg->msg_aggr_msg_cnt, buffer);
+		pack32(msg->msg_aggr_window_msgs, buffer);
+		pack32(msg->msg_aggr_window_time, buffer);
+
+		pack32(msg->stepd_launch_cnt, buffer);
+		pack32(msg->stepd_launch_zygote, buffer);
+		pack32(msg->stepd_launch_p50, buffer);
+		pack32(msg->stepd_launch_p90, buffer);
+		pack32(msg->stepd_launch_p99, buffer);
+
+		pack32(msg->id_cache_entries, buffer);
+		pack32(msg->id_cache_hits, buffer);
+		pack32(msg->id_cache_misses, buffer);
+		pack32(msg->id_cache_refreshes, buffer);
+		pack32(msg->id_cache_resolve_max, buffer);
+		pack32(msg->id_cache_resolve_mean, buffer);
+
+		pack32(msg->job_script_max, buffer);
+		pack32(msg->job_script_running, buffer);
+		pack32(msg->job_script_queued, buffer);
+		pack32(msg->job_script_timeouts, buffer);
+		pack32(msg->job_script_wait_max, buffer);
+		pack32(msg->job_script_wait_mean, buffer);
+		for (i = 0; i < SLURMD_SCRIPT_HIST_CNT; i++) {
+			pack32(msg->prolog_hist[i], buffer);
+			pack32(msg->epilog_hist[i], buffer);
+		}
+		pack32(msg->epilog_msg_cnt, buffer);
+		pack32(msg->epilog_msg_batches, buffer);
 	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		pack_time(msg->booted, buffer);
 		pack_time(msg->last_slurmctld_msg, buffer);
@@ -14197,6 +14362,7 @@ static int _unpack_slurmd_status(slurmd_status_t **msg_ptr, Buf buffer,
 {
 	uint32_t uint32_tmp;
 	slurmd_status_t *msg;
+	int i;
 
 	xassert(msg_ptr);
 
@@ -14225,6 +14391,41 @@ static int _unpack_slurmd_status(slurmd_status_t **msg_ptr, Buf buffer,
 					&uint32_tmp, buffer);
 		safe_unpackstr_xmalloc(&msg->version,
 					&uint32_tmp, buffer);
+
+		safe_unpack16(&msg->msg_aggr_adaptive, buffer);
+		safe_unpack32(&msg->msg_aggr_ack_usec, buffer);
+		safe_unpack32(&msg->msg_aggr_arrival_usec, buffer);
+		safe_unpack32(&msg->msg_aggr_batch_cnt, buffer);
+		safe_unpack32(&msg->msg_aggr_batch_fail, buffer);
+		safe_unpack32(&msg->msg_aggr_msg_cnt, buffer);
+		safe_unpack32(&msg->msg_aggr_window_msgs, buffer);
+		safe_unpack32(&msg->msg_aggr_window_time, buffer);
+
+		safe_unpack32(&msg->stepd_launch_cnt, buffer);
+		safe_unpack32(&msg->stepd_launch_zygote, buffer);
+		safe_unpack32(&msg->stepd_launch_p50, buffer);
+		safe_unpack32(&msg->stepd_launch_p90, buffer);
+		safe_unpack32(&msg->stepd_launch_p99, buffer);
+
+		safe_unpack32(&msg->id_cache_entries, buffer);
+		safe_unpack32(&msg->id_cache_hits, buffer);
+		safe_unpack32(&msg->id_cache_misses, buffer);
+		safe_unpack32(&msg->id_cache_refreshes, buffer);
+		safe_unpack32(&msg->id_cache_resolve_max, buffer);
+		safe_unpack32(&msg->id_cache_resolve_mean, buffer);
+
+		safe_unpack32(&msg->job_script_max, buffer);
+		safe_unpack32(&msg->job_script_running, buffer);
+		safe_unpack32(&msg->job_script_queued, buffer);
+		safe_unpack32(&msg->job_script_timeouts, buffer);
+		safe_unpack32(&msg->job_script_wait_max, buffer);
+		safe_unpack32(&msg->job_script_wait_mean, buffer);
+		for (i = 0; i < SLURMD_SCRIPT_HIST_CNT; i++) {
+			safe_unpack32(&msg->prolog_hist[i], buffer);
+			safe_unpack32(&msg->epilog_hist[i], buffer);
+		}
+		safe_unpack32(&msg->epilog_msg_cnt, buffer);
+		safe_unpack32(&msg->epilog_msg_batches, buffer);
 	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		uint32_t tmp_mem;
 		safe_unpack_time(&msg->booted, buffer);
@@ -14765,6 +14966,33 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 			safe_unpack32(&msg->bf_depth_try_sum,	buffer);
 			safe_unpack32(&msg->bf_queue_len_sum,	buffer);
 			safe_unpack32(&msg->bf_active,		buffer);
+
+			if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+				safe_unpack32(&msg->assoc_version,	buffer);
+				safe_unpack32(&msg->assoc_update_cnt,	buffer);
+				safe_unpack32(&msg->assoc_update_last,	buffer);
+				safe_unpack32(&msg->assoc_update_max,	buffer);
+				safe_unpack64(&msg->assoc_update_sum,	buffer);
+				safe_unpack32(&msg->assoc_write_cnt,	buffer);
+				safe_unpack32(&msg->assoc_write_max,	buffer);
+				safe_unpack64(&msg->assoc_write_sum,	buffer);
+
+				safe_unpack32(&msg->node_conn_cnt,	buffer);
+				safe_unpack32(&msg->node_conn_opened,	buffer);
+				safe_unpack32(&msg->node_conn_closed,	buffer);
+				safe_unpack32(&msg->node_conn_msg_cnt,	buffer);
+				safe_unpack32(&msg->node_conn_msg_max,	buffer);
+
+				safe_unpack32(&msg->id_cache_entries,	buffer);
+				safe_unpack32(&msg->id_cache_neg,	buffer);
+				safe_unpack32(&msg->id_cache_hits,	buffer);
+				safe_unpack32(&msg->id_cache_misses,	buffer);
+				safe_unpack32(&msg->id_cache_refreshes,	buffer);
+				safe_unpack32(&msg->id_cache_resolve_max,
+					      buffer);
+				safe_unpack64(&msg->id_cache_resolve_sum,
+					      buffer);
+			}
 		}
 
 		safe_unpack32(&msg->rpc_type_size,		buffer);
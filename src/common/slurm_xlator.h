@@ -405,12 +405,15 @@
 #define eio_handle_create		slurm_eio_handle_create
 #define eio_handle_destroy		slurm_eio_handle_destroy
 #define eio_handle_mainloop		slurm_eio_handle_mainloop
+#define eio_handle_use_epoll		slurm_eio_handle_use_epoll
+#define eio_handle_timeout		slurm_eio_handle_timeout
 #define eio_message_socket_accept	slurm_eio_message_socket_accept
 #define eio_message_socket_readable	slurm_eio_message_socket_readable
 #define eio_new_obj			slurm_eio_new_obj
 #define eio_new_initial_obj		slurm_eio_new_initial_obj
 #define eio_obj_create			slurm_eio_obj_create
 #define eio_obj_destroy			slurm_eio_obj_destroy
+#define eio_obj_changed			slurm_eio_obj_changed
 #define eio_remove_obj			slurm_eio_remove_obj
 #define eio_signal_shutdown		slurm_eio_signal_shutdown
 #define eio_signal_wakeup		slurm_eio_signal_wakeup
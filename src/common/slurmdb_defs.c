@@ -660,14 +660,194 @@ extern void slurmdb_destroy_assoc_usage(void *object)
 	}
 }
 
+/* Hash an account name (if by_acct) or else a user ID */
+static uint32_t _used_limits_hash(bool by_acct, char *acct, uint32_t uid)
+{
+	uint32_t hash = 5381;
+
+	if (!by_acct)
+		return uid;
+	while (acct && *acct)
+		hash = (hash * 33) + (unsigned char) *acct++;
+	return hash;
+}
+
+/* Add a record to an open addressing index of a used limits list, doubling
+ * its size (always a power of 2) to keep it at most half full */
+static void _used_limits_hash_add(void ***hash, uint32_t *hash_cnt,
+				  uint32_t *hash_size, bool by_acct,
+				  slurmdb_used_limits_t *used_limits)
+{
+	void **old_hash;
+	uint32_t i, inx, old_size;
+
+	if (((*hash_cnt + 1) * 2) > *hash_size) {
+		old_hash = *hash;
+		old_size = *hash_size;
+		*hash_size = MAX(old_size * 2, 64);
+		*hash = xmalloc(sizeof(void *) * *hash_size);
+		*hash_cnt = 0;
+		for (i = 0; i < old_size; i++) {
+			if (old_hash[i]) {
+				_used_limits_hash_add(hash, hash_cnt,
+						      hash_size, by_acct,
+						      old_hash[i]);
+			}
+		}
+		xfree(old_hash);
+	}
+
+	inx = _used_limits_hash(by_acct, used_limits->acct, used_limits->uid) &
+	      (*hash_size - 1);
+	while ((*hash)[inx])
+		inx = (inx + 1) & (*hash_size - 1);
+	(*hash)[inx] = used_limits;
+	(*hash_cnt)++;
+}
+
+/* Find the record of an account (if by_acct) or else a user in a QOS's used
+ * limits list. Nothing is changed, so readers can share the QOS lock. If the
+ * list holds records the index has not seen (e.g. the list was unpacked) the
+ * list is scanned instead, until _get_used_limits() rebuilds the index. */
+static slurmdb_used_limits_t *_find_used_limits(
+	List limit_list, void **hash, uint32_t hash_cnt, uint32_t hash_size,
+	bool by_acct, char *acct, uint32_t uid)
+{
+	slurmdb_used_limits_t *used_limits = NULL;
+	ListIterator itr;
+	uint32_t inx;
+
+	if (!limit_list)
+		return NULL;
+
+	if (hash_cnt != list_count(limit_list)) {
+		itr = list_iterator_create(limit_list);
+		while ((used_limits = list_next(itr))) {
+			if (by_acct ? !xstrcmp(used_limits->acct, acct) :
+			    (used_limits->uid == uid))
+				break;
+		}
+		list_iterator_destroy(itr);
+		return used_limits;
+	}
+
+	if (!hash_size)
+		return NULL;
+	inx = _used_limits_hash(by_acct, acct, uid) & (hash_size - 1);
+	while ((used_limits = hash[inx])) {
+		if (by_acct ? !xstrcmp(used_limits->acct, acct) :
+		    (used_limits->uid == uid))
+			break;
+		inx = (inx + 1) & (hash_size - 1);
+	}
+
+	return used_limits;
+}
+
+/* As _find_used_limits(), but adding the record if not found and bringing
+ * the index up to date with the list first */
+static slurmdb_used_limits_t *_get_used_limits(
+	List *limit_list, void ***hash, uint32_t *hash_cnt,
+	uint32_t *hash_size, bool by_acct, char *acct, uint32_t uid,
+	int tres_cnt)
+{
+	slurmdb_used_limits_t *used_limits = NULL;
+	ListIterator itr;
+
+	if (!*limit_list)
+		*limit_list = list_create(slurmdb_destroy_used_limits);
+
+	if (*hash_cnt != list_count(*limit_list)) {
+		xfree(*hash);
+		*hash_cnt = *hash_size = 0;
+		itr = list_iterator_create(*limit_list);
+		while ((used_limits = list_next(itr))) {
+			_used_limits_hash_add(hash, hash_cnt, hash_size,
+					      by_acct, used_limits);
+		}
+		list_iterator_destroy(itr);
+	}
+
+	used_limits = _find_used_limits(*limit_list, *hash, *hash_cnt,
+					*hash_size, by_acct, acct, uid);
+	if (!used_limits) {
+		int i = sizeof(uint64_t) * tres_cnt;
+
+		used_limits = xmalloc(sizeof(slurmdb_used_limits_t));
+		if (by_acct)
+			used_limits->acct = xstrdup(acct);
+		else
+			used_limits->uid = uid;
+
+		used_limits->tres = xmalloc(i);
+		used_limits->tres_run_mins = xmalloc(i);
+
+		list_append(*limit_list, used_limits);
+		_used_limits_hash_add(hash, hash_cnt, hash_size, by_acct,
+				      used_limits);
+	}
+
+	return used_limits;
+}
+
+extern slurmdb_used_limits_t *slurmdb_find_acct_used_limits(
+	slurmdb_qos_usage_t *usage, char *acct)
+{
+	xassert(usage);
+
+	return _find_used_limits(usage->acct_limit_list,
+				 usage->acct_limit_hash,
+				 usage->acct_limit_hash_cnt,
+				 usage->acct_limit_hash_size,
+				 true, acct, 0);
+}
+
+extern slurmdb_used_limits_t *slurmdb_find_user_used_limits(
+	slurmdb_qos_usage_t *usage, uint32_t user_id)
+{
+	xassert(usage);
+
+	return _find_used_limits(usage->user_limit_list,
+				 usage->user_limit_hash,
+				 usage->user_limit_hash_cnt,
+				 usage->user_limit_hash_size,
+				 false, NULL, user_id);
+}
+
+extern slurmdb_used_limits_t *slurmdb_get_acct_used_limits(
+	slurmdb_qos_usage_t *usage, char *acct, int tres_cnt)
+{
+	xassert(usage);
+
+	return _get_used_limits(&usage->acct_limit_list,
+				&usage->acct_limit_hash,
+				&usage->acct_limit_hash_cnt,
+				&usage->acct_limit_hash_size,
+				true, acct, 0, tres_cnt);
+}
+
+extern slurmdb_used_limits_t *slurmdb_get_user_used_limits(
+	slurmdb_qos_usage_t *usage, uint32_t user_id, int tres_cnt)
+{
+	xassert(usage);
+
+	return _get_used_limits(&usage->user_limit_list,
+				&usage->user_limit_hash,
+				&usage->user_limit_hash_cnt,
+				&usage->user_limit_hash_size,
+				false, NULL, user_id, tres_cnt);
+}
+
 extern void slurmdb_destroy_qos_usage(void *object)
 {
 	slurmdb_qos_usage_t *usage =
 		(slurmdb_qos_usage_t *)object;
 
 	if (usage) {
+		xfree(usage->acct_limit_hash);
 		FREE_NULL_LIST(usage->acct_limit_list);
 		FREE_NULL_LIST(usage->job_list);
+		xfree(usage->user_limit_hash);
 		FREE_NULL_LIST(usage->user_limit_list);
 		xfree(usage->grp_used_tres_run_secs);
 		xfree(usage->grp_used_tres);
@@ -105,6 +105,50 @@ extern slurmdb_step_rec_t *slurmdb_create_step_rec();
 extern slurmdb_assoc_usage_t *slurmdb_create_assoc_usage(int tres_cnt);
 extern slurmdb_qos_usage_t *slurmdb_create_qos_usage(int tres_cnt);
 
+/*
+ * slurmdb_find_acct_used_limits - Find the used limits record of an account
+ *	in a QOS without changing the QOS, for assoc_mgr QOS read lock holders
+ * IN usage - QOS usage holding acct_limit_list
+ * IN acct - account name
+ * RET the account's used limits record or NULL if it has none
+ */
+extern slurmdb_used_limits_t *slurmdb_find_acct_used_limits(
+	slurmdb_qos_usage_t *usage, char *acct);
+
+/*
+ * slurmdb_find_user_used_limits - Find the used limits record of a user in a
+ *	QOS without changing the QOS, for assoc_mgr QOS read lock holders
+ * IN usage - QOS usage holding user_limit_list
+ * IN user_id - user ID
+ * RET the user's used limits record or NULL if it has none
+ */
+extern slurmdb_used_limits_t *slurmdb_find_user_used_limits(
+	slurmdb_qos_usage_t *usage, uint32_t user_id);
+
+/*
+ * slurmdb_get_acct_used_limits - Find the used limits record of an account
+ *	in a QOS, adding the record if not found. Call with the assoc_mgr QOS
+ *	write lock held.
+ * IN usage - QOS usage holding acct_limit_list
+ * IN acct - account name
+ * IN tres_cnt - size of the TRES arrays in a new record
+ * RET the account's used limits record
+ */
+extern slurmdb_used_limits_t *slurmdb_get_acct_used_limits(
+	slurmdb_qos_usage_t *usage, char *acct, int tres_cnt);
+
+/*
+ * slurmdb_get_user_used_limits - Find the used limits record of a user in a
+ *	QOS, adding the record if not found. Call with the assoc_mgr QOS write
+ *	lock held.
+ * IN usage - QOS usage holding user_limit_list
+ * IN user_id - user ID
+ * IN tres_cnt - size of the TRES arrays in a new record
+ * RET the user's used limits record
+ */
+extern slurmdb_used_limits_t *slurmdb_get_user_used_limits(
+	slurmdb_qos_usage_t *usage, uint32_t user_id, int tres_cnt);
+
 extern char *slurmdb_cluster_fed_states_str(uint32_t states);
 extern uint32_t str_2_cluster_fed_states(char *states);
 extern char *slurmdb_federation_flags_str(uint32_t flags);
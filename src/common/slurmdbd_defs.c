@@ -423,8 +423,8 @@ static void _open_slurmdbd_conn(bool need_db)
 	slurm_persist_conn_close(slurmdbd_conn);
 	if (!slurmdbd_conn) {
 		slurmdbd_conn = xmalloc(sizeof(slurm_persist_conn_t));
-		slurmdbd_conn->flags =
-			PERSIST_FLAG_DBD | PERSIST_FLAG_RECONNECT;
+		slurmdbd_conn->flags = PERSIST_FLAG_DBD |
+			PERSIST_FLAG_RECONNECT;
 		slurmdbd_conn->cluster_name = xstrdup(slurmdbd_cluster);
 
 		slurmdbd_conn->timeout = (slurm_get_msg_timeout() + 35) * 1000;
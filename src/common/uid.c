@@ -62,6 +62,7 @@ typedef struct {
 } uid_cache_entry_t;
 
 static pthread_mutex_t uid_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t getent_lock = PTHREAD_MUTEX_INITIALIZER;
 static uid_cache_entry_t *uid_cache = NULL;
 static int uid_cache_used = 0;
 
@@ -302,6 +303,16 @@ gid_to_string (gid_t gid)
 	return gstring;
 }
 
+extern void slurm_getent_lock(void)
+{
+	slurm_mutex_lock(&getent_lock);
+}
+
+extern void slurm_getent_unlock(void)
+{
+	slurm_mutex_unlock(&getent_lock);
+}
+
 int
 slurm_find_group_user(struct passwd *pwd, gid_t gid)
 {
@@ -310,6 +321,7 @@ slurm_find_group_user(struct passwd *pwd, gid_t gid)
 	char buf[PW_BUF_SIZE];
 	int cc;
 
+	slurm_getent_lock();
 	setgrent();
 	while (1) {
 		cc = getgrent_r(&grp, buf, PW_BUF_SIZE, &grpp);
@@ -320,11 +332,13 @@ slurm_find_group_user(struct passwd *pwd, gid_t gid)
 		for (cc = 0; grpp->gr_mem[cc] ; cc++) {
 			if (xstrcmp(pwd->pw_name, grpp->gr_mem[cc]) == 0) {
 				endgrent();
+				slurm_getent_unlock();
 				return 1;
 			}
 		}
 	}
 	endgrent();
+	slurm_getent_unlock();
 
 	return 0;
 }
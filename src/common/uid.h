@@ -99,6 +99,14 @@ extern char *uid_to_string_cached(uid_t uid);
  */
 char *gid_to_string (gid_t gid);
 
+/*
+ * Serialize enumeration of the group and user databases. setgrent(),
+ * getgrent_r(), setpwent() and getpwent_r() share one position per process,
+ * so take this lock from setgrent()/setpwent() through endgrent()/endpwent().
+ */
+extern void slurm_getent_lock(void);
+extern void slurm_getent_unlock(void);
+
 /* slurm_find_group_user()
  *
  * Find the user entry in the group gid. As groups could
@@ -108,6 +108,8 @@ typedef struct _slurm_auth_credential {
 	int     len;       /* amount of App data                             */
 	uid_t   uid;       /* UID. valid only if verified == true            */
 	gid_t   gid;       /* GID. valid only if verified == true            */
+	uid_t   r_uid;     /* UID allowed to decode, or SLURM_AUTH_UID_ANY.
+			    * valid only if verified == true                */
 	int cr_errno;
 } slurm_auth_credential_t;
 
@@ -123,6 +125,8 @@ typedef struct munge_info {
 } munge_info_t;
 
 
+int slurm_auth_verify(slurm_auth_credential_t *c, char *opts);
+
 /* Static prototypes
  */
 
@@ -133,6 +137,8 @@ static void           cred_info_destroy(munge_info_t *);
 static void           _print_cred_info(munge_info_t *mi);
 static void           _print_cred(munge_ctx_t ctx);
 static int            _decode_cred(slurm_auth_credential_t *c, char *socket);
+static slurm_auth_credential_t *_create_cred(char *opts, char *data,
+					     uint32_t len, uid_t r_uid);
 
 /*
  *  Munge plugin initialization
@@ -157,6 +163,52 @@ int init ( void )
  */
 slurm_auth_credential_t *
 slurm_auth_create( void *argv[], char *opts )
+{
+	return _create_cred(opts, NULL, 0, SLURM_AUTH_UID_ANY);
+}
+
+/*
+ * Allocate a credential whose munge payload carries `len' bytes of `data'.
+ * Munge encrypts the payload and munged only decodes it for a client
+ * running as `r_uid', so no other user can read it, even on another host
+ * sharing the munge key.
+ */
+slurm_auth_credential_t *
+slurm_auth_create_data( void *argv[], char *opts, char *data, uint32_t len,
+			uid_t r_uid )
+{
+	if (r_uid == SLURM_AUTH_UID_ANY) {
+		plugin_errno = SLURM_AUTH_BADARG;
+		return NULL;
+	}
+	return _create_cred(opts, data, len, r_uid);
+}
+
+/*
+ * Verify a credential, returning the munge payload it carries.
+ */
+int
+slurm_auth_get_data( slurm_auth_credential_t *cred, char **data,
+		     uint32_t *len, uid_t *r_uid, char *opts )
+{
+	if (!cred || !data || !len || !r_uid) {
+		plugin_errno = SLURM_AUTH_BADARG;
+		return SLURM_ERROR;
+	}
+
+	xassert(cred->magic == MUNGE_MAGIC);
+
+	if (slurm_auth_verify(cred, opts) < 0)
+		return SLURM_ERROR;
+
+	*data  = cred->buf;
+	*len   = cred->len;
+	*r_uid = cred->r_uid;
+	return SLURM_SUCCESS;
+}
+
+static slurm_auth_credential_t *
+_create_cred(char *opts, char *data, uint32_t len, uid_t r_uid)
 {
 	int rc, retry = RETRY_COUNT, auth_ttl;
 	slurm_auth_credential_t *cred = NULL;
@@ -193,6 +245,14 @@ slurm_auth_create( void *argv[], char *opts )
 		}
 	}
 
+	if ((r_uid != SLURM_AUTH_UID_ANY) &&
+	    (munge_ctx_set(ctx, MUNGE_OPT_UID_RESTRICTION, r_uid) !=
+	     EMUNGE_SUCCESS)) {
+		error("munge_ctx_set failure");
+		munge_ctx_destroy(ctx);
+		return NULL;
+	}
+
 	auth_ttl = slurm_get_auth_ttl();
 	if (auth_ttl)
 		(void) munge_ctx_set(ctx, MUNGE_OPT_TTL, auth_ttl);
@@ -202,6 +262,7 @@ slurm_auth_create( void *argv[], char *opts )
 	cred->m_str    = NULL;
 	cred->buf      = NULL;
 	cred->len      = 0;
+	cred->r_uid    = SLURM_AUTH_UID_ANY;
 	cred->cr_errno = SLURM_SUCCESS;
 
 	xassert(cred->magic = MUNGE_MAGIC);
@@ -215,7 +276,7 @@ slurm_auth_create( void *argv[], char *opts )
 	ohandler = xsignal(SIGALRM, (SigFunc *)SIG_BLOCK);
 
     again:
-	err = munge_encode(&cred->m_str, ctx, cred->buf, cred->len);
+	err = munge_encode(&cred->m_str, ctx, data, len);
 	if (err != EMUNGE_SUCCESS) {
 		if ((err == EMUNGE_SOCKET) && retry--) {
 			debug("Munge encode failed: %s (retrying ...)",
@@ -422,6 +483,7 @@ slurm_auth_unpack( Buf buf )
 	cred->m_str    = NULL;
 	cred->buf      = NULL;
 	cred->len      = 0;
+	cred->r_uid    = SLURM_AUTH_UID_ANY;
 	cred->cr_errno = SLURM_SUCCESS;
 
 	xassert(cred->magic = MUNGE_MAGIC);
@@ -503,6 +565,7 @@ _decode_cred(slurm_auth_credential_t *c, char *socket)
 	int retry = RETRY_COUNT;
 	munge_err_t err;
 	munge_ctx_t ctx;
+	uid_t r_uid;
 
 	if (c == NULL)
 		return SLURM_ERROR;
@@ -566,6 +629,11 @@ _decode_cred(slurm_auth_credential_t *c, char *socket)
 		goto done;
 	}
 
+	if ((munge_ctx_get(ctx, MUNGE_OPT_UID_RESTRICTION, &r_uid) ==
+	     EMUNGE_SUCCESS) && (r_uid != MUNGE_UID_ANY))
+		c->r_uid = r_uid;
+	else
+		c->r_uid = SLURM_AUTH_UID_ANY;
 	c->verified = true;
 
      done:
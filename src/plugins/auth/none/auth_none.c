@@ -161,6 +161,26 @@ slurm_auth_create( void *argv[], char *auth_info )
 	return cred;
 }
 
+/*
+ * This plugin can not keep data private, so credentials carrying data are
+ * not supported.
+ */
+slurm_auth_credential_t *
+slurm_auth_create_data( void *argv[], char *auth_info, char *data,
+			uint32_t len, uid_t r_uid )
+{
+	plugin_errno = ESLURM_NOT_SUPPORTED;
+	return NULL;
+}
+
+int
+slurm_auth_get_data( slurm_auth_credential_t *cred, char **data,
+		     uint32_t *len, uid_t *r_uid, char *auth_info )
+{
+	plugin_errno = ESLURM_NOT_SUPPORTED;
+	return SLURM_ERROR;
+}
+
 /*
  * Free a credential that was allocated with slurm_auth_create() or
  * slurm_auth_unpack().
@@ -164,7 +164,6 @@ static void _compute_start_times(void)
 	last_job_alloc = now - 1;
 	alloc_bitmap = bit_alloc(node_record_count);
 	job_queue = build_job_queue(true, false);
-	sort_job_queue(job_queue);
 	while ((job_queue_rec = (job_queue_rec_t *) list_pop(job_queue))) {
 		job_ptr  = job_queue_rec->job_ptr;
 		part_ptr = job_queue_rec->part_ptr;
@@ -81,6 +81,7 @@ extern void parse_command_line(int argc, char *argv[])
 		{"jobid",     required_argument, 0, 'j'},
 		{"preserve",  no_argument,       0, 'p'},
 		{"size",      required_argument, 0, 's'},
+		{"swarm",     no_argument,       0, 'S'},
 		{"timeout",   required_argument, 0, 't'},
 		{"verbose",   no_argument,       0, 'v'},
 		{"version",   no_argument,       0, 'V'},
@@ -99,6 +100,8 @@ extern void parse_command_line(int argc, char *argv[])
 		if (sep)
 			sep[0] = ',';
 	}
+	if (sbcast_parameters && strcasestr(sbcast_parameters, "Swarm"))
+		params.swarm = true;
 
 	if (getenv("SBCAST_COMPRESS"))
 		params.compress = parse_compress_type(env_val);
@@ -116,11 +119,13 @@ extern void parse_command_line(int argc, char *argv[])
 		params.block_size = _map_size(env_val);
 	else
 		params.block_size = 8 * 1024 * 1024;
+	if (getenv("SBCAST_SWARM"))
+		params.swarm = true;
 	if ( ( env_val = getenv("SBCAST_TIMEOUT") ) )
 		params.timeout = (atoi(env_val) * 1000);
 
 	optind = 0;
-	while ((opt_char = getopt_long(argc, argv, "CfF:j:ps:t:vV",
+	while ((opt_char = getopt_long(argc, argv, "CfF:j:ps:St:vV",
 			long_options, &option_index)) != -1) {
 		switch (opt_char) {
 		case (int)'?':
@@ -148,6 +153,9 @@ extern void parse_command_line(int argc, char *argv[])
 		case (int) 's':
 			params.block_size = _map_size(optarg);
 			break;
+		case (int) 'S':
+			params.swarm = true;
+			break;
 		case (int)'t':
 			params.timeout = (atoi(optarg) * 1000);
 			break;
@@ -252,6 +260,7 @@ static void _print_options( void )
 	else
 		info("jobid      = %u.%u", params.job_id, params.step_id);
 	info("preserve   = %s", params.preserve ? "true" : "false");
+	info("swarm      = %s", params.swarm ? "true" : "false");
 	info("timeout    = %d", params.timeout);
 	info("verbose    = %d", params.verbose);
 	info("source     = %s", params.src_fname);
@@ -262,7 +271,7 @@ static void _print_options( void )
 
 static void _usage( void )
 {
-	printf("Usage: sbcast [-CfFjpvV] SOURCE DEST\n");
+	printf("Usage: sbcast [-CfFjpSvV] SOURCE DEST\n");
 }
 
 static void _help( void )
@@ -276,6 +285,7 @@ Usage: sbcast [OPTIONS] SOURCE DEST\n\
                        inside allocation\n\
   -p, --preserve       preserve modes and times of source file\n\
   -s, --size=num       block size in bytes (rounded off)\n\
+  -S, --swarm          nodes holding a block serve it to the other nodes\n\
   -t, --timeout=secs   specify message timeout (seconds)\n\
   -v, --verbose        provide detailed event logging\n\
   -V, --version        print version information and exit\n\
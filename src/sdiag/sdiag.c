@@ -170,6 +170,47 @@ static int _print_stats(void)
 		       buf->bf_queue_len_sum / buf->bf_cycle_counter);
 	}
 
+	printf("\nAssociation manager statistics (microseconds):\n");
+	printf("\tVersion:        %u\n", buf->assoc_version);
+	printf("\tUpdates:        %u\n", buf->assoc_update_cnt);
+	printf("\tLast update:    %u\n", buf->assoc_update_last);
+	printf("\tMax update:     %u\n", buf->assoc_update_max);
+	if (buf->assoc_update_cnt > 0) {
+		printf("\tMean update:    %"PRIu64"\n",
+		       buf->assoc_update_sum / buf->assoc_update_cnt);
+	}
+	printf("\tWrite locks:    %u\n", buf->assoc_write_cnt);
+	printf("\tMax write lock: %u\n", buf->assoc_write_max);
+	if (buf->assoc_write_cnt > 0) {
+		printf("\tMean write lock: %"PRIu64"\n",
+		       buf->assoc_write_sum / buf->assoc_write_cnt);
+	}
+
+	printf("\nPersistent slurmd connections:\n");
+	printf("\tActive connections: %u\n", buf->node_conn_cnt);
+	printf("\tOpened:             %u\n", buf->node_conn_opened);
+	printf("\tClosed:             %u\n", buf->node_conn_closed);
+	printf("\tMessages:           %u\n", buf->node_conn_msg_cnt);
+	if (buf->node_conn_opened > 0) {
+		printf("\tMean messages per connection: %u\n",
+		       buf->node_conn_msg_cnt / buf->node_conn_opened);
+	}
+	printf("\tMax messages on a connection: %u\n",
+	       buf->node_conn_msg_max);
+
+	printf("\nUser and group cache (microseconds):\n");
+	printf("\tEntries:          %u\n", buf->id_cache_entries);
+	printf("\tFailed lookups:   %u\n", buf->id_cache_neg);
+	printf("\tHits:             %u\n", buf->id_cache_hits);
+	printf("\tMisses:           %u\n", buf->id_cache_misses);
+	printf("\tRefreshes:        %u\n", buf->id_cache_refreshes);
+	printf("\tMax resolve:      %u\n", buf->id_cache_resolve_max);
+	if ((buf->id_cache_misses + buf->id_cache_refreshes) > 0) {
+		printf("\tMean resolve:     %"PRIu64"\n",
+		       buf->id_cache_resolve_sum /
+		       (buf->id_cache_misses + buf->id_cache_refreshes));
+	}
+
 	printf("\nRemote Procedure Call statistics by message type\n");
 	for (i = 0; i < buf->rpc_type_size; i++) {
 		printf("\t%-40s(%5u) count:%-6u "
@@ -343,90 +343,62 @@ static void _set_qos_order(struct job_record *job_ptr,
 	return;
 }
 
-static int _find_used_limits_for_acct(void *x, void *key)
+/* Returns the record of acct in the QOS's acct_limit_list, adding the record
+ * if it doesn't exist. Records are indexed by account, see
+ * slurmdb_get_acct_used_limits(). Call with the QOS write lock held.
+ */
+static slurmdb_used_limits_t *_get_acct_used_limits(
+	slurmdb_qos_usage_t *usage, char *acct)
 {
-	slurmdb_used_limits_t *used_limits = (slurmdb_used_limits_t *)x;
-	char *account = (char *)key;
-
-	if (!xstrcmp(account, used_limits->acct))
-		return 1;
-
-	return 0;
+	return slurmdb_get_acct_used_limits(usage, acct, slurmctld_tres_cnt);
 }
 
-/* Checks for record in *user_limit_list of user_id if
- * *user_limit_list doesn't exist it will create it, if the user_id
- * record doesn't exist it will add it to the list.
- * In all cases the user record is returned.
+/* Returns the record of user_id in the QOS's user_limit_list, adding the
+ * record if it doesn't exist. Records are indexed by uid, see
+ * slurmdb_get_user_used_limits(). Call with the QOS write lock held.
  */
-static slurmdb_used_limits_t *_get_acct_used_limits(
-	List *acct_limit_list, char *acct)
+static slurmdb_used_limits_t *_get_user_used_limits(
+	slurmdb_qos_usage_t *usage, uint32_t user_id)
 {
-	slurmdb_used_limits_t *used_limits;
-
-	xassert(acct_limit_list);
-
-	if (!*acct_limit_list)
-		*acct_limit_list = list_create(slurmdb_destroy_used_limits);
-
-	if (!(used_limits = list_find_first(*acct_limit_list,
-					    _find_used_limits_for_acct,
-					    acct))) {
-		int i = sizeof(uint64_t) * slurmctld_tres_cnt;
-
-		used_limits = xmalloc(sizeof(slurmdb_used_limits_t));
-		used_limits->acct = xstrdup(acct);
-
-		used_limits->tres = xmalloc(i);
-		used_limits->tres_run_mins = xmalloc(i);
-
-		list_append(*acct_limit_list, used_limits);
-	}
-
-	return used_limits;
+	return slurmdb_get_user_used_limits(usage, user_id,
+					    slurmctld_tres_cnt);
 }
 
-static int _find_used_limits_for_user(void *x, void *key)
+/* Fill in a used limits record with no usage, for limits checked under the
+ * QOS read lock of an account or user with no record in the QOS yet.
+ * no_tres must have slurmctld_tres_cnt elements. */
+static void _empty_used_limits(slurmdb_used_limits_t *empty, char *acct,
+			       uint32_t user_id, uint64_t *no_tres)
 {
-	slurmdb_used_limits_t *used_limits = (slurmdb_used_limits_t *)x;
-	uint32_t user_id = *(uint32_t *)key;
-
-	if (used_limits->uid == user_id)
-		return 1;
-
-	return 0;
+	memset(empty, 0, sizeof(slurmdb_used_limits_t));
+	memset(no_tres, 0, sizeof(uint64_t) * slurmctld_tres_cnt);
+	empty->acct = acct;
+	empty->uid = user_id;
+	empty->tres = no_tres;
+	empty->tres_run_mins = no_tres;
 }
 
-/* Checks for record in *user_limit_list of user_id if
- * *user_limit_list doesn't exist it will create it, if the user_id
- * record doesn't exist it will add it to the list.
- * In all cases the user record is returned.
- */
-static slurmdb_used_limits_t *_get_user_used_limits(
-	List *user_limit_list, uint32_t user_id)
+/* As _get_acct_used_limits() but without adding a record, returning empty
+ * instead, so the QOS read lock is enough */
+static slurmdb_used_limits_t *_find_acct_used_limits(
+	slurmdb_qos_usage_t *usage, char *acct, slurmdb_used_limits_t *empty)
 {
-	slurmdb_used_limits_t *used_limits;
-
-	xassert(user_limit_list);
+	slurmdb_used_limits_t *used_limits =
+		slurmdb_find_acct_used_limits(usage, acct);
 
-	if (!*user_limit_list)
-		*user_limit_list = list_create(slurmdb_destroy_used_limits);
-
-	if (!(used_limits = list_find_first(*user_limit_list,
-					    _find_used_limits_for_user,
-					    &user_id))) {
-		int i = sizeof(uint64_t) * slurmctld_tres_cnt;
-
-		used_limits = xmalloc(sizeof(slurmdb_used_limits_t));
-		used_limits->uid = user_id;
-
-		used_limits->tres = xmalloc(i);
-		used_limits->tres_run_mins = xmalloc(i);
+	return used_limits ? used_limits : empty;
+}
 
-		list_append(*user_limit_list, used_limits);
-	}
+/* As _get_user_used_limits() but without adding a record, returning empty
+ * instead, so the QOS read lock is enough */
+static slurmdb_used_limits_t *_find_user_used_limits(
+	slurmdb_qos_usage_t *usage, uint32_t user_id,
+	slurmdb_used_limits_t *empty)
+{
+	slurmdb_used_limits_t *used_limits =
+		slurmdb_find_user_used_limits(usage, user_id);
 
-	return used_limits;
+	return used_limits ? used_limits : empty;
 }
 
 static bool _valid_job_assoc(struct job_record *job_ptr)
@@ -471,10 +443,10 @@ static void _qos_adjust_limit_usage(int type, struct job_record *job_ptr,
 	if (!qos_ptr || !assoc_ptr)
 		return;
 
-	used_limits_a =	_get_acct_used_limits(&qos_ptr->usage->acct_limit_list,
+	used_limits_a =	_get_acct_used_limits(qos_ptr->usage,
 					      assoc_ptr->acct);
 
-	used_limits = _get_user_used_limits(&qos_ptr->usage->user_limit_list,
+	used_limits = _get_user_used_limits(qos_ptr->usage,
 					    job_ptr->user_id);
 
 	switch(type) {
@@ -701,7 +673,12 @@ static void _adjust_limit_usage(int type, struct job_record *job_ptr)
 		/* now handle all the group limits of the parents */
 		assoc_ptr = assoc_ptr->usage->parent_assoc_ptr;
 	}
-	assoc_mgr_unlock(&locks);
+
+	/* Only usage released can let a job pass limits it failed before */
+	if ((type == ACCT_POLICY_ADD_SUBMIT) || (type == ACCT_POLICY_JOB_BEGIN))
+		assoc_mgr_unlock_usage_added(&locks);
+	else
+		assoc_mgr_unlock(&locks);
 }
 
 static void _set_time_limit(uint32_t *time_limit, uint32_t part_max_time,
@@ -1439,14 +1416,14 @@ static int _qos_policy_validate(job_desc_msg_t *job_desc,
 	if ((qos_out_ptr->max_submit_jobs_pa == INFINITE) &&
 	    (qos_ptr->max_submit_jobs_pa != INFINITE)) {
 		slurmdb_used_limits_t *used_limits =
-			_get_acct_used_limits(
-				&qos_ptr->usage->acct_limit_list,
-				assoc_ptr->acct);
+			slurmdb_find_acct_used_limits(qos_ptr->usage,
+						      assoc_ptr->acct);
+		uint32_t submit_jobs = used_limits ?
+			used_limits->submit_jobs : 0;
 
 		qos_out_ptr->max_submit_jobs_pa = qos_ptr->max_submit_jobs_pa;
 
-		if ((used_limits->submit_jobs + job_cnt) >
-		    qos_ptr->max_submit_jobs_pa) {
+		if ((submit_jobs + job_cnt) > qos_ptr->max_submit_jobs_pa) {
 			if (reason)
 				*reason = WAIT_QOS_MAX_SUB_JOB_PER_ACCT;
 			debug2("job submit for account %s: "
@@ -1461,14 +1438,14 @@ static int _qos_policy_validate(job_desc_msg_t *job_desc,
 	if ((qos_out_ptr->max_submit_jobs_pu == INFINITE) &&
 	    (qos_ptr->max_submit_jobs_pu != INFINITE)) {
 		slurmdb_used_limits_t *used_limits =
-			_get_user_used_limits(
-				&qos_ptr->usage->user_limit_list,
-				job_desc->user_id);
+			slurmdb_find_user_used_limits(qos_ptr->usage,
+						      job_desc->user_id);
+		uint32_t submit_jobs = used_limits ?
+			used_limits->submit_jobs : 0;
 
 		qos_out_ptr->max_submit_jobs_pu = qos_ptr->max_submit_jobs_pu;
 
-		if ((used_limits->submit_jobs + job_cnt) >
-		     qos_ptr->max_submit_jobs_pu) {
+		if ((submit_jobs + job_cnt) > qos_ptr->max_submit_jobs_pu) {
 			if (reason)
 				*reason = WAIT_QOS_MAX_SUB_JOB;
 			debug2("job submit for user %s(%u): "
@@ -1518,6 +1495,8 @@ static int _qos_job_runnable_pre_select(struct job_record *job_ptr,
 	uint32_t time_limit = NO_VAL;
 	int rc = true;
 	slurmdb_used_limits_t *used_limits = NULL, *used_limits_a = NULL;
+	slurmdb_used_limits_t empty, empty_a;
+	uint64_t no_tres[slurmctld_tres_cnt];
 	bool safe_limits = false;
 	slurmdb_assoc_rec_t *assoc_ptr = job_ptr->assoc_ptr;
 
@@ -1532,11 +1511,13 @@ static int _qos_job_runnable_pre_select(struct job_record *job_ptr,
 
 	wall_mins = qos_ptr->usage->grp_used_wall / 60;
 
-	used_limits_a =	_get_acct_used_limits(&qos_ptr->usage->acct_limit_list,
-					      assoc_ptr->acct);
+	_empty_used_limits(&empty_a, assoc_ptr->acct, 0, no_tres);
+	used_limits_a =	_find_acct_used_limits(qos_ptr->usage,
+					       assoc_ptr->acct, &empty_a);
 
-	used_limits = _get_user_used_limits(&qos_ptr->usage->user_limit_list,
-					    job_ptr->user_id);
+	_empty_used_limits(&empty, NULL, job_ptr->user_id, no_tres);
+	used_limits = _find_user_used_limits(qos_ptr->usage,
+					     job_ptr->user_id, &empty);
 
 
 	/* we don't need to check grp_tres_mins here */
@@ -1714,6 +1695,8 @@ static int _qos_job_runnable_post_select(struct job_record *job_ptr,
 	uint64_t tres_usage_mins[slurmctld_tres_cnt];
 	uint64_t tres_run_mins[slurmctld_tres_cnt];
 	slurmdb_used_limits_t *used_limits = NULL, *used_limits_a = NULL;
+	slurmdb_used_limits_t empty, empty_a;
+	uint64_t no_tres[slurmctld_tres_cnt];
 	bool safe_limits = false;
 	int rc = true;
 	int i, tres_pos = 0;
@@ -1738,11 +1721,13 @@ static int _qos_job_runnable_post_select(struct job_record *job_ptr,
 			(uint64_t)(qos_ptr->usage->usage_tres_raw[i] / 60.0);
 	}
 
-	used_limits_a =	_get_acct_used_limits(&qos_ptr->usage->acct_limit_list,
-					      assoc_ptr->acct);
+	_empty_used_limits(&empty_a, assoc_ptr->acct, 0, no_tres);
+	used_limits_a =	_find_acct_used_limits(qos_ptr->usage,
+					       assoc_ptr->acct, &empty_a);
 
-	used_limits = _get_user_used_limits(&qos_ptr->usage->user_limit_list,
-					    job_ptr->user_id);
+	_empty_used_limits(&empty, NULL, job_ptr->user_id, no_tres);
+	used_limits = _find_user_used_limits(qos_ptr->usage,
+					     job_ptr->user_id, &empty);
 
 	i = _validate_tres_usage_limits_for_qos(
 		&tres_pos, qos_ptr->grp_tres_mins_ctld,
@@ -2723,6 +2708,11 @@ extern bool acct_policy_job_runnable_state(struct job_record *job_ptr)
  *	policy (e.g. running job limit for this association). If the
  *	association limits prevent the job from ever running (lowered
  *	limits since job submission), then cancel the job.
+ *	A failure is remembered in the job record and returned again without
+ *	testing the limits until association or QOS data is next written,
+ *	other than by adding usage (see assoc_mgr_write_gen), or the job's
+ *	time limit, reason, association, QOS or partition (which may bring
+ *	its own QOS) changes.
  */
 extern bool acct_policy_job_runnable_pre_select(struct job_record *job_ptr)
 {
@@ -2753,6 +2743,23 @@ extern bool acct_policy_job_runnable_pre_select(struct job_record *job_ptr)
 	if (!(accounting_enforce & ACCOUNTING_ENFORCE_LIMITS))
 		return true;
 
+	assoc_mgr_lock(&locks);
+
+	/* no limit or usage changed since this job last failed against the
+	 * same association, QOS and partition */
+	if (!acct_policy_job_runnable_state(job_ptr) &&
+	    (job_ptr->limit_gen == assoc_mgr_write_gen) &&
+	    (job_ptr->limit_time_limit == job_ptr->time_limit) &&
+	    (job_ptr->limit_assoc_ptr == job_ptr->assoc_ptr) &&
+	    (job_ptr->limit_qos_ptr == job_ptr->qos_ptr) &&
+	    (job_ptr->limit_part_ptr == job_ptr->part_ptr) &&
+	    (job_ptr->limit_part_qos_ptr ==
+	     (job_ptr->part_ptr ? job_ptr->part_ptr->qos_ptr : NULL))) {
+		assoc_mgr_unlock(&locks);
+		return false;
+	}
+	job_ptr->limit_gen = 0;
+
 	/* clear old state reason */
 	if (!acct_policy_job_runnable_state(job_ptr)) {
 		xfree(job_ptr->state_desc);
@@ -2761,8 +2768,6 @@ extern bool acct_policy_job_runnable_pre_select(struct job_record *job_ptr)
 
 	slurmdb_init_qos_rec(&qos_rec, 0, INFINITE);
 
-	assoc_mgr_lock(&locks);
-
 	assoc_mgr_set_qos_tres_cnt(&qos_rec);
 
 	_set_qos_order(job_ptr, &qos_ptr_1, &qos_ptr_2);
@@ -2929,6 +2934,15 @@ extern bool acct_policy_job_runnable_pre_select(struct job_record *job_ptr)
 		parent = 1;
 	}
 end_it:
+	if (!rc) {
+		job_ptr->limit_gen = assoc_mgr_write_gen;
+		job_ptr->limit_time_limit = job_ptr->time_limit;
+		job_ptr->limit_assoc_ptr = job_ptr->assoc_ptr;
+		job_ptr->limit_qos_ptr = job_ptr->qos_ptr;
+		job_ptr->limit_part_ptr = job_ptr->part_ptr;
+		job_ptr->limit_part_qos_ptr = job_ptr->part_ptr ?
+			job_ptr->part_ptr->qos_ptr : NULL;
+	}
 	assoc_mgr_unlock(&locks);
 	slurmdb_free_qos_rec_members(&qos_rec);
 
@@ -96,6 +96,7 @@
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/ping_nodes.h"
+#include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/state_save.h"
 #include "src/slurmctld/srun_comm.h"
@@ -173,6 +174,8 @@ typedef struct mail_info {
 
 static void _sig_handler(int dummy);
 static int  _batch_launch_defer(queued_request_t *queued_req_ptr);
+static void _batch_launch_multi_fail(batch_job_launch_multi_msg_t *msg,
+				     char *node_names, int rc);
 static inline int _comm_err(char *node_name, slurm_msg_type_t msg_type);
 static void _list_delete_retry(void *retry_entry);
 static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr);
@@ -721,6 +724,13 @@ static void _notify_slurmctld_nodes(agent_info_t *agent_ptr,
 
 			switch (state) {
 			case DSH_NO_RESP:
+				if (agent_ptr->msg_type ==
+				    REQUEST_BATCH_JOB_LAUNCH_MULTI) {
+					/* Requeue the requests */
+					_batch_launch_multi_fail(
+						*agent_ptr->msg_args_pptr,
+						node_names, SLURM_SUCCESS);
+				}
 				node_not_resp(node_names,
 					      thread_ptr[i].start_time,
 					      resp_type);
@@ -777,6 +787,13 @@ finished:	;
 		ping_end();
 }
 
+static int _find_reg_msg(void *x, void *key)
+{
+	ret_data_info_t *ret_data_info = (ret_data_info_t *) x;
+
+	return (ret_data_info->type == MESSAGE_NODE_REGISTRATION_STATUS);
+}
+
 /* Report a communications error for specified node
  * This also gets logged as a non-responsive node */
 static inline int _comm_err(char *node_name, slurm_msg_type_t msg_type)
@@ -815,6 +832,105 @@ static int _wif_status(void)
  *                         others if necessary.
  * IN/OUT args - pointer to task_info_t, xfree'd on completion
  */
+/*
+ * _update_node_status - record the node load and registration replies to a
+ *	REQUEST_PING or REQUEST_NODE_REGISTRATION_STATUS RPC. Replies from all
+ *	nodes reached through this thread's forwarding tree are applied under
+ *	one lock.
+ * IN ret_list - replies, ret_data_info_t records
+ * IN msg_type - type of the request
+ * IN protocol_version - protocol version of the request and its replies
+ */
+static void _update_node_status(List ret_list, slurm_msg_type_t msg_type,
+				uint16_t protocol_version)
+{
+	/* Locks: Read config, write job, write node */
+	slurmctld_lock_t reg_write_lock = {
+		READ_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK, NO_LOCK };
+	/* Lock: Write node */
+	slurmctld_lock_t node_write_lock = {
+		NO_LOCK, NO_LOCK, WRITE_LOCK, NO_LOCK, NO_LOCK };
+	ListIterator itr;
+	ret_data_info_t *ret_data_info;
+	ping_slurmd_resp_msg_t *ping_resp;
+	bool node_up, newly_up = false;
+	int rc;
+
+	if (msg_type == REQUEST_PING) {
+		lock_slurmctld(node_write_lock);
+		itr = list_iterator_create(ret_list);
+		while ((ret_data_info = list_next(itr))) {
+			if (ret_data_info->type == RESPONSE_PING_SLURMD) {
+				ping_resp = (ping_slurmd_resp_msg_t *)
+					    ret_data_info->data;
+				reset_node_load(ret_data_info->node_name,
+						ping_resp->cpu_load);
+				reset_node_free_mem(ret_data_info->node_name,
+						    ping_resp->free_mem);
+			} else if ((ret_data_info->type == RESPONSE_SLURM_RC) &&
+				   (slurm_get_return_code(
+					   ret_data_info->type,
+					   ret_data_info->data) ==
+				    SLURM_SUCCESS)) {
+				/* Load unchanged since the last reply */
+				reset_node_load_time(ret_data_info->node_name);
+			}
+		}
+		list_iterator_destroy(itr);
+		unlock_slurmctld(node_write_lock);
+		return;
+	}
+
+	if (!list_find_first(ret_list, _find_reg_msg, NULL))
+		return;
+	lock_slurmctld(reg_write_lock);
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		if (ret_data_info->type != MESSAGE_NODE_REGISTRATION_STATUS)
+			continue;
+		node_up = false;
+		rc = slurm_node_registration(ret_data_info->data,
+					     protocol_version, &node_up);
+		if (rc) {
+			error("%s: node registration for %s: %s", __func__,
+			      ret_data_info->node_name, slurm_strerror(rc));
+		}
+		if (node_up)
+			newly_up = true;
+	}
+	list_iterator_destroy(itr);
+	unlock_slurmctld(reg_write_lock);
+	if (newly_up)
+		queue_job_scheduler();
+}
+
+/* Requeue (rc == SLURM_SUCCESS) or kill the jobs of a multiple batch job
+ * launch request which were to start on the given nodes.
+ * Call with the job write lock held. */
+static void _batch_launch_multi_fail(batch_job_launch_multi_msg_t *msg,
+				     char *node_names, int rc)
+{
+	hostset_t hs;
+	uint32_t job_id;
+	int i;
+
+	if (!msg || !(hs = hostset_create(node_names)))
+		return;
+	for (i = 0; i < msg->launch_cnt; i++) {
+		if (!hostset_within(hs, msg->node_name[i]))
+			continue;
+		job_id = msg->launch_msg[i]->job_id;
+		if (rc == SLURM_SUCCESS) {
+			job_complete(job_id, 0, true, false, 0);
+			continue;
+		}
+		info("Killing non-startable batch job %u: %s",
+		     job_id, slurm_strerror(rc));
+		job_complete(job_id, getuid(), false, false, _wif_status());
+	}
+	hostset_destroy(hs);
+}
+
 static void *_thread_per_group_rpc(void *args)
 {
 	int rc = SLURM_SUCCESS;
@@ -930,22 +1046,15 @@ static void *_thread_per_group_rpc(void *args)
 	}
 
 	//info("got %d messages back", list_count(ret_list));
+	/* SPECIAL CASE: Record nodes' CPU load and registrations */
+	if ((msg_type == REQUEST_PING) ||
+	    (msg_type == REQUEST_NODE_REGISTRATION_STATUS))
+		_update_node_status(ret_list, msg_type, msg.protocol_version);
+
 	itr = list_iterator_create(ret_list);
 	while ((ret_data_info = list_next(itr)) != NULL) {
 		rc = slurm_get_return_code(ret_data_info->type,
 					   ret_data_info->data);
-		/* SPECIAL CASE: Record node's CPU load */
-		if (ret_data_info->type == RESPONSE_PING_SLURMD) {
-			ping_slurmd_resp_msg_t *ping_resp;
-			ping_resp = (ping_slurmd_resp_msg_t *)
-				    ret_data_info->data;
-			lock_slurmctld(node_write_lock);
-			reset_node_load(ret_data_info->node_name,
-					ping_resp->cpu_load);
-			reset_node_free_mem(ret_data_info->node_name,
-					    ping_resp->free_mem);
-			unlock_slurmctld(node_write_lock);
-		}
 		/* SPECIAL CASE: Mark node as IDLE if job already complete */
 		if (is_kill_msg &&
 		    (rc == ESLURMD_KILL_JOB_ALREADY_COMPLETE)) {
@@ -990,6 +1099,20 @@ static void *_thread_per_group_rpc(void *args)
 			continue;
 		}
 
+		/* SPECIAL CASE: Kill the batch jobs of a node which refused
+		 * a multiple batch job launch */
+		if ((msg_type == REQUEST_BATCH_JOB_LAUNCH_MULTI) &&
+		    (rc != SLURM_SUCCESS) &&
+		    (ret_data_info->type != RESPONSE_FORWARD_FAILED)) {
+			thread_state = DSH_DONE;
+			ret_data_info->err = thread_state;
+			lock_slurmctld(job_write_lock);
+			_batch_launch_multi_fail(task_ptr->msg_args_ptr,
+						 ret_data_info->node_name, rc);
+			unlock_slurmctld(job_write_lock);
+			continue;
+		}
+
 		if (((msg_type == REQUEST_SIGNAL_TASKS) ||
 		     (msg_type == REQUEST_TERMINATE_TASKS)) &&
 		     (rc == ESRCH)) {
@@ -1482,6 +1605,25 @@ extern void slurmctld_free_batch_job_launch_msg(batch_job_launch_msg_t * msg)
 	}
 }
 
+/* Free a multiple batch job launch request built by slurmctld, see
+ *	slurmctld_free_batch_job_launch_msg() */
+extern void slurmctld_free_batch_job_launch_multi_msg(
+	batch_job_launch_multi_msg_t *msg)
+{
+	int i;
+
+	if (msg) {
+		for (i = 0; i < msg->launch_cnt; i++) {
+			xfree(msg->node_name[i]);
+			slurmctld_free_batch_job_launch_msg(
+				msg->launch_msg[i]);
+		}
+		xfree(msg->node_name);
+		xfree(msg->launch_msg);
+		xfree(msg);
+	}
+}
+
 /* agent_purge - purge all pending RPC requests */
 void agent_purge(void)
 {
@@ -1518,6 +1660,10 @@ static void _purge_agent_args(agent_arg_t *agent_arg_ptr)
 		if (agent_arg_ptr->msg_type == REQUEST_BATCH_JOB_LAUNCH)
 			slurmctld_free_batch_job_launch_msg(agent_arg_ptr->
 							    msg_args);
+		else if (agent_arg_ptr->msg_type ==
+				REQUEST_BATCH_JOB_LAUNCH_MULTI)
+			slurmctld_free_batch_job_launch_multi_msg(
+					agent_arg_ptr->msg_args);
 		else if (agent_arg_ptr->msg_type ==
 				RESPONSE_RESOURCE_ALLOCATION)
 			slurm_free_resource_allocation_response_msg(
@@ -114,4 +114,8 @@ extern int retry_list_size(void);
  */
 extern void slurmctld_free_batch_job_launch_msg(batch_job_launch_msg_t * msg);
 
+/* Free a multiple batch job launch request built by slurmctld */
+extern void slurmctld_free_batch_job_launch_multi_msg(
+	batch_job_launch_multi_msg_t *msg);
+
 #endif /* !_AGENT_H */
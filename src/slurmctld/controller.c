@@ -63,6 +63,7 @@
 #include "src/common/fd.h"
 #include "src/common/gres.h"
 #include "src/common/hostlist.h"
+#include "src/common/id_cache.h"
 #include "src/common/layouts_mgr.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
@@ -79,6 +80,7 @@
 #include "src/common/slurm_jobacct_gather.h"
 #include "src/common/slurm_jobcomp.h"
 #include "src/common/slurm_mcs.h"
+#include "src/common/slurm_persist_conn.h"
 #include "src/common/slurm_priority.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_interface.h"
@@ -616,6 +618,10 @@ int main(int argc, char *argv[])
 		slurmctld_config.thread_id_sig  = (pthread_t) 0;
 		slurmctld_config.thread_id_rpc  = (pthread_t) 0;
 		slurmctld_config.thread_id_save = (pthread_t) 0;
+		/* Close slurmd connections so they move on to whichever
+		 * controller takes over */
+		slurm_persist_conn_mux_fini();
+		id_cache_fini();
 		bb_g_fini();
 		power_g_fini();
 		slurm_mcs_fini();
@@ -685,6 +691,8 @@ int main(int argc, char *argv[])
 
 	/* Purge our local data structures */
 	job_fini();
+	job_queue_fini();
+	job_dependency_fini();
 	part_fini();	/* part_fini() must precede node_fini() */
 	node_fini();
 	node_features_g_fini();
@@ -675,15 +675,15 @@ extern void pack_all_front_end(char **buffer_ptr, int *buffer_size, uid_t uid,
 extern int dump_all_front_end_state(void)
 {
 #ifdef HAVE_FRONT_END
-	/* Save high-water mark to avoid buffer growth with copies */
-	static int high_buffer_size = (1024 * 1024);
+	/* Start from the largest buffer so far to avoid growth with copies */
+	static buf_pool_t buf_pool = BUF_POOL_INITIALIZER(1024 * 1024);
 	int error_code = 0, i, log_fd;
 	char *old_file, *new_file, *reg_file;
 	front_end_record_t *front_end_ptr;
 	/* Locks: Read config and node */
 	slurmctld_lock_t node_read_lock = { READ_LOCK, NO_LOCK, READ_LOCK,
 					    NO_LOCK, NO_LOCK };
-	Buf buffer = init_buf(high_buffer_size);
+	Buf buffer = pool_init_buf(&buf_pool);
 	DEF_TIMERS;
 
 	START_TIMER;
@@ -718,7 +718,6 @@ extern int dump_all_front_end_state(void)
 	} else {
 		int pos = 0, nwrite = get_buf_offset(buffer), amount, rc;
 		char *data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
 		while (nwrite > 0) {
 			amount = write(log_fd, &data[pos], nwrite);
 			if ((amount < 0) && (errno != EINTR)) {
@@ -752,7 +751,7 @@ extern int dump_all_front_end_state(void)
 	xfree (new_file);
 	unlock_state_files ();
 
-	free_buf (buffer);
+	pool_free_buf(&buf_pool, buffer);
 	END_TIMER2("dump_all_front_end_state");
 	return error_code;
 #else
@@ -655,8 +655,8 @@ static slurmdb_qos_rec_t *_determine_and_validate_qos(
  * RET 0 or error code */
 int dump_all_job_state(void)
 {
-	/* Save high-water mark to avoid buffer growth with copies */
-	static int high_buffer_size = (1024 * 1024);
+	/* Start from the largest buffer so far to avoid growth with copies */
+	static buf_pool_t buf_pool = BUF_POOL_INITIALIZER(1024 * 1024);
 	int error_code = SLURM_SUCCESS, log_fd;
 	char *old_file, *new_file, *reg_file;
 	struct stat stat_buf;
@@ -665,7 +665,7 @@ int dump_all_job_state(void)
 		{ READ_LOCK, READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
-	Buf buffer = init_buf(high_buffer_size);
+	Buf buffer = pool_init_buf(&buf_pool);
 	time_t now = time(NULL);
 	time_t last_state_file_time;
 	DEF_TIMERS;
@@ -749,7 +749,6 @@ int dump_all_job_state(void)
 		fd_set_close_on_exec(log_fd);
 		nwrite = get_buf_offset(buffer);
 		data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
 		while (nwrite > 0) {
 			amount = write(log_fd, &data[pos], nwrite);
 			if ((amount < 0) && (errno != EINTR)) {
@@ -784,7 +783,7 @@ int dump_all_job_state(void)
 	xfree(new_file);
 	unlock_state_files();
 
-	free_buf(buffer);
+	pool_free_buf(&buf_pool, buffer);
 	END_TIMER2("dump_all_job_state");
 	return error_code;
 }
@@ -3846,6 +3845,10 @@ extern struct job_record *job_array_split(struct job_record *job_ptr)
 	job_ptr_pend->job_next = save_job_next;
 	job_ptr_pend->details  = save_details;
 	job_ptr_pend->step_list = save_step_list;
+	job_ptr_pend->step_node_busy = NULL;
+	job_ptr_pend->step_node_use = NULL;
+	job_ptr_pend->step_node_use_cnt = 0;
+	job_ptr_pend->sched_queue_gen = 0;
 	job_ptr_pend->db_index = save_db_index;
 
 	job_ptr_pend->prio_factors = save_prio_factors;
@@ -3970,6 +3973,7 @@ extern struct job_record *job_array_split(struct job_record *job_ptr)
 	details_new->cpu_freq_max = job_details->cpu_freq_max;
 	details_new->cpu_freq_gov = job_details->cpu_freq_gov;
 	details_new->depend_list = depended_list_copy(job_details->depend_list);
+	details_new->depend_wait = (time_t) 0;
 	details_new->dependency = xstrdup(job_details->dependency);
 	details_new->orig_dependency = xstrdup(job_details->orig_dependency);
 	if (job_details->env_cnt) {
@@ -9931,6 +9935,7 @@ static void _reset_step_bitmaps(struct job_record *job_ptr)
 	ListIterator step_iterator;
 	struct step_record *step_ptr;
 
+	step_node_use_reset(job_ptr);
 	step_iterator = list_iterator_create (job_ptr->step_list);
 	while ((step_ptr = (struct step_record *) list_next (step_iterator))) {
 		if (step_ptr->state < JOB_RUNNING)
@@ -12167,6 +12172,7 @@ fini:
 
 	FREE_NULL_LIST(gres_list);
 	FREE_NULL_LIST(license_list);
+	job_ptr->limit_gen = 0;	/* Retest accounting policy limits */
 	if (update_accounting) {
 		info("updating accounting");
 		/* Update job record in accounting to reflect changes */
@@ -13527,6 +13533,7 @@ extern void job_completion_logger(struct job_record *job_ptr, bool requeue)
 	}
 
 	_job_array_comp(job_ptr, true);
+	notify_job_dependency(job_ptr);
 
 	if (!IS_JOB_RESIZING(job_ptr) &&
 	    ((job_ptr->array_task_id == NO_VAL) ||
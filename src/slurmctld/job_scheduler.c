@@ -57,6 +57,7 @@
 #include "src/common/assoc_mgr.h"
 #include "src/common/env.h"
 #include "src/common/gres.h"
+#include "src/common/id_cache.h"
 #include "src/common/layouts_mgr.h"
 #include "src/common/list.h"
 #include "src/common/macros.h"
@@ -98,6 +99,55 @@
 #define BUILD_TIMEOUT 2000000	/* Max build_job_queue() run time in usec */
 #define MAX_FAILED_RESV 10
 #define MAX_RETRIES 10
+#define DEPEND_HASH_SIZE 10007	/* Buckets in depend_hash, a prime */
+#define DEPEND_RECHECK_TIME 300	/* Retest waiting dependencies after secs */
+#define BATCH_LAUNCH_JOBS 128	/* Default jobs per batch launch RPC */
+
+/*
+ * Persistent job queue: one record per pending job/partition pair, kept in
+ * sort_job_queue2() order across calls to build_job_queue(). Records are
+ * found by job ID and validated on each pass, so purged jobs need no hook.
+ * Only records which are new or whose sort key changed get sorted, then
+ * they are merged into the records which are already in order.
+ */
+typedef struct sched_queue_rec {
+	job_queue_rec_t rec;	/* must be first, see sort_job_queue2() */
+	uint32_t gen;		/* job's sched_queue_gen when queued */
+	uint32_t part_cnt;	/* size of job's part_ptr_list when queued */
+	void *qos_ptr;		/* job's QOS when last sorted */
+	uint32_t resv_id;	/* job's reservation when last sorted */
+	uint32_t tier;		/* partition priority_tier when last sorted */
+} sched_queue_rec_t;
+
+/*
+ * Reverse dependency edges: the jobs waiting upon a given job ID (a job ID or
+ * array_job_id as found in depend_spec). A job's details->depend_wait is set
+ * when test_job_dependency() finds all of its dependencies still pending and
+ * the job is then added here for each of them, so later tests return at once.
+ * notify_job_dependency() consumes the record of a job which starts or ends
+ * and clears depend_wait in each of its dependents. dep_job_id is kept sorted
+ * without duplicates, so retesting a dependent does not grow it. Stale job
+ * IDs are harmless, at worst causing one extra test of a dependent.
+ */
+typedef struct depend_edge {
+	uint32_t job_id;		/* job ID depended upon */
+	uint32_t *dep_job_id;		/* IDs of jobs waiting upon job_id,
+					 * sorted */
+	int dep_job_cnt;		/* entries used in dep_job_id */
+	int dep_job_size;		/* entries allocated in dep_job_id */
+	struct depend_edge *next;	/* next record in hash bucket */
+} depend_edge_t;
+
+/*
+ * Batch job launch held back by launch_job() during a scheduling pass. At the
+ * end of the pass _launch_hold_flush() sorts them by node and sends up to
+ * batch_launch_jobs launches for a node in one RPC.
+ */
+typedef struct launch_hold {
+	char *batch_host;
+	batch_job_launch_msg_t *launch_msg_ptr;
+	uint16_t protocol_version;
+} launch_hold_t;
 
 typedef struct epilog_arg {
 	char *epilog_slurmctld;
@@ -106,11 +156,22 @@ typedef struct epilog_arg {
 } epilog_arg_t;
 
 static char **	_build_env(struct job_record *job_ptr, bool is_epilog);
+static void	_depend_edge_add(uint32_t job_id, uint32_t dep_job_id);
+static void	_depend_edge_wake(uint32_t job_id);
 static void	_depend_list_del(void *dep_ptr);
 static void	_feature_list_delete(void *x);
 static void	_job_queue_append(List job_queue, struct job_record *job_ptr,
 				  struct part_record *part_ptr, uint32_t priority);
 static void	_job_queue_rec_del(void *x);
+static void	_launch_hold_begin(void);
+static void	_launch_hold_flush(void);
+static void	_sched_queue_job_add(struct job_record *job_ptr,
+				     sched_queue_rec_t ***add, int *add_cnt,
+				     int *add_size);
+static void	_sched_queue_merge(sched_queue_rec_t **add, int add_cnt);
+static void	_sched_queue_refresh(sched_queue_rec_t ***add, int *add_cnt,
+				     int *add_size);
+static void	_sched_queue_reset(void);
 static bool	_job_runnable_test1(struct job_record *job_ptr,
 				    bool clear_start);
 static bool	_job_runnable_test2(struct job_record *job_ptr,
@@ -127,7 +188,19 @@ static int	_valid_node_feature(char *feature, bool can_reboot);
 static void *	_wait_boot(void *arg);
 #endif
 static int	build_queue_timeout = BUILD_TIMEOUT;
+static pthread_mutex_t sched_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static sched_queue_rec_t **sched_queue = NULL;
+static int	sched_queue_cnt = 0, sched_queue_size = 0;
+static uint32_t	sched_queue_gen = 0;	 /* last generation assigned */
+static uint32_t	sched_queue_gen_min = 1; /* older generations are void */
+static uint32_t	sched_queue_pass = 0;
+static time_t	sched_queue_conf_update = 0;
+static time_t	sched_queue_part_update = 0;
 static int	save_last_part_update = 0;
+static depend_edge_t **depend_hash = NULL;
+static int	batch_launch_jobs = BATCH_LAUNCH_JOBS;
+static bool	launch_hold = false;	/* Protected by job write lock */
+static List	launch_hold_list = NULL;
 
 static pthread_mutex_t sched_mutex = PTHREAD_MUTEX_INITIALIZER;
 static int sched_pend_thread = 0;
@@ -243,6 +316,249 @@ static void _job_queue_rec_del(void *x)
 	xfree(x);
 }
 
+/* Add a record to an array of queue records, growing it as needed */
+static void _sched_queue_push(sched_queue_rec_t ***array, int *cnt,
+			      int *size, sched_queue_rec_t *q_ptr)
+{
+	if (*cnt >= *size) {
+		*size = MAX(*size * 2, 64);
+		xrealloc(*array, sizeof(sched_queue_rec_t *) * (*size));
+	}
+	(*array)[(*cnt)++] = q_ptr;
+}
+
+/* Discard every record in the persistent job queue */
+static void _sched_queue_reset(void)
+{
+	int i;
+
+	for (i = 0; i < sched_queue_cnt; i++)
+		xfree(sched_queue[i]);
+	sched_queue_cnt = 0;
+	sched_queue_gen_min = sched_queue_gen + 1;
+}
+
+/*
+ * job_queue_fini - Free the persistent job queue used by build_job_queue()
+ */
+extern void job_queue_fini(void)
+{
+	slurm_mutex_lock(&sched_queue_mutex);
+	_sched_queue_reset();
+	xfree(sched_queue);
+	sched_queue_size = 0;
+	slurm_mutex_unlock(&sched_queue_mutex);
+}
+
+/* Return the priority used to order a job in the given partition, where
+ * part_inx is the partition's position in the job's part_ptr_list */
+static uint32_t _sched_queue_prio(struct job_record *job_ptr, int part_inx)
+{
+	if (job_ptr->part_ptr_list && job_ptr->priority_array &&
+	    (part_inx >= 0))
+		return job_ptr->priority_array[part_inx];
+	return job_ptr->priority;
+}
+
+/* Update a queue record's copy of its sort key
+ * RET true if the key changed, so the record must be placed again */
+static bool _sched_queue_key(sched_queue_rec_t *q_ptr, uint32_t prio)
+{
+	struct job_record *job_ptr = q_ptr->rec.job_ptr;
+	uint32_t tier = 0;
+	bool changed;
+
+	if (q_ptr->rec.part_ptr)
+		tier = q_ptr->rec.part_ptr->priority_tier;
+	changed = (q_ptr->rec.priority != prio) ||
+		  (q_ptr->resv_id != job_ptr->resv_id) ||
+		  (q_ptr->tier != tier) ||
+		  (q_ptr->qos_ptr != job_ptr->qos_ptr);
+	q_ptr->rec.priority = prio;
+	q_ptr->resv_id = job_ptr->resv_id;
+	q_ptr->tier = tier;
+	q_ptr->qos_ptr = job_ptr->qos_ptr;
+
+	return changed;
+}
+
+/* Create the queue record for one job/partition pair */
+static void _sched_queue_rec_add(struct job_record *job_ptr,
+				 struct part_record *part_ptr, int part_inx,
+				 uint32_t part_cnt, sched_queue_rec_t ***add,
+				 int *add_cnt, int *add_size)
+{
+	sched_queue_rec_t *q_ptr;
+
+	q_ptr = xmalloc(sizeof(sched_queue_rec_t));
+	q_ptr->rec.array_task_id = job_ptr->array_task_id;
+	q_ptr->rec.job_id   = job_ptr->job_id;
+	q_ptr->rec.job_ptr  = job_ptr;
+	q_ptr->rec.part_ptr = part_ptr;
+	q_ptr->gen          = job_ptr->sched_queue_gen;
+	q_ptr->part_cnt     = part_cnt;
+	(void) _sched_queue_key(q_ptr, _sched_queue_prio(job_ptr, part_inx));
+	_sched_queue_push(add, add_cnt, add_size, q_ptr);
+}
+
+/* Create records for each partition of a pending job not yet queued */
+static void _sched_queue_job_add(struct job_record *job_ptr,
+				 sched_queue_rec_t ***add, int *add_cnt,
+				 int *add_size)
+{
+	ListIterator part_iterator;
+	struct part_record *part_ptr;
+	uint32_t part_cnt;
+	int inx = -1;
+
+	if (!job_ptr->part_ptr_list && !job_ptr->part_ptr) {
+		part_ptr = find_part_record(job_ptr->partition);
+		if (part_ptr == NULL) {
+			error("Could not find partition %s for job %u",
+			      job_ptr->partition, job_ptr->job_id);
+			return;
+		}
+		job_ptr->part_ptr = part_ptr;
+		error("partition pointer reset for job %u, part %s",
+		      job_ptr->job_id, job_ptr->partition);
+	}
+
+	if (++sched_queue_gen == 0) {
+		/* Generation wrapped, void every job's queue records */
+		ListIterator job_iterator = list_iterator_create(job_list);
+		struct job_record *tmp_job_ptr;
+		while ((tmp_job_ptr = list_next(job_iterator)))
+			tmp_job_ptr->sched_queue_gen = 0;
+		list_iterator_destroy(job_iterator);
+		sched_queue_gen = 1;
+		_sched_queue_reset();
+	}
+	job_ptr->sched_queue_gen = sched_queue_gen;
+
+	if (!job_ptr->part_ptr_list) {
+		_sched_queue_rec_add(job_ptr, job_ptr->part_ptr, -1, 0,
+				     add, add_cnt, add_size);
+		return;
+	}
+	part_cnt = list_count(job_ptr->part_ptr_list);
+	part_iterator = list_iterator_create(job_ptr->part_ptr_list);
+	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
+		_sched_queue_rec_add(job_ptr, part_ptr, ++inx, part_cnt,
+				     add, add_cnt, add_size);
+	}
+	list_iterator_destroy(part_iterator);
+}
+
+/* Validate a queue record against its job's current state and refresh its
+ * job pointer.
+ * OUT part_inx - partition's position in the job's part_ptr_list
+ * RET false if the record must be discarded */
+static bool _sched_queue_rec_valid(sched_queue_rec_t *q_ptr, int *part_inx)
+{
+	struct job_record *job_ptr;
+	struct part_record *part_ptr;
+	ListIterator part_iterator;
+	int inx = -1;
+
+	*part_inx = -1;
+	job_ptr = find_job_record(q_ptr->rec.job_id);
+	if (!job_ptr || (job_ptr->sched_queue_gen != q_ptr->gen))
+		return false;
+	q_ptr->rec.job_ptr = job_ptr;
+	if (!IS_JOB_PENDING(job_ptr) ||
+	    (job_ptr->array_task_id != q_ptr->rec.array_task_id))
+		goto invalid;
+
+	if (job_ptr->part_ptr_list) {
+		if (list_count(job_ptr->part_ptr_list) != q_ptr->part_cnt)
+			goto invalid;
+		part_iterator = list_iterator_create(job_ptr->part_ptr_list);
+		while ((part_ptr = (struct part_record *)
+				   list_next(part_iterator))) {
+			inx++;
+			if (part_ptr == q_ptr->rec.part_ptr) {
+				*part_inx = inx;
+				break;
+			}
+		}
+		list_iterator_destroy(part_iterator);
+		if (*part_inx < 0)
+			goto invalid;
+	} else if (q_ptr->part_cnt ||
+		   (job_ptr->part_ptr != q_ptr->rec.part_ptr)) {
+		goto invalid;
+	}
+	return true;
+
+invalid:
+	/* Void the job's other records, it gets queued again if pending */
+	job_ptr->sched_queue_gen = 0;
+	return false;
+}
+
+/* Drop stale records from the persistent job queue and move those whose
+ * sort key changed to the "add" array */
+static void _sched_queue_refresh(sched_queue_rec_t ***add, int *add_cnt,
+				 int *add_size)
+{
+	sched_queue_rec_t *q_ptr;
+	int i, j = 0, part_inx;
+
+	if ((sched_queue_part_update != last_part_update) ||
+	    (sched_queue_conf_update != slurmctld_conf.last_update)) {
+		/* Partition records may have been freed or the preemption
+		 * configuration, which affects the order, changed */
+		_sched_queue_reset();
+		sched_queue_part_update = last_part_update;
+		sched_queue_conf_update = slurmctld_conf.last_update;
+		return;
+	}
+
+	for (i = 0; i < sched_queue_cnt; i++) {
+		q_ptr = sched_queue[i];
+		if (!_sched_queue_rec_valid(q_ptr, &part_inx)) {
+			xfree(q_ptr);
+			continue;
+		}
+		if (_sched_queue_key(q_ptr,
+				     _sched_queue_prio(q_ptr->rec.job_ptr,
+						       part_inx)))
+			_sched_queue_push(add, add_cnt, add_size, q_ptr);
+		else
+			sched_queue[j++] = q_ptr;
+	}
+	sched_queue_cnt = j;
+}
+
+/* Sort new and changed records, then merge them into the persistent job
+ * queue, which is already in order */
+static void _sched_queue_merge(sched_queue_rec_t **add, int add_cnt)
+{
+	sched_queue_rec_t **merged;
+	int i = 0, j = 0, k = 0;
+
+	if (add_cnt == 0)
+		return;
+	qsort(add, add_cnt, sizeof(sched_queue_rec_t *),
+	      (__compar_fn_t) sort_job_queue2);
+
+	sched_queue_size = MAX(sched_queue_size, sched_queue_cnt + add_cnt);
+	merged = xmalloc(sizeof(sched_queue_rec_t *) * sched_queue_size);
+	while ((i < sched_queue_cnt) && (j < add_cnt)) {
+		if (sort_job_queue2(&sched_queue[i], &add[j]) <= 0)
+			merged[k++] = sched_queue[i++];
+		else
+			merged[k++] = add[j++];
+	}
+	while (i < sched_queue_cnt)
+		merged[k++] = sched_queue[i++];
+	while (j < add_cnt)
+		merged[k++] = add[j++];
+	xfree(sched_queue);
+	sched_queue = merged;
+	sched_queue_cnt = k;
+}
+
 /* Return true if the job has some step still in a cleaning state, which
  * can happen on a Cray if a job is requeued and the step NHC is still running
  * after the requeued job is eligible to run again */
@@ -387,7 +703,59 @@ static int _delta_tv(struct timeval *tv)
 	return delta_t;
 }
 /*
- * build_job_queue - build (non-priority ordered) list of pending jobs
+ * _split_array_task - create an individual job record for the next task of
+ *	a pending job array meta record, unless max_pend tasks already have
+ *	their own pending records
+ * IN job_ptr - pending job array meta record
+ * IN max_pend - maximum count of split out pending tasks
+ * IN bb - true if splitting for burst buffer staging
+ * RET true if job_ptr now describes an individual task
+ */
+static bool _split_array_task(struct job_record *job_ptr, int max_pend,
+			      bool bb)
+{
+	struct job_record *new_job_ptr;
+	char jobid_buf[32];
+	int i;
+
+	if ((i = bit_ffs(job_ptr->array_recs->task_id_bitmap)) < 0)
+		return false;
+	if (num_pending_job_array_tasks(job_ptr->array_job_id) >= max_pend)
+		return false;
+	if (job_ptr->array_recs->task_cnt < 1)
+		return false;
+	if (job_ptr->array_recs->task_cnt == 1) {
+		job_ptr->array_task_id = i;
+		job_array_post_sched(job_ptr);
+		return true;
+	}
+	job_ptr->array_task_id = i;
+	new_job_ptr = job_array_split(job_ptr);
+	if (!new_job_ptr) {
+		error("%s: Unable to copy record for %s", __func__,
+		      jobid2fmt(job_ptr, jobid_buf, sizeof(jobid_buf)));
+		return true;
+	}
+	if (bb) {
+		debug("%s: Split out %s for burst buffer use", __func__,
+		      jobid2fmt(job_ptr, jobid_buf, sizeof(jobid_buf)));
+	} else {
+		info("%s: Split out %s for SLURM_DEPEND_AFTER_CORRESPOND use",
+		     __func__, jobid2fmt(job_ptr, jobid_buf, sizeof(jobid_buf)));
+	}
+	new_job_ptr->job_state = JOB_PENDING;
+	new_job_ptr->start_time = (time_t) 0;
+	/* Do NOT clear db_index here, it is handled when
+	 * task_id_str is created elsewhere */
+	if (bb)
+		(void) bb_g_job_validate2(job_ptr, NULL);
+
+	return true;
+}
+
+/*
+ * build_job_queue - build list of pending jobs in priority order, as
+ *	sort_job_queue() would leave it
  * IN clear_start - if set then clear the start_time for pending jobs,
  *		    true when called from sched/backfill or sched/builtin
  * IN backfill - true if running backfill scheduler, enforce min time limit
@@ -398,60 +766,24 @@ extern List build_job_queue(bool clear_start, bool backfill)
 {
 	static time_t last_log_time = 0;
 	List job_queue;
-	ListIterator depend_iter, job_iterator, part_iterator;
-	struct job_record *job_ptr = NULL, *new_job_ptr;
+	ListIterator depend_iter, job_iterator;
+	struct job_record *job_ptr = NULL;
 	struct part_record *part_ptr;
 	struct depend_spec *dep_ptr;
-	int i, pend_cnt, reason, dep_corr;
+	sched_queue_rec_t **add = NULL, *q_ptr;
+	int add_cnt = 0, add_size = 0;
+	int i, reason, dep_corr;
 	struct timeval start_tv = {0, 0};
 	int tested_jobs = 0;
-	char jobid_buf[32];
-	int job_part_pairs = 0;
 	time_t now = time(NULL);
 
 	(void) _delta_tv(&start_tv);
 	job_queue = list_create(_job_queue_rec_del);
 
 	/* Create individual job records for job arrays that need burst buffer
-	 * staging */
-	job_iterator = list_iterator_create(job_list);
-	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
-		if (!IS_JOB_PENDING(job_ptr) ||
-		    !job_ptr->burst_buffer || !job_ptr->array_recs ||
-		    !job_ptr->array_recs->task_id_bitmap ||
-		    (job_ptr->array_task_id != NO_VAL))
-			continue;
-		if ((i = bit_ffs(job_ptr->array_recs->task_id_bitmap)) < 0)
-			continue;
-		pend_cnt = num_pending_job_array_tasks(job_ptr->array_job_id);
-		if (pend_cnt >= bb_array_stage_cnt)
-			continue;
-		if (job_ptr->array_recs->task_cnt < 1)
-			continue;
-		if (job_ptr->array_recs->task_cnt == 1) {
-			job_ptr->array_task_id = i;
-			job_array_post_sched(job_ptr);
-			continue;
-		}
-		job_ptr->array_task_id = i;
-		new_job_ptr = job_array_split(job_ptr);
-		if (new_job_ptr) {
-			debug("%s: Split out %s for burst buffer use", __func__,
-			      jobid2fmt(job_ptr, jobid_buf, sizeof(jobid_buf)));
-			new_job_ptr->job_state = JOB_PENDING;
-			new_job_ptr->start_time = (time_t) 0;
-			/* Do NOT clear db_index here, it is handled when
-			 * task_id_str is created elsewhere */
-			(void) bb_g_job_validate2(job_ptr, NULL);
-		} else {
-			error("%s: Unable to copy record for %s", __func__,
-			      jobid2fmt(job_ptr, jobid_buf, sizeof(jobid_buf)));
-		}
-	}
-	list_iterator_destroy(job_iterator);
-
-	/* Create individual job records for job arrays with
-	 * depend_type == SLURM_DEPEND_AFTER_CORRESPOND */
+	 * staging or have depend_type == SLURM_DEPEND_AFTER_CORRESPOND. Only
+	 * pending job array meta records qualify, so test both in one pass
+	 * over the job list. */
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		if (!IS_JOB_PENDING(job_ptr) ||
@@ -459,7 +791,8 @@ extern List build_job_queue(bool clear_start, bool backfill)
 		    !job_ptr->array_recs->task_id_bitmap ||
 		    (job_ptr->array_task_id != NO_VAL))
 			continue;
-		if ((i = bit_ffs(job_ptr->array_recs->task_id_bitmap)) < 0)
+		if (job_ptr->burst_buffer &&
+		    _split_array_task(job_ptr, bb_array_stage_cnt, true))
 			continue;
 		if ((job_ptr->details == NULL) ||
 		    (job_ptr->details->depend_list == NULL) ||
@@ -473,35 +806,19 @@ extern List build_job_queue(bool clear_start, bool backfill)
 				break;
 			}
 	        }
-		if (!dep_corr)
-			continue;
-		pend_cnt = num_pending_job_array_tasks(job_ptr->array_job_id);
-		if (pend_cnt >= CORRESPOND_ARRAY_TASK_CNT)
-			continue;
-		if (job_ptr->array_recs->task_cnt < 1)
-			continue;
-		if (job_ptr->array_recs->task_cnt == 1) {
-			job_ptr->array_task_id = i;
-			job_array_post_sched(job_ptr);
-			continue;
-		}
-		job_ptr->array_task_id = i;
-		new_job_ptr = job_array_split(job_ptr);
-		if (new_job_ptr) {
-			info("%s: Split out %s for SLURM_DEPEND_AFTER_CORRESPOND use",
-			      __func__,
-			      jobid2fmt(job_ptr, jobid_buf, sizeof(jobid_buf)));
-			new_job_ptr->job_state = JOB_PENDING;
-			new_job_ptr->start_time = (time_t) 0;
-			/* Do NOT clear db_index here, it is handled when
-			 * task_id_str is created elsewhere */
-		} else {
-			error("%s: Unable to copy record for %s", __func__,
-			      jobid2fmt(job_ptr, jobid_buf, sizeof(jobid_buf)));
-		}
+		list_iterator_destroy(depend_iter);
+		if (dep_corr)
+			(void) _split_array_task(job_ptr,
+						 CORRESPOND_ARRAY_TASK_CNT,
+						 false);
 	}
 	list_iterator_destroy(job_iterator);
 
+	slurm_mutex_lock(&sched_queue_mutex);
+	_sched_queue_refresh(&add, &add_cnt, &add_size);
+	if (++sched_queue_pass == 0)
+		sched_queue_pass = 1;
+
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		if (((tested_jobs % 100) == 0) &&
@@ -509,10 +826,9 @@ extern List build_job_queue(bool clear_start, bool backfill)
 			if (difftime(now, last_log_time) > 600) {
 				/* Log at most once every 10 minutes */
 				info("%s has run for %d usec, exiting with %d "
-				     "of %d jobs tested, %d job-partition "
-				     "pairs added",
+				     "of %d jobs tested",
 				     __func__, build_queue_timeout, tested_jobs,
-				     list_count(job_list), job_part_pairs);
+				     list_count(job_list));
 				last_log_time = now;
 			}
 			break;
@@ -521,63 +837,44 @@ extern List build_job_queue(bool clear_start, bool backfill)
 		job_ptr->preempt_in_progress = false;	/* initialize */
 		if (job_ptr->state_reason != WAIT_NO_REASON)
 			job_ptr->state_reason_prev = job_ptr->state_reason;
+		if (IS_JOB_PENDING(job_ptr) &&
+		    (job_ptr->sched_queue_gen < sched_queue_gen_min))
+			_sched_queue_job_add(job_ptr, &add, &add_cnt,
+					     &add_size);
 		if (!_job_runnable_test1(job_ptr, clear_start))
 			continue;
+		job_ptr->sched_queue_pass = sched_queue_pass;
+	}
+	list_iterator_destroy(job_iterator);
+
+	_sched_queue_merge(add, add_cnt);
+	xfree(add);
 
+	/* Partition specific tests, in priority order */
+	for (i = 0; i < sched_queue_cnt; i++) {
+		q_ptr = sched_queue[i];
+		job_ptr = q_ptr->rec.job_ptr;
+		if ((job_ptr->sched_queue_pass != sched_queue_pass) ||
+		    (job_ptr->sched_queue_gen != q_ptr->gen))
+			continue;
+		part_ptr = q_ptr->rec.part_ptr;
 		if (job_ptr->part_ptr_list) {
-			int inx = -1;
-			part_iterator = list_iterator_create(
-				job_ptr->part_ptr_list);
-			while ((part_ptr = (struct part_record *)
-				list_next(part_iterator))) {
-				job_ptr->part_ptr = part_ptr;
-				reason = job_limits_check(&job_ptr, backfill);
-				if ((reason != WAIT_NO_REASON) &&
-				    (reason != job_ptr->state_reason)) {
-					job_ptr->state_reason = reason;
-					xfree(job_ptr->state_desc);
-					last_job_update = now;
-				}
-				/* priority_array index matches part_ptr_list
-				 * position: increment inx */
-				inx++;
-				if (reason != WAIT_NO_REASON)
-					continue;
-				job_part_pairs++;
-				if (job_ptr->priority_array) {
-					_job_queue_append(job_queue, job_ptr,
-							  part_ptr,
-							  job_ptr->
-							  priority_array[inx]);
-				} else {
-					_job_queue_append(job_queue, job_ptr,
-							  part_ptr,
-							  job_ptr->priority);
-				}
-			}
-			list_iterator_destroy(part_iterator);
-		} else {
-			if (job_ptr->part_ptr == NULL) {
-				part_ptr = find_part_record(job_ptr->partition);
-				if (part_ptr == NULL) {
-					error("Could not find partition %s "
-					      "for job %u", job_ptr->partition,
-					      job_ptr->job_id);
-					continue;
-				}
-				job_ptr->part_ptr = part_ptr;
-				error("partition pointer reset for job %u, "
-				      "part %s", job_ptr->job_id,
-				      job_ptr->partition);
+			job_ptr->part_ptr = part_ptr;
+			reason = job_limits_check(&job_ptr, backfill);
+			if ((reason != WAIT_NO_REASON) &&
+			    (reason != job_ptr->state_reason)) {
+				job_ptr->state_reason = reason;
+				xfree(job_ptr->state_desc);
+				last_job_update = now;
 			}
-			if (!_job_runnable_test2(job_ptr, backfill))
+			if (reason != WAIT_NO_REASON)
 				continue;
-			job_part_pairs++;
-			_job_queue_append(job_queue, job_ptr,
-					  job_ptr->part_ptr, job_ptr->priority);
-		}
+		} else if (!_job_runnable_test2(job_ptr, backfill))
+			continue;
+		_job_queue_append(job_queue, job_ptr, part_ptr,
+				  q_ptr->rec.priority);
 	}
-	list_iterator_destroy(job_iterator);
+	slurm_mutex_unlock(&sched_queue_mutex);
 
 	return job_queue;
 }
@@ -1399,14 +1696,27 @@ static int _schedule(uint32_t job_limit)
 			sched_max_job_start = 0;
 		}
 
+		if (sched_params &&
+		    (tmp_ptr = strstr(sched_params, "batch_launch_jobs="))) {
+			batch_launch_jobs = atoi(tmp_ptr + 18);
+			if (batch_launch_jobs < 0) {
+				error("Invalid batch_launch_jobs: %d",
+				      batch_launch_jobs);
+				batch_launch_jobs = BATCH_LAUNCH_JOBS;
+			}
+		} else {
+			batch_launch_jobs = BATCH_LAUNCH_JOBS;
+		}
+
 		xfree(sched_params);
 		sched_update = slurmctld_conf.last_update;
 		info("SchedulerParameters=default_queue_depth=%d,"
 		     "max_rpc_cnt=%d,max_sched_time=%d,partition_job_depth=%d,"
-		     "sched_max_job_start=%d,sched_min_interval=%d",
+		     "sched_max_job_start=%d,sched_min_interval=%d,"
+		     "batch_launch_jobs=%d",
 		     def_job_limit, defer_rpc_cnt, sched_timeout,
 		     max_jobs_per_part, sched_max_job_start,
-		     sched_min_interval);
+		     sched_min_interval, batch_launch_jobs);
 	}
 
 	if ((defer_rpc_cnt > 0) &&
@@ -1466,6 +1776,7 @@ static int _schedule(uint32_t job_limit)
 	}
 #endif
 
+	_launch_hold_begin();
 	part_cnt = list_count(part_list);
 	failed_parts = xmalloc(sizeof(struct part_record *) * part_cnt);
 	failed_resv = xmalloc(sizeof(struct slurmctld_resv*) * MAX_FAILED_RESV);
@@ -1507,7 +1818,6 @@ static int _schedule(uint32_t job_limit)
 	} else {
 		job_queue = build_job_queue(false, false);
 		slurmctld_diag_stats.schedule_queue_len = list_count(job_queue);
-		sort_job_queue(job_queue);
 	}
 	while (1) {
 		if (fifo_sched) {
@@ -2033,6 +2343,7 @@ next_task:
 		     "configuring max_rpc_cnt",
 		     slurmctld_config.server_thread_count);
 	}
+	_launch_hold_flush();
 	unlock_slurmctld(job_write_lock);
 	END_TIMER2("schedule");
 
@@ -2143,8 +2454,6 @@ extern batch_job_launch_msg_t *build_launch_job_msg(struct job_record *job_ptr,
 						    uint16_t protocol_version)
 {
 	batch_job_launch_msg_t *launch_msg_ptr;
-	struct passwd pwd, *result;
-	char buffer[PW_BUF_SIZE];
 
 	/* Initialization of data structures */
 	launch_msg_ptr = (batch_job_launch_msg_t *)
@@ -2166,12 +2475,8 @@ extern batch_job_launch_msg_t *build_launch_job_msg(struct job_record *job_ptr,
 		return NULL;
 	}
 
-	if (slurm_getpwuid_r(launch_msg_ptr->uid,
-			     &pwd,
-			     buffer,
-			     PW_BUF_SIZE,
-			     &result)
-	    || !result) {
+	if (!(launch_msg_ptr->user_name =
+	      id_cache_uid_to_name(launch_msg_ptr->uid))) {
 #ifdef HAVE_NATIVE_CRAY
 		/* On a Cray this needs to happen before the launch of
 		 * the tasks.  So fail if it doesn't work.  On a
@@ -2183,8 +2488,7 @@ extern batch_job_launch_msg_t *build_launch_job_msg(struct job_record *job_ptr,
 		(void) job_complete(job_ptr->job_id, getuid(), false, true, 0);
 		return NULL;
 #endif
-	} else
-		launch_msg_ptr->user_name = xstrdup(result->pw_name);
+	}
 
 	launch_msg_ptr->gid = job_ptr->group_id;
 	launch_msg_ptr->ntasks = job_ptr->details->num_tasks;
@@ -2272,6 +2576,158 @@ extern batch_job_launch_msg_t *build_launch_job_msg(struct job_record *job_ptr,
 	return launch_msg_ptr;
 }
 
+/* Queue an agent request to launch one batch job */
+static void _launch_queue(char *batch_host,
+			  batch_job_launch_msg_t *launch_msg_ptr,
+			  uint16_t protocol_version)
+{
+	agent_arg_t *agent_arg_ptr;
+
+	agent_arg_ptr = (agent_arg_t *) xmalloc(sizeof(agent_arg_t));
+	agent_arg_ptr->protocol_version = protocol_version;
+	agent_arg_ptr->node_count = 1;
+	agent_arg_ptr->retry = 0;
+	agent_arg_ptr->hostlist = hostlist_create(batch_host);
+	agent_arg_ptr->msg_type = REQUEST_BATCH_JOB_LAUNCH;
+	agent_arg_ptr->msg_args = (void *) launch_msg_ptr;
+
+	/* Launch the RPC via agent */
+	agent_queue_request(agent_arg_ptr);
+}
+
+/* Test if a batch job launch can be held for _launch_hold_flush(). Only
+ * launches the agent would send at once are held, those it may defer until
+ * nodes boot or respond are queued alone. */
+static bool _launch_hold_test(struct job_record *job_ptr,
+			      uint16_t protocol_version)
+{
+#ifndef HAVE_FRONT_END
+	struct node_record *node_ptr;
+#endif
+
+	if ((protocol_version == (uint16_t) NO_VAL) ||
+	    (protocol_version < SLURM_17_02_PROTOCOL_VERSION))
+		return false;
+	if (job_ptr->wait_all_nodes)
+		return false;
+#ifndef HAVE_FRONT_END
+	node_ptr = find_node_record(job_ptr->batch_host);
+	if (!node_ptr || IS_NODE_POWER_SAVE(node_ptr) ||
+	    IS_NODE_NO_RESPOND(node_ptr))
+		return false;
+#endif
+	return true;
+}
+
+static void _launch_hold_del(void *x)
+{
+	launch_hold_t *hold_ptr = (launch_hold_t *) x;
+
+	if (hold_ptr) {
+		xfree(hold_ptr->batch_host);
+		if (hold_ptr->launch_msg_ptr) {
+			slurmctld_free_batch_job_launch_msg(
+				hold_ptr->launch_msg_ptr);
+		}
+		xfree(hold_ptr);
+	}
+}
+
+static int _launch_hold_sort(void *x, void *y)
+{
+	launch_hold_t *hold1 = *(launch_hold_t **) x;
+	launch_hold_t *hold2 = *(launch_hold_t **) y;
+
+	return xstrcmp(hold1->batch_host, hold2->batch_host);
+}
+
+/* Start holding batch job launches made by launch_job().
+ * Call with the job write lock held until _launch_hold_flush(). */
+static void _launch_hold_begin(void)
+{
+	if (batch_launch_jobs <= 1)
+		return;
+	if (!launch_hold_list)
+		launch_hold_list = list_create(_launch_hold_del);
+	launch_hold = true;
+}
+
+/* Queue one agent request for the held launches of one node.
+ * A group with a single launch is sent as a plain batch job launch. */
+static void _launch_group_queue(List group)
+{
+	batch_job_launch_multi_msg_t *multi_msg_ptr;
+	agent_arg_t *agent_arg_ptr;
+	launch_hold_t *hold_ptr;
+	int i = 0;
+
+	if (list_count(group) == 1) {
+		hold_ptr = list_peek(group);
+		_launch_queue(hold_ptr->batch_host, hold_ptr->launch_msg_ptr,
+			      hold_ptr->protocol_version);
+		hold_ptr->launch_msg_ptr = NULL;
+		list_flush(group);
+		return;
+	}
+
+	multi_msg_ptr = xmalloc(sizeof(batch_job_launch_multi_msg_t));
+	multi_msg_ptr->launch_cnt = list_count(group);
+	multi_msg_ptr->node_name = xmalloc(sizeof(char *) *
+					   multi_msg_ptr->launch_cnt);
+	multi_msg_ptr->launch_msg = xmalloc(sizeof(batch_job_launch_msg_t *) *
+					    multi_msg_ptr->launch_cnt);
+
+	hold_ptr = list_peek(group);
+	agent_arg_ptr = (agent_arg_t *) xmalloc(sizeof(agent_arg_t));
+	agent_arg_ptr->protocol_version = hold_ptr->protocol_version;
+	agent_arg_ptr->node_count = 1;
+	agent_arg_ptr->retry = 0;
+	agent_arg_ptr->hostlist = hostlist_create(hold_ptr->batch_host);
+	agent_arg_ptr->msg_type = REQUEST_BATCH_JOB_LAUNCH_MULTI;
+	agent_arg_ptr->msg_args = (void *) multi_msg_ptr;
+
+	while ((hold_ptr = list_pop(group))) {
+		multi_msg_ptr->node_name[i] = hold_ptr->batch_host;
+		multi_msg_ptr->launch_msg[i++] = hold_ptr->launch_msg_ptr;
+		xfree(hold_ptr);
+	}
+
+	debug2("%s: %u batch job launches to %s", __func__,
+	       multi_msg_ptr->launch_cnt, multi_msg_ptr->node_name[0]);
+	agent_queue_request(agent_arg_ptr);
+}
+
+/* Send the batch job launches held since _launch_hold_begin(), up to
+ * batch_launch_jobs launches for one node in each RPC. Each RPC carries
+ * only the launches of the node it is sent to, so no node is sent the
+ * scripts and environments of jobs it won't run. */
+static void _launch_hold_flush(void)
+{
+	launch_hold_t *hold_ptr;
+	List group;
+	char *last_host = NULL;
+
+	if (!launch_hold)
+		return;
+	launch_hold = false;
+	if (list_count(launch_hold_list) == 0)
+		return;
+
+	list_sort(launch_hold_list, _launch_hold_sort);
+	group = list_create(_launch_hold_del);
+	while ((hold_ptr = list_pop(launch_hold_list))) {
+		if (list_count(group) &&
+		    ((list_count(group) >= batch_launch_jobs) ||
+		     xstrcmp(hold_ptr->batch_host, last_host)))
+			_launch_group_queue(group);
+		last_host = hold_ptr->batch_host;
+		list_append(group, hold_ptr);
+	}
+	if (list_count(group))
+		_launch_group_queue(group);
+	FREE_NULL_LIST(group);
+}
+
 /*
  * launch_job - send an RPC to a slurmd to initiate a batch job
  * IN job_ptr - pointer to job that will be initiated
@@ -2280,7 +2736,6 @@ extern void launch_job(struct job_record *job_ptr)
 {
 	batch_job_launch_msg_t *launch_msg_ptr;
 	uint16_t protocol_version = (uint16_t) NO_VAL;
-	agent_arg_t *agent_arg_ptr;
 
 #ifdef HAVE_FRONT_END
 	front_end_record_t *front_end_ptr;
@@ -2298,17 +2753,19 @@ extern void launch_job(struct job_record *job_ptr)
 	if (launch_msg_ptr == NULL)
 		return;
 
-	agent_arg_ptr = (agent_arg_t *) xmalloc(sizeof(agent_arg_t));
-	agent_arg_ptr->protocol_version = protocol_version;
-	agent_arg_ptr->node_count = 1;
-	agent_arg_ptr->retry = 0;
 	xassert(job_ptr->batch_host);
-	agent_arg_ptr->hostlist = hostlist_create(job_ptr->batch_host);
-	agent_arg_ptr->msg_type = REQUEST_BATCH_JOB_LAUNCH;
-	agent_arg_ptr->msg_args = (void *) launch_msg_ptr;
+	if (launch_hold && _launch_hold_test(job_ptr, protocol_version)) {
+		launch_hold_t *hold_ptr = xmalloc(sizeof(launch_hold_t));
+		hold_ptr->batch_host = xstrdup(job_ptr->batch_host);
+		hold_ptr->launch_msg_ptr = launch_msg_ptr;
+		hold_ptr->protocol_version = protocol_version;
+		list_append(launch_hold_list, hold_ptr);
+		/* As _batch_launch_defer() would on finding the node ready */
+		job_config_fini(job_ptr);
+		return;
+	}
 
-	/* Launch the RPC via agent */
-	agent_queue_request(agent_arg_ptr);
+	_launch_queue(job_ptr->batch_host, launch_msg_ptr, protocol_version);
 }
 
 /*
@@ -2376,6 +2833,117 @@ static void _depend_list_del(void *dep_ptr)
 	xfree(dep_ptr);
 }
 
+/* Record that job dep_job_id waits upon job (or job array) job_id */
+static void _depend_edge_add(uint32_t job_id, uint32_t dep_job_id)
+{
+	depend_edge_t *edge_ptr;
+	int inx = job_id % DEPEND_HASH_SIZE;
+	int lo, hi, mid;
+
+	if (!depend_hash) {
+		depend_hash = xmalloc(sizeof(depend_edge_t *) *
+				      DEPEND_HASH_SIZE);
+	}
+	for (edge_ptr = depend_hash[inx]; edge_ptr; edge_ptr = edge_ptr->next) {
+		if (edge_ptr->job_id == job_id)
+			break;
+	}
+	if (!edge_ptr) {
+		edge_ptr = xmalloc(sizeof(depend_edge_t));
+		edge_ptr->job_id = job_id;
+		edge_ptr->next = depend_hash[inx];
+		depend_hash[inx] = edge_ptr;
+	}
+
+	/* Find where dep_job_id belongs, usually at the end as job IDs are
+	 * mostly added in increasing order */
+	lo = 0;
+	hi = edge_ptr->dep_job_cnt;
+	if (hi && (edge_ptr->dep_job_id[hi - 1] < dep_job_id))
+		lo = hi;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (edge_ptr->dep_job_id[mid] < dep_job_id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if ((lo < edge_ptr->dep_job_cnt) &&
+	    (edge_ptr->dep_job_id[lo] == dep_job_id))
+		return;		/* Job retested and added again */
+
+	if (edge_ptr->dep_job_cnt >= edge_ptr->dep_job_size) {
+		edge_ptr->dep_job_size = MAX(edge_ptr->dep_job_size * 2, 8);
+		xrealloc(edge_ptr->dep_job_id,
+			 sizeof(uint32_t) * edge_ptr->dep_job_size);
+	}
+	if (lo < edge_ptr->dep_job_cnt) {
+		memmove(edge_ptr->dep_job_id + lo + 1,
+			edge_ptr->dep_job_id + lo,
+			sizeof(uint32_t) * (edge_ptr->dep_job_cnt - lo));
+	}
+	edge_ptr->dep_job_id[lo] = dep_job_id;
+	edge_ptr->dep_job_cnt++;
+}
+
+/* Remove the record of jobs waiting upon job_id and force their dependencies
+ * to be tested again */
+static void _depend_edge_wake(uint32_t job_id)
+{
+	depend_edge_t *edge_ptr, **edge_pptr;
+	struct job_record *job_ptr;
+	int i;
+
+	if (!depend_hash)
+		return;
+	edge_pptr = &depend_hash[job_id % DEPEND_HASH_SIZE];
+	while ((edge_ptr = *edge_pptr) && (edge_ptr->job_id != job_id))
+		edge_pptr = &edge_ptr->next;
+	if (!edge_ptr)
+		return;
+	*edge_pptr = edge_ptr->next;
+
+	for (i = 0; i < edge_ptr->dep_job_cnt; i++) {
+		job_ptr = find_job_record(edge_ptr->dep_job_id[i]);
+		if (job_ptr && job_ptr->details)
+			job_ptr->details->depend_wait = (time_t) 0;
+	}
+	xfree(edge_ptr->dep_job_id);
+	xfree(edge_ptr);
+}
+
+/*
+ * notify_job_dependency - Note that a job has started or ended, so that jobs
+ *	depending upon it (or upon its job array) test their dependencies again
+ * IN job_ptr - job which changed state
+ */
+extern void notify_job_dependency(struct job_record *job_ptr)
+{
+	_depend_edge_wake(job_ptr->job_id);
+	if (job_ptr->array_job_id && (job_ptr->array_job_id != job_ptr->job_id))
+		_depend_edge_wake(job_ptr->array_job_id);
+}
+
+/*
+ * job_dependency_fini - Free the reverse dependency records
+ */
+extern void job_dependency_fini(void)
+{
+	depend_edge_t *edge_ptr;
+	int i;
+
+	if (!depend_hash)
+		return;
+	for (i = 0; i < DEPEND_HASH_SIZE; i++) {
+		while ((edge_ptr = depend_hash[i])) {
+			depend_hash[i] = edge_ptr->next;
+			xfree(edge_ptr->dep_job_id);
+			xfree(edge_ptr);
+		}
+	}
+	xfree(depend_hash);
+}
+
 /*
  * Copy a job's dependency list
  * IN depend_list_src - a job's depend_lst
@@ -2524,17 +3092,25 @@ extern int test_job_dependency(struct job_record *job_ptr)
 	ListIterator depend_iter, job_iterator;
 	struct depend_spec *dep_ptr;
 	bool failure = false, depends = false, rebuild_str = false;
-	bool or_satisfied = false;
+	bool or_satisfied = false, notify = true;
  	List job_queue = NULL;
  	bool run_now;
 	int results = 0;
 	struct job_record *qjob_ptr, *djob_ptr, *dcjob_ptr;
+	time_t now = time(NULL);
 
 	if ((job_ptr->details == NULL) ||
 	    (job_ptr->details->depend_list == NULL) ||
 	    (list_count(job_ptr->details->depend_list) == 0))
 		return 0;
 
+	/* Nothing depended upon has started or ended since the last test */
+	if (job_ptr->details->depend_wait &&
+	    (difftime(now, job_ptr->details->depend_wait) <
+	     DEPEND_RECHECK_TIME))
+		return 1;
+	job_ptr->details->depend_wait = (time_t) 0;
+
 	depend_iter = list_iterator_create(job_ptr->details->depend_list);
 	while ((dep_ptr = list_next(depend_iter))) {
 		bool clear_dep = false;
@@ -2567,6 +3143,7 @@ extern int test_job_dependency(struct job_record *job_ptr)
  				list_delete_item(depend_iter);
  			else
 				depends = true;
+			notify = false;	/* Depends upon other users' jobs */
 		} else if ((djob_ptr == NULL) ||
 			   (djob_ptr->magic != JOB_MAGIC) ||
 			   ((djob_ptr->job_id != dep_ptr->job_id) &&
@@ -2685,7 +3262,7 @@ extern int test_job_dependency(struct job_record *job_ptr)
 				break;
 			}
 		} else if (dep_ptr->depend_type == SLURM_DEPEND_EXPAND) {
-			time_t now = time(NULL);
+			notify = false;	/* Tracks the job's end_time */
 			if (IS_JOB_PENDING(djob_ptr)) {
 				depends = true;
 			} else if (IS_JOB_COMPLETED(djob_ptr)) {
@@ -2724,6 +3301,15 @@ extern int test_job_dependency(struct job_record *job_ptr)
 	else if (depends)
 		results = 1;
 
+	if ((results == 1) && notify) {
+		depend_iter = list_iterator_create(
+					job_ptr->details->depend_list);
+		while ((dep_ptr = list_next(depend_iter)))
+			_depend_edge_add(dep_ptr->job_id, job_ptr->job_id);
+		list_iterator_destroy(depend_iter);
+		job_ptr->details->depend_wait = now;
+	}
+
 	return results;
 }
 
@@ -3048,6 +3634,7 @@ extern int update_job_dependency(struct job_record *job_ptr, char *new_depend)
 	if (rc == SLURM_SUCCESS) {
 		FREE_NULL_LIST(job_ptr->details->depend_list);
 		job_ptr->details->depend_list = new_depend_list;
+		job_ptr->details->depend_wait = (time_t) 0;
 		_depend_list2str(job_ptr, or_flag);
 #if _DEBUG
 		print_job_dependency(job_ptr);
@@ -3511,7 +4098,7 @@ static char **_build_env(struct job_record *job_ptr, bool is_epilog)
 			job_ptr->partition);
 	}
 	setenvf(&my_env, "SLURM_JOB_UID", "%u", job_ptr->user_id);
-	name = uid_to_string((uid_t) job_ptr->user_id);
+	name = id_cache_uid_to_string((uid_t) job_ptr->user_id);
 	setenvf(&my_env, "SLURM_JOB_USER", "%s", name);
 	xfree(name);
 
@@ -62,7 +62,9 @@ typedef struct job_queue_rec {
 extern int build_feature_list(struct job_record *job_ptr);
 
 /*
- * build_job_queue - build (non-priority ordered) list of pending jobs
+ * build_job_queue - build list of pending jobs in priority order, as
+ *	sort_job_queue() would leave it. The order is kept in a persistent
+ *	queue which only sorts jobs that are new or changed priority.
  * IN clear_start - if set then clear the start_time for pending jobs
  * IN backfill - true if running backfill scheduler, enforce min time limit
  * RET the job queue
@@ -70,6 +72,16 @@ extern int build_feature_list(struct job_record *job_ptr);
  */
 extern List build_job_queue(bool clear_start, bool backfill);
 
+/*
+ * job_queue_fini - Free the persistent job queue used by build_job_queue()
+ */
+extern void job_queue_fini(void);
+
+/*
+ * job_dependency_fini - Free the reverse dependency records
+ */
+extern void job_dependency_fini(void);
+
 /* Given a scheduled job, return a pointer to it batch_job_launch_msg_t data */
 extern batch_job_launch_msg_t *build_launch_job_msg(
 					struct job_record *job_ptr,
@@ -205,6 +217,13 @@ extern int sort_job_queue2(void *x, void *y);
  */
 extern int test_job_dependency(struct job_record *job_ptr);
 
+/*
+ * notify_job_dependency - Note that a job has started or ended, so that jobs
+ *	depending upon it (or upon its job array) test their dependencies again
+ * IN job_ptr - job which changed state
+ */
+extern void notify_job_dependency(struct job_record *job_ptr);
+
 /*
  * Parse a job dependency string and use it to establish a "depend_spec"
  * list of dependencies. We accept both old format (a single job ID) and
@@ -125,15 +125,15 @@ static bool 	_valid_node_state_change(uint32_t old, uint32_t new);
 /* dump_all_node_state - save the state of all nodes to file */
 int dump_all_node_state ( void )
 {
-	/* Save high-water mark to avoid buffer growth with copies */
-	static int high_buffer_size = (1024 * 1024);
+	/* Start from the largest buffer so far to avoid growth with copies */
+	static buf_pool_t buf_pool = BUF_POOL_INITIALIZER(1024 * 1024);
 	int error_code = 0, inx, log_fd;
 	char *old_file, *new_file, *reg_file;
 	struct node_record *node_ptr;
 	/* Locks: Read config and node */
 	slurmctld_lock_t node_read_lock = { READ_LOCK, NO_LOCK, READ_LOCK,
 					    NO_LOCK, NO_LOCK };
-	Buf buffer = init_buf(high_buffer_size);
+	Buf buffer = pool_init_buf(&buf_pool);
 	DEF_TIMERS;
 
 	START_TIMER;
@@ -168,7 +168,6 @@ int dump_all_node_state ( void )
 	} else {
 		int pos = 0, nwrite = get_buf_offset(buffer), amount, rc;
 		char *data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
 		while (nwrite > 0) {
 			amount = write(log_fd, &data[pos], nwrite);
 			if ((amount < 0) && (errno != EINTR)) {
@@ -202,7 +201,7 @@ int dump_all_node_state ( void )
 	xfree (new_file);
 	unlock_state_files ();
 
-	free_buf (buffer);
+	pool_free_buf(&buf_pool, buffer);
 	END_TIMER2("dump_all_node_state");
 	return error_code;
 }
@@ -3933,3 +3932,21 @@ extern void reset_node_free_mem(char *node_name, uint64_t free_mem)
 #endif
 }
 
+/* Record that a node's CPU load and free memory values are current */
+extern void reset_node_load_time(char *node_name)
+{
+#ifdef HAVE_FRONT_END
+	return;
+#else
+	struct node_record *node_ptr;
+
+	node_ptr = find_node_record(node_name);
+	if (node_ptr) {
+		time_t now = time(NULL);
+		node_ptr->cpu_load_time = now;
+		node_ptr->free_mem_time = now;
+	} else
+		error("reset_node_load_time unable to find node %s", node_name);
+#endif
+}
+
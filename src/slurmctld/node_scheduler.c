@@ -55,6 +55,7 @@
 #include "src/common/assoc_mgr.h"
 #include "src/common/gres.h"
 #include "src/common/hostlist.h"
+#include "src/common/id_cache.h"
 #include "src/common/layouts_mgr.h"
 #include "src/common/list.h"
 #include "src/common/node_features.h"
@@ -2579,6 +2580,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 	configuring = IS_JOB_CONFIGURING(job_ptr);
 
 	job_ptr->job_state = JOB_RUNNING;
+	notify_job_dependency(job_ptr);
 	if (nonstop_ops.job_begin)
 		(nonstop_ops.job_begin)(job_ptr);
 
@@ -2695,7 +2697,7 @@ static void _launch_prolog(struct job_record *job_ptr)
 	prolog_msg_ptr->job_id = job_ptr->job_id;
 	prolog_msg_ptr->uid = job_ptr->user_id;
 	prolog_msg_ptr->gid = job_ptr->group_id;
-	prolog_msg_ptr->user_name = uid_to_string(job_ptr->user_id);
+	prolog_msg_ptr->user_name = id_cache_uid_to_string(job_ptr->user_id);
 	prolog_msg_ptr->alias_list = xstrdup(job_ptr->alias_list);
 	prolog_msg_ptr->nodes = xstrdup(job_ptr->nodes);
 	prolog_msg_ptr->partition = xstrdup(job_ptr->partition);
@@ -408,14 +408,14 @@ static int _delete_part_record(char *name)
 /* dump_all_part_state - save the state of all partitions to file */
 int dump_all_part_state(void)
 {
-	/* Save high-water mark to avoid buffer growth with copies */
-	static int high_buffer_size = BUF_SIZE;
+	/* Start from the largest buffer so far to avoid growth with copies */
+	static buf_pool_t buf_pool = BUF_POOL_INITIALIZER(BUF_SIZE);
 	int error_code = 0, log_fd;
 	char *old_file, *new_file, *reg_file;
 	/* Locks: Read partition */
 	slurmctld_lock_t part_read_lock =
 	    { READ_LOCK, NO_LOCK, NO_LOCK, READ_LOCK, NO_LOCK };
-	Buf buffer = init_buf(high_buffer_size);
+	Buf buffer = pool_init_buf(&buf_pool);
 	DEF_TIMERS;
 
 	START_TIMER;
@@ -446,7 +446,6 @@ int dump_all_part_state(void)
 	} else {
 		int pos = 0, nwrite = get_buf_offset(buffer), amount, rc;
 		char *data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
 		while (nwrite > 0) {
 			amount = write(log_fd, &data[pos], nwrite);
 			if ((amount < 0) && (errno != EINTR)) {
@@ -482,7 +481,7 @@ int dump_all_part_state(void)
 	xfree(new_file);
 	unlock_state_files();
 
-	free_buf(buffer);
+	pool_free_buf(&buf_pool, buffer);
 	END_TIMER2("dump_all_part_state");
 	return 0;
 }
@@ -1664,7 +1663,6 @@ extern int update_part (update_part_msg_t * part_desc, bool create_flag)
 				part_ptr->allow_groups, part_desc->name);
 			part_ptr->allow_uids =
 				_get_groups_members(part_ptr->allow_groups);
-			clear_group_cache();
 		}
 	}
 
@@ -2075,6 +2073,10 @@ void load_part_uid_allow_list(int force)
 	if ((force == 0) && (temp_time == last_update_time))
 		return;
 	debug("Updating partition uid access list");
+	/* Group members are kept fresh by the user/group cache, only a
+	 * change to the group file makes them stale */
+	if (temp_time != last_update_time)
+		clear_group_cache();
 	last_update_time = temp_time;
 
 	list_for_each(part_list, _update_part_uid_access_list, &updated);
@@ -2087,7 +2089,6 @@ void load_part_uid_allow_list(int force)
 		last_part_update = time(NULL);
 	}
 
-	clear_group_cache();
 	END_TIMER2("load_part_uid_allow_list");
 }
 
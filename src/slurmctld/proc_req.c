@@ -210,6 +210,7 @@ inline static void  _update_cred_key(void);
 static void  _slurm_rpc_composite_msg(slurm_msg_t *msg);
 static void  _slurm_rpc_comp_msg_list(composite_msg_t * comp_msg,
 				      bool *run_scheduler,
+				      bool *power_sync,
 				      List msg_list_in,
 				      struct timeval *start_tv,
 				      int timeout);
@@ -651,6 +652,15 @@ static void _throttle_fini(int *active_rpc_cnt)
 	slurm_mutex_unlock(&throttle_mutex);
 }
 
+/* Synchronize power layouts key/values after batch jobs complete */
+static void _sync_power_layouts(void)
+{
+	if ((powercap_get_cluster_current_cap() != 0) &&
+	    (which_power_layout() == 2)) {
+		layouts_entity_pull_kv("power", "Cluster", "CurrentSumPower");
+	}
+}
+
 /*
  * _fill_ctld_conf - make a copy of current slurm configuration
  *	this is done with locks set so the data can change at other times
@@ -2326,11 +2336,9 @@ static void _slurm_rpc_complete_batch_script(slurm_msg_t *msg,
 
 	END_TIMER2("_slurm_rpc_complete_batch_script");
 
-	/* synchronize power layouts key/values */
-	if ((powercap_get_cluster_current_cap() != 0) &&
-	    (which_power_layout() == 2)) {
-		layouts_entity_pull_kv("power", "Cluster", "CurrentSumPower");
-	}
+	/* A composite message does this once for the whole batch */
+	if (!running_composite)
+		_sync_power_layouts();
 
 	/* return result */
 	if (error_code) {
@@ -2347,8 +2355,11 @@ static void _slurm_rpc_complete_batch_script(slurm_msg_t *msg,
 			*run_scheduler = true;
 	}
 
-	/* If running composite lets not call this to avoid deadlock */
-	if (!running_composite && *run_scheduler)
+	/* If running composite lets not call these to avoid deadlock, the
+	 * composite message handler calls them once for the whole batch */
+	if (running_composite)
+		return;
+	if (*run_scheduler)
 		(void) schedule(0);		/* Has own locking */
 	if (dump_job)
 		(void) schedule_job_save();	/* Has own locking */
@@ -2710,6 +2721,41 @@ static void _slurm_rpc_event_log(slurm_msg_t * msg)
 	slurm_send_rc_msg(msg, error_code);
 }
 
+/*
+ * slurm_node_registration - validate a node's registration and the jobs
+ *	it reports
+ * NOTE: Caller must hold read config, write job and write node locks
+ */
+extern int slurm_node_registration(
+	slurm_node_registration_status_msg_t *reg_msg,
+	uint16_t protocol_version, bool *newly_up)
+{
+	if (protocol_version != SLURM_PROTOCOL_VERSION)
+		info("Node %s appears to have a different version "
+		     "of Slurm than ours.  Please update at your earliest "
+		     "convenience.", reg_msg->node_name);
+
+	if (!(slurmctld_conf.debug_flags & DEBUG_FLAG_NO_CONF_HASH) &&
+	    (reg_msg->hash_val != NO_VAL) &&
+	    (reg_msg->hash_val != slurm_get_hash_val())) {
+		error("Node %s appears to have a different slurm.conf "
+		      "than the slurmctld.  This could cause issues "
+		      "with communication and functionality.  "
+		      "Please review both files and make sure they "
+		      "are the same.  If this is expected ignore, and "
+		      "set DebugFlags=NO_CONF_HASH in your slurm.conf.",
+		      reg_msg->node_name);
+	}
+
+#ifdef HAVE_FRONT_END		/* Operates only on front-end */
+	return validate_nodes_via_front_end(reg_msg, protocol_version,
+					    newly_up);
+#else
+	validate_jobs_on_node(reg_msg);
+	return validate_node_specs(reg_msg, protocol_version, newly_up);
+#endif
+}
+
 /* _slurm_rpc_node_registration - process RPC to determine if a node's
  *	actual configuration satisfies the configured specification */
 static void _slurm_rpc_node_registration(slurm_msg_t * msg,
@@ -2735,36 +2781,13 @@ static void _slurm_rpc_node_registration(slurm_msg_t * msg,
 		error("Security violation, NODE_REGISTER RPC from uid=%d", uid);
 	}
 
-	if (msg->protocol_version != SLURM_PROTOCOL_VERSION)
-		info("Node %s appears to have a different version "
-		     "of Slurm than ours.  Please update at your earliest "
-		     "convenience.", node_reg_stat_msg->node_name);
-
 	if (error_code == SLURM_SUCCESS) {
 		/* do RPC call */
-		if (!(slurmctld_conf.debug_flags & DEBUG_FLAG_NO_CONF_HASH) &&
-		    (node_reg_stat_msg->hash_val != NO_VAL) &&
-		    (node_reg_stat_msg->hash_val != slurm_get_hash_val())) {
-			error("Node %s appears to have a different slurm.conf "
-			      "than the slurmctld.  This could cause issues "
-			      "with communication and functionality.  "
-			      "Please review both files and make sure they "
-			      "are the same.  If this is expected ignore, and "
-			      "set DebugFlags=NO_CONF_HASH in your slurm.conf.",
-			      node_reg_stat_msg->node_name);
-		}
 		if (!running_composite)
 			lock_slurmctld(job_write_lock);
-#ifdef HAVE_FRONT_END		/* Operates only on front-end */
-		error_code = validate_nodes_via_front_end(node_reg_stat_msg,
-							  msg->protocol_version,
-							  &newly_up);
-#else
-		validate_jobs_on_node(node_reg_stat_msg);
-		error_code = validate_node_specs(node_reg_stat_msg,
-						 msg->protocol_version,
-						 &newly_up);
-#endif
+		error_code = slurm_node_registration(node_reg_stat_msg,
+						     msg->protocol_version,
+						     &newly_up);
 		if (!running_composite)
 			unlock_slurmctld(job_write_lock);
 		END_TIMER2("_slurm_rpc_node_registration");
@@ -3339,7 +3362,7 @@ static void _slurm_rpc_step_complete(slurm_msg_t *msg, bool running_composite)
 			_throttle_fini(&active_rpc_cnt);
 		}
 		slurm_send_rc_msg(msg, rc);
-		if (!rc)	/* partition completion */
+		if (!rc && !running_composite)	/* partition completion */
 			schedule_job_save();	/* Has own locking */
 		return;
 	}
@@ -3391,6 +3414,8 @@ static void _slurm_rpc_step_complete(slurm_msg_t *msg, bool running_composite)
 			dump_job = true;
 		}
 	}
+	if (running_composite)
+		return;		/* Saved once for the whole batch */
 	if (dump_job)
 		(void) schedule_job_save();	/* Has own locking */
 	if (dump_node)
@@ -5897,7 +5922,7 @@ static void  _slurm_rpc_composite_msg(slurm_msg_t *msg)
 	static int sched_timeout = 0;
 	static int active_rpc_cnt = 0;
 	struct timeval start_tv;
-	bool run_scheduler = false;
+	bool run_scheduler = false, power_sync = false;
 	composite_msg_t *comp_msg, comp_resp_msg;
 	/* Locks: Read configuration, write job, write node */
 	slurmctld_lock_t job_write_lock = {
@@ -5943,7 +5968,7 @@ static void  _slurm_rpc_composite_msg(slurm_msg_t *msg)
 	_throttle_start(&active_rpc_cnt);
 	lock_slurmctld(job_write_lock);
 	gettimeofday(&start_tv, NULL);
-	_slurm_rpc_comp_msg_list(comp_msg, &run_scheduler,
+	_slurm_rpc_comp_msg_list(comp_msg, &run_scheduler, &power_sync,
 				 comp_resp_msg.msg_list, &start_tv,
 				 sched_timeout);
 	unlock_slurmctld(job_write_lock);
@@ -5974,13 +5999,18 @@ static void  _slurm_rpc_composite_msg(slurm_msg_t *msg)
 		 */
 		if (!LOTS_OF_AGENTS && !defer_sched)
 			(void) schedule(0);	/* Has own locking */
-		schedule_node_save();		/* Has own locking */
-		schedule_job_save();		/* Has own locking */
 	}
+	/* The messages above leave saving state and power layout updates to
+	 * be done once for the whole batch */
+	schedule_node_save();		/* Has own locking */
+	schedule_job_save();		/* Has own locking */
+	if (power_sync)
+		_sync_power_layouts();
 }
 
 static void  _slurm_rpc_comp_msg_list(composite_msg_t * comp_msg,
 				      bool *run_scheduler,
+				      bool *power_sync,
 				      List msg_list_in,
 				      struct timeval *start_tv,
 				      int timeout)
@@ -6028,6 +6058,7 @@ static void  _slurm_rpc_comp_msg_list(composite_msg_t * comp_msg,
 				     "messages", ncomp_msg->msg_list ?
 				     list_count(ncomp_msg->msg_list) : 0);
 			_slurm_rpc_comp_msg_list(ncomp_msg, run_scheduler,
+						 power_sync,
 						 comp_resp_msg->msg_list,
 						 start_tv, timeout);
 			if (list_count(comp_resp_msg->msg_list)) {
@@ -6059,6 +6090,7 @@ static void  _slurm_rpc_comp_msg_list(composite_msg_t * comp_msg,
 		case REQUEST_COMPLETE_BATCH_JOB:
 			_slurm_rpc_complete_batch_script(next_msg,
 							 run_scheduler, 1);
+			*power_sync = true;
 			break;
 		case REQUEST_STEP_COMPLETE:
 			_slurm_rpc_step_complete(next_msg, 1);
@@ -6158,6 +6190,37 @@ static int _process_persist_conn(void *arg,
  *
  * Pack the assoc_mgr lists and return it back to the caller.
  */
+/* Process a message from a slurmd's persistant connection.  Unlike over a
+ * new connection every message gets a response, even those with none
+ * otherwise, so the slurmd always knows where it is on the connection. */
+static int _process_node_persist_conn(void *arg,
+				      persist_msg_t *persist_msg,
+				      Buf *out_buffer, uint32_t *uid)
+{
+	slurm_msg_t msg;
+	slurm_persist_conn_t *persist_conn = arg;
+
+	*out_buffer = NULL;
+
+	slurm_msg_t_init(&msg);
+
+	msg.auth_cred = persist_conn->auth_cred;
+	msg.conn = persist_conn;
+	msg.conn_fd = persist_conn->fd;
+	msg.protocol_version = persist_conn->version;
+
+	msg.msg_type = persist_msg->msg_type;
+	msg.data = persist_msg->data;
+
+	slurmctld_req(&msg, NULL);
+
+	if ((msg.msg_type == MESSAGE_EPILOG_COMPLETE) ||
+	    (msg.msg_type == MESSAGE_COMPOSITE))
+		slurm_send_rc_msg(&msg, SLURM_SUCCESS);
+
+	return SLURM_SUCCESS;
+}
+
 static void _slurm_rpc_persist_init(slurm_msg_t *msg, connection_arg_t *arg)
 {
 	DEF_TIMERS;
@@ -6201,7 +6264,10 @@ static void _slurm_rpc_persist_init(slurm_msg_t *msg, connection_arg_t *arg)
 	persist_conn->fd = arg->newsockfd;
 	arg->newsockfd = -1;
 
-	persist_conn->callback_proc = _process_persist_conn;
+	if (persist_init->persist_type == PERSIST_TYPE_SLURMD)
+		persist_conn->callback_proc = _process_node_persist_conn;
+	else
+		persist_conn->callback_proc = _process_persist_conn;
 
 	persist_conn->rem_port = persist_init->port;
 	persist_conn->rem_host = xmalloc_nz(sizeof(char) * 16);
@@ -6217,8 +6283,27 @@ static void _slurm_rpc_persist_init(slurm_msg_t *msg, connection_arg_t *arg)
 	persist_conn->version = persist_init->version;
 	memcpy(&p_tmp, persist_conn, sizeof(slurm_persist_conn_t));
 
-	if ((rc = fed_mgr_add_sibling_conn(persist_conn, &comment))
-	    != SLURM_SUCCESS)
+	/* p_tmp has no session key so the response goes out unsigned */
+	if ((rc = slurm_persist_conn_session_accept(
+		     persist_conn, persist_init, uid,
+		     slurmctld_config.auth_info)) != SLURM_SUCCESS) {
+		comment = xstrdup(slurm_strerror(rc));
+		slurm_persist_conn_destroy(persist_conn);
+	} else if ((persist_init->persist_type == PERSIST_TYPE_SLURMD) &&
+		   !persist_conn->session_key) {
+		/* Node messages on this connection carry no credential of
+		 * their own, the session MAC is what authenticates them */
+		error("Persistent slurmd connection from %s without a session",
+		      persist_conn->rem_host);
+		rc = ESLURM_AUTH_CRED_INVALID;
+		comment = xstrdup(slurm_strerror(rc));
+		slurm_persist_conn_destroy(persist_conn);
+	} else if (persist_init->persist_type == PERSIST_TYPE_SLURMD) {
+		/* Many of these, few messages each, so no thread of their
+		 * own */
+		slurm_persist_conn_mux_add(persist_conn, persist_conn);
+	} else if ((rc = fed_mgr_add_sibling_conn(persist_conn, &comment))
+		   != SLURM_SUCCESS)
 		slurm_persist_conn_destroy(persist_conn);
 end_it:
 
@@ -84,6 +84,19 @@ extern int slurm_drain_nodes(char *node_list, char *reason,
  */
 extern int slurm_fail_job(uint32_t job_id, uint32_t job_state);
 
+/*
+ * slurm_node_registration - validate a node's registration and the jobs
+ *	it reports
+ * IN reg_msg - node registration message
+ * IN protocol_version - protocol version of the registration message
+ * OUT newly_up - set if the node is newly responding
+ * RET SLURM_SUCCESS or error code
+ * NOTE: Caller must hold read config, write job and write node locks
+ */
+extern int slurm_node_registration(
+	slurm_node_registration_status_msg_t *reg_msg,
+	uint16_t protocol_version, bool *newly_up);
+
 /* Copy an array of type char **, xmalloc() the array and xstrdup() the
  * strings in the array */
 extern char **xduparray(uint32_t size, char ** array);
@@ -56,6 +56,7 @@
 #include "src/common/cpu_frequency.h"
 #include "src/common/gres.h"
 #include "src/common/hostlist.h"
+#include "src/common/id_cache.h"
 #include "src/common/layouts_mgr.h"
 #include "src/common/list.h"
 #include "src/common/macros.h"
@@ -1131,6 +1132,8 @@ int read_slurm_conf(int recover, bool reconfig)
 	}
 
 	(void) _sync_nodes_to_comp_job();/* must follow select_g_node_init() */
+	id_cache_purge();
+	id_cache_init(slurmctld_conf.group_info & GROUP_TIME_MASK);
 	load_part_uid_allow_list(1);
 
 	if (reconfig) {
@@ -483,6 +483,9 @@ struct job_details {
 	uint16_t cpus_per_task;		/* number of processors required for
 					 * each task */
 	List depend_list;		/* list of job_ptr:state pairs */
+	time_t depend_wait;		/* time dependencies found pending,
+					 * cleared when a job depended upon
+					 * starts or ends */
 	char *dependency;		/* wait for other jobs */
 	char *orig_dependency;		/* original value (for archiving) */
 	uint16_t env_cnt;		/* size of env_sup (see below) */
@@ -665,6 +668,14 @@ struct job_record {
 					    * a limit instead of from
 					    * the request, or if the
 					    * limit was set from admin */
+	uint32_t limit_gen;		/* assoc_mgr_write_gen when job last
+					 * failed acct_policy pre_select
+					 * limits, 0 if no failure cached */
+	uint32_t limit_time_limit;	/* time_limit when limit_gen set */
+	void *limit_assoc_ptr;		/* assoc_ptr when limit_gen set */
+	void *limit_qos_ptr;		/* qos_ptr when limit_gen set */
+	void *limit_part_ptr;		/* part_ptr when limit_gen set */
+	void *limit_part_qos_ptr;	/* part_ptr's QOS when limit_gen set */
 	uint16_t mail_type;		/* see MAIL_JOB_* in slurm.h */
 	char *mail_user;		/* user to get e-mail notification */
 	uint32_t magic;			/* magic cookie for data integrity */
@@ -731,6 +742,11 @@ struct job_record {
 	uint32_t requid;	    	/* requester user ID */
 	char *resp_host;		/* host for srun communications */
 	char *sched_nodes;		/* list of nodes scheduled for job */
+	uint32_t sched_queue_gen;	/* generation of job's records in the
+					 * persistent job queue, see
+					 * job_scheduler.c */
+	uint32_t sched_queue_pass;	/* last build_job_queue() pass which
+					 * found the job runnable */
 	dynamic_plugin_data_t *select_jobinfo;/* opaque data, BlueGene */
 	char **spank_job_env;		/* environment variables for job prolog
 					 * and epilog scripts as set by SPANK
@@ -751,6 +767,11 @@ struct job_record {
 					 * scheduling cycle (state_reason is
 					 * cleared at start of cycle) */
 	List step_list;			/* list of job's steps */
+	bitstr_t *step_node_busy;	/* nodes with running steps, NULL if
+					 * index not built, see step_mgr.c */
+	uint16_t *step_node_use;	/* running step count per node, offset
+					 * from first job_resrcs node */
+	uint32_t step_node_use_cnt;	/* count of steps in step_node_use */
 	time_t suspend_time;		/* time job last suspended or resumed */
 	time_t time_last_active;	/* time of last job activity */
 	uint32_t time_limit;		/* time_limit minutes or INFINITE,
@@ -867,6 +888,7 @@ struct 	step_record {
 					  * in the step */
 	bitstr_t *step_node_bitmap;	/* bitmap of nodes allocated to job
 					 * step */
+	bool step_node_use_set;		/* counted in job's step_node_use */
 /*	time_t suspend_time;		 * time step last suspended or resumed
 					 * implicitly the same as suspend_time
 					 * in the job record */
@@ -2000,6 +2022,10 @@ extern void reset_node_load(char *node_name, uint32_t cpu_load);
 /* Reset a node's free memory value */
 extern void reset_node_free_mem(char *node_name, uint64_t free_mem);
 
+/* Record that a node's CPU load and free memory values are current, the node
+ * having replied that they are unchanged */
+extern void reset_node_load_time(char *node_name);
+
 /* Reset all scheduling statistics
  * level IN - clear backfilled_jobs count if set */
 extern void reset_stats(int level);
@@ -2155,6 +2181,14 @@ extern slurm_step_layout_t *step_layout_create(struct step_record *step_ptr,
 					       uint32_t task_dist,
 					       uint16_t plane_size);
 
+/*
+ * step_node_use_reset - Discard a job's index of nodes used by running
+ *	steps, it is rebuilt when next needed. Call after changing any
+ *	running step's step_node_bitmap.
+ * IN job_ptr - pointer to job table entry
+ */
+extern void step_node_use_reset(struct job_record *job_ptr);
+
 /*
  * step_list_purge - Simple purge of a job's step list records.
  * IN job_ptr - pointer to job table entry to have step records removed
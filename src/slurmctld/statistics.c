@@ -40,8 +40,11 @@
 
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/slurmctld.h"
+#include "src/common/assoc_mgr.h"
+#include "src/common/id_cache.h"
 #include "src/common/list.h"
 #include "src/common/pack.h"
+#include "src/common/slurm_persist_conn.h"
 #include "src/common/xstring.h"
 
 extern int retry_list_size(void);
@@ -51,6 +54,9 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			  uint16_t protocol_version)
 {
 	Buf buffer;
+	assoc_mgr_stats_t assoc_stats;
+	persist_mux_stats_t mux_stats;
+	id_cache_stats_t id_stats;
 	int parts_packed;
 	int agent_queue_size;
 	time_t now = time(NULL);
@@ -111,6 +117,34 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			pack32(slurmctld_diag_stats.bf_depth_try_sum, buffer);
 			pack32(slurmctld_diag_stats.bf_queue_len_sum, buffer);
 			pack32(slurmctld_diag_stats.bf_active,	 buffer);
+
+			if (protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+				assoc_mgr_get_stats(&assoc_stats);
+				pack32(assoc_stats.version, buffer);
+				pack32(assoc_stats.update_cnt, buffer);
+				pack32(assoc_stats.update_last, buffer);
+				pack32(assoc_stats.update_max, buffer);
+				pack64(assoc_stats.update_sum, buffer);
+				pack32(assoc_stats.write_cnt, buffer);
+				pack32(assoc_stats.write_max, buffer);
+				pack64(assoc_stats.write_sum, buffer);
+
+				slurm_persist_conn_mux_get_stats(&mux_stats);
+				pack32(mux_stats.conn_cnt, buffer);
+				pack32(mux_stats.conn_opened, buffer);
+				pack32(mux_stats.conn_closed, buffer);
+				pack32(mux_stats.msg_cnt, buffer);
+				pack32(mux_stats.msg_max, buffer);
+
+				id_cache_get_stats(&id_stats);
+				pack32(id_stats.entry_cnt, buffer);
+				pack32(id_stats.neg_cnt, buffer);
+				pack32(id_stats.hit_cnt, buffer);
+				pack32(id_stats.miss_cnt, buffer);
+				pack32(id_stats.refresh_cnt, buffer);
+				pack32(id_stats.resolve_max, buffer);
+				pack64(id_stats.resolve_sum, buffer);
+			}
 		}
 	}
 
@@ -151,5 +185,9 @@ extern void reset_stats(int level)
 	slurmctld_diag_stats.bf_last_depth_try = 0;
 	slurmctld_diag_stats.bf_active = 0;
 
+	assoc_mgr_reset_stats();
+	slurm_persist_conn_mux_reset_stats();
+	id_cache_reset_stats();
+
 	last_proc_req_start = time(NULL);
 }
@@ -107,6 +107,8 @@ static hostlist_t _step_range_to_hostlist(struct step_record *step_ptr,
 static int _step_hostname_to_inx(struct step_record *step_ptr,
 				char *node_name);
 static void _step_dealloc_lps(struct step_record *step_ptr);
+static bitstr_t *_step_node_busy(struct job_record *job_ptr);
+static void _step_node_use_update(struct step_record *step_ptr, bool add);
 
 /* Determine how many more CPUs are required for a job step */
 static int  _opt_cpu_cnt(uint32_t step_min_cpus, bitstr_t *node_bitmap,
@@ -323,6 +325,110 @@ extern void step_list_purge(struct job_record *job_ptr)
 	}
 	list_iterator_destroy(step_iterator);
 	FREE_NULL_LIST(job_ptr->step_list);
+	step_node_use_reset(job_ptr);
+}
+
+/*
+ * step_node_use_reset - Discard a job's index of nodes used by running
+ *	steps, it is rebuilt when next needed. Call after changing any
+ *	running step's step_node_bitmap.
+ * IN job_ptr - pointer to job table entry
+ */
+extern void step_node_use_reset(struct job_record *job_ptr)
+{
+	FREE_NULL_BITMAP(job_ptr->step_node_busy);
+	xfree(job_ptr->step_node_use);
+	job_ptr->step_node_use_cnt = 0;
+}
+
+/*
+ * Add or remove a running step's nodes to or from its job's index of nodes
+ * in use by steps. Only the step's own nodes are visited, so the cost does
+ * not depend upon the count of other steps in the job. The index is dropped
+ * as soon as no steps remain, so a requeued job never sees stale offsets.
+ */
+static void _step_node_use_update(struct step_record *step_ptr, bool add)
+{
+	struct job_record *job_ptr = step_ptr->job_ptr;
+	int i, i_first, i_last, job_first;
+
+	if (step_ptr->step_node_use_set == add)
+		return;
+	step_ptr->step_node_use_set = add;
+	if (!job_ptr || !job_ptr->step_node_busy)
+		return;		/* index not built, nothing to update */
+
+	if (step_ptr->step_node_bitmap &&
+	    job_ptr->job_resrcs && job_ptr->job_resrcs->node_bitmap &&
+	    ((job_first = bit_ffs(job_ptr->job_resrcs->node_bitmap)) >= 0) &&
+	    ((i_first = bit_ffs(step_ptr->step_node_bitmap)) >= 0)) {
+		i_first = MAX(i_first, job_first);
+		i_last  = MIN(bit_fls(step_ptr->step_node_bitmap),
+			      bit_fls(job_ptr->job_resrcs->node_bitmap));
+		for (i = i_first; i <= i_last; i++) {
+			if (!bit_test(step_ptr->step_node_bitmap, i) ||
+			    !bit_test(job_ptr->job_resrcs->node_bitmap, i))
+				continue;
+			if (add) {
+				if (job_ptr->step_node_use[i - job_first]++ == 0)
+					bit_set(job_ptr->step_node_busy, i);
+			} else if (job_ptr->step_node_use[i - job_first] &&
+				   (--job_ptr->step_node_use[i - job_first]
+				    == 0)) {
+				bit_clear(job_ptr->step_node_busy, i);
+			}
+		}
+	}
+
+	if (add) {
+		job_ptr->step_node_use_cnt++;
+	} else if ((job_ptr->step_node_use_cnt == 0) ||
+		   (--job_ptr->step_node_use_cnt == 0)) {
+		step_node_use_reset(job_ptr);
+	}
+}
+
+/*
+ * Return a bitmap of the job's nodes in use by running steps, building the
+ *	index from the job's step list if needed. Afterwards the index is
+ *	maintained as steps start and end.
+ * RET bitmap owned by the job record, do not free. NULL if no running steps
+ */
+static bitstr_t *_step_node_busy(struct job_record *job_ptr)
+{
+	ListIterator step_iterator;
+	struct step_record *step_ptr;
+	int first_bit, last_bit;
+
+	if (job_ptr->step_node_busy &&
+	    (bit_size(job_ptr->step_node_busy) != node_record_count))
+		step_node_use_reset(job_ptr);	/* node table changed */
+	if (job_ptr->step_node_busy)
+		return job_ptr->step_node_busy;
+	if (!job_ptr->step_list || !job_ptr->job_resrcs ||
+	    !job_ptr->job_resrcs->node_bitmap ||
+	    ((first_bit = bit_ffs(job_ptr->job_resrcs->node_bitmap)) < 0))
+		return NULL;
+
+	last_bit = bit_fls(job_ptr->job_resrcs->node_bitmap);
+	job_ptr->step_node_busy = bit_alloc(node_record_count);
+	job_ptr->step_node_use  = xmalloc(sizeof(uint16_t) *
+					  (last_bit - first_bit + 1));
+	job_ptr->step_node_use_cnt = 0;
+	step_iterator = list_iterator_create(job_ptr->step_list);
+	while ((step_ptr = (struct step_record *) list_next(step_iterator))) {
+		step_ptr->step_node_use_set = false;
+		if (step_ptr->state < JOB_RUNNING)
+			continue;
+		_step_node_use_update(step_ptr, true);
+	}
+	list_iterator_destroy(step_iterator);
+
+	if (job_ptr->step_node_use_cnt == 0) {
+		step_node_use_reset(job_ptr);
+		return NULL;
+	}
+	return job_ptr->step_node_busy;
 }
 
 /* _free_step_rec - delete a step record's data structures */
@@ -348,6 +454,7 @@ static void _free_step_rec(struct step_record *step_ptr)
 	jobacctinfo_destroy(step_ptr->jobacct);
 	FREE_NULL_BITMAP(step_ptr->core_bitmap_job);
 	FREE_NULL_BITMAP(step_ptr->exit_node_bitmap);
+	_step_node_use_update(step_ptr, false);
 	FREE_NULL_BITMAP(step_ptr->step_node_bitmap);
 	xfree(step_ptr->resv_port_array);
 	xfree(step_ptr->resv_ports);
@@ -950,8 +1057,6 @@ _pick_step_nodes (struct job_record  *job_ptr,
 	int error_code, nodes_picked_cnt = 0, cpus_picked_cnt = 0;
 	int cpu_cnt, i, task_cnt;
 	int mem_blocked_nodes = 0, mem_blocked_cpus = 0;
-	ListIterator step_iterator;
-	struct step_record *step_p;
 	job_resources_t *job_resrcs_ptr = job_ptr->job_resrcs;
 	uint32_t *usable_cpu_cnt = NULL;
 
@@ -1469,23 +1574,18 @@ _pick_step_nodes (struct job_record  *job_ptr,
 		bit_and (nodes_avail, relative_nodes);
 		FREE_NULL_BITMAP (relative_nodes);
 	} else {
-		nodes_idle = bit_alloc (bit_size (nodes_avail) );
-		step_iterator = list_iterator_create(job_ptr->step_list);
-		while ((step_p = (struct step_record *)
-			list_next(step_iterator))) {
-			if (step_p->state < JOB_RUNNING)
-				continue;
-			bit_or(nodes_idle, step_p->step_node_bitmap);
+		bitstr_t *nodes_busy = _step_node_busy(job_ptr);
+		if (nodes_busy) {
+			nodes_idle = bit_copy(nodes_busy);
 			if (slurmctld_conf.debug_flags & DEBUG_FLAG_STEPS) {
-				char *temp;
-				temp = bitmap2node_name(step_p->
-							step_node_bitmap);
-				info("step %u.%u has nodes %s",
-				     job_ptr->job_id, step_p->step_id, temp);
+				char *temp = bitmap2node_name(nodes_busy);
+				info("job %u steps have nodes %s",
+				     job_ptr->job_id, temp);
 				xfree(temp);
 			}
+		} else {
+			nodes_idle = bit_alloc(bit_size(nodes_avail));
 		}
-		list_iterator_destroy (step_iterator);
 		bit_not(nodes_idle);
 		bit_and(nodes_idle, nodes_avail);
 	}
@@ -2598,6 +2698,7 @@ step_create(job_step_create_request_msg_t *step_specs,
 		step_alloc_lps(step_ptr);
 	} else
 		xfree(step_node_list);
+	_step_node_use_update(step_ptr, true);
 	if (checkpoint_alloc_jobinfo (&step_ptr->check_job) < 0)
 		fatal ("step_create: checkpoint_alloc_jobinfo error");
 	*new_step_record = step_ptr;
@@ -4071,6 +4172,7 @@ extern int load_step_state(struct job_record *job_ptr, Buf buffer,
 	step_ptr->cpu_freq_max = cpu_freq_max;
 	step_ptr->cpu_freq_gov = cpu_freq_gov;
 	step_ptr->state        = state;
+	step_node_use_reset(job_ptr);
 
 	step_ptr->start_protocol_ver = start_protocol_ver;
 
@@ -4522,6 +4624,8 @@ extern void rebuild_step_bitmaps(struct job_record *job_ptr,
 	if (job_ptr->step_list == NULL)
 		return;
 
+	/* Node use index offsets follow job_resrcs->node_bitmap */
+	step_node_use_reset(job_ptr);
 	step_iterator = list_iterator_create(job_ptr->step_list);
 	while ((step_ptr = (struct step_record *)
 			   list_next (step_iterator))) {
@@ -4626,6 +4730,7 @@ extern struct step_record *build_extern_step(struct job_record *job_ptr)
 	if (job_ptr->node_bitmap)
 		step_ptr->step_node_bitmap =
 			bit_copy(job_ptr->node_bitmap);
+	_step_node_use_update(step_ptr, true);
 	step_ptr->time_last_active = time(NULL);
 	step_set_alloc_tres(step_ptr, 1, false, false);
 
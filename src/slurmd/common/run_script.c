@@ -53,6 +53,8 @@
 #include "src/slurmd/common/job_container_plugin.h"
 #include "src/slurmd/common/run_script.h"
 
+static run_script_wait_f script_wait = waitpid_timeout;
+
 /*
  *  Same as waitpid(2) but kill process group for pid after timeout secs.
  *   Returns 0 for valid status in pstatus, -1 on failure of waitpid(2).
@@ -92,6 +94,11 @@ int waitpid_timeout (const char *name, pid_t pid, int *pstatus, int timeout)
 	return (0);
 }
 
+void run_script_set_wait(run_script_wait_f wait_func)
+{
+	script_wait = wait_func ? wait_func : waitpid_timeout;
+}
+
 /*
  * Run a prolog or epilog script (does NOT drop privileges)
  * name IN: class of program (prolog, epilog, etc.),
@@ -151,7 +158,7 @@ _run_one_script(const char *name, const char *path, uint32_t job_id,
 		exit(127);
 	}
 
-	if (waitpid_timeout(name, cpid, &status, max_wait) < 0)
+	if ((*script_wait)(name, cpid, &status, max_wait) < 0)
 		return (-1);
 	return status;
 }
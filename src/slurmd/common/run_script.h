@@ -54,6 +54,18 @@
  */
 int waitpid_timeout (const char *name, pid_t pid, int *pstatus, int timeout);
 
+/*
+ *  Function run_script() waits for each script with, see waitpid_timeout()
+ */
+typedef int (*run_script_wait_f) (const char *name, pid_t pid, int *pstatus,
+				  int timeout);
+
+/*
+ *  Have run_script() wait for scripts with wait_func rather than
+ *  waitpid_timeout(), NULL to restore waitpid_timeout().
+ */
+void run_script_set_wait(run_script_wait_f wait_func);
+
 /*
  * Run a prolog or epilog script (does NOT drop privileges)
  * name IN: class of program (prolog, epilog, etc.),
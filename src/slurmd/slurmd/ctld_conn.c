@@ -0,0 +1,353 @@
+/*****************************************************************************\
+ *  ctld_conn.c - persistent connection from slurmd to slurmctld
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <pthread.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/read_config.h"
+#include "src/common/slurm_persist_conn.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/slurmd/slurmd/ctld_conn.h"
+
+/* Seconds to wait after failing to open the connection before trying
+ * again, messages go over new connections meanwhile */
+#define CTLD_CONN_RETRY 60
+
+/* A thread waiting for slurmctld's response to the message it sent */
+typedef struct {
+	bool done;		/* resp is set or the connection was lost */
+	int rc;			/* SLURM_SUCCESS if resp is set */
+	slurm_msg_t *resp;	/* response, NULL to discard it */
+	uint32_t seq;		/* position of the message on the connection */
+} ctld_waiter_t;
+
+/* ctld_conn_lock protects everything below. It is held while a message is
+ * written but not while waiting for the response. slurmctld handles the
+ * messages of a connection one at a time, so responses come back in the
+ * order the messages were sent: the n-th response read belongs to the
+ * message sent with seq n. One waiting thread at a time reads the socket
+ * and hands each response to the thread waiting for it. */
+static slurm_persist_conn_t *ctld_conn = NULL;
+static pthread_mutex_t ctld_conn_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ctld_conn_cond = PTHREAD_COND_INITIALIZER;
+static List ctld_conn_waiters = NULL;	/* ctld_waiter_t, in seq order */
+static uint32_t ctld_conn_send_seq = 0;
+static uint32_t ctld_conn_recv_seq = 0;
+static bool ctld_conn_broken = false;	/* shut down, reader to close it */
+static bool ctld_conn_reading = false;
+static time_t ctld_conn_next_try = 0;
+static time_t ctld_conn_shutdown = 0;
+
+/* Open the connection to the primary controller, or to the backup when the
+ * primary can't be reached or is not in control.  A backup in standby mode
+ * refuses the connection.  Call with ctld_conn_lock held.
+ * RET true if the connection is open */
+static bool _ctld_conn_ready(void)
+{
+	slurm_ctl_conf_t *conf;
+	char *addr[2];
+	uint16_t port;
+	time_t now;
+	int i;
+
+	if (ctld_conn_broken)
+		return false;
+	if (ctld_conn && (ctld_conn->fd >= 0))
+		return true;
+
+	now = time(NULL);
+	if (now < ctld_conn_next_try)
+		return false;
+
+	if (!ctld_conn) {
+		ctld_conn = xmalloc(sizeof(slurm_persist_conn_t));
+		ctld_conn->cluster_name = slurm_get_cluster_name();
+		ctld_conn->fd = -1;
+		ctld_conn->flags = PERSIST_FLAG_SESSION;
+		ctld_conn->persist_type = PERSIST_TYPE_SLURMD;
+		ctld_conn->shutdown = &ctld_conn_shutdown;
+	}
+	ctld_conn->timeout = slurm_get_msg_timeout() * 1000;
+
+	conf = slurm_conf_lock();
+	addr[0] = xstrdup(conf->control_addr);
+	addr[1] = xstrdup(conf->backup_addr);
+	port = conf->slurmctld_port;
+	slurm_conf_unlock();
+
+	for (i = 0; i < 2; i++) {
+		if (!addr[i])
+			continue;
+		xfree(ctld_conn->rem_host);
+		ctld_conn->rem_host = addr[i];
+		addr[i] = NULL;
+		ctld_conn->rem_port = port;
+		/* The controller may have been upgraded since we last
+		 * negotiated, start over from the lowest version */
+		ctld_conn->version = 0;
+		if (slurm_persist_conn_open(ctld_conn) == SLURM_SUCCESS) {
+			debug("%s: connected to slurmctld at %s:%u",
+			      __func__, ctld_conn->rem_host, port);
+			break;
+		}
+	}
+	xfree(addr[0]);
+	xfree(addr[1]);
+
+	if (ctld_conn->fd >= 0) {
+		ctld_conn_send_seq = 0;
+		ctld_conn_recv_seq = 0;
+		return true;
+	}
+
+	ctld_conn_next_try = now + CTLD_CONN_RETRY;
+	return false;
+}
+
+/* Close the connection and fail every thread waiting for a response on it.
+ * If a thread is reading the socket just shut it down so the read returns,
+ * the reader closes the connection once it is back.
+ * Call with ctld_conn_lock held. */
+static void _ctld_conn_lost(void)
+{
+	ctld_waiter_t *waiter;
+
+	if (!ctld_conn || (ctld_conn->fd < 0))
+		return;
+
+	if (ctld_conn_reading) {
+		if (!ctld_conn_broken)
+			shutdown(ctld_conn->fd, SHUT_RDWR);
+		ctld_conn_broken = true;
+		return;
+	}
+
+	slurm_persist_conn_close(ctld_conn);
+	ctld_conn_broken = false;
+	while ((waiter = list_dequeue(ctld_conn_waiters))) {
+		waiter->rc = SLURM_ERROR;
+		waiter->done = true;
+	}
+	slurm_cond_broadcast(&ctld_conn_cond);
+}
+
+/* Read one response off the connection and hand it to the thread that sent
+ * the matching message. Called with ctld_conn_lock held, which is released
+ * while reading. */
+static void _ctld_conn_read_one(void)
+{
+	persist_msg_t persist_msg;
+	ctld_waiter_t *waiter;
+	Buf buffer;
+	int rc = SLURM_ERROR;
+
+	ctld_conn_reading = true;
+	slurm_mutex_unlock(&ctld_conn_lock);
+
+	memset(&persist_msg, 0, sizeof(persist_msg_t));
+	if ((buffer = slurm_persist_recv_msg(ctld_conn))) {
+		rc = slurm_persist_msg_unpack(ctld_conn, &persist_msg, buffer);
+		free_buf(buffer);
+	}
+
+	slurm_mutex_lock(&ctld_conn_lock);
+	ctld_conn_reading = false;
+
+	if ((rc != SLURM_SUCCESS) || ctld_conn_broken) {
+		if (rc == SLURM_SUCCESS)
+			slurm_free_msg_data(persist_msg.msg_type,
+					    persist_msg.data);
+		debug("%s: lost connection to slurmctld at %s:%u",
+		      __func__, ctld_conn->rem_host, ctld_conn->rem_port);
+		_ctld_conn_lost();
+		return;
+	}
+
+	waiter = list_peek(ctld_conn_waiters);
+	if (!waiter || (waiter->seq != ctld_conn_recv_seq)) {
+		/* Can't happen, responses only come for messages sent */
+		error("%s: unexpected %s from slurmctld", __func__,
+		      rpc_num2string(persist_msg.msg_type));
+		slurm_free_msg_data(persist_msg.msg_type, persist_msg.data);
+		_ctld_conn_lost();
+		return;
+	}
+	(void) list_dequeue(ctld_conn_waiters);
+	ctld_conn_recv_seq++;
+
+	if (waiter->resp) {
+		slurm_msg_t_init(waiter->resp);
+		waiter->resp->msg_type = persist_msg.msg_type;
+		waiter->resp->data = persist_msg.data;
+		waiter->resp->protocol_version = ctld_conn->version;
+	} else
+		slurm_free_msg_data(persist_msg.msg_type, persist_msg.data);
+	waiter->rc = SLURM_SUCCESS;
+	waiter->done = true;
+	slurm_cond_broadcast(&ctld_conn_cond);
+}
+
+/* Send req over the connection and wait for slurmctld's response.
+ * IN resp - set to the response, or NULL to discard it
+ * OUT sent - set if the message was written to the connection, in which
+ *	case it must not be sent again: slurmctld may have processed it even
+ *	if its response never arrived
+ * RET SLURM_SUCCESS or SLURM_ERROR */
+static int _ctld_conn_send_recv(slurm_msg_t *req, slurm_msg_t *resp,
+				bool *sent)
+{
+	persist_msg_t persist_msg;
+	ctld_waiter_t waiter;
+	Buf buffer;
+	int rc;
+
+	*sent = false;
+	slurm_mutex_lock(&ctld_conn_lock);
+	if (!_ctld_conn_ready()) {
+		slurm_mutex_unlock(&ctld_conn_lock);
+		return SLURM_ERROR;
+	}
+
+	memset(&persist_msg, 0, sizeof(persist_msg_t));
+	persist_msg.msg_type = req->msg_type;
+	persist_msg.data = req->data;
+
+	buffer = slurm_persist_msg_pack(ctld_conn, &persist_msg);
+	rc = slurm_persist_send_msg(ctld_conn, buffer);
+	free_buf(buffer);
+	if (rc != SLURM_SUCCESS) {
+		debug("%s: lost connection to slurmctld at %s:%u sending %s",
+		      __func__, ctld_conn->rem_host, ctld_conn->rem_port,
+		      rpc_num2string(req->msg_type));
+		_ctld_conn_lost();
+		slurm_mutex_unlock(&ctld_conn_lock);
+		return SLURM_ERROR;
+	}
+	*sent = true;
+
+	memset(&waiter, 0, sizeof(ctld_waiter_t));
+	waiter.resp = resp;
+	waiter.seq = ctld_conn_send_seq++;
+	if (!ctld_conn_waiters)
+		ctld_conn_waiters = list_create(NULL);
+	list_enqueue(ctld_conn_waiters, &waiter);
+
+	while (!waiter.done) {
+		if (ctld_conn_reading)
+			slurm_cond_wait(&ctld_conn_cond, &ctld_conn_lock);
+		else
+			_ctld_conn_read_one();
+	}
+	slurm_mutex_unlock(&ctld_conn_lock);
+
+	return waiter.rc;
+}
+
+extern int ctld_conn_send_recv_msg(slurm_msg_t *req, slurm_msg_t *resp)
+{
+	bool sent;
+
+	if (_ctld_conn_send_recv(req, resp, &sent) == SLURM_SUCCESS)
+		return 0;
+
+	if (sent) {
+		slurm_seterrno(SLURM_COMMUNICATIONS_RECEIVE_ERROR);
+		return -1;
+	}
+
+	return slurm_send_recv_controller_msg(req, resp);
+}
+
+extern int ctld_conn_send_recv_rc_msg(slurm_msg_t *req, int *rc)
+{
+	slurm_msg_t resp;
+
+	if (ctld_conn_send_recv_msg(req, &resp) < 0)
+		return -1;
+
+	/* Sent in place of the response if slurmctld could not read
+	 * the message off the persistent connection */
+	if (resp.msg_type == PERSIST_RC)
+		*rc = ((persist_rc_msg_t *) resp.data)->rc;
+	else
+		*rc = slurm_get_return_code(resp.msg_type, resp.data);
+	slurm_free_msg_data(resp.msg_type, resp.data);
+
+	return 0;
+}
+
+extern int ctld_conn_send_only_msg(slurm_msg_t *req)
+{
+	bool sent;
+
+	if (_ctld_conn_send_recv(req, NULL, &sent) == SLURM_SUCCESS)
+		return 0;
+
+	/* Written as slurm_send_only_controller_msg() would have, only
+	 * the acknowledgement was lost */
+	if (sent)
+		return 0;
+
+	return slurm_send_only_controller_msg(req);
+}
+
+extern void ctld_conn_close(void)
+{
+	slurm_mutex_lock(&ctld_conn_lock);
+	_ctld_conn_lost();
+	ctld_conn_next_try = 0;
+	slurm_mutex_unlock(&ctld_conn_lock);
+}
+
+extern void ctld_conn_fini(void)
+{
+	slurm_mutex_lock(&ctld_conn_lock);
+	ctld_conn_shutdown = time(NULL);
+	_ctld_conn_lost();
+	/* The reader closes the connection and fails the waiters */
+	while (ctld_conn_reading ||
+	       (ctld_conn_waiters && list_count(ctld_conn_waiters)))
+		slurm_cond_wait(&ctld_conn_cond, &ctld_conn_lock);
+	slurm_persist_conn_destroy(ctld_conn);
+	ctld_conn = NULL;
+	FREE_NULL_LIST(ctld_conn_waiters);
+	slurm_mutex_unlock(&ctld_conn_lock);
+}
@@ -0,0 +1,80 @@
+/*****************************************************************************\
+ *  ctld_conn.h - persistent connection from slurmd to slurmctld
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMD_CTLD_CONN_H
+#define _SLURMD_CTLD_CONN_H
+
+#include "src/common/slurm_protocol_defs.h"
+
+/*
+ * Send a message to slurmctld over slurmd's persistent connection and
+ * return its response, opening the connection to the primary or backup
+ * controller as needed. When no connection can be had the message goes over
+ * a new connection as slurm_send_recv_controller_msg() would send it.
+ * Other threads may send over the connection while this one waits for
+ * its response. A message that was written before the connection was lost
+ * is not sent again since slurmctld may already have processed it, this
+ * fails with errno set to SLURM_COMMUNICATIONS_RECEIVE_ERROR instead.
+ * IN req - message to send
+ * OUT resp - response, free its data with slurm_free_msg_data()
+ * RET 0 on success, -1 on failure, see errno for details
+ */
+extern int ctld_conn_send_recv_msg(slurm_msg_t *req, slurm_msg_t *resp);
+
+/*
+ * As ctld_conn_send_recv_msg(), returning only the response's return code
+ * OUT rc - return code from slurmctld
+ * RET 0 on success, -1 on failure
+ */
+extern int ctld_conn_send_recv_rc_msg(slurm_msg_t *req, int *rc);
+
+/*
+ * Send a message to slurmctld for which it has no response. Over the
+ * persistent connection slurmctld still acknowledges it, which is waited
+ * for and discarded, otherwise as slurm_send_only_controller_msg(). Once
+ * written the message counts as sent even if the acknowledgement is lost.
+ * IN req - message to send
+ * RET 0 on success, -1 on failure
+ */
+extern int ctld_conn_send_only_msg(slurm_msg_t *req);
+
+/*
+ * Close the connection, the next message opens it again. Called when the
+ * controller addresses may have changed.
+ */
+extern void ctld_conn_close(void);
+
+/* Close the connection and free its memory */
+extern void ctld_conn_fini(void);
+
+#endif /* _SLURMD_CTLD_CONN_H */
@@ -0,0 +1,491 @@
+/*****************************************************************************\
+ *  job_script.c - running of job prologs and epilogs by slurmd
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "slurm/slurm.h"
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurm_protocol_defs.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/slurmd/common/run_script.h"
+#include "src/slurmd/slurmd/ctld_conn.h"
+#include "src/slurmd/slurmd/job_script.h"
+#include "src/slurmd/slurmd/slurmd.h"
+
+/*
+ * Prologs and epilogs are run by the threads of the RPCs launching and
+ * terminating jobs. Here they take turns to run when
+ * LaunchParameters=max_job_scripts limits how many run at once, and a
+ * single timer thread kills those running past PrologEpilogTimeout rather
+ * than each thread polling its script. Epilog complete messages are queued
+ * to one sender thread, which sends those queued while it was busy together.
+ */
+
+#define EPILOG_MSG_BATCH_MAX	128	/* most messages sent at once */
+
+typedef struct job_script_timer {
+	uint32_t id;
+	struct timespec when;
+	void (*func) (void *arg);
+	void *arg;
+	struct job_script_timer *next;
+} job_script_timer_t;
+
+typedef struct {
+	char *name;
+	pid_t pid;
+	int timeout;
+} script_kill_t;
+
+/* Prologs and epilogs running and waiting to run */
+static pthread_mutex_t script_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t script_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t script_max = 0;
+static uint32_t script_running = 0;
+static uint32_t script_ticket = 0;	/* tickets handed out */
+static uint32_t script_serving = 0;	/* tickets allowed to run */
+static uint32_t script_timeouts = 0;
+static uint32_t script_wait_cnt = 0;
+static uint32_t script_wait_max = 0;
+static uint64_t script_wait_sum = 0;
+static uint32_t script_hist[2][SLURMD_SCRIPT_HIST_CNT];
+
+/* Timers, sorted by expiration */
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_cond = PTHREAD_COND_INITIALIZER;
+static job_script_timer_t *timer_list = NULL;
+static uint32_t timer_next_id = 1;
+static uint32_t timer_running_id = 0;
+static pthread_t timer_thread = 0;
+static bool timer_shutdown = false;
+
+/* Epilog complete messages waiting to be sent */
+static pthread_mutex_t epilog_msg_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t epilog_msg_cond = PTHREAD_COND_INITIALIZER;
+static List epilog_msg_list = NULL;
+static pthread_t epilog_msg_thread = 0;
+static bool epilog_msg_shutdown = false;
+static uint32_t epilog_msg_cnt = 0;
+static uint32_t epilog_msg_batches = 0;
+
+static long _delta_usec(struct timeval *begin, struct timeval *end)
+{
+	return ((end->tv_sec - begin->tv_sec) * 1000000) +
+	       (end->tv_usec - begin->tv_usec);
+}
+
+static void *_timer_thread(void *arg)
+{
+	job_script_timer_t *timer;
+	struct timespec now;
+
+	slurm_mutex_lock(&timer_lock);
+	while (!timer_shutdown) {
+		if (!timer_list) {
+			slurm_cond_wait(&timer_cond, &timer_lock);
+			continue;
+		}
+		clock_gettime(CLOCK_REALTIME, &now);
+		timer = timer_list;
+		if ((timer->when.tv_sec > now.tv_sec) ||
+		    ((timer->when.tv_sec == now.tv_sec) &&
+		     (timer->when.tv_nsec > now.tv_nsec))) {
+			slurm_cond_timedwait(&timer_cond, &timer_lock,
+					     &timer->when);
+			continue;
+		}
+		timer_list = timer->next;
+		timer_running_id = timer->id;
+		slurm_mutex_unlock(&timer_lock);
+
+		(timer->func)(timer->arg);
+		xfree(timer);
+
+		slurm_mutex_lock(&timer_lock);
+		timer_running_id = 0;
+		slurm_cond_broadcast(&timer_cond);
+	}
+	slurm_mutex_unlock(&timer_lock);
+
+	return NULL;
+}
+
+extern uint32_t job_script_timer_add(int delay, void (*func) (void *arg),
+				     void *arg)
+{
+	job_script_timer_t *timer, **timer_pptr;
+	uint32_t id;
+
+	timer = xmalloc(sizeof(job_script_timer_t));
+	clock_gettime(CLOCK_REALTIME, &timer->when);
+	timer->when.tv_sec += delay;
+	timer->func = func;
+	timer->arg = arg;
+
+	slurm_mutex_lock(&timer_lock);
+	id = timer->id = timer_next_id++;
+	if (timer_next_id == 0)
+		timer_next_id = 1;
+	for (timer_pptr = &timer_list; *timer_pptr;
+	     timer_pptr = &(*timer_pptr)->next) {
+		if ((*timer_pptr)->when.tv_sec > timer->when.tv_sec)
+			break;
+	}
+	timer->next = *timer_pptr;
+	*timer_pptr = timer;
+	if (timer_list == timer)
+		slurm_cond_broadcast(&timer_cond);
+	slurm_mutex_unlock(&timer_lock);
+
+	return id;
+}
+
+extern void job_script_timer_cancel(uint32_t id)
+{
+	job_script_timer_t *timer, **timer_pptr;
+
+	slurm_mutex_lock(&timer_lock);
+	for (timer_pptr = &timer_list; (timer = *timer_pptr);
+	     timer_pptr = &timer->next) {
+		if (timer->id == id) {
+			*timer_pptr = timer->next;
+			xfree(timer);
+			break;
+		}
+	}
+	while (timer_running_id == id)
+		slurm_cond_wait(&timer_cond, &timer_lock);
+	slurm_mutex_unlock(&timer_lock);
+}
+
+static void _script_kill(void *arg)
+{
+	script_kill_t *kill_arg = arg;
+
+	info("%s%stimeout after %ds: killing pgid %d",
+	     kill_arg->name ? kill_arg->name : "",
+	     kill_arg->name ? ": " : "",
+	     kill_arg->timeout, kill_arg->pid);
+	killpg(kill_arg->pid, SIGKILL);
+
+	slurm_mutex_lock(&script_lock);
+	script_timeouts++;
+	slurm_mutex_unlock(&script_lock);
+}
+
+extern int job_script_wait(const char *name, pid_t pid, int *pstatus,
+			   int timeout)
+{
+	script_kill_t kill_arg;
+	uint32_t timer_id = 0;
+	siginfo_t info;
+	int rc;
+
+	if (timeout > 0) {
+		kill_arg.name = (char *) name;
+		kill_arg.pid = pid;
+		kill_arg.timeout = timeout;
+		timer_id = job_script_timer_add(timeout, _script_kill,
+						&kill_arg);
+	}
+
+	/* Wait without reaping, so the process group can't be reused by the
+	 * time the timer is cancelled */
+	memset(&info, 0, sizeof(siginfo_t));
+	while ((rc = waitid(P_PID, pid, &info, WEXITED | WNOWAIT)) < 0) {
+		if (errno != EINTR)
+			break;
+	}
+	if (timer_id)
+		job_script_timer_cancel(timer_id);
+	if (rc < 0) {
+		error("waitid: %m");
+		return -1;
+	}
+
+	while ((rc = waitpid(pid, pstatus, 0)) < 0) {
+		if (errno == EINTR)
+			continue;
+		error("waitpid: %m");
+		return -1;
+	}
+
+	killpg(pid, SIGKILL);  /* kill children too */
+	return 0;
+}
+
+extern void job_script_start(job_script_t *script, int type)
+{
+	uint32_t ticket;
+	long usec;
+
+	script->type = type;
+	gettimeofday(&script->queued, NULL);
+
+	slurm_mutex_lock(&script_lock);
+	ticket = script_ticket++;
+	while ((ticket != script_serving) ||
+	       (script_max && (script_running >= script_max)))
+		slurm_cond_wait(&script_cond, &script_lock);
+	script_serving++;
+	script_running++;
+	gettimeofday(&script->started, NULL);
+	usec = _delta_usec(&script->queued, &script->started);
+	script_wait_cnt++;
+	script_wait_sum += usec;
+	script_wait_max = MAX(script_wait_max, usec);
+	/* The next in line may be able to run too */
+	slurm_cond_broadcast(&script_cond);
+	slurm_mutex_unlock(&script_lock);
+}
+
+extern void job_script_done(job_script_t *script)
+{
+	struct timeval now;
+	long usec, bound = 10000;
+	int i;
+
+	gettimeofday(&now, NULL);
+	usec = _delta_usec(&script->started, &now);
+	for (i = 0; i < (SLURMD_SCRIPT_HIST_CNT - 1); i++, bound *= 10) {
+		if (usec < bound)
+			break;
+	}
+
+	slurm_mutex_lock(&script_lock);
+	script_running--;
+	script_hist[script->type][i]++;
+	slurm_cond_broadcast(&script_cond);
+	slurm_mutex_unlock(&script_lock);
+}
+
+extern void job_script_reconfig(uint32_t max_running)
+{
+	slurm_mutex_lock(&script_lock);
+	script_max = max_running;
+	slurm_cond_broadcast(&script_cond);
+	slurm_mutex_unlock(&script_lock);
+}
+
+static slurm_msg_t *_epilog_msg_create(uint32_t job_id, int rc)
+{
+	slurm_msg_t *msg = xmalloc(sizeof(slurm_msg_t));
+	epilog_complete_msg_t *req = xmalloc(sizeof(epilog_complete_msg_t));
+
+	req->job_id      = job_id;
+	req->return_code = rc;
+	req->node_name   = xstrdup(conf->node_name);
+
+	slurm_msg_t_init(msg);
+	msg->msg_type    = MESSAGE_EPILOG_COMPLETE;
+	msg->data        = req;
+
+	return msg;
+}
+
+/* Send one epilog complete message, or several as a MESSAGE_COMPOSITE
+ * Note: No return code to message, slurmctld will resend TERMINATE_JOB
+ * request if message send fails */
+static void _epilog_msg_send(List msg_list)
+{
+	slurm_msg_t msg, *epilog_msg;
+	composite_msg_t comp;
+	int msg_cnt = list_count(msg_list);
+
+	if (msg_cnt == 1) {
+		epilog_msg = list_peek(msg_list);
+		memcpy(&msg, epilog_msg, sizeof(slurm_msg_t));
+	} else {
+		memset(&comp, 0, sizeof(composite_msg_t));
+		slurm_set_addr(&comp.sender, conf->port, conf->hostname);
+		comp.msg_list = msg_list;
+		slurm_msg_t_init(&msg);
+		msg.msg_type = MESSAGE_COMPOSITE;
+		msg.protocol_version = SLURM_PROTOCOL_VERSION;
+		msg.data = &comp;
+	}
+
+	if (ctld_conn_send_only_msg(&msg) < 0) {
+		error("Unable to send %d epilog complete message(s): %m",
+		      msg_cnt);
+	} else {
+		debug("sent %d epilog complete message(s)", msg_cnt);
+	}
+
+	slurm_mutex_lock(&epilog_msg_lock);
+	epilog_msg_cnt += msg_cnt;
+	epilog_msg_batches++;
+	slurm_mutex_unlock(&epilog_msg_lock);
+}
+
+static void *_epilog_msg_thread(void *arg)
+{
+	List send_list;
+	slurm_msg_t *msg;
+
+	slurm_mutex_lock(&epilog_msg_lock);
+	while (1) {
+		if (!list_count(epilog_msg_list)) {
+			if (epilog_msg_shutdown)
+				break;
+			slurm_cond_wait(&epilog_msg_cond, &epilog_msg_lock);
+			continue;
+		}
+		send_list = list_create(slurm_free_comp_msg_list);
+		while ((list_count(send_list) < EPILOG_MSG_BATCH_MAX) &&
+		       (msg = list_dequeue(epilog_msg_list)))
+			list_append(send_list, msg);
+		slurm_mutex_unlock(&epilog_msg_lock);
+
+		_epilog_msg_send(send_list);
+		FREE_NULL_LIST(send_list);
+
+		slurm_mutex_lock(&epilog_msg_lock);
+	}
+	slurm_mutex_unlock(&epilog_msg_lock);
+
+	return NULL;
+}
+
+extern void job_script_epilog_complete(uint32_t job_id, int rc)
+{
+	slurm_msg_t *msg = _epilog_msg_create(job_id, rc);
+
+	slurm_mutex_lock(&epilog_msg_lock);
+	if (!epilog_msg_thread) {
+		/* Not running, send it ourselves */
+		List send_list = list_create(slurm_free_comp_msg_list);
+		slurm_mutex_unlock(&epilog_msg_lock);
+		list_append(send_list, msg);
+		_epilog_msg_send(send_list);
+		FREE_NULL_LIST(send_list);
+		return;
+	}
+	list_enqueue(epilog_msg_list, msg);
+	slurm_cond_signal(&epilog_msg_cond);
+	slurm_mutex_unlock(&epilog_msg_lock);
+}
+
+extern void job_script_init(void)
+{
+	pthread_attr_t attr;
+
+	run_script_set_wait(job_script_wait);
+
+	slurm_mutex_lock(&timer_lock);
+	timer_shutdown = false;
+	slurm_attr_init(&attr);
+	if (pthread_create(&timer_thread, &attr, _timer_thread, NULL))
+		fatal("%s: pthread_create: %m", __func__);
+	slurm_attr_destroy(&attr);
+	slurm_mutex_unlock(&timer_lock);
+
+	slurm_mutex_lock(&epilog_msg_lock);
+	epilog_msg_shutdown = false;
+	if (!epilog_msg_list)
+		epilog_msg_list = list_create(slurm_free_comp_msg_list);
+	slurm_attr_init(&attr);
+	if (pthread_create(&epilog_msg_thread, &attr, _epilog_msg_thread,
+			   NULL))
+		fatal("%s: pthread_create: %m", __func__);
+	slurm_attr_destroy(&attr);
+	slurm_mutex_unlock(&epilog_msg_lock);
+}
+
+extern void job_script_fini(void)
+{
+	job_script_timer_t *timer;
+	pthread_t thread_id;
+
+	slurm_mutex_lock(&epilog_msg_lock);
+	epilog_msg_shutdown = true;
+	thread_id = epilog_msg_thread;
+	slurm_cond_broadcast(&epilog_msg_cond);
+	slurm_mutex_unlock(&epilog_msg_lock);
+	if (thread_id)
+		pthread_join(thread_id, NULL);
+	slurm_mutex_lock(&epilog_msg_lock);
+	epilog_msg_thread = 0;
+	FREE_NULL_LIST(epilog_msg_list);
+	slurm_mutex_unlock(&epilog_msg_lock);
+
+	run_script_set_wait(NULL);
+
+	slurm_mutex_lock(&timer_lock);
+	timer_shutdown = true;
+	thread_id = timer_thread;
+	slurm_cond_broadcast(&timer_cond);
+	slurm_mutex_unlock(&timer_lock);
+	if (thread_id)
+		pthread_join(thread_id, NULL);
+	slurm_mutex_lock(&timer_lock);
+	timer_thread = 0;
+	while ((timer = timer_list)) {
+		timer_list = timer->next;
+		xfree(timer);
+	}
+	slurm_mutex_unlock(&timer_lock);
+}
+
+extern void job_script_get_stats(slurmd_status_t *resp)
+{
+	slurm_mutex_lock(&script_lock);
+	resp->job_script_max      = script_max;
+	resp->job_script_running  = script_running;
+	resp->job_script_queued   = script_ticket - script_serving;
+	resp->job_script_timeouts = script_timeouts;
+	resp->job_script_wait_max = script_wait_max;
+	if (script_wait_cnt)
+		resp->job_script_wait_mean = script_wait_sum / script_wait_cnt;
+	memcpy(resp->prolog_hist, script_hist[JOB_SCRIPT_PROLOG],
+	       sizeof(resp->prolog_hist));
+	memcpy(resp->epilog_hist, script_hist[JOB_SCRIPT_EPILOG],
+	       sizeof(resp->epilog_hist));
+	slurm_mutex_unlock(&script_lock);
+
+	slurm_mutex_lock(&epilog_msg_lock);
+	resp->epilog_msg_cnt     = epilog_msg_cnt;
+	resp->epilog_msg_batches = epilog_msg_batches;
+	slurm_mutex_unlock(&epilog_msg_lock);
+}
@@ -0,0 +1,113 @@
+/*****************************************************************************\
+ *  job_script.h - running of job prologs and epilogs by slurmd
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMD_JOB_SCRIPT_H
+#define _SLURMD_JOB_SCRIPT_H
+
+#include <inttypes.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+#include "slurm/slurm.h"
+
+#define JOB_SCRIPT_PROLOG	0
+#define JOB_SCRIPT_EPILOG	1
+
+/* A prolog or epilog, from job_script_start() to job_script_done() */
+typedef struct {
+	int type;		/* JOB_SCRIPT_* */
+	struct timeval queued;	/* when job_script_start() was called */
+	struct timeval started;	/* when it returned */
+} job_script_t;
+
+/*
+ * Start the threads timing out scripts and sending epilog complete
+ * messages. Scripts run by run_script() are then waited for by
+ * job_script_wait().
+ */
+extern void job_script_init(void);
+
+/* Stop those threads, sending any epilog complete messages still queued */
+extern void job_script_fini(void);
+
+/*
+ * Set how many prologs and epilogs may run at once, from
+ * LaunchParameters=max_job_scripts=#
+ * IN max_running - limit, 0 for none
+ */
+extern void job_script_reconfig(uint32_t max_running);
+
+/*
+ * Wait until another prolog or epilog may run, in the order they asked.
+ * Call job_script_done() once it has run.
+ * OUT script - filled in
+ * IN type - JOB_SCRIPT_PROLOG or JOB_SCRIPT_EPILOG
+ */
+extern void job_script_start(job_script_t *script, int type);
+
+/* Let the next prolog or epilog run and record how long this one took */
+extern void job_script_done(job_script_t *script);
+
+/*
+ * As waitpid_timeout(), but rather than polling the child the timeout is
+ * left to the timer thread, so the script is noticed as soon as it exits.
+ * RET 0 with the child's status in pstatus, -1 on failure of waitpid(2)
+ */
+extern int job_script_wait(const char *name, pid_t pid, int *pstatus,
+			   int timeout);
+
+/*
+ * Have the timer thread call func(arg) in delay seconds. It is called
+ * without locks held, other timers wait while it runs, so func must not
+ * block: leave messages to slurmctld and the like to another thread.
+ * RET id for job_script_timer_cancel()
+ */
+extern uint32_t job_script_timer_add(int delay, void (*func) (void *arg),
+				     void *arg);
+
+/*
+ * Cancel a timer if it has not expired. If its function is running, wait
+ * for it to return, so arg may be freed once this returns.
+ */
+extern void job_script_timer_cancel(uint32_t id);
+
+/*
+ * Queue a MESSAGE_EPILOG_COMPLETE for slurmctld. Messages queued while
+ * earlier ones are being sent go together in one MESSAGE_COMPOSITE.
+ */
+extern void job_script_epilog_complete(uint32_t job_id, int rc);
+
+/* Fill in the job script statistics of a slurmd status response */
+extern void job_script_get_stats(slurmd_status_t *resp);
+
+#endif /* _SLURMD_JOB_SCRIPT_H */
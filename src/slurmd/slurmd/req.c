@@ -55,6 +55,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/param.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/un.h>
@@ -70,6 +71,7 @@
 #include "src/common/forward.h"
 #include "src/common/gres.h"
 #include "src/common/hostlist.h"
+#include "src/common/id_cache.h"
 #include "src/common/list.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
@@ -78,7 +80,6 @@
 #include "src/common/node_select.h"
 #include "src/common/plugstack.h"
 #include "src/common/read_config.h"
-#include "src/common/siphash.h"
 #include "src/common/slurm_auth.h"
 #include "src/common/slurm_cred.h"
 #include "src/common/slurm_acct_gather_energy.h"
@@ -94,8 +95,11 @@
 
 #include "src/bcast/file_bcast.h"
 
+#include "src/slurmd/slurmd/ctld_conn.h"
 #include "src/slurmd/slurmd/get_mach_stat.h"
+#include "src/slurmd/slurmd/job_script.h"
 #include "src/slurmd/slurmd/slurmd.h"
+#include "src/slurmd/slurmd/step_registry.h"
 
 #include "src/slurmd/common/job_container_plugin.h"
 #include "src/slurmd/common/proctrack.h"
@@ -118,11 +122,6 @@
 #define MAX_CPU_CNT 1024
 #define MAX_NUMA_CNT 128
 
-typedef struct {
-	int ngids;
-	gid_t *gids;
-} gids_t;
-
 typedef struct {
 	uint32_t job_id;
 	uint32_t step_id;
@@ -135,14 +134,6 @@ typedef struct {
 	uint32_t step_id;
 } starting_step_t;
 
-typedef struct {
-	uint32_t job_id;
-	uint16_t msg_timeout;
-	bool *prolog_fini;
-	pthread_cond_t *timer_cond;
-	pthread_mutex_t *timer_mutex;
-} timer_struct_t;
-
 typedef struct {
 	uint32_t jobid;
 	uint32_t step_id;
@@ -179,6 +170,7 @@ static int  _terminate_all_steps(uint32_t jobid, bool batch);
 static void _rpc_launch_tasks(slurm_msg_t *);
 static void _rpc_abort_job(slurm_msg_t *);
 static void _rpc_batch_job(slurm_msg_t *msg, bool new_msg);
+static void _rpc_batch_job_multi(slurm_msg_t *msg);
 static void _rpc_prolog(slurm_msg_t *msg);
 static void _rpc_job_notify(slurm_msg_t *);
 static void _rpc_signal_tasks(slurm_msg_t *);
@@ -200,6 +192,7 @@ static void _file_bcast_cleanup(void);
 static int  _file_bcast_register_file(slurm_msg_t *msg,
 				      file_bcast_info_t *key);
 static int  _rpc_ping(slurm_msg_t *);
+static void _rpc_node_registration(slurm_msg_t *);
 static int  _rpc_health_check(slurm_msg_t *);
 static int  _rpc_acct_gather_update(slurm_msg_t *);
 static int  _rpc_acct_gather_energy(slurm_msg_t *);
@@ -212,7 +205,6 @@ static int  _run_epilog(job_env_t *job_env);
 static int  _run_prolog(job_env_t *job_env, slurm_cred_t *cred);
 static void _rpc_forward_data(slurm_msg_t *msg);
 static int  _rpc_network_callerid(slurm_msg_t *msg);
-static void _dealloc_gids(gids_t *p);
 
 
 static bool _pause_for_job_completion(uint32_t jobid, char *nodes,
@@ -228,9 +220,8 @@ static int  _valid_sbcast_cred(file_bcast_msg_t *req, uid_t req_uid,
 static void _wait_state_completed(uint32_t jobid, int max_delay);
 static uid_t _get_job_uid(uint32_t jobid);
 
-static gids_t *_gids_cache_lookup(char *user, gid_t gid);
-
 static int  _add_starting_step(uint16_t type, void *req);
+static void _register_step(uint16_t type, void *req);
 static int  _remove_starting_step(uint16_t type, void *req);
 static int  _compare_starting_steps(void *s0, void *s1);
 static int  _wait_for_starting_step(uint32_t job_id, uint32_t step_id);
@@ -278,6 +269,29 @@ static uint32_t active_job_id[JOB_STATE_CNT];
 static pthread_mutex_t prolog_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 #define FILE_BCAST_TIMEOUT 300
+
+/* Changes in load smaller than these are not returned in ping replies:
+ * CPU load * 100 and percent of free memory */
+#define PING_LOAD_DELTA	10
+#define PING_MEM_DELTA	1
+static pthread_mutex_t ping_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Latency of the last STEPD_LAUNCH_SAMPLES slurmstepd launches, from fork
+ * to the slurmstepd listening on its socket, in usec */
+#define STEPD_LAUNCH_SAMPLES 1024
+static pthread_mutex_t stepd_launch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t stepd_launch_usec[STEPD_LAUNCH_SAMPLES];
+static uint32_t stepd_launch_cnt = 0;
+static uint32_t stepd_launch_zygote = 0;
+
+/* Socket to the slurmstepd zygote of LaunchParameters=slurmstepd_zygote */
+#define STEPD_ZYGOTE_RETRY	60	/* seconds before restarting a zygote
+					 * that failed to start */
+#define STEPD_ZYGOTE_TIMEOUT	60	/* seconds for it to get ready */
+static pthread_mutex_t stepd_zygote_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int stepd_zygote_fd = -1;
+static time_t stepd_zygote_next_try = 0;
+
 static pthread_mutex_t file_bcast_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  file_bcast_cond  = PTHREAD_COND_INITIALIZER;
 static int fb_read_lock = 0, fb_write_wait_lock = 0, fb_write_lock = 0;
@@ -315,6 +329,11 @@ slurmd_req(slurm_msg_t *msg)
 		_rpc_batch_job(msg, true);
 		last_slurmctld_msg = time(NULL);
 		break;
+	case REQUEST_BATCH_JOB_LAUNCH_MULTI:
+		debug2("Processing RPC: REQUEST_BATCH_JOB_LAUNCH_MULTI");
+		_rpc_batch_job_multi(msg);
+		last_slurmctld_msg = time(NULL);
+		break;
 	case REQUEST_LAUNCH_TASKS:
 		debug2("Processing RPC: REQUEST_LAUNCH_TASKS");
 		slurm_mutex_lock(&launch_mutex);
@@ -390,6 +409,13 @@ slurmd_req(slurm_msg_t *msg)
 		break;
 	case REQUEST_NODE_REGISTRATION_STATUS:
 		debug2("Processing RPC: REQUEST_NODE_REGISTRATION_STATUS");
+		if (msg->protocol_version >= SLURM_17_02_PROTOCOL_VERSION) {
+			/* Reply with the registration itself, which returns
+			 * to slurmctld through the forwarding tree */
+			_rpc_node_registration(msg);
+			last_slurmctld_msg = time(NULL);
+			break;
+		}
 		/* Treat as ping (for slurmctld agent, just return SUCCESS) */
 		rc = _rpc_ping(msg);
 		last_slurmctld_msg = time(NULL);
@@ -492,7 +518,8 @@ _send_slurmstepd_init(int fd, int type, void *req,
 	slurm_msg_t msg;
 	uid_t uid = (uid_t)-1;
 	gid_t gid = (uid_t)-1;
-	gids_t *gids = NULL;
+	gid_t *gids = NULL;
+	int ngids;
 
 	int rank, proto;
 	int parent_rank, children, depth, max_depth;
@@ -692,7 +719,7 @@ _send_slurmstepd_init(int fd, int type, void *req,
 	}
 #endif
 	if (!user_name) {
-		/* Sanity check since gids_cache_lookup will fail
+		/* Sanity check since id_cache_user_gids will fail
 		 * with a NULL. */
 		error("%s: No user name for %d: %m", __func__, uid);
 		len = 0;
@@ -701,15 +728,15 @@ _send_slurmstepd_init(int fd, int type, void *req,
 		return errno;
 	}
 
-	if ((gids = _gids_cache_lookup(user_name, gid))) {
+	if ((ngids = id_cache_user_gids(user_name, gid, &gids))) {
 		int i;
 		uint32_t tmp32;
-		safe_write(fd, &gids->ngids, sizeof(int));
-		for (i = 0; i < gids->ngids; i++) {
-			tmp32 = (uint32_t)gids->gids[i];
+		safe_write(fd, &ngids, sizeof(int));
+		for (i = 0; i < ngids; i++) {
+			tmp32 = (uint32_t)gids[i];
 			safe_write(fd, &tmp32, sizeof(uint32_t));
 		}
-		_dealloc_gids(gids);
+		xfree(gids);
 	} else {
 		len = 0;
 		safe_write(fd, &len, sizeof(int));
@@ -724,6 +751,201 @@ rwfail:
 }
 
 
+/* Note a slurmstepd that started in usec */
+static void
+_stepd_launch_record(long usec, bool from_zygote)
+{
+	slurm_mutex_lock(&stepd_launch_mutex);
+	stepd_launch_usec[stepd_launch_cnt % STEPD_LAUNCH_SAMPLES] =
+		(uint32_t) MIN(usec, INFINITE - 1);
+	stepd_launch_cnt++;
+	if (from_zygote)
+		stepd_launch_zygote++;
+	slurm_mutex_unlock(&stepd_launch_mutex);
+}
+
+static int _cmp_uint32(const void *a, const void *b)
+{
+	uint32_t x = *(uint32_t *) a, y = *(uint32_t *) b;
+
+	if (x < y)
+		return -1;
+	return (x > y);
+}
+
+/* Fill in the slurmstepd launch counts and latency percentiles */
+static void
+_stepd_launch_stats(slurmd_status_t *resp)
+{
+	uint32_t sorted[STEPD_LAUNCH_SAMPLES];
+	int cnt;
+
+	slurm_mutex_lock(&stepd_launch_mutex);
+	resp->stepd_launch_cnt = stepd_launch_cnt;
+	resp->stepd_launch_zygote = stepd_launch_zygote;
+	cnt = MIN(stepd_launch_cnt, STEPD_LAUNCH_SAMPLES);
+	memcpy(sorted, stepd_launch_usec, cnt * sizeof(uint32_t));
+	slurm_mutex_unlock(&stepd_launch_mutex);
+
+	if (cnt == 0)
+		return;
+	qsort(sorted, cnt, sizeof(uint32_t), _cmp_uint32);
+	resp->stepd_launch_p50 = sorted[((cnt - 1) * 50) / 100];
+	resp->stepd_launch_p90 = sorted[((cnt - 1) * 90) / 100];
+	resp->stepd_launch_p99 = sorted[((cnt - 1) * 99) / 100];
+}
+
+/* Pass the pipes of a new step to the zygote, which forks its slurmstepd.
+ * Call with stepd_zygote_mutex held. */
+static int
+_zygote_send_pipes(int to_stepd, int to_slurmd)
+{
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	struct iovec iov;
+	char buf[CMSG_SPACE(2 * sizeof(int))];
+	char c = 0;
+	int fds[2] = { to_stepd, to_slurmd };
+
+	memset(&msg, 0, sizeof(msg));
+	memset(buf, 0, sizeof(buf));
+	iov.iov_base = &c;
+	iov.iov_len = sizeof(c);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = buf;
+	msg.msg_controllen = sizeof(buf);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	while (sendmsg(stepd_zygote_fd, &msg, MSG_NOSIGNAL) < 0) {
+		if (errno != EINTR) {
+			error("%s: sendmsg: %m", __func__);
+			return SLURM_ERROR;
+		}
+	}
+	return SLURM_SUCCESS;
+}
+
+/* Start a slurmstepd zygote, orphaned like the slurmstepd of a step, and
+ * wait for it to load its plugins. Call with stepd_zygote_mutex held. */
+static int
+_zygote_start(void)
+{
+	char *const argv[3] = { (char *)conf->stepd_loc, "zygote", NULL };
+	struct pollfd pfd;
+	int sv[2], i, rc = SLURM_FAILURE;
+	pid_t pid;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+		error("%s: socketpair: %m", __func__);
+		return SLURM_ERROR;
+	}
+	fd_set_close_on_exec(sv[0]);
+
+	if ((pid = fork()) < 0) {
+		error("%s: fork: %m", __func__);
+		close(sv[0]);
+		close(sv[1]);
+		return SLURM_ERROR;
+	} else if (pid == 0) {
+		setenv("SLURM_CONF", conf->conffile, 1);
+		if (setsid() < 0)
+			error("%s: setsid: %m", __func__);
+		if ((pid = fork()) < 0)
+			exit(1);
+		else if (pid > 0)
+			exit(0);
+
+		for (i = 3; i < 256; i++)
+			(void) fcntl(i, F_SETFD, FD_CLOEXEC);
+		if ((dup2(sv[1], STDIN_FILENO) == -1)  ||
+		    (dup2(devnull, STDOUT_FILENO) == -1) ||
+		    (dup2(devnull, STDERR_FILENO) == -1)) {
+			error("%s: dup2: %m", __func__);
+			exit(1);
+		}
+		log_fini();
+		execvp(argv[0], argv);
+		exit(2);
+	}
+
+	close(sv[1]);
+	if (waitpid(pid, NULL, 0) < 0)
+		error("Unable to reap slurmd child process");
+
+	if (_send_slurmd_conf_lite(sv[0], conf) < 0)
+		goto fail;
+	pfd.fd = sv[0];
+	pfd.events = POLLIN;
+	while (((i = poll(&pfd, 1, STEPD_ZYGOTE_TIMEOUT * 1000)) < 0) &&
+	       (errno == EINTR))
+		;
+	if ((i != 1) || (read(sv[0], &rc, sizeof(int)) != sizeof(int)) ||
+	    (rc != SLURM_SUCCESS))
+		goto fail;
+
+	debug("%s: slurmstepd zygote started", __func__);
+	stepd_zygote_fd = sv[0];
+	return SLURM_SUCCESS;
+
+fail:
+	error("%s: slurmstepd zygote failed to start", __func__);
+	close(sv[0]);
+	return SLURM_ERROR;
+}
+
+/*
+ * Have the zygote fork the slurmstepd of a step, starting the zygote as
+ * needed. Its slurmstepd is then sent its initialization data exactly as
+ * one slurmd forked and exec'd.
+ * RET SLURM_SUCCESS, or SLURM_ERROR for slurmd to fork and exec the
+ * slurmstepd itself
+ */
+static int
+_zygote_launch(int to_stepd, int to_slurmd)
+{
+	int rc = SLURM_ERROR;
+	time_t now;
+
+	slurm_mutex_lock(&stepd_zygote_mutex);
+	if (stepd_zygote_fd < 0) {
+		now = time(NULL);
+		if ((now >= stepd_zygote_next_try) &&
+		    (_zygote_start() != SLURM_SUCCESS))
+			stepd_zygote_next_try = now + STEPD_ZYGOTE_RETRY;
+	}
+	if (stepd_zygote_fd >= 0) {
+		rc = _zygote_send_pipes(to_stepd, to_slurmd);
+		if (rc != SLURM_SUCCESS) {
+			/* It exited, start another for the next step */
+			close(stepd_zygote_fd);
+			stepd_zygote_fd = -1;
+		}
+	}
+	slurm_mutex_unlock(&stepd_zygote_mutex);
+
+	return rc;
+}
+
+extern void
+stepd_zygote_fini(void)
+{
+	slurm_mutex_lock(&stepd_zygote_mutex);
+	if (stepd_zygote_fd >= 0) {
+		/* The zygote exits on seeing the socket close */
+		close(stepd_zygote_fd);
+		stepd_zygote_fd = -1;
+	}
+	stepd_zygote_next_try = 0;
+	slurm_mutex_unlock(&stepd_zygote_mutex);
+}
+
+
 /*
  * Fork and exec the slurmstepd, then send the slurmstepd its
  * initialization data.  Then wait for slurmstepd to send an "ok"
@@ -740,10 +962,13 @@ _forkexec_slurmstepd(uint16_t type, void *req,
 		     slurm_addr_t *cli, slurm_addr_t *self,
 		     const hostset_t step_hset, uint16_t protocol_version)
 {
-	pid_t pid;
+	pid_t pid = 0;
 	int to_stepd[2] = {-1, -1};
 	int to_slurmd[2] = {-1, -1};
+	bool from_zygote = false;
+	DEF_TIMERS;
 
+	START_TIMER;
 	if (pipe(to_stepd) < 0 || pipe(to_slurmd) < 0) {
 		error("_forkexec_slurmstepd pipe failed: %m");
 		return SLURM_FAILURE;
@@ -754,7 +979,13 @@ _forkexec_slurmstepd(uint16_t type, void *req,
 		return SLURM_FAILURE;
 	}
 
-	if ((pid = fork()) < 0) {
+#if (SLURMSTEPD_MEMCHECK == 0)
+	if (conf->stepd_zygote && !conf->chos_loc &&
+	    (_zygote_launch(to_stepd[0], to_slurmd[1]) == SLURM_SUCCESS))
+		from_zygote = true;
+#endif
+
+	if (!from_zygote && ((pid = fork()) < 0)) {
 		error("_forkexec_slurmstepd: fork: %m");
 		close(to_stepd[0]);
 		close(to_stepd[1]);
@@ -762,7 +993,7 @@ _forkexec_slurmstepd(uint16_t type, void *req,
 		close(to_slurmd[1]);
 		_remove_starting_step(type, req);
 		return SLURM_FAILURE;
-	} else if (pid > 0) {
+	} else if (from_zygote || (pid > 0)) {
 		int rc = SLURM_SUCCESS;
 #if (SLURMSTEPD_MEMCHECK == 0)
 		int i;
@@ -806,8 +1037,12 @@ _forkexec_slurmstepd(uint16_t type, void *req,
 				     "possible file system problem or full "
 				     "memory", delta_time);
 			}
-			if (rc != SLURM_SUCCESS)
+			if (rc != SLURM_SUCCESS) {
 				error("slurmstepd return code %d", rc);
+			} else {
+				END_TIMER;
+				_stepd_launch_record(DELTA_TIMER, from_zygote);
+			}
 
 			cc = SLURM_SUCCESS;
 			cc = write(to_stepd[1], &cc, sizeof(int));
@@ -817,12 +1052,14 @@ _forkexec_slurmstepd(uint16_t type, void *req,
 			}
 		}
 #endif
+		if (rc == SLURM_SUCCESS)
+			_register_step(type, req);
 	done:
 		if (_remove_starting_step(type, req))
 			error("Error cleaning up starting_step list");
 
 		/* Reap child */
-		if (waitpid(pid, NULL, 0) < 0)
+		if ((pid > 0) && (waitpid(pid, NULL, 0) < 0))
 			error("Unable to reap slurmd child process");
 		if (close(to_stepd[1]) < 0)
 			error("close write to_stepd in parent: %m");
@@ -2276,6 +2513,88 @@ done:
 	}
 }
 
+static void *_batch_job_thread(void *arg)
+{
+	slurm_msg_t *msg = (slurm_msg_t *) arg;
+
+	_rpc_batch_job(msg, false);
+	slurm_free_job_launch_msg(msg->data);
+	xfree(msg);
+	return NULL;
+}
+
+/* Launch the jobs of a REQUEST_BATCH_JOB_LAUNCH_MULTI, each in a thread of
+ * its own as if sent in a REQUEST_BATCH_JOB_LAUNCH. slurmctld only sends a
+ * node its own launches, any naming another node are skipped. Like
+ * _rpc_batch_job() the reply is sent before launching and failed launches
+ * are reported to slurmctld on their own. */
+static void
+_rpc_batch_job_multi(slurm_msg_t *msg)
+{
+	batch_job_launch_multi_msg_t *req = msg->data;
+	uid_t req_uid = g_slurm_auth_get_uid(msg->auth_cred, conf->auth_info);
+	slurm_msg_t *launch_msg;
+	pthread_attr_t attr;
+	pthread_t id;
+	bool replied = true;
+	int i, retries;
+
+	if (!_slurm_authorized_user(req_uid)) {
+		error("Security violation, batch launch RPC from uid %d",
+		      req_uid);
+		slurm_send_rc_msg(msg, ESLURM_USER_ID_MISSING);
+		return;
+	}
+
+	if (slurm_send_rc_msg(msg, SLURM_SUCCESS) < 1) {
+		/* The slurmctld is no longer waiting for a reply, see
+		 * _rpc_batch_job() */
+		error("Could not confirm batch launch of %u jobs, "
+		      "aborting request", req->launch_cnt);
+		replied = false;
+	}
+
+	slurm_attr_init(&attr);
+	if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED))
+		error("pthread_attr_setdetachstate: %m");
+	for (i = 0; i < req->launch_cnt; i++) {
+		if (xstrcmp(req->node_name[i], conf->node_name))
+			continue;
+		if (!replied) {
+			if (req->launch_msg[i]->step_id == SLURM_BATCH_SCRIPT)
+				_launch_job_fail(req->launch_msg[i]->job_id,
+					SLURM_COMMUNICATIONS_SEND_ERROR);
+			else
+				_abort_step(req->launch_msg[i]->job_id,
+					    req->launch_msg[i]->step_id);
+			continue;
+		}
+
+		launch_msg = xmalloc(sizeof(slurm_msg_t));
+		slurm_msg_t_init(launch_msg);
+		launch_msg->msg_type = REQUEST_BATCH_JOB_LAUNCH;
+		launch_msg->protocol_version = msg->protocol_version;
+		launch_msg->orig_addr = msg->orig_addr;
+		launch_msg->data = req->launch_msg[i];
+		req->launch_msg[i] = NULL;
+
+		retries = 0;
+		while (pthread_create(&id, &attr, _batch_job_thread,
+				      launch_msg)) {
+			error("%s: pthread_create: %m", __func__);
+			if (++retries > 3) {
+				_batch_job_thread(launch_msg);
+				break;
+			}
+			usleep(10);	/* sleep and again */
+		}
+	}
+	slurm_attr_destroy(&attr);
+
+	if (!replied)
+		send_registration_msg(SLURM_COMMUNICATIONS_SEND_ERROR, false);
+}
+
 /*
  * Send notification message to batch job
  */
@@ -2306,19 +2625,15 @@ _rpc_job_notify(slurm_msg_t *msg)
 		return;
 	}
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(req->job_id);
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
-		if ((stepd->jobid  != req->job_id) ||
-		    (stepd->stepid != SLURM_BATCH_SCRIPT)) {
+		if (stepd->stepid != SLURM_BATCH_SCRIPT)
 			continue;
-		}
 
 		step_cnt++;
 
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid,
-				   &stepd->protocol_version);
+		fd = step_registry_connect(stepd);
 		if (fd == -1) {
 			debug3("Unable to connect to step %u.%u",
 			       stepd->jobid, stepd->stepid);
@@ -2551,16 +2866,14 @@ _load_job_limits(void)
 		job_limits_list = list_create(_job_limits_free);
 	job_limits_loaded = true;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(NO_VAL);
 	step_iter = list_iterator_create(steps);
 	while ((stepd = list_next(step_iter))) {
 		job_limits_ptr = list_find_first(job_limits_list,
 						 _step_limits_match, stepd);
 		if (job_limits_ptr)	/* already processed */
 			continue;
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid,
-				   &stepd->protocol_version);
+		fd = step_registry_connect(stepd);
 		if (fd == -1)
 			continue;	/* step completed */
 
@@ -2695,7 +3008,7 @@ _enforce_job_mem_limit(void)
 		job_mem_info_ptr[i].vsize_limit *= (vsize_factor / 100.0);
 	}
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(NO_VAL);
 	step_iter = list_iterator_create(steps);
 	while ((stepd = list_next(step_iter))) {
 		for (job_inx=0; job_inx<job_cnt; job_inx++) {
@@ -2705,9 +3018,7 @@ _enforce_job_mem_limit(void)
 		if (job_inx >= job_cnt)
 			continue;	/* job/step not being tracked */
 
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid,
-				   &stepd->protocol_version);
+		fd = step_registry_connect(stepd);
 		if (fd == -1)
 			continue;	/* step completed */
 		acct_req.job_id  = stepd->jobid;
@@ -2783,6 +3094,23 @@ _enforce_job_mem_limit(void)
 	xfree(job_mem_info_ptr);
 }
 
+/* Return true if the load in a ping reply differs from the last load
+ * returned by less than PING_LOAD_DELTA and PING_MEM_DELTA */
+static bool _ping_unchanged(ping_slurmd_resp_msg_t *resp,
+			    ping_slurmd_resp_msg_t *last_resp)
+{
+	uint64_t mem_delta;
+
+	if ((resp->cpu_load > (last_resp->cpu_load + PING_LOAD_DELTA)) ||
+	    (last_resp->cpu_load > (resp->cpu_load + PING_LOAD_DELTA)))
+		return false;
+	mem_delta = last_resp->free_mem * PING_MEM_DELTA / 100;
+	if ((resp->free_mem > (last_resp->free_mem + mem_delta)) ||
+	    (last_resp->free_mem > (resp->free_mem + mem_delta)))
+		return false;
+	return true;
+}
+
 static int
 _rpc_ping(slurm_msg_t *msg)
 {
@@ -2790,6 +3118,10 @@ _rpc_ping(slurm_msg_t *msg)
 	uid_t req_uid = g_slurm_auth_get_uid(msg->auth_cred,
 					     conf->auth_info);
 	static bool first_msg = true;
+	static ping_slurmd_resp_msg_t last_resp;
+	static bool last_resp_set = false;
+	ping_slurmd_resp_msg_t ping_resp;
+	bool send_rc = false;
 
 	if (!_slurm_authorized_user(req_uid)) {
 		error("Security violation, ping RPC from uid %d",
@@ -2802,7 +3134,24 @@ _rpc_ping(slurm_msg_t *msg)
 	}
 	first_msg = false;
 
-	if (rc != SLURM_SUCCESS) {
+	if (rc == SLURM_SUCCESS) {
+		get_cpu_load(&ping_resp.cpu_load);
+		get_free_mem(&ping_resp.free_mem);
+		/* Only return the load when it has changed from what was
+		 * last returned, otherwise a return code is enough for
+		 * slurmctld to keep its current values */
+		slurm_mutex_lock(&ping_mutex);
+		if ((msg->protocol_version >= SLURM_17_02_PROTOCOL_VERSION) &&
+		    last_resp_set && _ping_unchanged(&ping_resp, &last_resp)) {
+			send_rc = true;
+		} else {
+			last_resp = ping_resp;
+			last_resp_set = true;
+		}
+		slurm_mutex_unlock(&ping_mutex);
+	}
+
+	if ((rc != SLURM_SUCCESS) || send_rc) {
 		/* Return result. If the reply can't be sent this indicates
 		 * 1. The network is broken OR
 		 * 2. slurmctld has died    OR
@@ -2817,9 +3166,6 @@ _rpc_ping(slurm_msg_t *msg)
 		}
 	} else {
 		slurm_msg_t resp_msg;
-		ping_slurmd_resp_msg_t ping_resp;
-		get_cpu_load(&ping_resp.cpu_load);
-		get_free_mem(&ping_resp.free_mem);
 		slurm_msg_t_copy(&resp_msg, msg);
 		resp_msg.msg_type = RESPONSE_PING_SLURMD;
 		resp_msg.data     = &ping_resp;
@@ -2834,6 +3180,30 @@ _rpc_ping(slurm_msg_t *msg)
 	return rc;
 }
 
+static void
+_rpc_node_registration(slurm_msg_t *msg)
+{
+	uid_t req_uid = g_slurm_auth_get_uid(msg->auth_cred,
+					     conf->auth_info);
+
+	if (!_slurm_authorized_user(req_uid)) {
+		error("Security violation, node registration RPC from uid %d",
+		      req_uid);
+		slurm_send_rc_msg(msg, ESLURM_USER_ID_MISSING);
+		return;
+	}
+
+	/* If the reply can't be sent, register directly with slurmctld as
+	 * when a ping reply fails */
+	if (reply_registration_msg(msg, SLURM_SUCCESS, true) != SLURM_SUCCESS)
+		send_registration_msg(SLURM_SUCCESS, true);
+
+	/* Take this opportunity to enforce any job memory limits */
+	_enforce_job_mem_limit();
+	/* Clear up any stalled file transfers as well */
+	_file_bcast_cleanup();
+}
+
 static int
 _rpc_health_check(slurm_msg_t *msg)
 {
@@ -3231,7 +3601,7 @@ _rpc_step_complete_aggr(slurm_msg_t *msg)
 		slurm_msg_t req;
 		_setup_step_complete_msg(&req, msg->data);
 
-		while (slurm_send_recv_controller_rc_msg(&req, &rc) < 0) {
+		while (ctld_conn_send_recv_rc_msg(&req, &rc) < 0) {
 			error("Unable to send step complete, "
 			      "trying again in a minute: %m");
 		}
@@ -3256,13 +3626,11 @@ _get_step_list(void)
 	ListIterator i;
 	step_loc_t *stepd;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(NO_VAL);
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
 		int fd;
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid,
-				   &stepd->protocol_version);
+		fd = step_registry_connect(stepd);
 		if (fd == -1)
 			continue;
 
@@ -3300,6 +3668,9 @@ _rpc_daemon_status(slurm_msg_t *msg)
 {
 	slurm_msg_t      resp_msg;
 	slurmd_status_t *resp = NULL;
+	msg_aggr_stats_t aggr_stats;
+	id_cache_stats_t id_stats;
+	uint32_t resolve_cnt;
 
 	resp = xmalloc(sizeof(slurmd_status_t));
 	resp->actual_cpus        = conf->actual_cpus;
@@ -3318,6 +3689,29 @@ _rpc_daemon_status(slurm_msg_t *msg)
 	resp->slurmd_logfile     = xstrdup(conf->logfile);
 	resp->version            = xstrdup(SLURM_VERSION_STRING);
 
+	msg_aggr_get_stats(&aggr_stats);
+	resp->msg_aggr_adaptive     = aggr_stats.adaptive;
+	resp->msg_aggr_ack_usec     = aggr_stats.ack_usec;
+	resp->msg_aggr_arrival_usec = aggr_stats.arrival_usec;
+	resp->msg_aggr_batch_cnt    = aggr_stats.batch_cnt;
+	resp->msg_aggr_batch_fail   = aggr_stats.batch_fail;
+	resp->msg_aggr_msg_cnt      = aggr_stats.msg_cnt;
+	resp->msg_aggr_window_msgs  = aggr_stats.max_msg_cnt;
+	resp->msg_aggr_window_time  = aggr_stats.window;
+	_stepd_launch_stats(resp);
+	job_script_get_stats(resp);
+
+	id_cache_get_stats(&id_stats);
+	resolve_cnt = id_stats.miss_cnt + id_stats.refresh_cnt;
+	resp->id_cache_entries      = id_stats.entry_cnt;
+	resp->id_cache_hits         = id_stats.hit_cnt;
+	resp->id_cache_misses       = id_stats.miss_cnt;
+	resp->id_cache_refreshes    = id_stats.refresh_cnt;
+	resp->id_cache_resolve_max  = id_stats.resolve_max;
+	if (resolve_cnt)
+		resp->id_cache_resolve_mean = id_stats.resolve_sum /
+					      resolve_cnt;
+
 	slurm_msg_t_copy(&resp_msg, msg);
 	resp_msg.msg_type = RESPONSE_SLURMD_STATUS;
 	resp_msg.data     = resp;
@@ -3653,13 +4047,11 @@ static void  _rpc_pid2jid(slurm_msg_t *msg)
 	ListIterator i;
 	step_loc_t *stepd;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(NO_VAL);
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
 		int fd;
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid,
-				   &stepd->protocol_version);
+		fd = step_registry_connect(stepd);
 		if (fd == -1)
 			continue;
 
@@ -3703,19 +4095,14 @@ _get_grouplist(char **user_name, uid_t my_uid, gid_t my_gid,
 	       int *ngroups, gid_t **groups)
 {
 	if (!*user_name)
-		*user_name = uid_to_string(my_uid);
+		*user_name = id_cache_uid_to_name(my_uid);
 
 	if (!*user_name) {
 		error("sbcast: Could not find uid %ld", (long)my_uid);
 		return -1;
 	}
 
-	*groups = (gid_t *) xmalloc(*ngroups * sizeof(gid_t));
-
-	if (getgrouplist(*user_name, my_gid, *groups, ngroups) < 0) {
-		*groups = xrealloc(*groups, *ngroups * sizeof(gid_t));
-		getgrouplist(*user_name, my_gid, *groups, ngroups);
-	}
+	*ngroups = id_cache_user_gids(*user_name, my_gid, groups);
 
 	return 0;
 
@@ -3876,7 +4263,7 @@ void file_bcast_purge(void)
 
 static int _rpc_file_bcast(slurm_msg_t *msg)
 {
-	int rc, offset, inx;
+	int rc;
 	file_bcast_info_t *file_info;
 	file_bcast_msg_t *req = msg->data;
 	file_bcast_info_t key;
@@ -3932,19 +4319,11 @@ static int _rpc_file_bcast(slurm_msg_t *msg)
 		return SLURM_FAILURE;
 	}
 
-	offset = 0;
-	while (req->block_len - offset) {
-		inx = write(file_info->fd, &req->block[offset],
-			    (req->block_len - offset));
-		if (inx == -1) {
-			if ((errno == EINTR) || (errno == EAGAIN))
-				continue;
-			error("sbcast: uid:%u can't write `%s`: %m",
-			      key.uid, key.fname);
-			_fb_rdunlock();
-			return SLURM_FAILURE;
-		}
-		offset += inx;
+	if (bcast_write_block(file_info->fd, req, msg->protocol_version)) {
+		error("sbcast: uid:%u can't write `%s`: %m",
+		      key.uid, key.fname);
+		_fb_rdunlock();
+		return SLURM_FAILURE;
 	}
 
 	file_info->last_update = time(NULL);
@@ -4029,7 +4408,7 @@ static int _file_bcast_register_file(slurm_msg_t *msg,
 	file_bcast_msg_t *req = msg->data;
 	int fd, flags, rc;
 	int pipe[2];
-	int ngroups = 16;
+	int ngroups = 0;
 	gid_t *groups;
 	pid_t child;
 	file_bcast_info_t *file_info;
@@ -4264,16 +4643,10 @@ static uid_t _get_job_uid(uint32_t jobid)
 	uid_t uid = -1;
 	int fd;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(jobid);
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
-		if (stepd->jobid != jobid) {
-			/* multiple jobs expected on shared nodes */
-			continue;
-		}
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid,
-				   &stepd->protocol_version);
+		fd = step_registry_connect(stepd);
 		if (fd == -1) {
 			debug3("Unable to connect to step %u.%u",
 			       stepd->jobid, stepd->stepid);
@@ -4311,24 +4684,15 @@ _kill_all_active_steps(uint32_t jobid, int sig, bool batch)
 	int step_cnt  = 0;
 	int fd;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(jobid);
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
-		if (stepd->jobid != jobid) {
-			/* multiple jobs expected on shared nodes */
-			debug3("Step from other job: jobid=%u (this jobid=%u)",
-			       stepd->jobid, jobid);
-			continue;
-		}
-
 		if ((stepd->stepid == SLURM_BATCH_SCRIPT) && (!batch))
 			continue;
 
 		step_cnt++;
 
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid,
-				   &stepd->protocol_version);
+		fd = step_registry_connect(stepd);
 		if (fd == -1) {
 			debug3("Unable to connect to step %u.%u",
 			       stepd->jobid, stepd->stepid);
@@ -4364,24 +4728,15 @@ _terminate_all_steps(uint32_t jobid, bool batch)
 	int step_cnt  = 0;
 	int fd;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(jobid);
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
-		if (stepd->jobid != jobid) {
-			/* multiple jobs expected on shared nodes */
-			debug3("Step from other job: jobid=%u (this jobid=%u)",
-			       stepd->jobid, jobid);
-			continue;
-		}
-
 		if ((stepd->stepid == SLURM_BATCH_SCRIPT) && (!batch))
 			continue;
 
 		step_cnt++;
 
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid,
-				   &stepd->protocol_version);
+		fd = step_registry_connect(stepd);
 		if (fd == -1) {
 			debug3("Unable to connect to step %u.%u",
 			       stepd->jobid, stepd->stepid);
@@ -4409,14 +4764,12 @@ _job_still_running(uint32_t job_id)
 	ListIterator i;
 	step_loc_t  *s     = NULL;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(job_id);
 	i = list_iterator_create(steps);
 	while ((s = list_next(i))) {
 		if (s->jobid == job_id) {
 			int fd;
-			fd = stepd_connect(s->directory, s->nodename,
-					   s->jobid, s->stepid,
-					   &s->protocol_version);
+			fd = step_registry_connect(s);
 			if (fd == -1)
 				continue;
 
@@ -4462,14 +4815,12 @@ _steps_completed_now(uint32_t jobid)
 	step_loc_t *stepd;
 	bool rc = true;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(jobid);
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
 		if (stepd->jobid == jobid) {
 			int fd;
-			fd = stepd_connect(stepd->directory, stepd->nodename,
-					   stepd->jobid, stepd->stepid,
-					   &stepd->protocol_version);
+			fd = step_registry_connect(stepd);
 			if (fd == -1)
 				continue;
 
@@ -4504,9 +4855,9 @@ static void _epilog_complete_msg_setup(
 
 /*
  *  Send epilog complete message to currently active controller.
- *  If enabled, use message aggregation.
- *   Returns SLURM_SUCCESS if message sent successfully,
- *           SLURM_FAILURE if epilog complete message fails to be sent.
+ *  If enabled, use message aggregation, otherwise the message is queued
+ *  to be sent with any others completing at the same time.
+ *   Returns SLURM_SUCCESS
  */
 static int
 _epilog_complete(uint32_t jobid, int rc)
@@ -4526,20 +4877,9 @@ _epilog_complete(uint32_t jobid, int rc)
 
 		msg_aggr_add_msg(msg, 0, NULL);
 	} else {
-		slurm_msg_t msg;
-		epilog_complete_msg_t req;
-
-		_epilog_complete_msg_setup(&msg, &req, jobid, rc);
-
-		/* Note: No return code to message, slurmctld will resend
-		 * TERMINATE_JOB request if message send fails */
-		if (slurm_send_only_controller_msg(&msg) < 0) {
-			error("Unable to send epilog complete message: %m");
-			ret = SLURM_ERROR;
-		} else {
-			debug("Job %u: sent epilog complete msg: rc = %d",
-			      jobid, rc);
-		}
+		job_script_epilog_complete(jobid, rc);
+		debug("Job %u: queued epilog complete msg: rc = %d",
+		      jobid, rc);
 	}
 	return ret;
 }
@@ -4587,16 +4927,9 @@ _rpc_signal_job(slurm_msg_t *msg)
 	 * Loop through all job steps for this job and signal the
 	 * step's process group through the slurmstepd.
 	 */
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(req->job_id);
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
-		if (stepd->jobid != req->job_id) {
-			/* multiple jobs expected on shared nodes */
-			debug3("Step from other job: jobid=%u (this jobid=%u)",
-			       stepd->jobid, req->job_id);
-			continue;
-		}
-
 		if (stepd->stepid == SLURM_BATCH_SCRIPT) {
 			debug2("batch script itself not signalled");
 			continue;
@@ -4604,9 +4937,7 @@ _rpc_signal_job(slurm_msg_t *msg)
 
 		step_cnt++;
 
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid,
-				   &stepd->protocol_version);
+		fd = step_registry_connect(stepd);
 		if (fd == -1) {
 			debug3("Unable to connect to step %u.%u",
 			       stepd->jobid, stepd->stepid);
@@ -4699,7 +5030,7 @@ extern void record_launched_jobs(void)
 	ListIterator i;
 	step_loc_t *stepd;
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(NO_VAL);
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
 		_launch_complete_add(stepd->jobid);
@@ -4786,7 +5117,7 @@ _rpc_suspend_job(slurm_msg_t *msg)
 	 * as appropriate. Since the "suspend" action may contains a sleep
 	 * (if the launch is in progress) suspend multiple jobsteps in parallel.
 	 */
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(req->job_id);
 	i = list_iterator_create(steps);
 
 	while (1) {
@@ -4795,19 +5126,10 @@ _rpc_suspend_job(slurm_msg_t *msg)
 
 		fdi = 0;
 		while ((stepd = list_next(i))) {
-			if (stepd->jobid != req->job_id) {
-				/* multiple jobs expected on shared nodes */
-				debug3("Step from other job: jobid=%u "
-				       "(this jobid=%u)",
-				       stepd->jobid, req->job_id);
-				continue;
-			}
 			step_cnt++;
 
-			fd[fdi] = stepd_connect(stepd->directory,
-						stepd->nodename, stepd->jobid,
-						stepd->stepid,
-						&protocol_version[fdi]);
+			fd[fdi] = step_registry_connect(stepd);
+			protocol_version[fdi] = stepd->protocol_version;
 			if (fd[fdi] == -1) {
 				debug3("Unable to connect to step %u.%u",
 				       stepd->jobid, stepd->stepid);
@@ -5187,7 +5509,7 @@ _rpc_complete_batch(slurm_msg_t *msg)
 			slurm_msg_t_init(&req_msg);
 			req_msg.msg_type = msg_type;
 			req_msg.data	 = msg->data;
-			msg_rc = slurm_send_recv_controller_msg(
+			msg_rc = ctld_conn_send_recv_msg(
 				&req_msg, &resp_msg);
 
 			if (msg_rc == SLURM_SUCCESS)
@@ -5670,7 +5992,7 @@ _build_env(job_env_t *job_env)
 #ifndef HAVE_NATIVE_CRAY
 	/* uid_to_string on a cray is a heavy call, so try to avoid it */
 	if (!job_env->user_name) {
-		job_env->user_name = uid_to_string(job_env->uid);
+		job_env->user_name = id_cache_uid_to_string(job_env->uid);
 		user_name_set = 1;
 	}
 #endif
@@ -5768,7 +6090,7 @@ _run_spank_job_script (const char *mode, char **env, uint32_t job_id, uid_t uid)
 	close (pfds[1]);
 
 	timeout = MAX(slurm_get_prolog_timeout(), 120); /* 120 secs in v15.08 */
-	if (waitpid_timeout (mode, cpid, &status, timeout) < 0) {
+	if (job_script_wait(mode, cpid, &status, timeout) < 0) {
 		error ("spank/%s timed out after %u secs", mode, timeout);
 		return (-1);
 	}
@@ -5788,8 +6110,11 @@ static int _run_job_script(const char *name, const char *path,
 			   uint32_t jobid, int timeout, char **env, uid_t uid)
 {
 	struct stat stat_buf;
+	job_script_t script;
 	int status = 0, rc;
 
+	job_script_start(&script, xstrcmp(name, "epilog") ?
+			 JOB_SCRIPT_PROLOG : JOB_SCRIPT_EPILOG);
 	/*
 	 *  Always run both spank prolog/epilog and real prolog/epilog script,
 	 *   even if spank plugins fail. (May want to alter this in the future)
@@ -5800,6 +6125,7 @@ static int _run_job_script(const char *name, const char *path,
 		status = _run_spank_job_script(name, env, jobid, uid);
 	if ((rc = run_script(name, path, jobid, timeout, env, uid)))
 		status = rc;
+	job_script_done(&script);
 	return (status);
 }
 
@@ -5828,42 +6154,48 @@ _run_prolog(job_env_t *job_env, slurm_cred_t *cred)
 	return rc;
 }
 #else
-static void *_prolog_timer(void *x)
+/* Tell the user of a job that its prolog is still running */
+static void *_prolog_notify(void *x)
 {
-	int delay_time, rc = SLURM_SUCCESS;
-	struct timespec ts;
-	struct timeval now;
+	uint32_t *job_id = (uint32_t *) x;
 	slurm_msg_t msg;
 	job_notify_msg_t notify_req;
 	char srun_msg[128];
-	timer_struct_t *timer_struct = (timer_struct_t *) x;
-
-	delay_time = MAX(2, (timer_struct->msg_timeout - 2));
-	gettimeofday(&now, NULL);
-	ts.tv_sec = now.tv_sec + delay_time;
-	ts.tv_nsec = now.tv_usec * 1000;
-	slurm_mutex_lock(timer_struct->timer_mutex);
-	if (!timer_struct->prolog_fini) {
-		rc = pthread_cond_timedwait(timer_struct->timer_cond,
-					    timer_struct->timer_mutex, &ts);
-	}
-	slurm_mutex_unlock(timer_struct->timer_mutex);
-
-	if (rc != ETIMEDOUT)
-		return NULL;
 
 	slurm_msg_t_init(&msg);
 	snprintf(srun_msg, sizeof(srun_msg), "Prolog hung on node %s",
 		 conf->node_name);
-	notify_req.job_id	= timer_struct->job_id;
+	notify_req.job_id	= *job_id;
 	notify_req.job_step_id	= NO_VAL;
 	notify_req.message	= srun_msg;
 	msg.msg_type	= REQUEST_JOB_NOTIFY;
 	msg.data	= &notify_req;
 	slurm_send_only_controller_msg(&msg);
+	xfree(job_id);
+
 	return NULL;
 }
 
+/* Run by the job script timer thread if the prolog is still running. The
+ * notification is sent from a thread of its own, an unresponsive slurmctld
+ * must not hold up the timers killing scripts. */
+static void _prolog_timer(void *x)
+{
+	uint32_t *job_id = xmalloc(sizeof(uint32_t));
+	pthread_attr_t attr;
+	pthread_t id;
+
+	*job_id = *(uint32_t *) x;
+	slurm_attr_init(&attr);
+	if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED))
+		error("pthread_attr_setdetachstate: %m");
+	if (pthread_create(&id, &attr, _prolog_notify, job_id)) {
+		error("%s: pthread_create: %m", __func__);
+		xfree(job_id);
+	}
+	slurm_attr_destroy(&attr);
+}
+
 static int
 _run_prolog(job_env_t *job_env, slurm_cred_t *cred)
 {
@@ -5873,12 +6205,7 @@ _run_prolog(job_env_t *job_env, slurm_cred_t *cred)
 	time_t start_time = time(NULL);
 	static uint16_t msg_timeout = 0;
 	static uint16_t timeout;
-	pthread_t       timer_id;
-	pthread_attr_t  timer_attr;
-	pthread_cond_t  timer_cond  = PTHREAD_COND_INITIALIZER;
-	pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
-	timer_struct_t  timer_struct;
-	bool prolog_fini = false;
+	uint32_t timer_id, timer_job_id = job_env->jobid;
 	char **my_env;
 
 	my_env = _build_env(job_env);
@@ -5902,13 +6229,8 @@ _run_prolog(job_env_t *job_env, slurm_cred_t *cred)
 	my_prolog = xstrdup(conf->prolog);
 	slurm_mutex_unlock(&conf->config_mutex);
 
-	slurm_attr_init(&timer_attr);
-	timer_struct.job_id      = job_env->jobid;
-	timer_struct.msg_timeout = msg_timeout;
-	timer_struct.prolog_fini = &prolog_fini;
-	timer_struct.timer_cond  = &timer_cond;
-	timer_struct.timer_mutex = &timer_mutex;
-	pthread_create(&timer_id, &timer_attr, &_prolog_timer, &timer_struct);
+	timer_id = job_script_timer_add(MAX(2, (msg_timeout - 2)),
+					_prolog_timer, &timer_job_id);
 	START_TIMER;
 
 	if (timeout == (uint16_t)NO_VAL)
@@ -5920,10 +6242,7 @@ _run_prolog(job_env_t *job_env, slurm_cred_t *cred)
 
 	END_TIMER;
 	info("%s: run job script took %s", __func__, TIME_STR);
-	slurm_mutex_lock(&timer_mutex);
-	prolog_fini = true;
-	slurm_cond_broadcast(&timer_cond);
-	slurm_mutex_unlock(&timer_mutex);
+	job_script_timer_cancel(timer_id);
 
 	diff_time = difftime(time(NULL), start_time);
 	info("%s: prolog with lock for job %u ran for %d seconds",
@@ -5937,7 +6256,6 @@ _run_prolog(job_env_t *job_env, slurm_cred_t *cred)
 	xfree(my_prolog);
 	_destroy_env(my_env);
 
-	pthread_join(timer_id, NULL);
 	return rc;
 }
 #endif
@@ -5984,176 +6302,35 @@ _run_epilog(job_env_t *job_env)
 }
 
 
-/**********************************************************************/
-/* Because calling initgroups(2)/getgrouplist(3) can be expensive and */
-/* is not cached by sssd or nscd, we cache the group access list.     */
-/**********************************************************************/
-
-typedef struct gid_cache_s {
-	char *user;
-	time_t timestamp;
-	gid_t gid;
-	gids_t *gids;
-	struct gid_cache_s *next;
-} gids_cache_t;
-
-#define GIDS_HASH_LEN 64
-static gids_cache_t *gids_hashtbl[GIDS_HASH_LEN] = {NULL};
-static pthread_mutex_t gids_mutex = PTHREAD_MUTEX_INITIALIZER;
-
-static gids_t *
-_alloc_gids(int n, gid_t *gids)
-{
-	gids_t *new;
-
-	new = (gids_t *)xmalloc(sizeof(gids_t));
-	new->ngids = n;
-	new->gids = gids;
-	return new;
-}
-
-static void
-_dealloc_gids(gids_t *p)
-{
-	xfree(p->gids);
-	xfree(p);
-}
-
-/* Duplicate a gids_t struct.  */
-static gids_t *
-_gids_dup(gids_t *g)
-{
-	int buf_size;
-	gids_t *n = xmalloc(sizeof(gids_t));
-	n->ngids = g->ngids;
-	buf_size = g->ngids * sizeof(gid_t);
-	n->gids = xmalloc(buf_size);
-	memcpy(n->gids, g->gids, buf_size);
-	return n;
-}
-
-static gids_cache_t *
-_alloc_gids_cache(char *user, gid_t gid, gids_t *gids, gids_cache_t *next)
-{
-	gids_cache_t *p;
-
-	p = (gids_cache_t *)xmalloc(sizeof(gids_cache_t));
-	p->user = xstrdup(user);
-	p->timestamp = time(NULL);
-	p->gid = gid;
-	p->gids = gids;
-	p->next = next;
-	return p;
-}
-
-static void
-_dealloc_gids_cache(gids_cache_t *p)
-{
-	xfree(p->user);
-	_dealloc_gids(p->gids);
-	xfree(p);
-}
-
-static size_t
-_gids_hashtbl_idx(const char *user)
+extern void
+destroy_starting_step(void *x)
 {
-	uint64_t x = siphash_str(user);
-	return x % GIDS_HASH_LEN;
+	xfree(x);
 }
 
-void
-gids_cache_purge(void)
-{
-	int i;
-	gids_cache_t *p, *q;
-
-	slurm_mutex_lock(&gids_mutex);
-	for (i=0; i<GIDS_HASH_LEN; i++) {
-		p = gids_hashtbl[i];
-		while (p) {
-			q = p->next;
-			_dealloc_gids_cache(p);
-			p = q;
-		}
-		gids_hashtbl[i] = NULL;
-	}
-	slurm_mutex_unlock(&gids_mutex);
-}
 
+/* Record a slurmstepd that has started listening on its socket */
 static void
-_gids_cache_register(char *user, gid_t gid, gids_t *gids)
+_register_step(uint16_t type, void *req)
 {
-	size_t idx;
-	gids_cache_t *p, *q;
-
-	idx = _gids_hashtbl_idx(user);
-	q = gids_hashtbl[idx];
-	p = _alloc_gids_cache(user, gid, gids, q);
-	gids_hashtbl[idx] = p;
-	debug2("Cached group access list for %s/%d", user, gid);
-}
-
-static gids_t *
-_gids_cache_lookup(char *user, gid_t gid)
-{
-	size_t idx;
-	gids_cache_t *p;
-	bool found_but_old = false;
-	time_t now = 0;
-	int ngroups = 0;
-	gid_t *groups;
-	gids_t *ret_gids = NULL;
-
-	idx = _gids_hashtbl_idx(user);
-	slurm_mutex_lock(&gids_mutex);
-	p = gids_hashtbl[idx];
-	while (p) {
-		if (xstrcmp(p->user, user) == 0 && p->gid == gid) {
-			slurm_ctl_conf_t *cf = slurm_conf_lock();
-			int group_ttl = cf->group_info & GROUP_TIME_MASK;
-			slurm_conf_unlock();
-			if (!group_ttl) {
-				ret_gids = _gids_dup(p->gids);
-				goto done;
-			}
-			now = time(NULL);
-			if (difftime(now, p->timestamp) < group_ttl) {
-				ret_gids = _gids_dup(p->gids);
-				goto done;
-			} else {
-				found_but_old = true;
-				break;
-			}
-		}
-		p = p->next;
-	}
-	/* Cache lookup failed or cached value was too old, fetch new
-	 * value and insert it into cache.  */
-	getgrouplist(user, gid, NULL, &ngroups);
-	groups = xmalloc(ngroups * sizeof(gid_t));
-	if (getgrouplist(user, gid, groups, &ngroups) == -1)
-		error("getgrouplist failed");
-	if (found_but_old) {
-		xfree(p->gids->gids);
-		p->gids->gids = groups;
-		p->gids->ngids = ngroups;
-		p->timestamp = now;
-		ret_gids = _gids_dup(p->gids);
-	} else {
-		gids_t *gids = _alloc_gids(ngroups, groups);
-		_gids_cache_register(user, gid, gids);
-		ret_gids = _gids_dup(gids);
+	switch (type) {
+	case LAUNCH_BATCH_JOB:
+		step_registry_add(((batch_job_launch_msg_t *)req)->job_id,
+				  ((batch_job_launch_msg_t *)req)->step_id);
+		break;
+	case LAUNCH_TASKS:
+		step_registry_add(
+			((launch_tasks_request_msg_t *)req)->job_id,
+			((launch_tasks_request_msg_t *)req)->job_step_id);
+		break;
+	case REQUEST_LAUNCH_PROLOG:
+		step_registry_add(((prolog_launch_msg_t *)req)->job_id,
+				  SLURM_EXTERN_CONT);
+		break;
+	default:
+		error("%s called with an invalid type: %u", __func__, type);
+		break;
 	}
-done:
-	slurm_mutex_unlock(&gids_mutex);
-	return ret_gids;
-}
-
-
-extern void
-destroy_starting_step(void *x)
-{
-	xfree(x);
 }
 
 
@@ -49,11 +49,12 @@ void slurmd_req(slurm_msg_t *msg);
 
 void destroy_starting_step(void *x);
 
-void gids_cache_purge(void);
-
 /* Add record for every launched job so we know they are ready for suspend */
 extern void record_launched_jobs(void);
 
+/* Stop the slurmstepd zygote, the next step launched starts another */
+extern void stepd_zygote_fini(void);
+
 void file_bcast_init(void);
 void file_bcast_purge(void);
 
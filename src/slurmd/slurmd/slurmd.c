@@ -69,6 +69,7 @@
 #include "src/common/forward.h"
 #include "src/common/gres.h"
 #include "src/common/hostlist.h"
+#include "src/common/id_cache.h"
 #include "src/common/list.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
@@ -97,8 +98,10 @@
 #include "src/common/xsignal.h"
 
 #include "src/slurmd/common/core_spec_plugin.h"
+#include "src/slurmd/slurmd/ctld_conn.h"
 #include "src/slurmd/slurmd/get_mach_stat.h"
 #include "src/slurmd/common/job_container_plugin.h"
+#include "src/slurmd/slurmd/job_script.h"
 #include "src/slurmd/common/proctrack.h"
 #include "src/slurmd/slurmd/req.h"
 #include "src/slurmd/common/run_script.h"
@@ -107,6 +110,7 @@
 #include "src/slurmd/slurmd/slurmd.h"
 #include "src/slurmd/common/slurmd_cgroup.h"
 #include "src/slurmd/slurmd/slurmd_plugstack.h"
+#include "src/slurmd/slurmd/step_registry.h"
 #include "src/slurmd/common/xcpuinfo.h"
 
 #define GETOPT_ARGS	"bcCd:Df:hL:Mn:N:vV"
@@ -358,6 +362,8 @@ main (int argc, char *argv[])
 	_install_fork_handlers();
 	list_install_fork_handlers();
 	slurm_conf_install_fork_handlers();
+	step_registry_init();
+	job_script_init();
 	record_launched_jobs();
 
 	/*
@@ -372,7 +378,8 @@ main (int argc, char *argv[])
 	_spawn_registration_engine();
 	msg_aggr_sender_init(conf->hostname, conf->port,
 			     conf->msg_aggr_window_time,
-			     conf->msg_aggr_window_msgs);
+			     conf->msg_aggr_window_msgs,
+			     conf->msg_aggr_adaptive);
 	_msg_engine();
 
 	/*
@@ -388,7 +395,7 @@ main (int argc, char *argv[])
 	_slurmd_fini();
 	_destroy_conf();
 	slurm_crypto_fini();	/* must be after _destroy_conf() */
-	gids_cache_purge();
+	id_cache_fini();
 	file_bcast_purge();
 
 	info("Slurmd shutdown completing");
@@ -636,7 +643,7 @@ send_registration_msg(uint32_t status, bool startup)
 		req.msg_type = MESSAGE_NODE_REGISTRATION_STATUS;
 		req.data     = msg;
 
-		if (slurm_send_recv_controller_rc_msg(&req, &rc) < 0) {
+		if (ctld_conn_send_recv_rc_msg(&req, &rc) < 0) {
 			error("Unable to register: %m");
 			ret_val = SLURM_FAILURE;
 		}
@@ -649,6 +656,31 @@ send_registration_msg(uint32_t status, bool startup)
 	return ret_val;
 }
 
+int
+reply_registration_msg(slurm_msg_t *req, uint32_t status, bool startup)
+{
+	slurm_msg_t resp_msg;
+	slurm_node_registration_status_msg_t *msg =
+		xmalloc (sizeof (slurm_node_registration_status_msg_t));
+	int ret_val = SLURM_SUCCESS;
+
+	msg->startup = (uint16_t) startup;
+	_fill_registration_msg(msg);
+	msg->status  = status;
+
+	slurm_msg_t_copy(&resp_msg, req);
+	resp_msg.msg_type = MESSAGE_NODE_REGISTRATION_STATUS;
+	resp_msg.data     = msg;
+	if (slurm_send_node_msg(req->conn_fd, &resp_msg) < 0) {
+		error("Unable to return registration: %m");
+		ret_val = SLURM_FAILURE;
+	} else
+		sent_reg_time = time(NULL);
+	slurm_free_node_registration_status_msg(msg);
+
+	return ret_val;
+}
+
 static void
 _fill_registration_msg(slurm_node_registration_status_msg_t *msg)
 {
@@ -729,7 +761,7 @@ _fill_registration_msg(slurm_node_registration_status_msg_t *msg)
 			error("switch_g_build_node_info: %m");
 	}
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(NO_VAL);
 	msg->job_count = list_count(steps);
 	msg->job_id    = xmalloc(msg->job_count * sizeof(*msg->job_id));
 	/* Note: Running batch jobs will have step_id == NO_VAL */
@@ -739,9 +771,7 @@ _fill_registration_msg(slurm_node_registration_status_msg_t *msg)
 	n = 0;
 	while ((stepd = list_next(i))) {
 		int fd;
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid,
-				   &stepd->protocol_version);
+		fd = step_registry_connect(stepd);
 		if (fd == -1) {
 			--(msg->job_count);
 			continue;
@@ -802,8 +832,9 @@ _massage_pathname(char **path)
 static void
 _read_config(void)
 {
-	char *path_pubkey = NULL;
+	char *path_pubkey = NULL, *tmp_ptr;
 	slurm_ctl_conf_t *cf = NULL;
+	uint32_t max_job_scripts = 0;
 	int cc;
 #ifndef HAVE_FRONT_END
 	bool cr_flag = false, gang_flag = false;
@@ -818,6 +849,8 @@ _read_config(void)
 	xfree(conf->chos_loc);
 	conf->chos_loc = xstrdup(cf->chos_loc);
 
+	id_cache_init(cf->group_info & GROUP_TIME_MASK);
+
 	conf->last_update = time(NULL);
 
 	if (conf->conffile == NULL)
@@ -1039,9 +1072,16 @@ _read_config(void)
 
 	conf->mem_limit_enforce = cf->mem_limit_enforce;
 	conf->health_check_interval = cf->health_check_interval;
+	conf->stepd_zygote = (cf->launch_params &&
+			      strstr(cf->launch_params, "slurmstepd_zygote"));
+	if (cf->launch_params &&
+	    (tmp_ptr = strstr(cf->launch_params, "max_job_scripts=")))
+		max_job_scripts = atoi(tmp_ptr + 16);
 
 	slurm_mutex_unlock(&conf->config_mutex);
 	slurm_conf_unlock();
+
+	job_script_reconfig(max_job_scripts);
 }
 
 static void
@@ -1056,6 +1096,12 @@ _reconfigure(void)
 	slurm_conf_reinit(conf->conffile);
 	_read_config();
 
+	/* Pick up any new ControlAddr or BackupAddr */
+	ctld_conn_close();
+
+	/* Steps launched from now on get plugins loaded with the new config */
+	stepd_zygote_fini();
+
 	/*
 	 * Rebuild topology information and refresh slurmd topo infos
 	 */
@@ -1065,7 +1111,8 @@ _reconfigure(void)
 	cpu_freq_reconfig();
 
 	msg_aggr_sender_reconfig(conf->msg_aggr_window_time,
-				 conf->msg_aggr_window_msgs);
+				 conf->msg_aggr_window_msgs,
+				 conf->msg_aggr_adaptive);
 
 	/*
 	 * In case the administrator changed the cpu frequency set capabilities
@@ -1086,21 +1133,19 @@ _reconfigure(void)
 	slurm_cred_ctx_key_update(conf->vctx, conf->pubkey);
 
 	/*
-	 * Purge the username -> grouplist cache.
+	 * Purge the user and group cache.
 	 */
-	gids_cache_purge();
+	id_cache_purge();
 
 	/* send reconfig to each stepd so they can refresh their log
 	 * file handle
 	 */
 
-	steps = stepd_available(conf->spooldir, conf->node_name);
+	steps = step_registry_list(NO_VAL);
 	i = list_iterator_create(steps);
 	while ((stepd = list_next(i))) {
 		int fd;
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid,
-				   &stepd->protocol_version);
+		fd = step_registry_connect(stepd);
 		if (fd == -1)
 			continue;
 
@@ -1705,6 +1750,10 @@ cleanup:
 static int
 _slurmd_fini(void)
 {
+	job_script_fini();	/* sends queued epilog complete messages */
+	ctld_conn_fini();
+	stepd_zygote_fini();
+	step_registry_fini();
 	node_features_g_fini();
 	core_spec_g_fini();
 	switch_g_node_fini();
@@ -2046,6 +2095,16 @@ static uint64_t _parse_msg_aggr_params(int type, char *params)
 		if ((sub_str = xstrcasestr(params, "WindowMsgs=")))
 			value = _get_int(sub_str + 11);
 		break;
+	case WINDOW_ADAPTIVE:
+		if ((sub_str = xstrcasestr(params, "WindowAdaptive="))) {
+			sub_str += 15;
+			if (!strncasecmp(sub_str, "yes", 3) ||
+			    (_get_int(sub_str) == 1))
+				value = 1;
+			else
+				value = 0;
+		}
+		break;
 	default:
 		fatal("invalid message aggregation parameters: %s", params);
 	}
@@ -2063,9 +2122,12 @@ static void _set_msg_aggr_params(void)
 		conf->msg_aggr_window_time = DEFAULT_MSG_AGGR_WINDOW_TIME;
 	if (conf->msg_aggr_window_msgs == NO_VAL)
 		conf->msg_aggr_window_msgs = DEFAULT_MSG_AGGR_WINDOW_MSGS;
+	conf->msg_aggr_adaptive = (_parse_msg_aggr_params(WINDOW_ADAPTIVE,
+				   conf->msg_aggr_params) == 1);
 	if (conf->msg_aggr_window_msgs > 1) {
-		info("Message aggregation enabled: WindowMsgs=%"PRIu64", WindowTime=%"PRIu64,
-		     conf->msg_aggr_window_msgs, conf->msg_aggr_window_time);
+		info("Message aggregation enabled: WindowMsgs=%"PRIu64", WindowTime=%"PRIu64"%s",
+		     conf->msg_aggr_window_msgs, conf->msg_aggr_window_time,
+		     conf->msg_aggr_adaptive ? ", WindowAdaptive=yes" : "");
 	} else
 		info("Message aggregation disabled");
 }
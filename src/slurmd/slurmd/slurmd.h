@@ -60,7 +60,8 @@ extern int devnull;
  */
 typedef enum {
 	WINDOW_TIME,
-	WINDOW_MSGS
+	WINDOW_MSGS,
+	WINDOW_ADAPTIVE
 } msg_aggr_param_type_t;
 
 /*
@@ -152,10 +153,12 @@ typedef struct slurmd_config {
 	char           *msg_aggr_params;      /* message aggregation params */
 	uint64_t        msg_aggr_window_msgs; /* msg aggr window size in msgs */
 	uint64_t        msg_aggr_window_time; /* msg aggr window size in time */
+	bool            msg_aggr_adaptive; /* msg aggr window adapts to load */
 	uint16_t	use_pam;
 	uint32_t	task_plugin_param; /* TaskPluginParams, expressed
 					 * using cpu_bind_type_t flags */
 	uint16_t	propagate_prio;	/* PropagatePrioProcess flag       */
+	bool		stepd_zygote;	/* fork slurmstepd from a zygote   */
 
 	List		starting_steps; /* steps that are starting but cannot
 					   receive RPCs yet */
@@ -177,6 +180,15 @@ extern slurmd_conf_t * conf;
  */
 int send_registration_msg(uint32_t status, bool startup);
 
+/* Return node registration message with status as the reply to a
+ * REQUEST_NODE_REGISTRATION_STATUS RPC, so that it is collected along with
+ * the other nodes' replies as the request's forwarding tree unwinds
+ * IN req - the request being replied to
+ * IN status - same values slurm error codes (for node shutdown)
+ * IN startup - non-zero if slurmd just restarted
+ */
+int reply_registration_msg(slurm_msg_t *req, uint32_t status, bool startup);
+
 /*
  * save_cred_state - save the current credential list to a file
  * IN list - list of credentials
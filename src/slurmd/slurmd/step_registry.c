@@ -0,0 +1,212 @@
+/*****************************************************************************\
+ *  step_registry.c - slurmd's record of the slurmstepd running on the node
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "slurm/slurm.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/slurmd/slurmd/slurmd.h"
+#include "src/slurmd/slurmd/step_registry.h"
+
+/* Steps are hashed by job id, so a job's steps are found without looking at
+ * those of every other job on the node */
+#define STEP_HASH_SIZE 256
+#define STEP_HASH_INX(_jobid) ((_jobid) % STEP_HASH_SIZE)
+
+typedef struct step_reg {
+	uint32_t jobid;
+	uint32_t stepid;
+	struct step_reg *next;
+} step_reg_t;
+
+static step_reg_t *step_hash[STEP_HASH_SIZE];
+static pthread_mutex_t step_hash_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void _free_step_loc(void *x)
+{
+	step_loc_t *loc = (step_loc_t *) x;
+
+	xfree(loc->directory);
+	xfree(loc->nodename);
+	xfree(loc);
+}
+
+/* Call with step_hash_lock held */
+static void _add_step(uint32_t jobid, uint32_t stepid)
+{
+	step_reg_t *step;
+	int inx = STEP_HASH_INX(jobid);
+
+	for (step = step_hash[inx]; step; step = step->next) {
+		if ((step->jobid == jobid) && (step->stepid == stepid))
+			return;
+	}
+
+	step = xmalloc(sizeof(step_reg_t));
+	step->jobid = jobid;
+	step->stepid = stepid;
+	step->next = step_hash[inx];
+	step_hash[inx] = step;
+}
+
+/* Call with step_hash_lock held */
+static void _append_loc(List steps, step_reg_t *step)
+{
+	step_loc_t *loc = xmalloc(sizeof(step_loc_t));
+
+	loc->directory = xstrdup(conf->spooldir);
+	loc->nodename = xstrdup(conf->node_name);
+	loc->jobid = step->jobid;
+	loc->stepid = step->stepid;
+	list_append(steps, loc);
+}
+
+extern void step_registry_init(void)
+{
+	List steps;
+	ListIterator itr;
+	step_loc_t *stepd;
+
+	steps = stepd_available(conf->spooldir, conf->node_name);
+	if (!steps)
+		return;
+
+	slurm_mutex_lock(&step_hash_lock);
+	itr = list_iterator_create(steps);
+	while ((stepd = list_next(itr)))
+		_add_step(stepd->jobid, stepd->stepid);
+	list_iterator_destroy(itr);
+	slurm_mutex_unlock(&step_hash_lock);
+
+	debug("%s: found %d steps in %s", __func__, list_count(steps),
+	      conf->spooldir);
+	FREE_NULL_LIST(steps);
+}
+
+extern void step_registry_fini(void)
+{
+	step_reg_t *step, *next;
+	int inx;
+
+	slurm_mutex_lock(&step_hash_lock);
+	for (inx = 0; inx < STEP_HASH_SIZE; inx++) {
+		for (step = step_hash[inx]; step; step = next) {
+			next = step->next;
+			xfree(step);
+		}
+		step_hash[inx] = NULL;
+	}
+	slurm_mutex_unlock(&step_hash_lock);
+}
+
+extern void step_registry_add(uint32_t jobid, uint32_t stepid)
+{
+	slurm_mutex_lock(&step_hash_lock);
+	_add_step(jobid, stepid);
+	slurm_mutex_unlock(&step_hash_lock);
+}
+
+extern void step_registry_remove(uint32_t jobid, uint32_t stepid)
+{
+	step_reg_t *step, **step_pptr;
+
+	slurm_mutex_lock(&step_hash_lock);
+	step_pptr = &step_hash[STEP_HASH_INX(jobid)];
+	while ((step = *step_pptr)) {
+		if ((step->jobid == jobid) && (step->stepid == stepid)) {
+			*step_pptr = step->next;
+			xfree(step);
+			break;
+		}
+		step_pptr = &step->next;
+	}
+	slurm_mutex_unlock(&step_hash_lock);
+}
+
+extern List step_registry_list(uint32_t jobid)
+{
+	List steps = list_create(_free_step_loc);
+	step_reg_t *step;
+	int inx;
+
+	slurm_mutex_lock(&step_hash_lock);
+	if (jobid != NO_VAL) {
+		for (step = step_hash[STEP_HASH_INX(jobid)]; step;
+		     step = step->next) {
+			if (step->jobid == jobid)
+				_append_loc(steps, step);
+		}
+	} else {
+		for (inx = 0; inx < STEP_HASH_SIZE; inx++) {
+			for (step = step_hash[inx]; step; step = step->next)
+				_append_loc(steps, step);
+		}
+	}
+	slurm_mutex_unlock(&step_hash_lock);
+
+	return steps;
+}
+
+extern int step_registry_connect(step_loc_t *stepd)
+{
+	struct stat stat_buf;
+	char *name = NULL;
+	int fd, save_errno;
+
+	fd = stepd_connect(stepd->directory, stepd->nodename,
+			   stepd->jobid, stepd->stepid,
+			   &stepd->protocol_version);
+	if (fd != -1)
+		return fd;
+
+	/* stepd_connect() also unlinks a socket nobody listens on */
+	save_errno = errno;
+	xstrfmtcat(name, "%s/%s_%u.%u", stepd->directory, stepd->nodename,
+		   stepd->jobid, stepd->stepid);
+	if ((stat(name, &stat_buf) < 0) && (errno == ENOENT)) {
+		debug3("%s: step %u.%u is gone", __func__,
+		       stepd->jobid, stepd->stepid);
+		step_registry_remove(stepd->jobid, stepd->stepid);
+	}
+	xfree(name);
+	errno = save_errno;
+
+	return -1;
+}
@@ -0,0 +1,75 @@
+/*****************************************************************************\
+ *  step_registry.h - slurmd's record of the slurmstepd running on the node
+ *****************************************************************************
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMD_STEP_REGISTRY_H
+#define _SLURMD_STEP_REGISTRY_H
+
+#include <inttypes.h>
+
+#include "src/common/list.h"
+#include "src/common/stepd_api.h"
+
+/*
+ * Load the registry from the slurmstepd sockets in the spool directory, the
+ * only time it is scanned. Steps launched afterwards are added by slurmd as
+ * their slurmstepd starts listening.
+ */
+extern void step_registry_init(void);
+
+/* Forget every step and free the registry's memory */
+extern void step_registry_fini(void);
+
+/* Record a slurmstepd that is listening on its socket */
+extern void step_registry_add(uint32_t jobid, uint32_t stepid);
+
+/* Forget a step whose slurmstepd is gone */
+extern void step_registry_remove(uint32_t jobid, uint32_t stepid);
+
+/*
+ * Build a list of the registered steps, as stepd_available() would from
+ * the spool directory.
+ * IN jobid - job whose steps to list, or NO_VAL for the steps of every job
+ * RET List of step_loc_t, free with FREE_NULL_LIST()
+ */
+extern List step_registry_list(uint32_t jobid);
+
+/*
+ * stepd_connect() to a step from step_registry_list(), forgetting the step
+ * if its socket is gone. Steps are removed this way rather than on exit,
+ * which slurmd is not told of.
+ * IN/OUT stepd - step to connect to, protocol_version is set
+ * RET socket descriptor or -1 on error
+ */
+extern int step_registry_connect(step_loc_t *stepd);
+
+#endif /* _SLURMD_STEP_REGISTRY_H */
@@ -55,6 +55,7 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -120,8 +121,18 @@ struct client_io_info {
 
 	/* true if writing to a file, false if writing to a socket */
 	bool is_local_file;
+
+	/* output coalescing (LAUNCH_COALESCE_IO) */
+	struct io_buf *batch;		/* SLURM_IO_BATCH being written */
+	struct timeval hold_start;	/* when queued output was first held */
 };
 
+/* Latency cap on output held back for coalescing, in msec */
+static int io_batch_delay = IO_BATCH_DELAY_MSEC;
+
+static bool _client_hold_output(eio_obj_t *);
+static struct io_buf *_client_build_batch(struct client_io_info *);
+
 
 static bool _local_file_writable(eio_obj_t *);
 static int  _local_file_write(eio_obj_t *, List);
@@ -208,6 +219,8 @@ static void _route_msg_task_to_client(eio_obj_t *obj);
 static void _free_outgoing_msg(struct io_buf *msg, stepd_step_rec_t *job);
 static void _free_incoming_msg(struct io_buf *msg, stepd_step_rec_t *job);
 static void _free_all_outgoing_msgs(List msg_queue, stepd_step_rec_t *job);
+static void _put_free_incoming(struct io_buf *msg, stepd_step_rec_t *job);
+static void _clients_changed(stepd_step_rec_t *job);
 static bool _incoming_buf_free(stepd_step_rec_t *job);
 static bool _outgoing_buf_free(stepd_step_rec_t *job);
 static int  _send_connection_okay_response(stepd_step_rec_t *job);
@@ -287,14 +300,107 @@ _client_writable(eio_obj_t *obj)
 		debug5("  client->out.msg_queue queue length = %d",
 		       list_count(client->msg_queue));
 
-	if (client->out_msg != NULL
-	    || !list_is_empty(client->msg_queue))
+	if (client->out_msg != NULL)
+		return true;
+	if (!list_is_empty(client->msg_queue)
+	    && !_client_hold_output(obj))
 		return true;
 
 	debug5("  false");
 	return false;
 }
 
+/*
+ * With LAUNCH_COALESCE_IO, hold back output queued for a client until a
+ * full batch has accumulated or the oldest queued message has waited
+ * io_batch_delay msec, so that lines from many tasks reach the client in
+ * one SLURM_IO_BATCH message instead of one write per task read.
+ * RET true if the queued output should stay queued for now
+ */
+static bool
+_client_hold_output(eio_obj_t *obj)
+{
+	struct client_io_info *client = (struct client_io_info *) obj->arg;
+	ListIterator msgs;
+	struct io_buf *msg;
+	struct timeval now;
+	uint32_t len = 0;
+	int wait_msec;
+
+	if (((client->job->flags & LAUNCH_COALESCE_IO) == 0)
+	    || (io_batch_delay <= 0) || obj->shutdown)
+		return false;
+	if (list_count(client->msg_queue) >= IO_BATCH_MAX_MSGS)
+		return false;
+	msgs = list_iterator_create(client->msg_queue);
+	while ((msg = list_next(msgs)))
+		len += msg->length;
+	list_iterator_destroy(msgs);
+	if (len >= IO_BATCH_FLUSH_LEN)
+		return false;
+
+	gettimeofday(&now, NULL);
+	if (client->hold_start.tv_sec == 0) {
+		client->hold_start = now;
+		wait_msec = io_batch_delay;
+	} else {
+		wait_msec = io_batch_delay -
+			((now.tv_sec - client->hold_start.tv_sec) * 1000 +
+			 (now.tv_usec - client->hold_start.tv_usec) / 1000);
+		if (wait_msec <= 0)
+			return false;
+	}
+	debug5("  holding %u bytes for %d msec", len, wait_msec);
+	eio_handle_timeout(client->job->eio, wait_msec);
+	return true;
+}
+
+/*
+ * Move as many queued messages as fit into the client's private batch
+ * buffer, each still framed by its own io header, behind a single
+ * SLURM_IO_BATCH header.
+ */
+static struct io_buf *
+_client_build_batch(struct client_io_info *client)
+{
+	struct io_buf *batch, *msg;
+	struct slurm_io_header header;
+	Buf packbuf;
+	int hdr_len = io_hdr_packed_size();
+	int cnt = 0;
+
+	if (client->batch == NULL) {
+		client->batch = xmalloc(sizeof(struct io_buf));
+		client->batch->data = xmalloc(hdr_len + IO_BATCH_MAX_LEN);
+	}
+	batch = client->batch;
+	batch->length = hdr_len;
+	while ((cnt < IO_BATCH_MAX_MSGS)
+	       && (msg = list_peek(client->msg_queue))
+	       && (batch->length + msg->length <= hdr_len + IO_BATCH_MAX_LEN)) {
+		(void) list_dequeue(client->msg_queue);
+		memcpy(batch->data + batch->length, msg->data, msg->length);
+		batch->length += msg->length;
+		cnt++;
+		/* May route more task output onto client->msg_queue */
+		_free_outgoing_msg(msg, client->job);
+	}
+
+	header.type = SLURM_IO_BATCH;
+	header.gtaskid = 0;
+	header.ltaskid = 0;
+	header.length = batch->length - hdr_len;
+	packbuf = create_buf(batch->data, hdr_len);
+	io_hdr_pack(&header, packbuf);
+	/* free the Buf packbuf, but not the memory to which it points */
+	packbuf->head = NULL;
+	free_buf(packbuf);
+	batch->ref_count = 0;
+
+	debug5("  batched %d messages, %u bytes", cnt, header.length);
+	return batch;
+}
+
 static int
 _client_read(eio_obj_t *obj, List objs)
 {
@@ -320,7 +426,7 @@ _client_read(eio_obj_t *obj, List objs)
 		if (n <= 0) { /* got eof or fatal error */
 			debug5("  got eof or error _client_read header, n=%d", n);
 			client->in_eof = true;
-			list_enqueue(client->job->free_incoming, client->in_msg);
+			_put_free_incoming(client->in_msg, client->job);
 			client->in_msg = NULL;
 			return SLURM_SUCCESS;
 		}
@@ -338,7 +444,7 @@ _client_read(eio_obj_t *obj, List objs)
 	if (client->header.type == SLURM_IO_CONNECTION_TEST) {
 		if (client->header.length != 0) {
 			debug5("  error in _client_read: bad connection test");
-			list_enqueue(client->job->free_incoming, client->in_msg);
+			_put_free_incoming(client->in_msg, client->job);
 			client->in_msg = NULL;
 			return SLURM_ERROR;
 		}
@@ -352,7 +458,7 @@ _client_read(eio_obj_t *obj, List objs)
 			 */
 			return SLURM_SUCCESS;
 		}
-		list_enqueue(client->job->free_incoming, client->in_msg);
+		_put_free_incoming(client->in_msg, client->job);
 		client->in_msg = NULL;
 		return SLURM_SUCCESS;
 	} else if (client->header.length == 0) { /* zero length is an eof message */
@@ -374,7 +480,7 @@ _client_read(eio_obj_t *obj, List objs)
 		if (n <= 0) { /* got eof (or unhandled error) */
 			debug5("  got eof on _client_read body");
 			client->in_eof = true;
-			list_enqueue(client->job->free_incoming, client->in_msg);
+			_put_free_incoming(client->in_msg, client->job);
 			client->in_msg = NULL;
 			return SLURM_SUCCESS;
 		}
@@ -405,6 +511,7 @@ _client_read(eio_obj_t *obj, List objs)
 				io = (struct task_write_info *)task->in->arg;
 				client->in_msg->ref_count++;
 				list_enqueue(io->msg_queue, client->in_msg);
+				eio_obj_changed(task->in);
 			}
 			debug5("  message ref_count = %d", client->in_msg->ref_count);
 		} else {
@@ -417,6 +524,7 @@ _client_read(eio_obj_t *obj, List objs)
 					continue;
 				client->in_msg->ref_count++;
 				list_enqueue(io->msg_queue, client->in_msg);
+				eio_obj_changed(task->in);
 				break;
 			}
 		}
@@ -445,7 +553,12 @@ _client_write(eio_obj_t *obj, List objs)
 	 * next message from the queue.
 	 */
 	if (client->out_msg == NULL) {
-		client->out_msg = list_dequeue(client->msg_queue);
+		if ((client->job->flags & LAUNCH_COALESCE_IO)
+		    && (list_count(client->msg_queue) > 1))
+			client->out_msg = _client_build_batch(client);
+		else
+			client->out_msg = list_dequeue(client->msg_queue);
+		client->hold_start.tv_sec = 0;
 		if (client->out_msg == NULL) {
 			debug5("_client_write: nothing in the queue");
 			return SLURM_SUCCESS;
@@ -484,7 +597,8 @@ again:
 	if (client->out_remaining > 0)
 		return SLURM_SUCCESS;
 
-	_free_outgoing_msg(client->out_msg, client->job);
+	if (client->out_msg != client->batch)
+		_free_outgoing_msg(client->out_msg, client->job);
 	client->out_msg = NULL;
 
 	return SLURM_SUCCESS;
@@ -1256,6 +1370,7 @@ _send_connection_okay_response(stepd_step_rec_t *job)
 		xassert(client->magic == CLIENT_IO_MAGIC);
 		if (list_enqueue(client->msg_queue, msg))
 			msg->ref_count++;
+		eio_obj_changed(eio);
 	}
 	list_iterator_destroy(clients);
 
@@ -1340,8 +1455,11 @@ _route_msg_task_to_client(eio_obj_t *obj)
 			xassert(client->magic == CLIENT_IO_MAGIC);
 			if (list_enqueue(client->msg_queue, msg))
 				msg->ref_count++;
+			eio_obj_changed(eio);
 		}
 		list_iterator_destroy(clients);
+		/* Room in the cbuf, the task may be readable again */
+		eio_obj_changed(obj);
 
 		/* Update the outgoing message cache */
 		if (list_enqueue(out->job->outgoing_cache, msg)) {
@@ -1351,17 +1469,34 @@ _route_msg_task_to_client(eio_obj_t *obj)
 	}
 }
 
+/* Ask every client whether it is readable or writable again */
+static void
+_clients_changed(stepd_step_rec_t *job)
+{
+	ListIterator clients;
+	eio_obj_t *eio;
+
+	clients = list_iterator_create(job->clients);
+	while ((eio = list_next(clients)))
+		eio_obj_changed(eio);
+	list_iterator_destroy(clients);
+}
+
+/* Put a message back on the free List, clients which ran out of incoming
+ * buffers may be readable again */
+static void
+_put_free_incoming(struct io_buf *msg, stepd_step_rec_t *job)
+{
+	list_enqueue(job->free_incoming, msg);
+	_clients_changed(job);
+}
+
 static void
 _free_incoming_msg(struct io_buf *msg, stepd_step_rec_t *job)
 {
 	msg->ref_count--;
-	if (msg->ref_count == 0) {
-		/* Put the message back on the free List */
-		list_enqueue(job->free_incoming, msg);
-
-		/* Kick the event IO engine */
-		eio_signal_wakeup(job->eio);
-	}
+	if (msg->ref_count == 0)
+		_put_free_incoming(msg, job);
 }
 
 static void
@@ -1389,8 +1524,6 @@ _free_outgoing_msg(struct io_buf *msg, stepd_step_rec_t *job)
 					break;
 			}
 		}
-		/* Kick the event IO engine */
-		eio_signal_wakeup(job->eio);
 	}
 }
 
@@ -1452,6 +1585,29 @@ io_close_all(stepd_step_rec_t *job)
 	eio_signal_shutdown(job->eio);
 }
 
+/*
+ * Free the client state of an eio object on job->clients. Messages still
+ * queued belong to the job's buffer lists, the object itself to job->eio.
+ */
+void
+io_client_destroy(void *arg)
+{
+	eio_obj_t *obj = (eio_obj_t *) arg;
+	struct client_io_info *client;
+
+	if (!obj || !(client = (struct client_io_info *) obj->arg))
+		return;
+	xassert(client->magic == CLIENT_IO_MAGIC);
+
+	if (client->batch) {
+		xfree(client->batch->data);
+		xfree(client->batch);
+	}
+	FREE_NULL_LIST(client->msg_queue);
+	obj->arg = NULL;
+	xfree(client);
+}
+
 void
 io_close_local_fds(stepd_step_rec_t *job)
 {
@@ -1485,6 +1641,7 @@ _io_thr(void *arg)
 {
 	stepd_step_rec_t *job = (stepd_step_rec_t *) arg;
 	sigset_t set;
+	char *launch_params, *tmp;
 	int rc;
 
 	/* A SIGHUP signal signals a reattach to the mgr thread.  We need
@@ -1496,6 +1653,14 @@ _io_thr(void *arg)
 	sigaddset(&set, SIGPIPE);
 	pthread_sigmask(SIG_BLOCK, &set, NULL);
 
+	launch_params = slurm_get_launch_params();
+	if (launch_params && strstr(launch_params, "eio_epoll"))
+		(void) eio_handle_use_epoll(job->eio);
+	if (launch_params &&
+	    (tmp = strstr(launch_params, "io_coalesce_delay=")))
+		io_batch_delay = atoi(tmp + 18);
+	xfree(launch_params);
+
 	debug("IO handler started pid=%lu", (unsigned long) getpid());
 	rc = eio_handle_mainloop(job->eio);
 	debug("IO handler exited, rc=%d", rc);
@@ -1793,6 +1958,7 @@ _send_eof_msg(struct task_read_info *out)
 
 		if (list_enqueue(client->msg_queue, msg))
 			msg->ref_count++;
+		eio_obj_changed(eio);
 	}
 	list_iterator_destroy(clients);
 
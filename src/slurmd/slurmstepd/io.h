@@ -131,6 +131,12 @@ void io_close_all(stepd_step_rec_t *job);
 
 void io_close_local_fds(stepd_step_rec_t *job);
 
+/*
+ *  Destructor for job->clients, freeing the state of each client once
+ *  the IO thread has exited. Call before eio_handle_destroy(job->eio).
+ */
+void io_client_destroy(void *arg);
+
 
 /*
  *  Look for a pattern in the stdout and stderr file names, and see
@@ -1095,6 +1095,37 @@ fail1:
 	return rc;
 }
 
+/*
+ * Load the plugins used by every step.
+ */
+extern int mgr_init_plugins(void)
+{
+	char *ckpt_type = slurm_get_checkpoint_type();
+	int rc = SLURM_SUCCESS;
+
+	/* run now so we don't drop permissions on any of the gather plugins */
+	acct_gather_conf_init();
+
+	/*
+	 * Preload all plugins at start time to avoid plugin changes
+	 * (i.e. due to a Slurm upgrade) after the process starts.
+	 */
+	if ((core_spec_g_init() != SLURM_SUCCESS)		||
+	    (switch_init() != SLURM_SUCCESS)			||
+	    (slurmd_task_init() != SLURM_SUCCESS)		||
+	    (slurm_proctrack_init() != SLURM_SUCCESS)		||
+	    (checkpoint_init(ckpt_type) != SLURM_SUCCESS)	||
+	    (jobacct_gather_init() != SLURM_SUCCESS)		||
+	    (acct_gather_profile_init() != SLURM_SUCCESS)	||
+	    (slurm_crypto_init() != SLURM_SUCCESS)		||
+	    (job_container_init() != SLURM_SUCCESS)		||
+	    (gres_plugin_init() != SLURM_SUCCESS))
+		rc = SLURM_PLUGIN_NAME_INVALID;
+	xfree(ckpt_type);
+
+	return rc;
+}
+
 /*
  * Executes the functions of the slurmd job manager process,
  * which runs as root and performs shared memory and interconnect
@@ -1108,7 +1139,6 @@ job_manager(stepd_step_rec_t *job)
 {
 	int  rc = SLURM_SUCCESS;
 	bool io_initialized = false;
-	char *ckpt_type = slurm_get_checkpoint_type();
 	char *err_msg = NULL;
 
 	debug3("Entered job_manager for %u.%u pid=%d",
@@ -1119,26 +1149,9 @@ job_manager(stepd_step_rec_t *job)
 		debug ("Unable to set dumpable to 1");
 #endif /* PR_SET_DUMPABLE */
 
-	/* run now so we don't drop permissions on any of the gather plugins */
-	acct_gather_conf_init();
-
-	/*
-	 * Preload all plugins at start time to avoid plugin changes
-	 * (i.e. due to a Slurm upgrade) after the process starts.
-	 */
-	if ((core_spec_g_init() != SLURM_SUCCESS)		||
-	    (switch_init() != SLURM_SUCCESS)			||
-	    (slurmd_task_init() != SLURM_SUCCESS)		||
-	    (slurm_proctrack_init() != SLURM_SUCCESS)		||
-	    (checkpoint_init(ckpt_type) != SLURM_SUCCESS)	||
-	    (jobacct_gather_init() != SLURM_SUCCESS)		||
-	    (acct_gather_profile_init() != SLURM_SUCCESS)	||
-	    (slurm_crypto_init() != SLURM_SUCCESS)		||
-	    (job_container_init() != SLURM_SUCCESS)		||
-	    (gres_plugin_init() != SLURM_SUCCESS)) {
-		rc = SLURM_PLUGIN_NAME_INVALID;
+	/* A slurmstepd forked from a zygote has these loaded already */
+	if ((rc = mgr_init_plugins()) != SLURM_SUCCESS)
 		goto fail1;
-	}
 	if (mpi_hook_slurmstepd_init(&job->env) != SLURM_SUCCESS) {
 		rc = SLURM_MPI_PLUGIN_NAME_INVALID;
 		goto fail1;
@@ -1393,7 +1406,6 @@ fail1:
 	if (!job->batch && core_spec_g_clear(job->cont_id))
 		error("core_spec_g_clear: %m");
 
-	xfree(ckpt_type);
 	return(rc);
 }
 
@@ -68,6 +68,13 @@ stepd_step_rec_t *mgr_launch_batch_job_setup(batch_job_launch_msg_t *msg,
  */
 void mgr_launch_batch_job_cleanup(stepd_step_rec_t *job, int rc);
 
+/*
+ * Load the plugins used by every step. Called by job_manager(), or once by
+ * a slurmstepd zygote before it forks the slurmstepd of each step.
+ * Returns SLURM_SUCCESS or SLURM_PLUGIN_NAME_INVALID.
+ */
+extern int mgr_init_plugins(void);
+
 /*
  * Executes the functions of the slurmd job manager process,
  * which runs as root and performs shared memory and interconnect
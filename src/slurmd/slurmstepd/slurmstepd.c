@@ -43,6 +43,8 @@
 #include <signal.h>
 #include <stdlib.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "src/common/cpu_frequency.h"
@@ -85,6 +87,11 @@ static stepd_step_rec_t *_step_setup(slurm_addr_t *cli, slurm_addr_t *self,
 static void _step_cleanup(stepd_step_rec_t *job, slurm_msg_t *msg, int rc);
 #endif
 static int _process_cmdline (int argc, char *argv[]);
+static void _zygote(char **argv);
+static void _free_conf_lite(slurmd_conf_t *confl);
+
+/* Set by "slurmstepd zygote" */
+static bool zygote_mode = false;
 
 int slurmstepd_blocked_signals[] = {
 	SIGPIPE, 0
@@ -119,6 +126,10 @@ main (int argc, char *argv[])
 	if (slurm_auth_init(NULL) != SLURM_SUCCESS)
 		fatal( "failed to initialize authentication plugin" );
 
+	/* Only returns in the slurmstepd of a step */
+	if (zygote_mode)
+		_zygote(argv);
+
 	/* Receive job parameters from the slurmd */
 	_init_from_slurmd(STDIN_FILENO, argv, &cli, &self, &msg,
 			  &ngids, &gids);
@@ -200,20 +211,30 @@ ending:
 
 	xfree(cli);
 	xfree(self);
-	xfree(conf->block_map);
-	xfree(conf->block_map_inv);
-	xfree(conf->hostname);
-	xfree(conf->logfile);
-	xfree(conf->node_name);
-	xfree(conf->node_topo_addr);
-	xfree(conf->node_topo_pattern);
-	xfree(conf->spooldir);
+	_free_conf_lite(conf);
 	xfree(conf);
 #endif
 	info("done with job");
 	return rc;
 }
 
+/* Free the members of a slurmd_conf_t set by
+ * unpack_slurmd_conf_lite_no_alloc() */
+static void _free_conf_lite(slurmd_conf_t *confl)
+{
+	xfree(confl->block_map);
+	xfree(confl->block_map_inv);
+	xfree(confl->hostname);
+	xfree(confl->job_acct_gather_freq);
+	xfree(confl->job_acct_gather_type);
+	xfree(confl->logfile);
+	xfree(confl->node_name);
+	xfree(confl->node_topo_addr);
+	xfree(confl->node_topo_pattern);
+	xfree(confl->spooldir);
+	xfree(confl->task_epilog);
+	xfree(confl->task_prolog);
+}
 
 static slurmd_conf_t * read_slurmd_conf_lite (int fd)
 {
@@ -225,9 +246,12 @@ static slurmd_conf_t * read_slurmd_conf_lite (int fd)
 
 	/*  First check to see if we've already initialized the
 	 *   global slurmd_conf_t in 'conf'. Allocate memory if not.
+	 *   A step forked by the zygote reads its conf again, so drop
+	 *   what the zygote read first.
 	 */
 	if (conf) {
 		confl = conf;
+		_free_conf_lite(confl);
 	} else {
 		local_conf = xmalloc(sizeof(slurmd_conf_t));
 		confl = local_conf;
@@ -366,9 +390,119 @@ static int _process_cmdline (int argc, char *argv[])
 			exit (1);
 		exit (0);
 	}
+	if ((argc == 2) && (xstrcmp(argv[1], "zygote") == 0))
+		zygote_mode = true;
 	return (0);
 }
 
+/*
+ * Receive the pipes to slurmd for a new step, sent by _zygote_launch() in
+ * src/slurmd/slurmd/req.c.
+ * RET SLURM_SUCCESS, or SLURM_ERROR once slurmd closes the socket
+ */
+static int
+_zygote_recv_pipes(int sock, int *to_stepd, int *to_slurmd)
+{
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	struct iovec iov;
+	char buf[CMSG_SPACE(2 * sizeof(int))];
+	char c;
+	int fds[2];
+	ssize_t len;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = &c;
+	iov.iov_len = sizeof(c);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = buf;
+	msg.msg_controllen = sizeof(buf);
+
+	while ((len = recvmsg(sock, &msg, 0)) < 0) {
+		if (errno != EINTR) {
+			error("%s: recvmsg: %m", __func__);
+			return SLURM_ERROR;
+		}
+	}
+	if (len == 0)
+		return SLURM_ERROR;
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (!cmsg || (cmsg->cmsg_type != SCM_RIGHTS) ||
+	    (cmsg->cmsg_len != CMSG_LEN(2 * sizeof(int)))) {
+		error("%s: no pipes in message", __func__);
+		return SLURM_ERROR;
+	}
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+	*to_stepd = fds[0];
+	*to_slurmd = fds[1];
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * Run as a zygote for slurmd: read its configuration and load the step
+ * plugins once, then fork a slurmstepd for each step slurmd asks for. Each
+ * is handed the pipes slurmd would otherwise have made its stdin and
+ * stdout before exec'ing it, and is orphaned as slurmd's would be. The
+ * zygote exits when slurmd closes the socket on its stdin.
+ */
+static void
+_zygote(char **argv)
+{
+	log_options_t lopts = LOG_OPTS_INITIALIZER;
+	int to_stepd, to_slurmd;
+	pid_t pid;
+
+	log_init(argv[0], lopts, LOG_DAEMON, NULL);
+	if (!read_slurmd_conf_lite(STDIN_FILENO))
+		fatal("Failed to read conf from slurmd");
+	log_alter(conf->log_opts, 0, conf->logfile);
+	log_set_timefmt(conf->log_fmt);
+
+	if (mgr_init_plugins() != SLURM_SUCCESS) {
+		_send_fail_to_slurmd(STDIN_FILENO);
+		exit(1);
+	}
+	_send_ok_to_slurmd(STDIN_FILENO);
+	debug("slurmstepd zygote ready");
+
+	while (_zygote_recv_pipes(STDIN_FILENO, &to_stepd, &to_slurmd)
+	       == SLURM_SUCCESS) {
+		if ((pid = fork()) < 0) {
+			error("%s: fork: %m", __func__);
+		} else if (pid == 0) {
+			if (setsid() < 0)
+				error("%s: setsid: %m", __func__);
+			if ((pid = fork()) < 0) {
+				error("%s: Unable to fork grandchild: %m",
+				      __func__);
+				exit(1);
+			} else if (pid > 0) {
+				exit(0);
+			}
+
+			/* The grandchild becomes the step's slurmstepd */
+			if ((dup2(to_stepd, STDIN_FILENO) < 0) ||
+			    (dup2(to_slurmd, STDOUT_FILENO) < 0)) {
+				error("%s: dup2: %m", __func__);
+				exit(1);
+			}
+			close(to_stepd);
+			close(to_slurmd);
+			return;
+		} else if (waitpid(pid, NULL, 0) < 0) {
+			error("%s: Unable to reap child: %m", __func__);
+		}
+		close(to_stepd);
+		close(to_slurmd);
+	}
+
+	debug("slurmstepd zygote exiting");
+	exit(0);
+}
+
 
 static void
 _send_ok_to_slurmd(int sock)
@@ -314,11 +314,11 @@ stepd_step_rec_create(launch_tasks_request_msg_t *msg, uint16_t protocol_version
 	job->eio     = eio_handle_create(0);
 	job->sruns   = list_create((ListDelF) _srun_info_destructor);
 
-	/* Based on my testing the next 3 lists here could use the
+	job->clients = list_create(io_client_destroy);
+	/* Based on my testing the next 2 lists here could use the
 	 * eio_obj_destroy, but if you do you can get an invalid read.  Since
 	 * these stay until the end of the job it isn't that big of a deal.
 	 */
-	job->clients = list_create(NULL); /* FIXME! Needs destructor */
 	job->stdout_eio_objs = list_create(NULL); /* FIXME! Needs destructor */
 	job->stderr_eio_objs = list_create(NULL); /* FIXME! Needs destructor */
 	job->free_incoming = list_create(NULL); /* FIXME! Needs destructor */
@@ -577,9 +577,10 @@ stepd_step_rec_destroy(stepd_step_rec_t *job)
 		multi_prog = 1;
 	for (i = 0; i < job->node_tasks; i++)
 		_task_info_destroy(job->task[i], multi_prog);
+	/* Client state is reached through the eio objects */
+	FREE_NULL_LIST(job->clients);
 	eio_handle_destroy(job->eio);
 	FREE_NULL_LIST(job->sruns);
-	FREE_NULL_LIST(job->clients);
 	FREE_NULL_LIST(job->stdout_eio_objs);
 	FREE_NULL_LIST(job->stderr_eio_objs);
 	FREE_NULL_LIST(job->free_incoming);
@@ -662,7 +662,11 @@ static int _unpack_persist_init(slurmdbd_conn_t *slurmdbd_conn,
 	if (req_msg->version > SLURM_PROTOCOL_VERSION)
 		req_msg->version = SLURM_PROTOCOL_VERSION;
 
-	rc = _handle_init_msg(slurmdbd_conn, req_msg, uid);
+	rc = slurm_persist_conn_session_accept(slurmdbd_conn->conn, req_msg,
+					       req_msg->uid,
+					       slurmdbd_conf->auth_info);
+	if (rc == SLURM_SUCCESS)
+		rc = _handle_init_msg(slurmdbd_conn, req_msg, uid);
 
 	if (rc != SLURM_SUCCESS)
 		comment = slurm_strerror(rc);
@@ -0,0 +1,278 @@
+/* Test of src/common/eio.c with both the poll() and epoll() backends
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <src/common/eio.h>
+#include <src/common/fd.h>
+#include <src/common/xmalloc.h>
+
+/* testsuite/dejagnu.h can not be used here, its wait() conflicts with
+ * <sys/wait.h> as included through eio.h */
+static int failed;
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {			\
+	if (_tst) {				\
+		printf("\tFAILED: %s\n", _msg);	\
+		failed++;			\
+	} else					\
+		printf("\tPASSED: %s\n", _msg);	\
+} while (0)
+
+#define PIPE_CNT	64
+#define MSG_CNT		16
+
+static int bytes_read;
+static int eof_cnt;
+
+static bool _readable(eio_obj_t *obj)
+{
+	return (obj->fd >= 0);
+}
+
+static int _handle_read(eio_obj_t *obj, List objs)
+{
+	char buf[64];
+	int n;
+
+	n = read(obj->fd, buf, sizeof(buf));
+	if ((n < 0) && ((errno == EINTR) || (errno == EAGAIN)))
+		return 0;
+	if (n <= 0) {
+		close(obj->fd);
+		obj->fd = -1;
+		obj->shutdown = true;
+		eof_cnt++;
+		return 0;
+	}
+	bytes_read += n;
+	return 0;
+}
+
+static struct io_operations reader_ops = {
+	.readable	= &_readable,
+	.handle_read	= &_handle_read,
+};
+
+/* An object which never becomes ready and keeps asking to be polled again
+ * through eio_handle_timeout() until it has been examined HOLD_CNT times */
+#define HOLD_CNT	3
+static eio_handle_t *hold_eio;
+static int hold_passes;
+
+static bool _hold_readable(eio_obj_t *obj)
+{
+	if (++hold_passes > HOLD_CNT) {
+		close(obj->fd);
+		obj->fd = -1;
+		return false;
+	}
+	eio_handle_timeout(hold_eio, 10);
+	return true;
+}
+
+static struct io_operations hold_ops = {
+	.readable	= &_hold_readable,
+	.handle_read	= &_handle_read,
+};
+
+/* IDLE_CNT objects waiting on pipes nobody writes to, a "gate" object which
+ * only becomes writable once the "trigger" object has read its pipe, and
+ * which then closes the idle pipes so the mainloop ends. The trigger tells
+ * the engine about the gate through eio_obj_changed(). */
+#define IDLE_CNT	256
+static eio_obj_t *idle_objs[IDLE_CNT];
+static eio_obj_t *gate_obj;
+static int idle_fds[IDLE_CNT];
+static int idle_asks;
+static bool gate_open, gate_written;
+
+static bool _idle_readable(eio_obj_t *obj)
+{
+	idle_asks++;
+	return (obj->fd >= 0);
+}
+
+static struct io_operations idle_ops = {
+	.readable	= &_idle_readable,
+	.handle_read	= &_handle_read,
+};
+
+static int _trigger_read(eio_obj_t *obj, List objs)
+{
+	_handle_read(obj, objs);
+	gate_open = true;
+	eio_obj_changed(gate_obj);
+	return 0;
+}
+
+static struct io_operations trigger_ops = {
+	.readable	= &_readable,
+	.handle_read	= &_trigger_read,
+};
+
+static bool _gate_writable(eio_obj_t *obj)
+{
+	return ((obj->fd >= 0) && gate_open);
+}
+
+static int _gate_write(eio_obj_t *obj, List objs)
+{
+	int i;
+
+	gate_written = (write(obj->fd, "x", 1) == 1);
+	close(obj->fd);
+	obj->fd = -1;
+	for (i = 0; i < IDLE_CNT; i++) {
+		close(idle_objs[i]->fd);
+		close(idle_fds[i]);
+		idle_objs[i]->fd = -1;
+		eio_obj_changed(idle_objs[i]);
+	}
+	return 0;
+}
+
+static struct io_operations gate_ops = {
+	.readable	= NULL,
+	.writable	= &_gate_writable,
+	.handle_write	= &_gate_write,
+};
+
+/* RET 0 or -1 if a pipe can not be created */
+static int _setup_gate(eio_handle_t *eio)
+{
+	int fds[2], i;
+
+	idle_asks = 0;
+	gate_open = gate_written = false;
+	for (i = 0; i < IDLE_CNT; i++) {
+		if (pipe(fds) < 0)
+			return -1;
+		idle_fds[i] = fds[1];
+		idle_objs[i] = eio_obj_create(fds[0], &idle_ops, NULL);
+		eio_new_initial_obj(eio, idle_objs[i]);
+	}
+
+	if (pipe(fds) < 0)
+		return -1;
+	fd_set_nonblocking(fds[0]);
+	if (write(fds[1], "go", 2) != 2)
+		return -1;
+	close(fds[1]);
+	eio_new_initial_obj(eio, eio_obj_create(fds[0], &trigger_ops, NULL));
+
+	if (pipe(fds) < 0)
+		return -1;
+	gate_obj = eio_obj_create(fds[1], &gate_ops, NULL);
+	eio_new_initial_obj(eio, gate_obj);
+	/* The read end is left open for the gate's write to succeed */
+
+	return 0;
+}
+
+/* Write MSG_CNT messages into each of PIPE_CNT pipes, then run the eio
+ * mainloop until every reader has seen end of file.
+ * RET count of bytes written */
+static int _run_pipes(eio_handle_t *eio)
+{
+	char msg[] = "0123456789";
+	int fds[2], i, j, written = 0;
+
+	for (i = 0; i < PIPE_CNT; i++) {
+		if (pipe(fds) < 0) {
+			TEST(1, "pipe");
+			return -1;
+		}
+		fd_set_nonblocking(fds[0]);
+		for (j = 0; j < MSG_CNT; j++)
+			written += write(fds[1], msg, strlen(msg));
+		close(fds[1]);
+		eio_new_initial_obj(eio, eio_obj_create(fds[0], &reader_ops,
+							NULL));
+	}
+	return written;
+}
+
+int main(int argc, char *argv[])
+{
+	eio_handle_t *eio;
+	int fds[2], written, rc;
+
+	printf("\tNOTE: Testing poll() backend\n");
+	bytes_read = eof_cnt = 0;
+	eio = eio_handle_create(0);
+	written = _run_pipes(eio);
+	rc = eio_handle_mainloop(eio);
+	TEST(rc != 0, "poll mainloop return code");
+	TEST(bytes_read != written, "poll data received");
+	TEST(eof_cnt != PIPE_CNT, "poll end of file on every pipe");
+	eio_handle_destroy(eio);
+
+	printf("\tNOTE: Testing epoll() backend\n");
+	bytes_read = eof_cnt = 0;
+	eio = eio_handle_create(0);
+	if (eio_handle_use_epoll(eio) != 0) {
+		printf("\tUNTESTED: epoll not supported\n");
+	} else {
+		written = _run_pipes(eio);
+		rc = eio_handle_mainloop(eio);
+		TEST(rc != 0, "epoll mainloop return code");
+		TEST(bytes_read != written, "epoll data received");
+		TEST(eof_cnt != PIPE_CNT, "epoll end of file on every pipe");
+	}
+	eio_handle_destroy(eio);
+
+	printf("\tNOTE: Testing eio_obj_changed()\n");
+	eio = eio_handle_create(0);
+	if (eio_handle_use_epoll(eio) != 0) {
+		printf("\tUNTESTED: epoll not supported\n");
+	} else if (_setup_gate(eio) < 0) {
+		TEST(1, "pipe");
+	} else {
+		rc = eio_handle_mainloop(eio);
+		TEST(rc != 0, "changed mainloop return code");
+		TEST(!gate_written, "object changed by another is served");
+		/* Asked when added and once closed, not on every pass */
+		TEST(idle_asks > 2 * IDLE_CNT, "idle objects not asked again");
+	}
+	eio_handle_destroy(eio);
+
+	printf("\tNOTE: Testing eio_handle_timeout()\n");
+	hold_passes = 0;
+	hold_eio = eio = eio_handle_create(0);
+	if (pipe(fds) < 0) {
+		TEST(1, "pipe");
+		return failed;
+	}
+	eio_new_initial_obj(eio, eio_obj_create(fds[0], &hold_ops, NULL));
+	rc = eio_handle_mainloop(eio);
+	TEST(rc != 0, "timeout mainloop return code");
+	TEST(hold_passes != HOLD_CNT + 1, "timeout wakes idle mainloop");
+	close(fds[1]);
+	eio_handle_destroy(eio);
+
+	printf("\tNOTE: Testing eio_handle_timeout() with epoll()\n");
+	hold_passes = 0;
+	hold_eio = eio = eio_handle_create(0);
+	if (eio_handle_use_epoll(eio) != 0) {
+		printf("\tUNTESTED: epoll not supported\n");
+	} else if (pipe(fds) < 0) {
+		TEST(1, "pipe");
+	} else {
+		eio_new_initial_obj(eio, eio_obj_create(fds[0], &hold_ops,
+							NULL));
+		rc = eio_handle_mainloop(eio);
+		TEST(rc != 0, "epoll timeout mainloop return code");
+		TEST(hold_passes != HOLD_CNT + 1,
+		     "epoll timeout wakes idle mainloop");
+		close(fds[1]);
+	}
+	eio_handle_destroy(eio);
+
+	return failed;
+}
@@ -0,0 +1,136 @@
+/* Test of sbcast block offsets past 4 GiB: REQUEST_FILE_BCAST must carry the
+ * full 64 bit offset, and bcast_write_block() in src/bcast/file_bcast.c must
+ * write the block there, while blocks from older versions, whose 32 bit
+ * offset wraps, are still written in sequence.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <src/bcast/file_bcast.h>
+#include <src/common/pack.h>
+#include <src/common/slurm_cred.h>
+#include <src/common/slurm_protocol_defs.h>
+#include <src/common/slurm_protocol_pack.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+
+/* testsuite/dejagnu.h can not be used here, its wait() conflicts with
+ * <sys/wait.h> as included through slurm_protocol_defs.h */
+static int failed;
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {			\
+	if (_tst) {				\
+		printf("\tFAILED: %s\n", _msg);	\
+		failed++;			\
+	} else					\
+		printf("\tPASSED: %s\n", _msg);	\
+} while (0)
+
+#define BIG_OFFSET	((5ULL << 30) + 17)	/* 5 GiB and change */
+#define BLOCK_DATA	"sbcast block"
+
+/* A credential to pack, its signature is never checked here */
+static sbcast_cred_t *_fake_cred(void)
+{
+	sbcast_cred_t *cred;
+	Buf buffer = init_buf(256);
+
+	pack_time(time(NULL), buffer);
+	pack_time(time(NULL) + 60, buffer);
+	pack32(1234, buffer);
+	packstr("node[1-4]", buffer);
+	packmem("signature", 10, buffer);
+	set_buf_offset(buffer, 0);
+	cred = unpack_sbcast_cred(buffer);
+	free_buf(buffer);
+
+	return cred;
+}
+
+/* Pack and unpack a block with the given protocol version
+ * RET the unpacked message or NULL */
+static file_bcast_msg_t *_pack_unpack(file_bcast_msg_t *req,
+				      uint16_t protocol_version)
+{
+	slurm_msg_t msg;
+	Buf buffer = init_buf(1024);
+
+	slurm_msg_t_init(&msg);
+	msg.msg_type = REQUEST_FILE_BCAST;
+	msg.protocol_version = protocol_version;
+	msg.data = req;
+	pack_msg(&msg, buffer);
+
+	set_buf_offset(buffer, 0);
+	msg.data = NULL;
+	if (unpack_msg(&msg, buffer) != SLURM_SUCCESS)
+		msg.data = NULL;
+	free_buf(buffer);
+
+	return msg.data;
+}
+
+int main(int argc, char *argv[])
+{
+	file_bcast_msg_t req, *out;
+	char fname[] = "/tmp/file-bcast-test.XXXXXX";
+	char data[sizeof(BLOCK_DATA)];
+	struct stat stat_buf;
+	int fd;
+
+	memset(&req, 0, sizeof(file_bcast_msg_t));
+	req.fname = "/tmp/dest";
+	req.block_no = 2;
+	req.block = BLOCK_DATA;
+	req.block_len = sizeof(BLOCK_DATA);
+	req.uncomp_len = sizeof(BLOCK_DATA);
+	req.block_offset = BIG_OFFSET;
+	req.file_size = BIG_OFFSET + sizeof(BLOCK_DATA);
+	req.cred = _fake_cred();
+
+	out = _pack_unpack(&req, SLURM_PROTOCOL_VERSION);
+	TEST(!out || (out->block_offset != BIG_OFFSET) ||
+	     (out->block_len != req.block_len) ||
+	     memcmp(out->block, BLOCK_DATA, sizeof(BLOCK_DATA)),
+	     "offset past 4 GiB packed in full");
+	slurm_free_file_bcast_msg(out);
+
+	if ((fd = mkstemp(fname)) < 0) {
+		perror("mkstemp");
+		return 1;
+	}
+	unlink(fname);
+
+	if (bcast_write_block(fd, &req, SLURM_PROTOCOL_VERSION) &&
+	    (errno == EFBIG)) {
+		printf("\tSKIPPED: no large file support in /tmp\n");
+	} else {
+		TEST(fstat(fd, &stat_buf) ||
+		     (stat_buf.st_size != req.file_size),
+		     "block written past 4 GiB");
+		TEST((pread(fd, data, sizeof(data), BIG_OFFSET) !=
+		      sizeof(data)) ||
+		     memcmp(data, BLOCK_DATA, sizeof(BLOCK_DATA)),
+		     "block data at its offset");
+	}
+
+	/* 16.05 sends 32 bits of offset, the wrapped value must not be used */
+	TEST(ftruncate(fd, 0) || (lseek(fd, 0, SEEK_SET) != 0) ||
+	     bcast_write_block(fd, &req, SLURM_16_05_PROTOCOL_VERSION) ||
+	     bcast_write_block(fd, &req, SLURM_16_05_PROTOCOL_VERSION) ||
+	     fstat(fd, &stat_buf) ||
+	     (stat_buf.st_size != (2 * sizeof(BLOCK_DATA))),
+	     "blocks of older versions written in sequence");
+	close(fd);
+
+	delete_sbcast_cred(req.cred);
+
+	return failed;
+}
@@ -0,0 +1,106 @@
+/* Test of the user and group cache in src/common/id_cache.c: lookups agree
+ * with the name service, are answered from the cache when repeated, and
+ * failed lookups are cached as well.
+ */
+#include <grp.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include <src/common/id_cache.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+
+static int failed;
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {			\
+	if (_tst) {				\
+		printf("\tFAILED: %s\n", _msg);	\
+		failed++;			\
+	} else					\
+		printf("\tPASSED: %s\n", _msg);	\
+} while (0)
+
+/* A uid nobody is expected to have */
+#define NO_SUCH_UID	((uid_t) 0x7ffffffe)
+
+int main(int argc, char *argv[])
+{
+	id_cache_stats_t stats;
+	struct passwd *pw;
+	struct group *gr;
+	char *name, *user_name;
+	gid_t *gids = NULL;
+	uid_t *uids;
+	uint32_t hit_cnt;
+	int i, ngids;
+	bool found;
+
+	id_cache_init(600);
+
+	name = id_cache_uid_to_name(0);
+	TEST(xstrcmp(name, "root"), "uid 0 is root");
+	xfree(name);
+
+	pw = getpwuid(getuid());
+	user_name = id_cache_uid_to_name(getuid());
+	TEST(pw && xstrcmp(user_name, pw->pw_name),
+	     "user name agrees with getpwuid");
+
+	id_cache_get_stats(&stats);
+	hit_cnt = stats.hit_cnt;
+	name = id_cache_uid_to_name(getuid());
+	id_cache_get_stats(&stats);
+	TEST(xstrcmp(name, user_name) || (stats.hit_cnt != hit_cnt + 1),
+	     "repeated lookup answered from the cache");
+	xfree(name);
+
+	name = id_cache_uid_to_name(NO_SUCH_UID);
+	TEST(name != NULL, "unknown uid has no name");
+	name = id_cache_uid_to_name(NO_SUCH_UID);
+	id_cache_get_stats(&stats);
+	TEST((name != NULL) || (stats.neg_cnt != 1) ||
+	     (stats.hit_cnt != hit_cnt + 2), "failed lookup cached");
+	name = id_cache_uid_to_string(NO_SUCH_UID);
+	TEST(xstrcmp(name, "nobody"), "unknown uid is nobody as a string");
+	xfree(name);
+
+	if (pw && user_name) {
+		ngids = id_cache_user_gids(user_name, pw->pw_gid, &gids);
+		found = false;
+		for (i = 0; i < ngids; i++) {
+			if (gids[i] == pw->pw_gid)
+				found = true;
+		}
+		TEST(!found, "group access list includes the primary group");
+		xfree(gids);
+	}
+	xfree(user_name);
+
+	gr = getgrgid(0);
+	if (gr) {
+		uids = id_cache_group_members(gr->gr_name);
+		TEST(!uids, "members of an existing group found");
+		xfree(uids);
+	}
+
+	uids = id_cache_group_members("no-such-group-for-id-cache-test");
+	TEST(uids != NULL, "unknown group has no members");
+
+	id_cache_purge();
+	id_cache_get_stats(&stats);
+	TEST(stats.entry_cnt != 0, "purge frees every entry");
+
+	id_cache_reset_stats();
+	id_cache_get_stats(&stats);
+	TEST(stats.hit_cnt || stats.miss_cnt || stats.resolve_sum,
+	     "reset clears the counters");
+
+	id_cache_fini();
+
+	return failed;
+}
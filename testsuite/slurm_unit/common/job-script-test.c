@@ -0,0 +1,236 @@
+/* Test of the prolog and epilog support of src/slurmd/slurmd/job_script.c:
+ * timers fire in order of expiry, cancelling a timer stops it or waits for
+ * it to finish, job_script_wait() kills a script running past its timeout,
+ * and with LaunchParameters=max_job_scripts scripts run in the order they
+ * asked to.
+ */
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <src/slurmd/common/run_script.h>
+#include <src/slurmd/slurmd/ctld_conn.h>
+#include <src/slurmd/slurmd/job_script.h>
+#include <src/slurmd/slurmd/slurmd.h>
+
+/* testsuite/dejagnu.h can not be used here, its wait() conflicts with
+ * <sys/wait.h> */
+static int failed;
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {			\
+	if (_tst) {				\
+		printf("\tFAILED: %s\n", _msg);	\
+		failed++;			\
+	} else					\
+		printf("\tPASSED: %s\n", _msg);	\
+} while (0)
+
+#define SCRIPT_CNT	4
+
+/* What job_script.o needs from the rest of slurmd */
+slurmd_conf_t *conf = NULL;
+
+extern int ctld_conn_send_only_msg(slurm_msg_t *req)
+{
+	return 0;
+}
+
+extern void run_script_set_wait(run_script_wait_f wait_func)
+{
+}
+
+static pthread_mutex_t test_lock = PTHREAD_MUTEX_INITIALIZER;
+static int fired[3];
+static int fire_cnt = 0;
+static bool slow_started = false, slow_done = false;
+static int run_order[SCRIPT_CNT];
+static int run_cnt = 0, running = 0, running_max = 0;
+
+static void _timer_fire(void *arg)
+{
+	slurm_mutex_lock(&test_lock);
+	fired[fire_cnt++] = *(int *) arg;
+	slurm_mutex_unlock(&test_lock);
+}
+
+static void _timer_slow(void *arg)
+{
+	slurm_mutex_lock(&test_lock);
+	slow_started = true;
+	slurm_mutex_unlock(&test_lock);
+	usleep(500000);
+	slurm_mutex_lock(&test_lock);
+	slow_done = true;
+	slurm_mutex_unlock(&test_lock);
+}
+
+static long _delta_usec(struct timeval *start)
+{
+	struct timeval end;
+
+	gettimeofday(&end, NULL);
+	return ((end.tv_sec - start->tv_sec) * 1000000) +
+	       (end.tv_usec - start->tv_usec);
+}
+
+static uint32_t _queued(void)
+{
+	slurmd_status_t stats;
+
+	memset(&stats, 0, sizeof(slurmd_status_t));
+	job_script_get_stats(&stats);
+	return stats.job_script_queued;
+}
+
+/* A prolog that runs for a while once its turn comes */
+static void *_script(void *arg)
+{
+	job_script_t script;
+	int id = *(int *) arg;
+
+	job_script_start(&script, JOB_SCRIPT_PROLOG);
+	slurm_mutex_lock(&test_lock);
+	run_order[run_cnt++] = id;
+	running++;
+	running_max = MAX(running_max, running);
+	slurm_mutex_unlock(&test_lock);
+
+	usleep(50000);
+
+	slurm_mutex_lock(&test_lock);
+	running--;
+	slurm_mutex_unlock(&test_lock);
+	job_script_done(&script);
+
+	return NULL;
+}
+
+/* Start SCRIPT_CNT scripts, each asking to run after the one before */
+static void _run_scripts(pthread_t *threads, int *ids)
+{
+	int i, j;
+
+	run_cnt = running = running_max = 0;
+	for (i = 0; i < SCRIPT_CNT; i++) {
+		uint32_t queued = _queued();
+
+		ids[i] = i;
+		pthread_create(&threads[i], NULL, _script, &ids[i]);
+		for (j = 0; j < 100; j++) {
+			slurm_mutex_lock(&test_lock);
+			if (run_cnt > i) {
+				slurm_mutex_unlock(&test_lock);
+				break;
+			}
+			slurm_mutex_unlock(&test_lock);
+			if (_queued() > queued)
+				break;
+			usleep(10000);
+		}
+	}
+	for (i = 0; i < SCRIPT_CNT; i++)
+		pthread_join(threads[i], NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t threads[SCRIPT_CNT];
+	int ids[SCRIPT_CNT], args[3] = { 1, 2, 3 };
+	slurmd_status_t stats;
+	struct timeval start;
+	uint32_t id, cancel_id;
+	pid_t pid;
+	int i, status = 0, in_order;
+	long usec;
+
+	job_script_init();
+
+	/* Timers fire in order of expiry, not of being added */
+	job_script_timer_add(2, _timer_fire, &args[1]);
+	cancel_id = job_script_timer_add(1, _timer_fire, &args[2]);
+	job_script_timer_add(1, _timer_fire, &args[0]);
+	job_script_timer_cancel(cancel_id);
+	sleep(3);
+	slurm_mutex_lock(&test_lock);
+	TEST((fire_cnt != 2) || (fired[0] != 1) || (fired[1] != 2),
+	     "timers fire in order of expiry");
+	slurm_mutex_unlock(&test_lock);
+	TEST(fire_cnt != 2, "cancelled timer does not fire");
+
+	/* Cancelling a running timer waits for it to return */
+	id = job_script_timer_add(0, _timer_slow, NULL);
+	for (i = 0; i < 100; i++) {
+		slurm_mutex_lock(&test_lock);
+		if (slow_started) {
+			slurm_mutex_unlock(&test_lock);
+			break;
+		}
+		slurm_mutex_unlock(&test_lock);
+		usleep(10000);
+	}
+	job_script_timer_cancel(id);
+	slurm_mutex_lock(&test_lock);
+	TEST(!slow_started || !slow_done,
+	     "cancel waits for a running timer");
+	slurm_mutex_unlock(&test_lock);
+
+	/* A script exiting on time is not killed */
+	if ((pid = fork()) == 0) {
+		setpgid(0, 0);
+		_exit(3);
+	}
+	setpgid(pid, pid);
+	TEST((job_script_wait("test", pid, &status, 10) != 0) ||
+	     !WIFEXITED(status) || (WEXITSTATUS(status) != 3),
+	     "script exit status returned");
+
+	/* A script running past its timeout is killed */
+	if ((pid = fork()) == 0) {
+		setpgid(0, 0);
+		sleep(30);
+		_exit(0);
+	}
+	setpgid(pid, pid);
+	gettimeofday(&start, NULL);
+	i = job_script_wait("test", pid, &status, 1);
+	usec = _delta_usec(&start);
+	TEST((i != 0) || !WIFSIGNALED(status) ||
+	     (WTERMSIG(status) != SIGKILL), "hung script killed");
+	TEST(usec > 3000000, "hung script killed at its timeout");
+
+	memset(&stats, 0, sizeof(slurmd_status_t));
+	job_script_get_stats(&stats);
+	TEST(stats.job_script_timeouts != 1, "timeout counted");
+
+	/* One at a time, in the order they asked */
+	job_script_reconfig(1);
+	_run_scripts(threads, ids);
+	for (i = 0, in_order = 1; i < SCRIPT_CNT; i++) {
+		if (run_order[i] != i)
+			in_order = 0;
+	}
+	TEST(!in_order || (run_cnt != SCRIPT_CNT), "scripts run in order");
+	TEST(running_max != 1, "max_job_scripts=1 runs one at a time");
+
+	job_script_reconfig(2);
+	_run_scripts(threads, ids);
+	TEST(running_max != 2, "max_job_scripts=2 runs two at a time");
+
+	memset(&stats, 0, sizeof(slurmd_status_t));
+	job_script_get_stats(&stats);
+	TEST((stats.job_script_max != 2) || stats.job_script_running ||
+	     stats.job_script_queued, "script counts reported");
+	TEST(stats.prolog_hist[1] != (2 * SCRIPT_CNT),
+	     "prolog run times recorded");
+
+	job_script_fini();
+
+	return failed;
+}
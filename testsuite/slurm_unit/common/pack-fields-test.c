@@ -0,0 +1,309 @@
+/* Test of the field descriptor and bulk array un/pack functions in
+ * src/common/pack.c: messages converted to them must keep the wire format
+ * of the per-field pack functions they replaced. Randomized messages are
+ * packed both ways, compared byte for byte and unpacked again, truncated
+ * copies must fail to unpack cleanly, and the pack rates of both are
+ * reported. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <src/common/log.h>
+#include <src/common/pack.h>
+#include <src/common/slurm_acct_gather_energy.h>
+#include <src/common/slurm_protocol_defs.h>
+#include <src/common/slurm_protocol_pack.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+
+/* testsuite/dejagnu.h can not be used here, its wait() conflicts with
+ * <sys/wait.h> as included through slurm_protocol_defs.h */
+static int failed;
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {			\
+	if (_tst) {				\
+		printf("\tFAILED: %s\n", _msg);	\
+		failed++;			\
+	} else					\
+		printf("\tPASSED: %s\n", _msg);	\
+} while (0)
+
+#define ARRAY_CNT	4096
+#define BENCH_CNT	100000
+#define FUZZ_CNT	200
+#define MAX_JOBS	64
+
+static unsigned int seed = 1;
+
+static uint64_t _rand64(void)
+{
+	return ((uint64_t) rand_r(&seed) << 33) ^
+	       ((uint64_t) rand_r(&seed) << 11) ^ rand_r(&seed);
+}
+
+static long _delta_usec(struct timeval *start)
+{
+	struct timeval end;
+
+	gettimeofday(&end, NULL);
+	return ((end.tv_sec - start->tv_sec) * 1000000) +
+	       (end.tv_usec - start->tv_usec);
+}
+
+/* The SLURM_17_02_PROTOCOL_VERSION node registration as packed one field
+ * at a time before its conversion to field descriptors */
+static void _pack_node_reg_ref(slurm_node_registration_status_msg_t *msg,
+			       Buf buffer)
+{
+	acct_gather_energy_t *energy = msg->energy;
+	int i;
+
+	pack_time(msg->timestamp, buffer);
+	pack_time(msg->slurmd_start_time, buffer);
+	pack32(msg->status, buffer);
+	packstr(msg->features_active, buffer);
+	packstr(msg->features_avail, buffer);
+	packstr(msg->node_name, buffer);
+	packstr(msg->arch, buffer);
+	packstr(msg->cpu_spec_list, buffer);
+	packstr(msg->os, buffer);
+	pack16(msg->cpus, buffer);
+	pack16(msg->boards, buffer);
+	pack16(msg->sockets, buffer);
+	pack16(msg->cores, buffer);
+	pack16(msg->threads, buffer);
+	pack64(msg->real_memory, buffer);
+	pack32(msg->tmp_disk, buffer);
+	pack32(msg->up_time, buffer);
+	pack32(msg->hash_val, buffer);
+	pack32(msg->cpu_load, buffer);
+	pack64(msg->free_mem, buffer);
+
+	pack32(msg->job_count, buffer);
+	for (i = 0; i < msg->job_count; i++)
+		pack32(msg->job_id[i], buffer);
+	for (i = 0; i < msg->job_count; i++)
+		pack32(msg->step_id[i], buffer);
+	pack16(msg->startup, buffer);
+	pack32(0, buffer);	/* gres_info_size */
+	pack64(energy->base_consumed_energy, buffer);
+	pack32(energy->base_watts, buffer);
+	pack64(energy->consumed_energy, buffer);
+	pack32(energy->current_watts, buffer);
+	pack64(energy->previous_consumed_energy, buffer);
+	pack_time(energy->poll_time, buffer);
+	packstr(msg->version, buffer);
+}
+
+static slurm_node_registration_status_msg_t *_rand_node_reg(void)
+{
+	slurm_node_registration_status_msg_t *msg;
+	int i;
+
+	msg = xmalloc(sizeof(slurm_node_registration_status_msg_t));
+	msg->timestamp = (time_t) (_rand64() >> 2);
+	msg->slurmd_start_time = (time_t) (_rand64() >> 2);
+	msg->status = _rand64();
+	msg->features_active = xstrdup_printf("f%u", rand_r(&seed));
+	msg->features_avail = xstrdup_printf("f%u,g%u", rand_r(&seed),
+					     rand_r(&seed));
+	msg->node_name = xstrdup_printf("node%05u", rand_r(&seed) % 100000);
+	msg->arch = xstrdup("x86_64");
+	if (rand_r(&seed) & 1)
+		msg->cpu_spec_list = xstrdup("0-1");
+	msg->os = xstrdup("Linux");
+	msg->cpus = _rand64();
+	msg->boards = _rand64();
+	msg->sockets = _rand64();
+	msg->cores = _rand64();
+	msg->threads = _rand64();
+	msg->real_memory = _rand64();
+	msg->tmp_disk = _rand64();
+	msg->up_time = _rand64();
+	msg->hash_val = _rand64();
+	msg->cpu_load = _rand64();
+	msg->free_mem = _rand64();
+	msg->job_count = rand_r(&seed) % MAX_JOBS;
+	msg->job_id = xmalloc(sizeof(uint32_t) * msg->job_count);
+	msg->step_id = xmalloc(sizeof(uint32_t) * msg->job_count);
+	for (i = 0; i < msg->job_count; i++) {
+		msg->job_id[i] = _rand64();
+		msg->step_id[i] = _rand64();
+	}
+	msg->energy = acct_gather_energy_alloc(1);
+	msg->energy->base_consumed_energy = _rand64();
+	msg->energy->base_watts = _rand64();
+	msg->energy->consumed_energy = _rand64();
+	msg->energy->current_watts = _rand64();
+	msg->energy->previous_consumed_energy = _rand64();
+	msg->energy->poll_time = (time_t) (_rand64() >> 2);
+	msg->version = xstrdup("17.02");
+	return msg;
+}
+
+static int _node_reg_cmp(slurm_node_registration_status_msg_t *a,
+			 slurm_node_registration_status_msg_t *b)
+{
+	if ((a->timestamp != b->timestamp) ||
+	    (a->slurmd_start_time != b->slurmd_start_time) ||
+	    (a->status != b->status) || (a->cpus != b->cpus) ||
+	    (a->boards != b->boards) || (a->sockets != b->sockets) ||
+	    (a->cores != b->cores) || (a->threads != b->threads) ||
+	    (a->real_memory != b->real_memory) ||
+	    (a->tmp_disk != b->tmp_disk) || (a->up_time != b->up_time) ||
+	    (a->hash_val != b->hash_val) || (a->cpu_load != b->cpu_load) ||
+	    (a->free_mem != b->free_mem) || (a->job_count != b->job_count))
+		return 1;
+	if (xstrcmp(a->node_name, b->node_name) ||
+	    xstrcmp(a->cpu_spec_list, b->cpu_spec_list) ||
+	    xstrcmp(a->version, b->version))
+		return 1;
+	if (memcmp(a->job_id, b->job_id, sizeof(uint32_t) * a->job_count) ||
+	    memcmp(a->step_id, b->step_id, sizeof(uint32_t) * a->job_count))
+		return 1;
+	if (memcmp(a->energy, b->energy, sizeof(acct_gather_energy_t)))
+		return 1;
+	return 0;
+}
+
+static void _msg_init(slurm_msg_t *msg, void *data)
+{
+	slurm_msg_t_init(msg);
+	msg->msg_type = MESSAGE_NODE_REGISTRATION_STATUS;
+	msg->protocol_version = SLURM_PROTOCOL_VERSION;
+	msg->data = data;
+}
+
+int main(int argc, char *argv[])
+{
+	slurm_node_registration_status_msg_t *reg;
+	slurm_msg_t msg;
+	Buf ref_buf, buf, short_buf;
+	uint32_t values[ARRAY_CNT], *out_values, out_cnt, len;
+	struct timeval start;
+	long usec;
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	int i, j, cmp_errs = 0, rt_errs = 0, short_errs = 0, errs;
+
+	/* Truncated messages are logged as malformed, keep those quiet */
+	log_opts.stderr_level = LOG_LEVEL_QUIET;
+	log_init("pack-fields-test", log_opts, 0, NULL);
+
+	/* Round trip randomized messages, byte compared with the per-field
+	 * packing, and unpack every truncation of some of them */
+	for (i = 0; i < FUZZ_CNT; i++) {
+		reg = _rand_node_reg();
+		ref_buf = init_buf(0);
+		_pack_node_reg_ref(reg, ref_buf);
+		buf = init_buf(0);
+		_msg_init(&msg, reg);
+		pack_msg(&msg, buf);
+		if ((get_buf_offset(buf) != get_buf_offset(ref_buf)) ||
+		    memcmp(get_buf_data(buf), get_buf_data(ref_buf),
+			   get_buf_offset(buf)))
+			cmp_errs++;
+
+		len = get_buf_offset(buf);
+		set_buf_offset(buf, 0);
+		_msg_init(&msg, NULL);
+		if (unpack_msg(&msg, buf) || _node_reg_cmp(reg, msg.data) ||
+		    (get_buf_offset(buf) != len))
+			rt_errs++;
+		slurm_free_node_registration_status_msg(msg.data);
+
+		for (j = 0; (i < (FUZZ_CNT / 10)) && (j < len); j++) {
+			short_buf = create_buf(xmalloc(j + 1), j);
+			memcpy(get_buf_data(short_buf), get_buf_data(buf), j);
+			_msg_init(&msg, NULL);
+			if (unpack_msg(&msg, short_buf) == SLURM_SUCCESS) {
+				short_errs++;
+				slurm_free_node_registration_status_msg(
+					msg.data);
+			}
+			free_buf(short_buf);
+		}
+		free_buf(buf);
+		free_buf(ref_buf);
+		slurm_free_node_registration_status_msg(reg);
+	}
+	TEST(cmp_errs, "node registration wire format unchanged");
+	TEST(rt_errs, "node registration round trip");
+	TEST(short_errs, "truncated node registration rejected");
+
+	/* Bulk arrays keep the format of packing each value */
+	for (i = 0; i < ARRAY_CNT; i++)
+		values[i] = _rand64();
+	ref_buf = init_buf(0);
+	pack32(ARRAY_CNT, ref_buf);
+	for (i = 0; i < ARRAY_CNT; i++)
+		pack32(values[i], ref_buf);
+	buf = init_buf(0);
+	pack32_array(values, ARRAY_CNT, buf);
+	TEST((get_buf_offset(buf) != get_buf_offset(ref_buf)) ||
+	     memcmp(get_buf_data(buf), get_buf_data(ref_buf),
+		    get_buf_offset(buf)), "pack32_array wire format unchanged");
+	set_buf_offset(buf, 0);
+	errs = unpack32_array(&out_values, &out_cnt, buf);
+	TEST(errs || (out_cnt != ARRAY_CNT) ||
+	     memcmp(out_values, values, sizeof(values)),
+	     "pack32_array round trip");
+	xfree(out_values);
+	free_buf(buf);
+	len = get_buf_offset(ref_buf) - sizeof(uint32_t);
+	buf = create_buf(xmalloc(len), len);
+	memcpy(get_buf_data(buf), get_buf_data(ref_buf), len);
+	TEST(unpack32_array(&out_values, &out_cnt, buf) != SLURM_ERROR,
+	     "unpack32_array rejects count beyond buffer");
+	xfree(out_values);
+	free_buf(buf);
+	free_buf(ref_buf);
+
+	/* Compare pack rates */
+	reg = _rand_node_reg();
+	buf = init_buf(0);
+	gettimeofday(&start, NULL);
+	for (i = 0; i < BENCH_CNT; i++) {
+		set_buf_offset(buf, 0);
+		_pack_node_reg_ref(reg, buf);
+	}
+	usec = _delta_usec(&start);
+	printf("\tNOTE: node registration (%u jobs), per-field packs per sec: "
+	       "%.0f\n", reg->job_count,
+	       BENCH_CNT * 1000000.0 / (usec ? usec : 1));
+	_msg_init(&msg, reg);
+	gettimeofday(&start, NULL);
+	for (i = 0; i < BENCH_CNT; i++) {
+		set_buf_offset(buf, 0);
+		pack_msg(&msg, buf);
+	}
+	usec = _delta_usec(&start);
+	printf("\tNOTE: node registration (%u jobs), descriptor packs per sec: "
+	       "%.0f\n", reg->job_count,
+	       BENCH_CNT * 1000000.0 / (usec ? usec : 1));
+	slurm_free_node_registration_status_msg(reg);
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < (BENCH_CNT / 100); i++) {
+		set_buf_offset(buf, 0);
+		pack32(ARRAY_CNT, buf);
+		for (j = 0; j < ARRAY_CNT; j++)
+			pack32(values[j], buf);
+	}
+	usec = _delta_usec(&start);
+	printf("\tNOTE: %d value array, per-value packs per sec: %.0f\n",
+	       ARRAY_CNT, (BENCH_CNT / 100) * 1000000.0 / (usec ? usec : 1));
+	gettimeofday(&start, NULL);
+	for (i = 0; i < (BENCH_CNT / 100); i++) {
+		set_buf_offset(buf, 0);
+		pack32_array(values, ARRAY_CNT, buf);
+	}
+	usec = _delta_usec(&start);
+	printf("\tNOTE: %d value array, bulk packs per sec: %.0f\n",
+	       ARRAY_CNT, (BENCH_CNT / 100) * 1000000.0 / (usec ? usec : 1));
+	free_buf(buf);
+
+	return failed;
+}
@@ -17,9 +17,12 @@
 		pass( _msg );       \
 } while (0)
 
+/* Count of values packed to test buffer growth, 4MB of data */
+#define GROW_CNT	(1024 * 1024)
+
 int main (int argc, char *argv[])
 {
-	Buf buffer;
+	Buf buffer, buffer2;
 	uint16_t test16 = 1234, out16;
 	uint32_t test32 = 5678, out32, byte_cnt;
 	char testbytes[] = "TEST BYTES", *outbytes;
@@ -29,6 +32,8 @@ int main (int argc, char *argv[])
 	int data_size;
 	long double test_double = 1340664754944.2132312, test_double2;
 	uint64_t test64;
+	static buf_pool_t buf_pool = BUF_POOL_INITIALIZER(0);
+	uint32_t i, grow_cnt, errs;
 
 	buffer = init_buf (0);
         pack16(test16, buffer);
@@ -83,6 +88,41 @@ int main (int argc, char *argv[])
 	xfree(outstring);
 
 	free_buf(buffer);
+
+	/* Buffers grow geometrically while packing large messages */
+	buffer = init_buf(0);
+	for (i = 0, grow_cnt = 0; i < GROW_CNT; i++) {
+		out32 = size_buf(buffer);
+		pack32(i, buffer);
+		if (size_buf(buffer) != out32)
+			grow_cnt++;
+	}
+	TEST(grow_cnt > 20, "buffer growth is geometric");
+	set_buf_offset(buffer, 0);
+	for (i = 0, errs = 0; i < GROW_CNT; i++) {
+		if (unpack32(&out32, buffer) || (out32 != i))
+			errs++;
+	}
+	TEST(errs, "un/pack32 across buffer growth");
+	free_buf(buffer);
+
+	/* Buffer pools reuse released buffers and start new ones at the
+	 * largest size packed */
+	buffer = pool_init_buf(&buf_pool);
+	for (i = 0; i < GROW_CNT; i++)
+		pack32(i, buffer);
+	data = get_buf_data(buffer);
+	pool_free_buf(&buf_pool, buffer);
+	buffer = pool_init_buf(&buf_pool);
+	TEST((get_buf_data(buffer) != data) || get_buf_offset(buffer),
+	     "pool reuses released buffer");
+	/* The released buffer is still in use, so this one is new */
+	buffer2 = pool_init_buf(&buf_pool);
+	TEST(size_buf(buffer2) < (GROW_CNT * sizeof(uint32_t)),
+	     "pool sizes new buffer to high-water mark");
+	pool_free_buf(&buf_pool, buffer);
+	pool_free_buf(&buf_pool, buffer2);
+
 	totals();
 	return failed;
 
@@ -0,0 +1,248 @@
+/* Test of the connections served by slurm_persist_conn_mux_add() in
+ * src/common/slurm_persist_conn.c: messages on many connections are all
+ * read by the one mux thread, session MACs are checked on the way in and
+ * added on the way out, and a connection sending a bad MAC is closed.
+ * Neither a slow RPC nor a partly sent message holds up other connections.
+ */
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <src/common/fd.h>
+#include <src/common/siphash.h>
+#include <src/common/slurm_protocol_defs.h>
+#include <src/common/xmalloc.h>
+
+/* testsuite/dejagnu.h can not be used here, its wait() conflicts with
+ * <sys/wait.h> as included through slurm_protocol_defs.h */
+static int failed;
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {			\
+	if (_tst) {				\
+		printf("\tFAILED: %s\n", _msg);	\
+		failed++;			\
+	} else					\
+		printf("\tPASSED: %s\n", _msg);	\
+} while (0)
+
+#define CONN_CNT	32
+#define MSG_CNT		4
+#define SLOW_MSG	REQUEST_RECONFIGURE	/* processed in SLOW_USEC */
+#define SLOW_USEC	2000000
+
+static time_t shutdown_time = 0;
+static int closed_cnt = 0;
+
+static int _callback_proc(void *arg, persist_msg_t *msg, Buf *out_buffer,
+			  uint32_t *uid)
+{
+	slurm_persist_conn_t *persist_conn = arg;
+
+	if (msg->msg_type == SLOW_MSG)
+		usleep(SLOW_USEC);
+	*out_buffer = slurm_persist_make_rc_msg(persist_conn, SLURM_SUCCESS,
+						NULL, msg->msg_type);
+	return SLURM_SUCCESS;
+}
+
+static void _callback_fini(void *arg)
+{
+	closed_cnt++;
+}
+
+static char *_key(char c)
+{
+	char *key = xmalloc(KEYLEN);
+
+	memset(key, c, KEYLEN);
+	return key;
+}
+
+/* Make a connected pair, the server end handed to the mux thread */
+static slurm_persist_conn_t *_conn_pair(char server_key, char client_key)
+{
+	slurm_persist_conn_t *client, *server;
+	int fds[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+		perror("socketpair");
+		return NULL;
+	}
+	/* As slurm_persist_conn_writeable() expects */
+	fd_set_nonblocking(fds[0]);
+	fd_set_nonblocking(fds[1]);
+
+	server = xmalloc(sizeof(slurm_persist_conn_t));
+	server->fd = fds[0];
+	server->callback_proc = _callback_proc;
+	server->callback_fini = _callback_fini;
+	server->shutdown = &shutdown_time;
+	server->timeout = 30000;	/* the partial message outlives the test */
+	server->version = SLURM_PROTOCOL_VERSION;
+	server->session_key = _key(server_key);
+	server->session_server = true;
+	slurm_persist_conn_mux_add(server, server);
+
+	client = xmalloc(sizeof(slurm_persist_conn_t));
+	client->fd = fds[1];
+	client->shutdown = &shutdown_time;
+	client->timeout = 5000;
+	client->version = SLURM_PROTOCOL_VERSION;
+	client->session_key = _key(client_key);
+
+	return client;
+}
+
+static int _send(slurm_persist_conn_t *client, uint16_t msg_type)
+{
+	persist_msg_t msg;
+	Buf buffer;
+	int rc;
+
+	memset(&msg, 0, sizeof(persist_msg_t));
+	msg.msg_type = msg_type;
+	buffer = slurm_persist_msg_pack(client, &msg);
+	rc = slurm_persist_send_msg(client, buffer);
+	free_buf(buffer);
+
+	return rc;
+}
+
+static int _send_ping(slurm_persist_conn_t *client)
+{
+	return _send(client, REQUEST_PING);
+}
+
+/* RET SLURM_SUCCESS if an rc message for msg_type came back */
+static int _recv_rc_type(slurm_persist_conn_t *client, uint16_t msg_type)
+{
+	persist_msg_t msg;
+	persist_rc_msg_t *rc_msg;
+	Buf buffer;
+	int rc;
+
+	if (!(buffer = slurm_persist_recv_msg(client)))
+		return SLURM_ERROR;
+
+	memset(&msg, 0, sizeof(persist_msg_t));
+	rc = slurm_persist_msg_unpack(client, &msg, buffer);
+	free_buf(buffer);
+	if (rc != SLURM_SUCCESS)
+		return rc;
+
+	rc_msg = msg.data;
+	if ((msg.msg_type != PERSIST_RC) || rc_msg->rc ||
+	    (rc_msg->ret_info != msg_type))
+		rc = SLURM_ERROR;
+	slurm_persist_free_rc_msg(rc_msg);
+
+	return rc;
+}
+
+/* RET SLURM_SUCCESS if an rc message for a ping came back */
+static int _recv_rc(slurm_persist_conn_t *client)
+{
+	return _recv_rc_type(client, REQUEST_PING);
+}
+
+static long _delta_usec(struct timeval *start)
+{
+	struct timeval end;
+
+	gettimeofday(&end, NULL);
+	return ((end.tv_sec - start->tv_sec) * 1000000) +
+	       (end.tv_usec - start->tv_usec);
+}
+
+int main(int argc, char *argv[])
+{
+	slurm_persist_conn_t *clients[CONN_CNT], *bad;
+	persist_mux_stats_t stats;
+	struct timeval start;
+	uint32_t nw_size;
+	int i, j, send_err = 0, recv_err = 0;
+
+	/* Interleave the messages of all connections */
+	for (i = 0; i < CONN_CNT; i++)
+		clients[i] = _conn_pair('k', 'k');
+	for (j = 0; j < MSG_CNT; j++) {
+		for (i = 0; i < CONN_CNT; i++) {
+			if (_send_ping(clients[i]) != SLURM_SUCCESS)
+				send_err++;
+		}
+		for (i = 0; i < CONN_CNT; i++) {
+			if (_recv_rc(clients[i]) != SLURM_SUCCESS)
+				recv_err++;
+		}
+	}
+	TEST(send_err, "send on every connection");
+	TEST(recv_err, "signed response to every message");
+
+	slurm_persist_conn_mux_get_stats(&stats);
+	TEST(stats.conn_cnt != CONN_CNT, "open connections counted");
+	TEST(stats.msg_cnt != (CONN_CNT * MSG_CNT), "messages counted");
+	TEST(stats.msg_max != MSG_CNT, "messages per connection counted");
+
+	/* Other connections are answered while one message is processed */
+	_send(clients[2], SLOW_MSG);
+	gettimeofday(&start, NULL);
+	_send_ping(clients[3]);
+	TEST((_recv_rc(clients[3]) != SLURM_SUCCESS) ||
+	     (_delta_usec(&start) >= (SLOW_USEC / 2)),
+	     "slow RPC does not hold up other connections");
+	TEST(_recv_rc_type(clients[2], SLOW_MSG) != SLURM_SUCCESS,
+	     "slow RPC answered");
+
+	/* Nor while one message is partly sent */
+	nw_size = htonl(100);
+	TEST((write(clients[4]->fd, &nw_size, sizeof(nw_size)) !=
+	      sizeof(nw_size)) || (write(clients[4]->fd, "part", 4) != 4),
+	     "partial message sent");
+	gettimeofday(&start, NULL);
+	_send_ping(clients[5]);
+	TEST((_recv_rc(clients[5]) != SLURM_SUCCESS) ||
+	     (_delta_usec(&start) >= (SLOW_USEC / 2)),
+	     "partial message does not hold up other connections");
+
+	/* The mux thread must drop the sender of a bad MAC and nobody else */
+	bad = _conn_pair('k', 'x');
+	_send_ping(bad);
+	TEST(_recv_rc(bad) == SLURM_SUCCESS, "bad session MAC rejected");
+	for (i = 0; i < 50 && !closed_cnt; i++)
+		usleep(10000);
+	TEST(closed_cnt != 1, "bad session MAC closes the connection");
+	slurm_persist_conn_destroy(bad);
+
+	_send_ping(clients[0]);
+	TEST(_recv_rc(clients[0]) != SLURM_SUCCESS,
+	     "other connections unaffected");
+
+	/* Closing the client end closes the server end */
+	slurm_persist_conn_destroy(clients[1]);
+	clients[1] = NULL;
+	for (i = 0; i < 50 && (closed_cnt < 2); i++)
+		usleep(10000);
+	slurm_persist_conn_mux_get_stats(&stats);
+	TEST(stats.conn_cnt != (CONN_CNT - 1), "EOF closes the connection");
+	TEST(stats.conn_closed != 2, "closed connections counted");
+
+	slurm_persist_conn_mux_reset_stats();
+	slurm_persist_conn_mux_get_stats(&stats);
+	TEST(stats.msg_cnt || stats.conn_opened ||
+	     (stats.conn_cnt != (CONN_CNT - 1)),
+	     "reset keeps only the open connection count");
+
+	slurm_persist_conn_mux_fini();
+	TEST(closed_cnt != (CONN_CNT + 1), "fini closes every connection");
+
+	for (i = 0; i < CONN_CNT; i++)
+		slurm_persist_conn_destroy(clients[i]);
+
+	return failed;
+}
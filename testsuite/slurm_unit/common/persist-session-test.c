@@ -0,0 +1,250 @@
+/* Test of the session MACs added to persistant connection messages by
+ * slurm_persist_send_msg() and checked by slurm_persist_recv_msg() in
+ * src/common/slurm_persist_conn.c: a message is only taken if it carries
+ * the MAC of the session key, of the next sequence number and of the
+ * direction it was sent in, so altered, unsigned, replayed, reordered and
+ * reflected messages are all rejected.
+ *
+ * Every message is read off the wire as sent and then written to the
+ * receiving end by the test, standing in for whoever is on the network.
+ */
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <src/common/fd.h>
+#include <src/common/siphash.h>
+#include <src/common/slurm_protocol_defs.h>
+#include <src/common/xmalloc.h>
+
+/* testsuite/dejagnu.h can not be used here, its wait() conflicts with
+ * <sys/wait.h> as included through slurm_protocol_defs.h */
+static int failed;
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {			\
+	if (_tst) {				\
+		printf("\tFAILED: %s\n", _msg);	\
+		failed++;			\
+	} else					\
+		printf("\tPASSED: %s\n", _msg);	\
+} while (0)
+
+typedef struct {
+	char *data;
+	uint32_t size;
+} frame_t;
+
+static time_t shutdown_time = 0;
+
+/* One end of a connection, the other end of its socket (*wire) is left
+ * to the test. server is set for the end that accepted the session. */
+static slurm_persist_conn_t *_conn(char key, bool server, int *wire)
+{
+	slurm_persist_conn_t *persist_conn;
+	int fds[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+		perror("socketpair");
+		exit(1);
+	}
+	/* As slurm_persist_conn_writeable() expects */
+	fd_set_nonblocking(fds[0]);
+
+	persist_conn = xmalloc(sizeof(slurm_persist_conn_t));
+	persist_conn->fd = fds[0];
+	persist_conn->shutdown = &shutdown_time;
+	persist_conn->timeout = 5000;
+	persist_conn->version = SLURM_PROTOCOL_VERSION;
+	persist_conn->session_server = server;
+	if (key) {
+		persist_conn->session_key = xmalloc(KEYLEN);
+		memset(persist_conn->session_key, key, KEYLEN);
+	}
+	*wire = fds[1];
+
+	return persist_conn;
+}
+
+static int _read_all(int fd, void *buf, size_t size)
+{
+	ssize_t rc;
+
+	while (size) {
+		if ((rc = read(fd, buf, size)) <= 0)
+			return SLURM_ERROR;
+		buf = (char *) buf + rc;
+		size -= rc;
+	}
+	return SLURM_SUCCESS;
+}
+
+/* Send a message of msg_type on persist_conn and take it off the wire */
+static frame_t *_send(slurm_persist_conn_t *persist_conn, int wire,
+		      uint16_t msg_type)
+{
+	persist_msg_t msg;
+	frame_t *frame;
+	uint32_t nw_size;
+	Buf buffer;
+
+	memset(&msg, 0, sizeof(persist_msg_t));
+	msg.msg_type = msg_type;
+	buffer = slurm_persist_msg_pack(persist_conn, &msg);
+	if (slurm_persist_send_msg(persist_conn, buffer) != SLURM_SUCCESS) {
+		free_buf(buffer);
+		return NULL;
+	}
+	free_buf(buffer);
+
+	frame = xmalloc(sizeof(frame_t));
+	if (_read_all(wire, &nw_size, sizeof(nw_size)) != SLURM_SUCCESS) {
+		xfree(frame);
+		return NULL;
+	}
+	frame->size = ntohl(nw_size);
+	frame->data = xmalloc(frame->size);
+	if (_read_all(wire, frame->data, frame->size) != SLURM_SUCCESS) {
+		xfree(frame->data);
+		xfree(frame);
+		return NULL;
+	}
+
+	return frame;
+}
+
+static void _frame_free(frame_t *frame)
+{
+	if (frame) {
+		xfree(frame->data);
+		xfree(frame);
+	}
+}
+
+/* Deliver frame to persist_conn through its wire
+ * RET the type of the message taken or NO_VAL if it was rejected */
+static uint32_t _recv(slurm_persist_conn_t *persist_conn, int wire,
+		      frame_t *frame)
+{
+	persist_msg_t msg;
+	uint32_t nw_size, msg_type = NO_VAL;
+	Buf buffer;
+
+	if (!frame)
+		return NO_VAL;
+	nw_size = htonl(frame->size);
+	if ((write(wire, &nw_size, sizeof(nw_size)) != sizeof(nw_size)) ||
+	    (write(wire, frame->data, frame->size) != frame->size))
+		return NO_VAL;
+
+	if (!(buffer = slurm_persist_recv_msg(persist_conn)))
+		return NO_VAL;
+	memset(&msg, 0, sizeof(persist_msg_t));
+	if (slurm_persist_msg_unpack(persist_conn, &msg, buffer) ==
+	    SLURM_SUCCESS)
+		msg_type = msg.msg_type;
+	free_buf(buffer);
+
+	return msg_type;
+}
+
+int main(int argc, char *argv[])
+{
+	slurm_persist_conn_t *client, *server, *other, *unsigned_conn;
+	int client_wire, server_wire, other_wire, unsigned_wire;
+	frame_t *f0, *f1, *f2, *f3, *tampered, *frame;
+
+	client = _conn('k', false, &client_wire);
+	server = _conn('k', true, &server_wire);
+
+	f0 = _send(client, client_wire, REQUEST_PING);
+	TEST(!f0, "signed message sent");
+	TEST(_recv(server, server_wire, f0) != REQUEST_PING,
+	     "signed message taken");
+	TEST(_recv(server, server_wire, f0) != NO_VAL,
+	     "replayed message rejected");
+
+	f1 = _send(client, client_wire, REQUEST_RECONFIGURE);
+	f2 = _send(client, client_wire, REQUEST_CONTROL);
+	TEST(_recv(server, server_wire, f2) != NO_VAL,
+	     "message ahead of sequence rejected");
+	TEST(_recv(server, server_wire, f1) != REQUEST_RECONFIGURE,
+	     "message in sequence taken after a rejected one");
+	TEST(_recv(server, server_wire, f2) != REQUEST_CONTROL,
+	     "next message in sequence taken");
+	TEST(_recv(server, server_wire, f1) != NO_VAL,
+	     "message behind sequence rejected");
+
+	/* Flip a bit in the payload, then in the MAC itself */
+	f3 = _send(client, client_wire, REQUEST_PING);
+	tampered = xmalloc(sizeof(frame_t));
+	tampered->size = f3->size;
+	tampered->data = xmalloc(f3->size);
+	memcpy(tampered->data, f3->data, f3->size);
+	tampered->data[1] ^= 0x01;
+	TEST(_recv(server, server_wire, tampered) != NO_VAL,
+	     "altered message rejected");
+	tampered->data[1] ^= 0x01;
+	tampered->data[tampered->size - 1] ^= 0x80;
+	TEST(_recv(server, server_wire, tampered) != NO_VAL,
+	     "altered MAC rejected");
+	TEST(_recv(server, server_wire, f3) != REQUEST_PING,
+	     "original taken after altered copies");
+
+	/* Right sequence number, wrong key */
+	other = _conn('x', false, &other_wire);
+	other->session_send_seq = server->session_recv_seq;
+	frame = _send(other, other_wire, REQUEST_PING);
+	TEST(_recv(server, server_wire, frame) != NO_VAL,
+	     "message signed with another key rejected");
+	_frame_free(frame);
+
+	/* No MAC at all */
+	unsigned_conn = _conn(0, false, &unsigned_wire);
+	frame = _send(unsigned_conn, unsigned_wire, REQUEST_PING);
+	TEST(_recv(server, server_wire, frame) != NO_VAL,
+	     "unsigned message rejected");
+	_frame_free(frame);
+
+	/* Replies are signed with their own sequence */
+	frame = _send(server, server_wire, REQUEST_PING);
+	TEST(_recv(client, client_wire, frame) != REQUEST_PING,
+	     "signed reply taken");
+	TEST(_recv(client, client_wire, frame) != NO_VAL,
+	     "replayed reply rejected");
+	_frame_free(frame);
+
+	/* A reply sent back to the server with the sequence number it
+	 * expects next is still not a request */
+	frame = _send(server, server_wire, REQUEST_PING);
+	server->session_recv_seq = server->session_send_seq - 1;
+	TEST(_recv(server, server_wire, frame) != NO_VAL,
+	     "reflected reply rejected");
+	server->session_recv_seq = 4;
+	_frame_free(frame);
+
+	TEST((client->session_send_seq != 4) ||
+	     (server->session_recv_seq != 4),
+	     "sequence advanced once per message taken");
+
+	_frame_free(f0);
+	_frame_free(f1);
+	_frame_free(f2);
+	_frame_free(f3);
+	_frame_free(tampered);
+	slurm_persist_conn_destroy(client);
+	slurm_persist_conn_destroy(server);
+	slurm_persist_conn_destroy(other);
+	slurm_persist_conn_destroy(unsigned_conn);
+	close(client_wire);
+	close(server_wire);
+	close(other_wire);
+	close(unsigned_wire);
+
+	return failed;
+}
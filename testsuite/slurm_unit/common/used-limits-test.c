@@ -0,0 +1,130 @@
+/* Test of the QOS per user and per account used limits index in
+ * src/common/slurmdb_defs.c, both the lookups that add missing records and
+ * those for readers that change nothing, reporting lookup rates at 10000
+ * users as accounting policy checks do them (once per job test) */
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <src/common/list.h>
+#include <src/common/slurmdb_defs.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+
+#include <testsuite/dejagnu.h>
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {			\
+	if (_tst)				\
+		fail( _msg );			\
+	else					\
+		pass( _msg );			\
+} while (0)
+
+#define ACCT_CNT	100
+#define LOOKUP_CNT	1000000
+#define SCAN_CNT	2000
+#define TRES_CNT	4
+#define USER_CNT	10000
+
+static int _find_user(void *x, void *key)
+{
+	slurmdb_used_limits_t *used_limits = (slurmdb_used_limits_t *) x;
+
+	return (used_limits->uid == *(uint32_t *) key);
+}
+
+static long _delta_usec(struct timeval *start)
+{
+	struct timeval end;
+
+	gettimeofday(&end, NULL);
+	return ((end.tv_sec - start->tv_sec) * 1000000) +
+	       (end.tv_usec - start->tv_usec);
+}
+
+int main(int argc, char *argv[])
+{
+	slurmdb_qos_usage_t *usage;
+	slurmdb_used_limits_t *used_limits, *users[USER_CNT];
+	char acct[32];
+	struct timeval start;
+	uint32_t uid;
+	long usec;
+	int i, errs;
+
+	usage = slurmdb_create_qos_usage(TRES_CNT);
+
+	/* Records are added once and found again */
+	for (i = 0; i < USER_CNT; i++)
+		users[i] = slurmdb_get_user_used_limits(usage, i * 7, TRES_CNT);
+	for (i = 0, errs = 0; i < USER_CNT; i++) {
+		used_limits = slurmdb_get_user_used_limits(usage, i * 7,
+							   TRES_CNT);
+		if ((used_limits != users[i]) || (used_limits->uid != i * 7))
+			errs++;
+	}
+	TEST(errs, "find user records");
+	TEST(list_count(usage->user_limit_list) != USER_CNT,
+	     "one record per user");
+
+	for (i = 0, errs = 0; i < ACCT_CNT; i++) {
+		snprintf(acct, sizeof(acct), "acct%d", i);
+		used_limits = slurmdb_get_acct_used_limits(usage, acct,
+							   TRES_CNT);
+		if (xstrcmp(used_limits->acct, acct) ||
+		    (slurmdb_get_acct_used_limits(usage, acct, TRES_CNT) !=
+		     used_limits))
+			errs++;
+	}
+	TEST(errs, "find account records");
+	TEST(list_count(usage->acct_limit_list) != ACCT_CNT,
+	     "one record per account");
+
+	/* Lookups for readers add nothing */
+	TEST(slurmdb_find_user_used_limits(usage, 7) != users[1],
+	     "find user record without adding");
+	TEST(slurmdb_find_user_used_limits(usage, 1) ||
+	     (list_count(usage->user_limit_list) != USER_CNT),
+	     "missing user record not added");
+	TEST(slurmdb_find_acct_used_limits(usage, "no_acct") ||
+	     (list_count(usage->acct_limit_list) != ACCT_CNT),
+	     "missing account record not added");
+
+	/* Records added to the list directly (e.g. unpacked) are found before
+	 * the index is rebuilt, then indexed */
+	used_limits = xmalloc(sizeof(slurmdb_used_limits_t));
+	used_limits->uid = 3;
+	list_append(usage->user_limit_list, used_limits);
+	TEST(slurmdb_find_user_used_limits(usage, 3) != used_limits,
+	     "find record added to list without rebuilding the index");
+	TEST(slurmdb_get_user_used_limits(usage, 3, TRES_CNT) != used_limits,
+	     "find record added to list");
+	TEST(usage->user_limit_hash_cnt != (USER_CNT + 1),
+	     "index rebuilt");
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < LOOKUP_CNT; i++) {
+		uid = (i % USER_CNT) * 7;
+		(void) slurmdb_get_user_used_limits(usage, uid, TRES_CNT);
+	}
+	usec = _delta_usec(&start);
+	printf("NOTE: %d users, indexed lookups per sec: %.0f\n",
+	       USER_CNT, LOOKUP_CNT * 1000000.0 / (usec ? usec : 1));
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < SCAN_CNT; i++) {
+		uid = ((i * 37) % USER_CNT) * 7;
+		(void) list_find_first(usage->user_limit_list, _find_user,
+				       &uid);
+	}
+	usec = _delta_usec(&start);
+	printf("NOTE: %d users, list scans per sec: %.0f\n",
+	       USER_CNT, SCAN_CNT * 1000000.0 / (usec ? usec : 1));
+
+	slurmdb_destroy_qos_usage(usage);
+
+	totals();
+	return failed;
+}